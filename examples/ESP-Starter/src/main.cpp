@@ -6,65 +6,81 @@ terms of the Do What The Fuck You Want To Public License, Version 2,
 as published by Sam Hocevar. See the COPYING file for more details.
 ****************************************************************************/
 #include "main.h"
+#include "bs_assets.h"
 
 #ifdef BS_USE_TELNETSPY
-void setExtraRemoteCommands(char c) {
-  if (c == '?') {
-    LOG_PRINTLN(bs.builtInRemoteCommandsMenu + "G = Get Station ID\n? = This menu\n");
-  }
-  if (c == 'G') {
-    LOG_PRINTF("\nStation ID = [%s]\n", my_config.station_id);
-  }
+void getStationId(int argc, char **argv) {
+  LOG_PRINTF("\nStation ID = [%s]\n", my_config.station_id);
 }
 #endif
-void updateExtraConfigItem(const String item, String value) {
-    if (item == "station_id") {
-        memset(my_config.station_id, CFG_NOT_SET, WIFI_SSID_LEN);
-        if (value.length() > 0) {
-            value.toCharArray(my_config.station_id, STATION_ID_LEN);
+void updateExtraConfigItem(const char *item, const char *value) {
+    if (strcmp(item, "station_id") == 0) {
+        memset(my_config.station_id, CFG_NOT_SET, STATION_ID_LEN);
+        if (strlen(value) > 0) {
+            strncpy(my_config.station_id, value, STATION_ID_LEN - 1);
             my_config.station_id_flag = CFG_SET;
         } else {
             my_config.station_id_flag = CFG_NOT_SET;
         }
+        bs.publish("station_id", my_config.station_id);
         return;
     }
 }
-void updateExtraHtmlTemplateItems(String *html) {
-  while (html->indexOf("{station_id}", 0) != -1) {
-    html->replace("{station_id}", String(my_config.station_id));
-  }
+const char* updateExtraHtmlTemplateItems(const char *token) {
+  if (strcmp(token, "station_id") == 0) return my_config.station_id;
+  return NULL;
 }
 
 void setup() {
   #ifdef BS_USE_TELNETSPY
-    bs.setExtraRemoteCommands(setExtraRemoteCommands);
+    bs.addRemoteCommand("G", "Get Station ID", getStationId);
   #endif
 
   bs.setConfig(&my_config, sizeof(my_config));
   bs.updateExtraConfigItem(updateExtraConfigItem);
   bs.updateExtraHtmlTemplateItems(updateExtraHtmlTemplateItems);
+  bs.addConfigItem("station_id", STATION_ID_LEN - 1);
+  bs.useAssets(bs_assets, BS_ASSET_COUNT);
+  // a sensor that must report quickly can leave littlefs, ota and the web
+  // server until after its first reading
+  // bs.useFastBoot();
+  // readings can be forwarded too -- try it against tools/bs_telemetry.py
+  // bs.useTelemetry("http://192.168.1.10:8080/ingest");
   
   if (!bs.setup()) return;
 
   // initialize our extended config struct if values are not set
   if (my_config.station_id_flag != CFG_SET) {
-    String().toCharArray(my_config.station_id, STATION_ID_LEN);
+    memset(my_config.station_id, CFG_NOT_SET, STATION_ID_LEN);
   }
 
   bs.updateSetupHtml();
   bs.updateIndexHtml();
 
+  // index.html is rendered once, open pages follow these over /events
+  bs.publish("station_id", my_config.station_id);
+  bs.scheduleEvery(10000, []()
+    {
+      bs.publish("timestamp", bs.getTimestamp());
+      const IPAddress ip = bs.wifimode == WIFI_STA ? WiFi.localIP() : WiFi.softAPIP();
+      bs.publish("ip_address", ip.toString().c_str());
+    });
+
+  // keep a history of the wifi signal -- GET /ts?series=0
+  bs.scheduleEvery(60000, []()
+    {
+      bs.recordValue(0, WiFi.RSSI());
+
+      // a no-op until useTelemetry() is given an endpoint
+      BSString<64> record;
+      record.printf("{\"t\":%ld,\"rssi\":%d}", (long) time(NULL), WiFi.RSSI());
+      bs.queueTelemetry(record.c_str());
+    });
+
   // setup done
   LOG_PRINTLN("\nSystem Ready\n");
 }
 
 void loop() {
   bs.loop();
-
-  static unsigned long lastUpdate = 0;
-
-  if (millis() > 60000 && millis() - 60000 > lastUpdate) {
-    bs.updateIndexHtml();
-    lastUpdate = millis();
-  }
 }
@@ -0,0 +1,167 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ARDUINO_H
+#define BS_HOST_ARDUINO_H
+
+// host stand-in for the arduino-esp32 core -- just the part ESP-Bootstrap
+// uses, built with -DBS_HOST -Desp32 so the library takes its esp32 paths.
+// persistent state (eeprom, littlefs, rtc memory) lives under BS_HOST_DIR
+// (default ./bs_host), see host/src/main.cpp for the other knobs
+
+#include "BSPlatform.h"
+
+#include <climits>
+#include <cmath>
+#include <string>
+#include <strings.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define F(s)                          (s)
+#define HIGH                          1
+#define LOW                           0
+#define INPUT                         0
+#define OUTPUT                        1
+
+// rtc memory is a linker section the host saves across restart / deep sleep
+#define RTC_DATA_ATTR                 __attribute__((section("bs_rtc_data")))
+#define RTC_NOINIT_ATTR               __attribute__((section("bs_rtc_noinit")))
+
+inline void pinMode(uint8_t pin, uint8_t mode) { (void) pin; (void) mode; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { (void) pin; (void) value; }
+inline long random(long max) { return max > 0 ? ::random() % max : 0; }
+inline long random(long min, long max) { return max > min ? min + ::random() % (max - min) : min; }
+inline uint32_t getCpuFrequencyMhz() { return 0; }
+
+class String {
+    public:
+        String() {}
+        String(const char *s) : s(s != NULL ? s : "") {}
+        String(const std::string &s) : s(s) {}
+        String(char c) : s(1, c) {}
+        String(int n) : s(std::to_string(n)) {}
+        String(unsigned int n) : s(std::to_string(n)) {}
+        String(long n) : s(std::to_string(n)) {}
+        String(unsigned long n) : s(std::to_string(n)) {}
+
+        const char* c_str() const { return s.c_str(); }
+        unsigned int length() const { return s.length(); }
+        bool isEmpty() const { return s.empty(); }
+        char operator[](unsigned int i) const { return i < s.length() ? s[i] : '\0'; }
+
+        bool equals(const String &o) const { return s == o.s; }
+        bool equals(const char *o) const { return s == o; }
+        bool equalsIgnoreCase(const String &o) const { return strcasecmp(s.c_str(), o.c_str()) == 0; }
+        bool operator==(const String &o) const { return s == o.s; }
+        bool operator==(const char *o) const { return s == o; }
+        bool operator!=(const String &o) const { return s != o.s; }
+        bool operator!=(const char *o) const { return s != o; }
+        bool startsWith(const String &p) const { return s.compare(0, p.s.length(), p.s) == 0; }
+        bool endsWith(const String &p) const { return s.length() >= p.s.length() && s.compare(s.length() - p.s.length(), p.s.length(), p.s) == 0; }
+
+        int indexOf(char c, unsigned int from = 0) const { const size_t i = s.find(c, from); return i == std::string::npos ? -1 : (int) i; }
+        int indexOf(const String &o, unsigned int from = 0) const { const size_t i = s.find(o.s, from); return i == std::string::npos ? -1 : (int) i; }
+        int lastIndexOf(char c) const { const size_t i = s.rfind(c); return i == std::string::npos ? -1 : (int) i; }
+        String substring(unsigned int from) const { return from < s.length() ? String(s.substr(from)) : String(); }
+        String substring(unsigned int from, unsigned int to) const { return from < to && from < s.length() ? String(s.substr(from, to - from)) : String(); }
+        long toInt() const { return strtol(s.c_str(), NULL, 10); }
+        void toLowerCase() { for (char &c : s) c = tolower(c); }
+        void toCharArray(char *buf, unsigned int len) const {
+            if (len == 0) return;
+            strncpy(buf, s.c_str(), len - 1);
+            buf[len - 1] = '\0';
+        }
+
+        String& operator+=(const String &o) { s += o.s; return *this; }
+        String& operator+=(const char *o) { s += o; return *this; }
+        String& operator+=(char c) { s += c; return *this; }
+        friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+        friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+        friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+
+    private:
+        std::string s;
+};
+
+class Printable {
+    public:
+        virtual ~Printable() {}
+        virtual size_t printTo(Print &p) const = 0;
+};
+
+class IPAddress : public Printable {
+    public:
+        IPAddress() {}
+        IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{ a, b, c, d } {}
+
+        uint8_t operator[](int i) const { return octets[i]; }
+        uint8_t& operator[](int i) { return octets[i]; }
+        bool operator==(const IPAddress &o) const { return memcmp(octets, o.octets, 4) == 0; }
+        String toString() const {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+            return String(buf);
+        }
+        size_t printTo(Print &p) const override { return p.print(toString()); }
+
+    private:
+        uint8_t octets[4] = { 0, 0, 0, 0 };
+};
+
+// stdout / stdin
+class HardwareSerial : public Stream {
+    public:
+        void begin(unsigned long baud) { (void) baud; }
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *data, size_t n) override;
+        void flush() override;
+        int available() override;
+        int read() override;
+        int peek() override;
+
+    private:
+        int peeked = -1;
+};
+extern HardwareSerial Serial;
+
+// the heap is the process heap measured against a device sized budget
+#define BS_HOST_HEAP_SIZE             (320 * 1024)
+
+class EspClass {
+    public:
+        uint32_t getFreeHeap();
+        uint32_t getMinFreeHeap();
+        uint32_t getMaxAllocHeap() { return getFreeHeap(); }
+        uint32_t getHeapSize() { return BS_HOST_HEAP_SIZE; }
+
+        uint32_t getSketchSize() { return 0; }
+        String getSketchMD5() { return String(); }
+        uint32_t getFreeSketchSpace() { return 0; }
+
+        // re-executes the process, the way the device boots again
+        void restart();
+
+    private:
+        uint32_t min_free = UINT32_MAX;
+};
+extern EspClass ESP;
+
+// hardware timers run on a thread of their own
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t* timerBegin(uint8_t num, uint16_t divider, bool count_up);
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerWrite(hw_timer_t *timer, uint64_t value);
+
+// deep sleep is a re-exec after the sleep, rtc memory kept
+void esp_sleep_enable_timer_wakeup(uint64_t time_us);
+void esp_deep_sleep_start();
+#endif
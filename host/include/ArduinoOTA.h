@@ -0,0 +1,49 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ARDUINO_OTA_H
+#define BS_HOST_ARDUINO_OTA_H
+
+#include <Arduino.h>
+
+#define U_FLASH                       0
+#define U_SPIFFS                      100
+
+typedef enum {
+    OTA_AUTH_ERROR,
+    OTA_BEGIN_ERROR,
+    OTA_CONNECT_ERROR,
+    OTA_RECEIVE_ERROR,
+    OTA_END_ERROR
+} ota_error_t;
+
+// espota has nothing to talk to on the host -- the handlers are kept and
+// never called
+class ArduinoOTAClass {
+    public:
+        typedef std::function<void(void)> THandlerFunction;
+        typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+        typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+        void setHostname(const char *name) { (void) name; }
+        void onStart(THandlerFunction fn) { start_cb = fn; }
+        void onEnd(THandlerFunction fn) { end_cb = fn; }
+        void onError(THandlerFunction_Error fn) { error_cb = fn; }
+        void onProgress(THandlerFunction_Progress fn) { progress_cb = fn; }
+        void begin() {}
+        void end() {}
+        void handle() {}
+        int getCommand() { return U_FLASH; }
+
+    private:
+        THandlerFunction start_cb;
+        THandlerFunction end_cb;
+        THandlerFunction_Error error_cb;
+        THandlerFunction_Progress progress_cb;
+};
+extern ArduinoOTAClass ArduinoOTA;
+#endif
@@ -0,0 +1,80 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ASYNC_TCP_H
+#define BS_HOST_ASYNC_TCP_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+// what lwip would take before send() -- TCP_SND_BUF on the esp32
+#define BS_HOST_TCP_SND_BUF           5744
+
+class AsyncClient;
+
+typedef std::function<void(void *arg, AsyncClient *client)> AcConnectHandler;
+typedef std::function<void(void *arg, AsyncClient *client, void *data, size_t len)> AcDataHandler;
+typedef std::function<void(void *arg, AsyncClient *client, int8_t error)> AcErrorHandler;
+typedef std::function<void(void *arg, AsyncClient *client, uint32_t time)> AcTimeoutHandler;
+
+// an outbound tcp connection on a socket -- connect() returns at once and
+// a thread of its own (the "tcp task") runs the callbacks.  the server
+// stand-in hands requests one that only knows its peer
+class AsyncClient {
+    public:
+        AsyncClient() {}
+        AsyncClient(const IPAddress &remote, const uint16_t port) : remote_ip(remote), remote_port(port) {}
+        ~AsyncClient();
+
+        bool connect(const char *host, uint16_t port);
+        bool connect(const IPAddress &ip, uint16_t port) { return connect(ip.toString().c_str(), port); }
+        void close(bool now = false);
+        bool connected() { return is_connected; }
+
+        size_t space() { return is_connected && out.length() < BS_HOST_TCP_SND_BUF ? BS_HOST_TCP_SND_BUF - out.length() : 0; }
+        size_t add(const char *data, size_t size, uint8_t flags = 0);
+        bool send();
+        size_t write(const char *data) { return write(data, strlen(data)); }
+        size_t write(const char *data, size_t size) { const size_t n = add(data, size); send(); return n; }
+
+        void onConnect(AcConnectHandler cb, void *arg = NULL) { connect_cb = cb; connect_arg = arg; }
+        void onDisconnect(AcConnectHandler cb, void *arg = NULL) { disconnect_cb = cb; disconnect_arg = arg; }
+        void onData(AcDataHandler cb, void *arg = NULL) { data_cb = cb; data_arg = arg; }
+        void onError(AcErrorHandler cb, void *arg = NULL) { error_cb = cb; error_arg = arg; }
+        void onTimeout(AcTimeoutHandler cb, void *arg = NULL) { timeout_cb = cb; timeout_arg = arg; }
+        void setRxTimeout(uint32_t timeout_s) { rx_timeout_s = timeout_s; }
+
+        IPAddress remoteIP() { return remote_ip; }
+        uint16_t remotePort() { return remote_port; }
+
+    private:
+        void run(const std::string host, const uint16_t port);
+
+        std::thread worker;
+        std::atomic<int> fd { -1 };
+        std::atomic<bool> closing { false };
+        std::atomic<bool> is_connected { false };
+        std::string out;
+        uint32_t rx_timeout_s = 0;
+
+        IPAddress remote_ip;
+        uint16_t remote_port = 0;
+
+        AcConnectHandler connect_cb;
+        AcConnectHandler disconnect_cb;
+        AcDataHandler data_cb;
+        AcErrorHandler error_cb;
+        AcTimeoutHandler timeout_cb;
+        void *connect_arg = NULL;
+        void *disconnect_arg = NULL;
+        void *data_arg = NULL;
+        void *error_arg = NULL;
+        void *timeout_arg = NULL;
+};
+#endif
@@ -0,0 +1,46 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_H
+#define BS_HOST_H
+
+#include <Arduino.h>
+#include <string>
+
+// the process side of the host build, configured from the environment
+//
+//   BS_HOST_DIR           eeprom, littlefs and rtc memory (./bs_host)
+//   BS_HOST_FS_IMAGE      seeds an empty littlefs, like uploadfs
+//   BS_HOST_PORT_OFFSET   added to ports below 1024 (8000) -- :80 is :8080
+//   BS_HOST_WIFI_SCAN     ssid:rssi[:password],... the scan sees
+//   BS_HOST_WIFI_DROP_MS  the station link drops this long after connecting
+//   BS_HOST_LOOPS         loop() passes before exiting (0 -- until signalled)
+//   BS_HOST_RESET_REASON  set across a restart / deep sleep re-exec
+//   BS_HOST_CORES         the cpu count BS_USE_DUAL_CORE sees (BSPlatform.h)
+
+void bs_host_init(int argc, char **argv);
+bool bs_host_running();
+void bs_host_stop();
+
+std::string bs_host_path(const char *name);
+uint16_t bs_host_port(const uint16_t port);
+long bs_host_env(const char *name, const long fallback);
+
+// rtc memory survives a restart (noinit) or a deep sleep (data and noinit)
+void bs_host_save_rtc(const bool data);
+void bs_host_restore_rtc(const bool data);
+
+// replaces the process, the way the device boots again
+void bs_host_reexec(const int reset_reason);
+
+// a test's scratch device -- BS_HOST_DIR a fresh /tmp/bs_<prefix>_XXXXXX
+// unless one is set, littlefs seeded from data (the tests get the
+// example's as BS_HOST_TEST_DATA), then setConfig() and setup()
+class Bootstrap;
+void bs_host_test_dir(const char *prefix);
+bool bs_host_test_setup(Bootstrap *bs, void *cfg, const short size, const char *prefix, const char *data);
+#endif
@@ -0,0 +1,34 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_EEPROM_H
+#define BS_HOST_EEPROM_H
+
+#include <Arduino.h>
+#include <vector>
+
+// eeprom in BS_HOST_DIR/eeprom.bin -- erased flash (0xff) past its end,
+// written back on commit() only, like the flash sector behind the real one
+class EEPROMClass {
+    public:
+        bool begin(size_t size);
+        uint8_t read(int address);
+        void write(int address, uint8_t value);
+        bool commit();
+        void end();
+        size_t length() { return data.size(); }
+
+        // how often commit() actually wrote -- flash wear, in effect
+        uint32_t commits() { return commit_count; }
+
+    private:
+        std::vector<uint8_t> data;
+        bool dirty = false;
+        uint32_t commit_count = 0;
+};
+extern EEPROMClass EEPROM;
+#endif
@@ -0,0 +1,342 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ESP_ASYNC_WEB_SERVER_H
+#define BS_HOST_ESP_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <FS.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the part of ESPAsyncWebServer the library uses, on plain sockets
+//
+// one thread accepts and serves connections one at a time, the way the
+// async_tcp task runs every callback on the device -- handlers, upload and
+// body callbacks and the response fillers never run concurrently with
+// each other, only with loop().  HTTP/1.1 with Connection: close, a body
+// needs a Content-Length.  urlencoded forms become post parameters,
+// multipart parts go to the upload handler, anything else to the body
+// handler, in chunks no larger than a tcp segment
+
+#define BS_HOST_WEB_SEGMENT           1436
+#define BS_HOST_WEB_HEAD_MAX          8192
+#define BS_HOST_WEB_BODY_MAX          (16 * 1024 * 1024)
+#define BS_HOST_WEB_TIMEOUT_MS        5000
+#define RESPONSE_TRY_AGAIN            0xFFFFFFFF
+
+typedef enum {
+    HTTP_GET     = 0b00000001,
+    HTTP_POST    = 0b00000010,
+    HTTP_DELETE  = 0b00000100,
+    HTTP_PUT     = 0b00001000,
+    HTTP_PATCH   = 0b00010000,
+    HTTP_HEAD    = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY     = 0b01111111
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+typedef std::function<size_t(uint8_t *buffer, size_t max_len, size_t index)> AwsResponseFiller;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+
+class AsyncWebParameter {
+    public:
+        AsyncWebParameter(const String &name, const String &value, bool form = false, bool file = false, size_t size = 0)
+            : _name(name), _value(value), _size(size), _isForm(form), _isFile(file) {}
+        const String &name() const { return _name; }
+        const String &value() const { return _value; }
+        size_t size() const { return _size; }
+        bool isPost() const { return _isForm; }
+        bool isFile() const { return _isFile; }
+
+    private:
+        String _name;
+        String _value;
+        size_t _size;
+        bool _isForm;
+        bool _isFile;
+};
+
+class AsyncWebHeader {
+    public:
+        AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+        const String &name() const { return _name; }
+        const String &value() const { return _value; }
+
+    private:
+        String _name;
+        String _value;
+};
+
+class AsyncWebServerResponse {
+    public:
+        virtual ~AsyncWebServerResponse() {}
+        void setCode(int code) { _code = code; }
+        void setContentLength(size_t len) { _contentLength = len; }
+        void setContentType(const String &type) { _contentType = type; }
+        void addHeader(const String &name, const String &value) { _headers.push_back(AsyncWebHeader(name, value)); }
+
+        // host side -- the server drains fill() until it returns 0
+        int code() const { return _code; }
+        bool chunked() const { return _chunked; }
+        const String &contentType() const { return _contentType; }
+        int64_t contentLength() const { return _contentLength; }
+        const std::vector<AsyncWebHeader> &headers() const { return _headers; }
+        virtual size_t fill(uint8_t *buffer, size_t max_len, size_t index) = 0;
+
+    protected:
+        int _code = 200;
+        String _contentType;
+        int64_t _contentLength = 0;
+        bool _chunked = false;
+        std::vector<AsyncWebHeader> _headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse {
+    public:
+        AsyncBasicResponse(int code, const String &contentType = String(), const String &content = String());
+        size_t fill(uint8_t *buffer, size_t max_len, size_t index) override;
+
+    private:
+        String _content;
+};
+
+class AsyncProgmemResponse : public AsyncWebServerResponse {
+    public:
+        AsyncProgmemResponse(int code, const String &contentType, const uint8_t *content, size_t len);
+        size_t fill(uint8_t *buffer, size_t max_len, size_t index) override;
+
+    private:
+        const uint8_t *_content;
+};
+
+class AsyncFileResponse : public AsyncWebServerResponse {
+    public:
+        AsyncFileResponse(FS &fs, const String &path, const String &contentType = String(), bool download = false);
+        AsyncFileResponse(File content, const String &path, const String &contentType = String(), bool download = false);
+        size_t fill(uint8_t *buffer, size_t max_len, size_t index) override;
+
+    private:
+        void setup(const String &path, const String &contentType, bool download);
+        File _content;
+};
+
+class AsyncCallbackResponse : public AsyncWebServerResponse {
+    public:
+        AsyncCallbackResponse(const String &contentType, size_t len, AwsResponseFiller callback, bool chunked = false);
+        size_t fill(uint8_t *buffer, size_t max_len, size_t index) override;
+
+    private:
+        AwsResponseFiller _callback;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+    public:
+        using Print::write;
+
+        AsyncResponseStream(const String &contentType, size_t bufferSize);
+        size_t write(uint8_t c) override { _content.push_back((char) c); _contentLength = _content.length(); return 1; }
+        size_t write(const uint8_t *data, size_t n) override { _content.append((const char *) data, n); _contentLength = _content.length(); return n; }
+        size_t fill(uint8_t *buffer, size_t max_len, size_t index) override;
+
+    private:
+        std::string _content;
+};
+
+class AsyncWebServerRequest {
+    friend class AsyncWebServer;
+
+    public:
+        AsyncWebServerRequest(AsyncWebServer *server, const IPAddress &remote, const uint16_t port);
+        ~AsyncWebServerRequest();
+
+        void *_tempObject = NULL;
+
+        AsyncClient *client() { return &_client; }
+        WebRequestMethodComposite method() const { return _method; }
+        const String &url() const { return _url; }
+        const String &contentType() const { return _contentType; }
+        size_t contentLength() const { return _contentLength; }
+
+        size_t params() const { return _params.size(); }
+        bool hasParam(const String &name, bool post = false, bool file = false) const { return getParam(name, post, file) != NULL; }
+        const AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) const;
+        const AsyncWebParameter *getParam(size_t num) const { return num < _params.size() ? &_params[num] : NULL; }
+
+        size_t headers() const { return _headers.size(); }
+        bool hasHeader(const String &name) const { return getHeader(name) != NULL; }
+        const AsyncWebHeader *getHeader(const String &name) const;
+
+        void onDisconnect(ArDisconnectHandler fn) { _onDisconnect = fn; }
+
+        AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String());
+        AsyncWebServerResponse *beginResponse(FS &fs, const String &path, const String &contentType = String(), bool download = false);
+        AsyncWebServerResponse *beginResponse(File content, const String &path, const String &contentType = String(), bool download = false);
+        AsyncWebServerResponse *beginResponse(const String &contentType, size_t len, AwsResponseFiller callback);
+        AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller callback);
+        AsyncWebServerResponse *beginResponse_P(int code, const String &contentType, const uint8_t *content, size_t len);
+        AsyncResponseStream *beginResponseStream(const String &contentType, size_t bufferSize = 1460);
+
+        void send(AsyncWebServerResponse *response);
+        void send(int code, const String &contentType = String(), const String &content = String()) { send(beginResponse(code, contentType, content)); }
+        void send(FS &fs, const String &path, const String &contentType = String(), bool download = false) { send(beginResponse(fs, path, contentType, download)); }
+        void redirect(const String &url);
+
+    private:
+        AsyncWebServer *_server;
+        AsyncClient _client;
+        WebRequestMethodComposite _method = HTTP_GET;
+        String _url;
+        String _contentType;
+        size_t _contentLength = 0;
+        std::vector<AsyncWebParameter> _params;
+        std::vector<AsyncWebHeader> _headers;
+        AsyncWebServerResponse *_response = NULL;
+        ArDisconnectHandler _onDisconnect;
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebHandler {
+    public:
+        virtual ~AsyncWebHandler() {}
+        virtual bool canHandle(AsyncWebServerRequest *request) { (void) request; return false; }
+        virtual void handleRequest(AsyncWebServerRequest *request) { (void) request; }
+        virtual void handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
+            (void) request; (void) filename; (void) index; (void) data; (void) len; (void) final;
+        }
+        virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            (void) request; (void) data; (void) len; (void) index; (void) total;
+        }
+        // host side -- a handler that keeps the connection (server sent
+        // events), and a hook the server thread calls between connections
+        virtual bool adopt(AsyncWebServerRequest *request, int fd) { (void) request; (void) fd; return false; }
+        virtual void tick() {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+    public:
+        AsyncCallbackWebHandler(const String &uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody)
+            : _uri(uri), _method(method), _onRequest(onRequest), _onUpload(onUpload), _onBody(onBody) {}
+
+        bool canHandle(AsyncWebServerRequest *request) override;
+        void handleRequest(AsyncWebServerRequest *request) override { if (_onRequest) _onRequest(request); else request->send(500); }
+        void handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) override {
+            if (_onUpload) _onUpload(request, filename, index, data, len, final);
+        }
+        void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override {
+            if (_onBody) _onBody(request, data, len, index, total);
+        }
+
+    private:
+        String _uri;
+        WebRequestMethodComposite _method;
+        ArRequestHandlerFunction _onRequest;
+        ArUploadHandlerFunction _onUpload;
+        ArBodyHandlerFunction _onBody;
+};
+
+class AsyncEventSource;
+
+class AsyncEventSourceClient {
+    public:
+        AsyncEventSourceClient(AsyncEventSource *server, int fd, const IPAddress &remote);
+        ~AsyncEventSourceClient();
+
+        void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+        void close();
+        bool connected() const { return _fd >= 0; }
+        uint32_t lastId() const { return _lastId; }
+        size_t packetsWaiting() const { return 0; }
+        AsyncClient *client() { return &_client; }
+
+    private:
+        friend class AsyncEventSource;
+        bool write(const std::string &data);
+
+        AsyncEventSource *_server;
+        int _fd;
+        uint32_t _lastId = 0;
+        AsyncClient _client;
+};
+
+typedef std::function<void(AsyncEventSourceClient *client)> ArEventHandlerFunction;
+
+// every client socket is written straight from send(), a client that
+// cannot take the message is dropped rather than queued
+class AsyncEventSource : public AsyncWebHandler {
+    public:
+        AsyncEventSource(const String &url) : _url(url) {}
+        ~AsyncEventSource();
+
+        const char *url() const { return _url.c_str(); }
+        void onConnect(ArEventHandlerFunction cb) { _connectcb = cb; }
+        void close();
+        void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+        size_t count();
+        size_t avgPacketsWaiting() const { return 0; }
+
+        bool canHandle(AsyncWebServerRequest *request) override;
+        bool adopt(AsyncWebServerRequest *request, int fd) override;
+        void tick() override;
+
+    private:
+        void prune();
+
+        String _url;
+        std::mutex _lock;
+        std::vector<AsyncEventSourceClient *> _clients;
+        ArEventHandlerFunction _connectcb;
+};
+
+class AsyncWebServer {
+    public:
+        AsyncWebServer(uint16_t port) : _port(port) {}
+        ~AsyncWebServer();
+
+        void begin();
+        void end();
+
+        AsyncCallbackWebHandler &on(const char *uri, ArRequestHandlerFunction onRequest) { return on(uri, HTTP_ANY, onRequest); }
+        AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                    ArUploadHandlerFunction onUpload = NULL, ArBodyHandlerFunction onBody = NULL);
+        AsyncWebHandler &addHandler(AsyncWebHandler *handler);
+        void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+
+        // host side -- the port actually listened on
+        uint16_t port() const { return _boundPort; }
+
+    private:
+        void run();
+        void serve(const int fd, const IPAddress &remote, const uint16_t remote_port);
+        AsyncWebHandler *find(AsyncWebServerRequest *request);
+        bool readBody(const int fd, AsyncWebServerRequest *request, AsyncWebHandler *handler, std::string &pending);
+        void parseForm(AsyncWebServerRequest *request, const std::string &body);
+        void parseMultipart(AsyncWebServerRequest *request, AsyncWebHandler *handler, const std::string &body, const String &boundary);
+        void respond(const int fd, AsyncWebServerRequest *request);
+
+        uint16_t _port;
+        uint16_t _boundPort = 0;
+        int _listen = -1;
+        std::atomic<bool> _running { false };
+        std::thread _thread;
+        std::vector<AsyncWebHandler *> _handlers;
+        std::vector<AsyncCallbackWebHandler *> _owned;
+        ArRequestHandlerFunction _notFound;
+};
+#endif
@@ -0,0 +1,29 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ELEGANT_OTA_H
+#define BS_HOST_ELEGANT_OTA_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// /update is not served on the host, POST /ota covers the same ground
+class ElegantOTAClass {
+    public:
+        void begin(AsyncWebServer *server) { (void) server; }
+        void loop() {}
+        void onStart(std::function<void(void)> fn) { start_cb = fn; }
+        void onProgress(std::function<void(size_t, size_t)> fn) { progress_cb = fn; }
+        void onEnd(std::function<void(bool)> fn) { end_cb = fn; }
+
+    private:
+        std::function<void(void)> start_cb;
+        std::function<void(size_t, size_t)> progress_cb;
+        std::function<void(bool)> end_cb;
+};
+extern ElegantOTAClass ElegantOTA;
+#endif
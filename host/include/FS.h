@@ -0,0 +1,78 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_FS_H
+#define BS_HOST_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ                     "r"
+#define FILE_WRITE                    "w"
+#define FILE_APPEND                   "a"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class HostFileImpl;
+
+// a handle onto a file or directory below the mount point -- copies share
+// the same open file, like the esp32 core's
+class File : public Stream {
+    public:
+        File() {}
+        File(std::shared_ptr<HostFileImpl> impl) : impl(impl) {}
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *data, size_t n) override;
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t read(uint8_t *buf, size_t n);
+        void flush() override;
+        bool seek(uint32_t pos, SeekMode mode = SeekSet);
+        size_t position() const;
+        size_t size() const;
+        void close();
+        operator bool() const;
+
+        const char* name() const;
+        const char* path() const;
+        bool isDirectory() const;
+        File openNextFile(const char *mode = FILE_READ);
+        time_t getLastWrite();
+
+    private:
+        std::shared_ptr<HostFileImpl> impl;
+};
+
+class FS {
+    public:
+        File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+        File open(const String &path, const char *mode = FILE_READ, const bool create = false) { return open(path.c_str(), mode, create); }
+        bool exists(const char *path);
+        bool exists(const String &path) { return exists(path.c_str()); }
+        bool remove(const char *path);
+        bool remove(const String &path) { return remove(path.c_str()); }
+        bool rename(const char *from, const char *to);
+        bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+        bool mkdir(const char *path);
+        bool mkdir(const String &path) { return mkdir(path.c_str()); }
+        bool rmdir(const char *path);
+
+        // the host directory a device path maps to
+        std::string hostPath(const char *path);
+
+    protected:
+        std::string root;
+        bool mounted = false;
+};
+
+namespace fs {
+    using ::FS;
+    using ::File;
+}
+#endif
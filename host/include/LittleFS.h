@@ -0,0 +1,28 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_LITTLEFS_H
+#define BS_HOST_LITTLEFS_H
+
+#include "FS.h"
+
+// the size a 4 MB board leaves for littlefs
+#define BS_HOST_FS_SIZE               (1536 * 1024)
+
+// littlefs on a host directory -- BS_HOST_DIR/littlefs.  an empty one is
+// seeded from BS_HOST_FS_IMAGE (a data/ folder) on mount, the way
+// uploadfs would have flashed it
+class LittleFSFS : public FS {
+    public:
+        bool begin(const bool format_on_fail = false, const char *base_path = "/littlefs", const uint8_t max_open = 10, const char *label = NULL);
+        void end() { mounted = false; }
+        bool format();
+        size_t totalBytes() { return BS_HOST_FS_SIZE; }
+        size_t usedBytes();
+};
+extern LittleFSFS LittleFS;
+#endif
@@ -0,0 +1,32 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_TELNETSPY_H
+#define BS_HOST_TELNETSPY_H
+
+#include <Arduino.h>
+
+// the log and the shell go to the terminal -- there is no telnet side
+class TelnetSpy : public Stream {
+    public:
+        using Print::write;
+
+        void begin(unsigned long baud) { Serial.begin(baud); }
+        void setWelcomeMsg(const char *msg) { (void) msg; }
+        void setWelcomeMsg(const String &msg) { (void) msg; }
+        void handle() {}
+        void disconnectClient() {}
+        bool isClientConnected() { return false; }
+
+        size_t write(uint8_t c) override { return Serial.write(c); }
+        size_t write(const uint8_t *data, size_t n) override { return Serial.write(data, n); }
+        void flush() override { Serial.flush(); }
+        int available() override { return Serial.available(); }
+        int read() override { return Serial.read(); }
+        int peek() override { return Serial.peek(); }
+};
+#endif
@@ -0,0 +1,39 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_UPDATE_H
+#define BS_HOST_UPDATE_H
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN           0xFFFFFFFF
+#ifndef U_FLASH
+    #define U_FLASH                   0
+    #define U_SPIFFS                  100
+#endif
+
+// the "ota partition" is BS_HOST_DIR/firmware.bin -- written to a temp
+// file and renamed into place only when end(true) succeeds
+class UpdateClass {
+    public:
+        bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH);
+        size_t write(uint8_t *data, size_t len);
+        bool end(bool even_if_remaining = false);
+        void abort();
+        bool isRunning() { return file != NULL; }
+        bool hasError() { return failed; }
+        size_t progress() { return written; }
+        const char *errorString() { return failed ? "write failed" : "no error"; }
+
+    private:
+        FILE *file = NULL;
+        size_t expected = 0;
+        size_t written = 0;
+        bool failed = false;
+};
+extern UpdateClass Update;
+#endif
@@ -0,0 +1,116 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_WIFI_H
+#define BS_HOST_WIFI_H
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } WiFiMode_t;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+    WIFI_EVENT_WIFI_READY = 0,
+    WIFI_EVENT_SCAN_DONE,
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_STOP,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+    WIFI_EVENT_MAX = 32,
+} wifi_event_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_SCAN_DONE,
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_MAX = 32,
+} WiFiEvent_t;
+
+typedef union {
+    struct { uint8_t reason; } wifi_sta_disconnected;
+} WiFiEventInfo_t;
+
+typedef int WiFiEventId_t;
+typedef std::function<void(WiFiEvent_t event, WiFiEventInfo_t info)> WiFiEventFuncCb;
+
+// a simulated radio -- the scan sees what BS_HOST_WIFI_SCAN lists
+// (ssid:rssi[:password],...) or hostScan() sets, a station joins any of
+// those whose password matches and gets the loopback address.  the link
+// drops BS_HOST_WIFI_DROP_MS after joining, or on hostDisconnect(), and
+// the disconnect event fires from a thread of its own like the esp32
+// event task
+class WiFiClass {
+    public:
+        void persistent(bool persistent) { (void) persistent; }
+        void setAutoConnect(bool enabled) { (void) enabled; }
+        void setAutoReconnect(bool enabled) { (void) enabled; }
+        bool setSleep(bool enabled) { (void) enabled; return true; }
+        void hostname(const char *name) { (void) name; }
+        bool mode(WiFiMode_t m);
+        WiFiMode_t getMode() { return wifi_mode; }
+
+        WiFiEventId_t onEvent(WiFiEventFuncCb cb, WiFiEvent_t event = ARDUINO_EVENT_MAX);
+
+        int16_t scanNetworks();
+        String SSID(uint8_t i);
+        String SSID() { return connected_ssid; }
+        int32_t RSSI(uint8_t i);
+        int8_t RSSI();
+        uint8_t* BSSID(uint8_t i);
+
+        wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true);
+        wl_status_t status() { return wifi_status; }
+        bool isConnected() { return wifi_status == WL_CONNECTED; }
+        bool disconnect(bool wifioff = false, bool eraseap = false);
+        IPAddress localIP();
+
+        bool softAP(const char *ssid, const char *passphrase = NULL);
+        IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+
+        // scripting -- "ssid:rssi[:password],..." and a dropped link
+        void hostScan(const char *spec);
+        void hostDisconnect(const uint8_t reason = 8);
+
+    private:
+        typedef struct {
+            String ssid;
+            int32_t rssi;
+            String password;
+            uint8_t bssid[6];
+        } HOST_NETWORK_TYPE;
+
+        typedef struct {
+            WiFiEventFuncCb cb;
+            WiFiEvent_t event;
+        } HOST_HANDLER_TYPE;
+
+        void fire(WiFiEvent_t event, WiFiEventInfo_t info);
+
+        std::vector<HOST_NETWORK_TYPE> networks;
+        bool scripted = false;
+        std::vector<HOST_HANDLER_TYPE> handlers;
+        volatile WiFiMode_t wifi_mode = WIFI_OFF;
+        volatile wl_status_t wifi_status = WL_IDLE_STATUS;
+        String connected_ssid;
+        int8_t connected_rssi = 0;
+        uint32_t link = 0;
+};
+extern WiFiClass WiFi;
+#endif
@@ -0,0 +1,28 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ESP_HEAP_CAPS_H
+#define BS_HOST_ESP_HEAP_CAPS_H
+
+#include <cstdint>
+#include <cstddef>
+
+#define MALLOC_CAP_DEFAULT            (1 << 12)
+
+typedef struct multi_heap_info_t {
+    size_t total_free_bytes;
+    size_t total_allocated_bytes;
+    size_t largest_free_block;
+    size_t minimum_free_bytes;
+    size_t allocated_blocks;
+    size_t free_blocks;
+    size_t total_blocks;
+} multi_heap_info_t;
+
+// from mallinfo2 -- allocated_blocks counts malloc's in-use chunks
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps);
+#endif
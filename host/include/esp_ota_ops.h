@@ -0,0 +1,14 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ESP_OTA_OPS_H
+#define BS_HOST_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+inline const esp_partition_t *esp_ota_get_running_partition() { return NULL; }
+#endif
@@ -0,0 +1,26 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ESP_PARTITION_H
+#define BS_HOST_ESP_PARTITION_H
+
+#include <cstdint>
+#include <cstddef>
+#include "esp_err.h"
+
+// there is no running image to read back -- delta patches fail cleanly
+typedef struct esp_partition_t {
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    (void) partition; (void) src_offset; (void) dst; (void) size;
+    return ESP_FAIL;
+}
+#endif
@@ -0,0 +1,14 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ESP_TASK_WDT_H
+#define BS_HOST_ESP_TASK_WDT_H
+
+#include "esp_err.h"
+
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+#endif
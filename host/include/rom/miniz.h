@@ -0,0 +1,42 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_MINIZ_H
+#define BS_HOST_MINIZ_H
+
+#include <cstdint>
+#include <cstddef>
+#include <zlib.h>
+
+// the rom's tinfl, raw deflate only, on top of zlib.  zlib allocates out
+// of an arena inside the decompressor so free() on it releases everything,
+// the same as the rom's fixed size struct
+#define TINFL_LZ_DICT_SIZE            32768
+#define TINFL_FLAG_HAS_MORE_INPUT     2
+#define TINFL_ARENA_LEN               (48 * 1024)
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct tinfl_decompressor {
+    z_stream zs;
+    bool ready;
+    size_t arena_used;
+    uint8_t arena[TINFL_ARENA_LEN];
+} tinfl_decompressor;
+
+void tinfl_init(tinfl_decompressor *r);
+// out_buf_next must lie in [out_buf_start, out_buf_start + TINFL_LZ_DICT_SIZE)
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in_buf_next, size_t *in_buf_size,
+                              uint8_t *out_buf_start, uint8_t *out_buf_next, size_t *out_buf_size, const uint32_t flags);
+#endif
@@ -0,0 +1,20 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HOST_ROM_RTC_H
+#define BS_HOST_ROM_RTC_H
+
+typedef enum {
+    NO_MEAN = 0,
+    POWERON_RESET = 1,
+    DEEPSLEEP_RESET = 5,
+    SW_CPU_RESET = 12,
+} RESET_REASON;
+
+// BS_HOST_RESET_REASON, set by the re-exec behind a restart or deep sleep
+RESET_REASON rtc_get_reset_reason(int cpu_no);
+#endif
@@ -0,0 +1,130 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "AsyncTCP.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// lwip's err_t for a connection that never came up
+#define BS_HOST_ERR_CONN              -14
+
+AsyncClient::~AsyncClient() {
+    close(true);
+    if (worker.joinable()) worker.join();
+}
+
+bool AsyncClient::connect(const char *host, uint16_t port) {
+    // one connection at a time, and never from its own callbacks
+    if (worker.joinable()) {
+        if (worker.get_id() == std::this_thread::get_id()) return false;
+        worker.join();
+    }
+
+    closing = false;
+    is_connected = false;
+    out.clear();
+    worker = std::thread(&AsyncClient::run, this, std::string(host), port);
+    return true;
+}
+
+void AsyncClient::close(bool now) {
+    (void) now;
+    closing = true;
+    const int s = fd;
+    if (s >= 0) shutdown(s, SHUT_RDWR);
+}
+
+size_t AsyncClient::add(const char *data, size_t size, uint8_t flags) {
+    (void) flags;
+    const size_t room = space();
+    const size_t n = size < room ? size : room;
+    out.append(data, n);
+    return n;
+}
+
+bool AsyncClient::send() {
+    const int s = fd;
+    if (s < 0 || !is_connected) return false;
+
+    size_t sent = 0;
+    while (sent < out.length()) {
+        const ssize_t n = ::send(s, out.data() + sent, out.length() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
+    }
+    const bool all = sent == out.length();
+    out.clear();
+    return all;
+}
+
+void AsyncClient::run(const std::string host, const uint16_t port) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    struct addrinfo *res = NULL;
+    int s = -1;
+    if (getaddrinfo(host.c_str(), service, &hints, &res) == 0 && res != NULL) {
+        s = socket(res->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (s >= 0) {
+            fd = s;
+            if (::connect(s, res->ai_addr, res->ai_addrlen) == 0 && !closing) {
+                const struct sockaddr_in *addr = (const struct sockaddr_in *) res->ai_addr;
+                const uint8_t *ip = (const uint8_t *) &addr->sin_addr.s_addr;
+                remote_ip = IPAddress(ip[0], ip[1], ip[2], ip[3]);
+                remote_port = port;
+                is_connected = true;
+            }
+        }
+        freeaddrinfo(res);
+    }
+
+    if (!is_connected) {
+        fd = -1;
+        if (s >= 0) ::close(s);
+        if (error_cb) error_cb(error_arg, this, BS_HOST_ERR_CONN);
+        if (disconnect_cb) disconnect_cb(disconnect_arg, this);
+        return;
+    }
+
+    if (connect_cb) connect_cb(connect_arg, this);
+
+    uint32_t idle_ms = 0;
+    char buf[1460];
+    while (!closing) {
+        struct pollfd pfd = { s, POLLIN, 0 };
+        const int ready = poll(&pfd, 1, 100);
+        if (ready < 0) break;
+
+        if (ready == 0) {
+            idle_ms += 100;
+            if (rx_timeout_s > 0 && idle_ms >= rx_timeout_s * 1000) {
+                idle_ms = 0;
+                if (timeout_cb) timeout_cb(timeout_arg, this, rx_timeout_s * 1000);
+            }
+            continue;
+        }
+
+        const ssize_t n = recv(s, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        idle_ms = 0;
+        if (data_cb) data_cb(data_arg, this, buf, n);
+    }
+
+    is_connected = false;
+    fd = -1;
+    ::close(s);
+    if (disconnect_cb) disconnect_cb(disconnect_arg, this);
+}
@@ -0,0 +1,371 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSHost.h"
+#include "Bootstrap.h"
+#include <rom/rtc.h>
+#include <esp_heap_caps.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include <atomic>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static char **host_argv = NULL;
+static volatile sig_atomic_t host_running = 1;
+static RESET_REASON reset_reason = POWERON_RESET;
+static uint64_t sleep_us = 0;
+
+// the linker brackets each rtc section -- weak, a binary may have neither
+extern char __start_bs_rtc_data[] __attribute__((weak));
+extern char __stop_bs_rtc_data[] __attribute__((weak));
+extern char __start_bs_rtc_noinit[] __attribute__((weak));
+extern char __stop_bs_rtc_noinit[] __attribute__((weak));
+
+// every allocation in the process counted on its way to glibc's malloc --
+// what bs_alloc_count() and allocated_blocks report.  the sanitizers bring
+// their own malloc, so under them nothing is counted
+#if defined(__SANITIZE_ADDRESS__)
+    #define BS_HOST_COUNT_ALLOCS      0
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define BS_HOST_COUNT_ALLOCS  0
+    #endif
+#endif
+#ifndef BS_HOST_COUNT_ALLOCS
+    #define BS_HOST_COUNT_ALLOCS      1
+#endif
+
+#if BS_HOST_COUNT_ALLOCS
+    static std::atomic<uint64_t> host_allocs(0);
+    static std::atomic<uint64_t> host_frees(0);
+    // per thread as well, so a measurement sees its own thread's and not
+    // the web server's running alongside it
+    static __thread uint64_t thread_allocs = 0;
+
+    extern "C" {
+        void* __libc_malloc(size_t size);
+        void* __libc_calloc(size_t n, size_t size);
+        void* __libc_realloc(void *p, size_t size);
+        void* __libc_memalign(size_t alignment, size_t size);
+        void __libc_free(void *p);
+
+        static void* counted(void *p) {
+            if (p == NULL) return p;
+            host_allocs.fetch_add(1, std::memory_order_relaxed);
+            thread_allocs++;
+            return p;
+        }
+
+        void* malloc(size_t size) { return counted(__libc_malloc(size)); }
+        void* calloc(size_t n, size_t size) { return counted(__libc_calloc(n, size)); }
+        void* memalign(size_t alignment, size_t size) { return counted(__libc_memalign(alignment, size)); }
+        void* aligned_alloc(size_t alignment, size_t size) { return counted(__libc_memalign(alignment, size)); }
+
+        int posix_memalign(void **out, size_t alignment, size_t size) {
+            void *p = counted(__libc_memalign(alignment, size));
+            if (p == NULL) return ENOMEM;
+            *out = p;
+            return 0;
+        }
+
+        // a resize is neither, realloc(NULL) allocates and realloc(p, 0) frees
+        void* realloc(void *p, size_t size) {
+            if (p == NULL) return malloc(size);
+            if (size == 0) {
+                free(p);
+                return NULL;
+            }
+            return __libc_realloc(p, size);
+        }
+
+        void free(void *p) {
+            if (p == NULL) return;
+            host_frees.fetch_add(1, std::memory_order_relaxed);
+            __libc_free(p);
+        }
+
+        uint64_t bs_host_alloc_count() {
+            return thread_allocs;
+        }
+    }
+#endif
+
+static void onSignal(int sig) {
+    (void) sig;
+    host_running = 0;
+}
+
+void bs_host_init(int argc, char **argv) {
+    (void) argc;
+    host_argv = argv;
+
+    // Serial is a line at a time, even into a pipe
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    const long reason = bs_host_env("BS_HOST_RESET_REASON", POWERON_RESET);
+    reset_reason = (RESET_REASON) reason;
+
+    mkdir(bs_host_path("").c_str(), 0755);
+
+    // a power on starts from blank rtc memory, anything else finds it kept
+    if (reset_reason == DEEPSLEEP_RESET || reset_reason == SW_CPU_RESET) {
+        bs_host_restore_rtc(true);
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+}
+
+bool bs_host_running() {
+    return host_running;
+}
+
+void bs_host_stop() {
+    host_running = 0;
+}
+
+std::string bs_host_path(const char *name) {
+    const char *dir = getenv("BS_HOST_DIR");
+    std::string path = dir != NULL && dir[0] != '\0' ? dir : "./bs_host";
+    if (name[0] != '\0') path += std::string("/") + name;
+    return path;
+}
+
+uint16_t bs_host_port(const uint16_t port) {
+    if (port >= 1024) return port;
+    return (uint16_t) (port + bs_host_env("BS_HOST_PORT_OFFSET", 8000));
+}
+
+long bs_host_env(const char *name, const long fallback) {
+    const char *value = getenv(name);
+    return value != NULL && value[0] != '\0' ? strtol(value, NULL, 10) : fallback;
+}
+
+void bs_host_test_dir(const char *prefix) {
+    if (getenv("BS_HOST_DIR") != NULL) return;
+    char dir[64];
+    snprintf(dir, sizeof(dir), "/tmp/bs_%s_XXXXXX", prefix);
+    if (mkdtemp(dir) != NULL) setenv("BS_HOST_DIR", dir, 1);
+}
+
+bool bs_host_test_setup(Bootstrap *bs, void *cfg, const short size, const char *prefix, const char *data) {
+    bs_host_test_dir(prefix);
+    setenv("BS_HOST_FS_IMAGE", data, 0);
+
+    bs->setConfig(cfg, size);
+    return bs->setup();
+}
+
+static void saveSection(const char *name, const char *start, const char *stop) {
+    if (start == NULL || stop <= start) return;
+    FILE *f = fopen(bs_host_path(name).c_str(), "wb");
+    if (f == NULL) return;
+    fwrite(start, 1, stop - start, f);
+    fclose(f);
+}
+
+static void restoreSection(const char *name, char *start, const char *stop) {
+    if (start == NULL || stop <= start) return;
+    FILE *f = fopen(bs_host_path(name).c_str(), "rb");
+    if (f == NULL) return;
+
+    // a different build may have laid the section out differently
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == stop - start) {
+        fseek(f, 0, SEEK_SET);
+        if (fread(start, 1, stop - start, f) != (size_t) (stop - start)) memset(start, 0, stop - start);
+    }
+    fclose(f);
+}
+
+void bs_host_save_rtc(const bool data) {
+    if (data) saveSection("rtc_data.bin", __start_bs_rtc_data, __stop_bs_rtc_data);
+    saveSection("rtc_noinit.bin", __start_bs_rtc_noinit, __stop_bs_rtc_noinit);
+}
+
+void bs_host_restore_rtc(const bool data) {
+    if (data) restoreSection("rtc_data.bin", __start_bs_rtc_data, __stop_bs_rtc_data);
+    restoreSection("rtc_noinit.bin", __start_bs_rtc_noinit, __stop_bs_rtc_noinit);
+}
+
+void bs_host_reexec(const int reason) {
+    fflush(stdout);
+
+    // nothing open -- listening sockets above all -- survives into the new image
+    DIR *fds = opendir("/proc/self/fd");
+    if (fds != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(fds)) != NULL) {
+            const int fd = atoi(entry->d_name);
+            if (fd > 2 && fd != dirfd(fds)) fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        closedir(fds);
+    }
+
+    char value[8];
+    snprintf(value, sizeof(value), "%d", reason);
+    setenv("BS_HOST_RESET_REASON", value, 1);
+
+    if (host_argv != NULL) execv("/proc/self/exe", host_argv);
+
+    // not started through bs_host_init() -- a test, say
+    fprintf(stderr, "\nbs_host: restart requested (reason %d), exiting\n", reason);
+    exit(0);
+}
+
+RESET_REASON rtc_get_reset_reason(int cpu_no) {
+    (void) cpu_no;
+    return reset_reason;
+}
+
+void EspClass::restart() {
+    bs_host_save_rtc(true);
+    bs_host_reexec(SW_CPU_RESET);
+}
+
+uint32_t EspClass::getFreeHeap() {
+    const struct mallinfo2 info = mallinfo2();
+    const uint32_t free_now = info.uordblks < BS_HOST_HEAP_SIZE ? BS_HOST_HEAP_SIZE - info.uordblks : 0;
+    if (free_now < min_free) min_free = free_now;
+    return free_now;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    getFreeHeap();
+    return min_free;
+}
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps) {
+    (void) caps;
+    const struct mallinfo2 mi = mallinfo2();
+    memset(info, 0, sizeof(*info));
+    info->total_free_bytes = ESP.getFreeHeap();
+    info->total_allocated_bytes = mi.uordblks;
+    info->largest_free_block = info->total_free_bytes;
+    info->minimum_free_bytes = ESP.getMinFreeHeap();
+    info->free_blocks = mi.ordblks;
+    #if BS_HOST_COUNT_ALLOCS
+        info->allocated_blocks = (size_t) (host_allocs.load(std::memory_order_relaxed) - host_frees.load(std::memory_order_relaxed));
+    #endif
+}
+
+void esp_sleep_enable_timer_wakeup(uint64_t time_us) {
+    sleep_us = time_us;
+}
+
+void esp_deep_sleep_start() {
+    bs_host_save_rtc(true);
+    fflush(stdout);
+    usleep(sleep_us);
+    bs_host_reexec(DEEPSLEEP_RESET);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t n) {
+    return fwrite(data, 1, n, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+int HardwareSerial::available() {
+    if (peeked >= 0) return 1;
+
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLIN)) return 0;
+
+    // readable at eof too -- that is not a byte
+    uint8_t c;
+    if (::read(STDIN_FILENO, &c, 1) != 1) return 0;
+    peeked = c;
+    return 1;
+}
+
+int HardwareSerial::read() {
+    if (!available()) return -1;
+    const int c = peeked;
+    peeked = -1;
+    return c;
+}
+
+int HardwareSerial::peek() {
+    return available() ? peeked : -1;
+}
+
+struct hw_timer_s {
+    pthread_t thread;
+    void (*fn)(void) = NULL;
+    uint16_t divider = 80;
+    uint64_t alarm = 0;
+    volatile bool enabled = false;
+    bool started = false;
+};
+
+static void* timerThread(void *arg) {
+    hw_timer_t *timer = (hw_timer_t *) arg;
+
+    while (true) {
+        // the apb clock is 80 MHz, divided down per timer
+        const uint64_t period_us = timer->alarm * timer->divider / 80;
+        usleep(period_us > 0 ? period_us : 1000);
+        if (timer->enabled && timer->fn != NULL) timer->fn();
+    }
+    return NULL;
+}
+
+hw_timer_t* timerBegin(uint8_t num, uint16_t divider, bool count_up) {
+    (void) num;
+    (void) count_up;
+    hw_timer_t *timer = new hw_timer_t();
+    timer->divider = divider > 0 ? divider : 1;
+    return timer;
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge) {
+    (void) edge;
+    timer->fn = fn;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload) {
+    (void) autoreload;
+    timer->alarm = alarm_value;
+}
+
+void timerAlarmEnable(hw_timer_t *timer) {
+    timer->enabled = true;
+    if (timer->started) return;
+
+    timer->started = pthread_create(&timer->thread, NULL, timerThread, timer) == 0;
+    if (timer->started) pthread_detach(timer->thread);
+}
+
+void timerWrite(hw_timer_t *timer, uint64_t value) {
+    (void) timer;
+    (void) value;
+}
+
+size_t Print::print(const String &s) {
+    return write((const uint8_t *) s.c_str(), s.length());
+}
+
+size_t Print::print(const Printable &p) {
+    return p.printTo(*this);
+}
@@ -0,0 +1,54 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "EEPROM.h"
+#include "BSHost.h"
+
+EEPROMClass EEPROM;
+
+bool EEPROMClass::begin(size_t size) {
+    data.assign(size, 0xff);
+    dirty = false;
+
+    FILE *f = fopen(bs_host_path("eeprom.bin").c_str(), "rb");
+    if (f == NULL) return true;
+    const size_t n = fread(data.data(), 1, size, f);
+    fclose(f);
+    (void) n;
+    return true;
+}
+
+uint8_t EEPROMClass::read(int address) {
+    return address >= 0 && (size_t) address < data.size() ? data[address] : 0;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    if (address < 0 || (size_t) address >= data.size() || data[address] == value) return;
+    data[address] = value;
+    dirty = true;
+}
+
+bool EEPROMClass::commit() {
+    if (!dirty) return true;
+
+    // written aside and swapped in, a crash leaves the old image whole
+    const std::string path = bs_host_path("eeprom.bin");
+    const std::string temp = path + ".tmp";
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (f == NULL) return false;
+    const bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+    if (fclose(f) != 0 || !written || rename(temp.c_str(), path.c_str()) != 0) return false;
+
+    dirty = false;
+    commit_count++;
+    return true;
+}
+
+void EEPROMClass::end() {
+    commit();
+    data.clear();
+}
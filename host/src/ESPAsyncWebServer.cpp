@@ -0,0 +1,730 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "ESPAsyncWebServer.h"
+#include "BSHost.h"
+
+#include <cerrno>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static const char *reasonPhrase(const int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 416: return "Range Not Satisfiable";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "";
+    }
+}
+
+static String contentTypeFor(const String &path) {
+    if (path.endsWith(".html") || path.endsWith(".htm")) return "text/html";
+    if (path.endsWith(".css")) return "text/css";
+    if (path.endsWith(".json")) return "application/json";
+    if (path.endsWith(".js")) return "application/javascript";
+    if (path.endsWith(".png")) return "image/png";
+    if (path.endsWith(".gif")) return "image/gif";
+    if (path.endsWith(".jpg")) return "image/jpeg";
+    if (path.endsWith(".ico")) return "image/x-icon";
+    if (path.endsWith(".svg")) return "image/svg+xml";
+    if (path.endsWith(".xml")) return "text/xml";
+    if (path.endsWith(".pdf")) return "application/pdf";
+    if (path.endsWith(".zip")) return "application/zip";
+    if (path.endsWith(".gz")) return "application/x-gzip";
+    return "text/plain";
+}
+
+static std::string urlDecode(const std::string &in, const bool plus) {
+    std::string out;
+    out.reserve(in.length());
+    for (size_t i = 0; i < in.length(); i++) {
+        if (in[i] == '%' && i + 2 < in.length() && isxdigit((unsigned char) in[i + 1]) && isxdigit((unsigned char) in[i + 2])) {
+            out.push_back((char) strtol(in.substr(i + 1, 2).c_str(), NULL, 16));
+            i += 2;
+        } else if (plus && in[i] == '+') {
+            out.push_back(' ');
+        } else {
+            out.push_back(in[i]);
+        }
+    }
+    return out;
+}
+
+static void parsePairs(std::vector<AsyncWebParameter> &params, const std::string &in, const bool form) {
+    size_t start = 0;
+    while (start < in.length()) {
+        size_t end = in.find('&', start);
+        if (end == std::string::npos) end = in.length();
+
+        const std::string pair = in.substr(start, end - start);
+        if (!pair.empty()) {
+            const size_t eq = pair.find('=');
+            const std::string name = urlDecode(pair.substr(0, eq), true);
+            const std::string value = eq == std::string::npos ? std::string() : urlDecode(pair.substr(eq + 1), true);
+            params.push_back(AsyncWebParameter(String(name), String(value), form));
+        }
+        start = end + 1;
+    }
+}
+
+// everything or nothing -- a short write ends the connection
+static bool sendAll(const int fd, const char *data, size_t len, const int flags = 0) {
+    while (len > 0) {
+        const ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL | flags);
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static String headerParam(const String &value, const char *key) {
+    const String needle = String(key) + "=";
+    const int at = value.indexOf(needle);
+    if (at < 0) return String();
+
+    unsigned int from = at + needle.length();
+    if (value[from] == '"') {
+        const int close = value.indexOf('"', from + 1);
+        return value.substring(from + 1, close < 0 ? value.length() : (unsigned int) close);
+    }
+    const int end = value.indexOf(';', from);
+    return value.substring(from, end < 0 ? value.length() : (unsigned int) end);
+}
+
+//
+// responses
+//
+AsyncBasicResponse::AsyncBasicResponse(int code, const String &contentType, const String &content) : _content(content) {
+    _code = code;
+    _contentType = contentType;
+    _contentLength = content.length();
+    if (_contentLength > 0 && _contentType.length() == 0) _contentType = "text/plain";
+}
+
+size_t AsyncBasicResponse::fill(uint8_t *buffer, size_t max_len, size_t index) {
+    if (index >= _content.length()) return 0;
+    const size_t n = _content.length() - index < max_len ? _content.length() - index : max_len;
+    memcpy(buffer, _content.c_str() + index, n);
+    return n;
+}
+
+AsyncProgmemResponse::AsyncProgmemResponse(int code, const String &contentType, const uint8_t *content, size_t len) : _content(content) {
+    _code = code;
+    _contentType = contentType;
+    _contentLength = len;
+}
+
+size_t AsyncProgmemResponse::fill(uint8_t *buffer, size_t max_len, size_t index) {
+    if (index >= (size_t) _contentLength) return 0;
+    const size_t n = _contentLength - index < max_len ? _contentLength - index : max_len;
+    memcpy(buffer, _content + index, n);
+    return n;
+}
+
+AsyncFileResponse::AsyncFileResponse(FS &fs, const String &path, const String &contentType, bool download) {
+    if (!download && !fs.exists(path) && fs.exists(path + ".gz")) {
+        _content = fs.open(path + ".gz", FILE_READ);
+        addHeader("Content-Encoding", "gzip");
+    } else {
+        _content = fs.open(path, FILE_READ);
+    }
+    setup(path, contentType, download);
+}
+
+AsyncFileResponse::AsyncFileResponse(File content, const String &path, const String &contentType, bool download) : _content(content) {
+    setup(path, contentType, download);
+}
+
+void AsyncFileResponse::setup(const String &path, const String &contentType, bool download) {
+    _code = 200;
+    _contentLength = _content ? _content.size() : 0;
+    _contentType = contentType.length() > 0 ? contentType : contentTypeFor(path);
+
+    const int slash = path.lastIndexOf('/');
+    const String name = path.substring(slash + 1);
+    addHeader("Content-Disposition", String(download ? "attachment" : "inline") + "; filename=\"" + name + "\"");
+}
+
+size_t AsyncFileResponse::fill(uint8_t *buffer, size_t max_len, size_t index) {
+    (void) index;
+    return _content ? _content.read(buffer, max_len) : 0;
+}
+
+AsyncCallbackResponse::AsyncCallbackResponse(const String &contentType, size_t len, AwsResponseFiller callback, bool chunked) : _callback(callback) {
+    _code = 200;
+    _contentType = contentType;
+    _contentLength = len;
+    _chunked = chunked;
+}
+
+size_t AsyncCallbackResponse::fill(uint8_t *buffer, size_t max_len, size_t index) {
+    return _callback ? _callback(buffer, max_len, index) : 0;
+}
+
+AsyncResponseStream::AsyncResponseStream(const String &contentType, size_t bufferSize) {
+    _code = 200;
+    _contentType = contentType;
+    _content.reserve(bufferSize);
+}
+
+size_t AsyncResponseStream::fill(uint8_t *buffer, size_t max_len, size_t index) {
+    if (index >= _content.length()) return 0;
+    const size_t n = _content.length() - index < max_len ? _content.length() - index : max_len;
+    memcpy(buffer, _content.data() + index, n);
+    return n;
+}
+
+//
+// requests
+//
+AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer *server, const IPAddress &remote, const uint16_t port)
+    : _server(server), _client(remote, port) {}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+    if (_onDisconnect) _onDisconnect();
+    delete _response;
+    if (_tempObject != NULL) free(_tempObject);
+}
+
+const AsyncWebParameter *AsyncWebServerRequest::getParam(const String &name, bool post, bool file) const {
+    for (const AsyncWebParameter &p : _params) {
+        if (p.name() == name && p.isPost() == post && p.isFile() == file) return &p;
+    }
+    return NULL;
+}
+
+const AsyncWebHeader *AsyncWebServerRequest::getHeader(const String &name) const {
+    for (const AsyncWebHeader &h : _headers) {
+        if (h.name().equalsIgnoreCase(name)) return &h;
+    }
+    return NULL;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String &contentType, const String &content) {
+    return new AsyncBasicResponse(code, contentType, content);
+}
+
+// the library returns NULL for a missing file, a 404 is kinder to callers
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(FS &fs, const String &path, const String &contentType, bool download) {
+    if (fs.exists(path) || (!download && fs.exists(path + ".gz"))) return new AsyncFileResponse(fs, path, contentType, download);
+    return new AsyncBasicResponse(404);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(File content, const String &path, const String &contentType, bool download) {
+    if (content) return new AsyncFileResponse(content, path, contentType, download);
+    return new AsyncBasicResponse(404);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(const String &contentType, size_t len, AwsResponseFiller callback) {
+    return new AsyncCallbackResponse(contentType, len, callback);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String &contentType, AwsResponseFiller callback) {
+    return new AsyncCallbackResponse(contentType, 0, callback, true);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse_P(int code, const String &contentType, const uint8_t *content, size_t len) {
+    return new AsyncProgmemResponse(code, contentType, content, len);
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const String &contentType, size_t bufferSize) {
+    return new AsyncResponseStream(contentType, bufferSize);
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *response) {
+    // only the first response counts
+    if (_response != NULL) {
+        delete response;
+        return;
+    }
+    _response = response;
+}
+
+void AsyncWebServerRequest::redirect(const String &url) {
+    AsyncWebServerResponse *response = beginResponse(302);
+    response->addHeader("Location", url);
+    send(response);
+}
+
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest *request) {
+    if (!_onRequest) return false;
+    if (!(_method & request->method())) return false;
+    if (_uri.length() == 0) return true;
+
+    if (_uri.endsWith("*")) return request->url().startsWith(_uri.substring(0, _uri.length() - 1));
+    return _uri == request->url() || request->url().startsWith(_uri + "/");
+}
+
+//
+// server sent events
+//
+AsyncEventSourceClient::AsyncEventSourceClient(AsyncEventSource *server, int fd, const IPAddress &remote)
+    : _server(server), _fd(fd), _client(remote, 0) {}
+
+AsyncEventSourceClient::~AsyncEventSourceClient() {
+    close();
+}
+
+bool AsyncEventSourceClient::write(const std::string &data) {
+    if (_fd < 0) return false;
+    if (!sendAll(_fd, data.data(), data.length(), MSG_DONTWAIT)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AsyncEventSourceClient::send(const char *message, const char *event, uint32_t id, uint32_t reconnect) {
+    std::string out;
+    char line[32];
+    if (reconnect) {
+        snprintf(line, sizeof(line), "retry: %u\r\n", reconnect);
+        out += line;
+    }
+    if (id) {
+        snprintf(line, sizeof(line), "id: %u\r\n", id);
+        out += line;
+        _lastId = id;
+    }
+    if (event != NULL) {
+        out += "event: ";
+        out += event;
+        out += "\r\n";
+    }
+    if (message != NULL) {
+        const char *start = message;
+        while (true) {
+            const char *nl = strchr(start, '\n');
+            out += "data: ";
+            out.append(start, nl == NULL ? strlen(start) : (size_t) (nl - start));
+            out += "\r\n";
+            if (nl == NULL) break;
+            start = nl + 1;
+        }
+    }
+    out += "\r\n";
+    write(out);
+}
+
+void AsyncEventSourceClient::close() {
+    if (_fd < 0) return;
+    shutdown(_fd, SHUT_RDWR);
+    ::close(_fd);
+    _fd = -1;
+}
+
+AsyncEventSource::~AsyncEventSource() {
+    close();
+    prune();
+}
+
+bool AsyncEventSource::canHandle(AsyncWebServerRequest *request) {
+    return request->method() == HTTP_GET && request->url() == _url;
+}
+
+bool AsyncEventSource::adopt(AsyncWebServerRequest *request, int fd) {
+    static const char head[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n";
+    if (!sendAll(fd, head, sizeof(head) - 1)) return false;
+
+    // like the library the connect callback runs with the client list held
+    std::lock_guard<std::mutex> guard(_lock);
+    AsyncEventSourceClient *client = new AsyncEventSourceClient(this, fd, request->client()->remoteIP());
+    _clients.push_back(client);
+    if (_connectcb) _connectcb(client);
+    return true;
+}
+
+void AsyncEventSource::send(const char *message, const char *event, uint32_t id, uint32_t reconnect) {
+    std::lock_guard<std::mutex> guard(_lock);
+    for (AsyncEventSourceClient *client : _clients) {
+        if (client->connected()) client->send(message, event, id, reconnect);
+    }
+}
+
+size_t AsyncEventSource::count() {
+    std::lock_guard<std::mutex> guard(_lock);
+    size_t n = 0;
+    for (AsyncEventSourceClient *client : _clients) {
+        if (client->connected()) n++;
+    }
+    return n;
+}
+
+void AsyncEventSource::close() {
+    std::lock_guard<std::mutex> guard(_lock);
+    for (AsyncEventSourceClient *client : _clients) client->close();
+}
+
+void AsyncEventSource::tick() {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        for (AsyncEventSourceClient *client : _clients) {
+            if (!client->connected()) continue;
+
+            char c;
+            const ssize_t n = recv(client->_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) client->close();
+        }
+    }
+    prune();
+}
+
+void AsyncEventSource::prune() {
+    std::lock_guard<std::mutex> guard(_lock);
+    for (size_t i = 0; i < _clients.size(); ) {
+        if (_clients[i]->connected()) {
+            i++;
+            continue;
+        }
+        delete _clients[i];
+        _clients.erase(_clients.begin() + i);
+    }
+}
+
+//
+// the server
+//
+AsyncWebServer::~AsyncWebServer() {
+    end();
+    for (AsyncCallbackWebHandler *handler : _owned) delete handler;
+}
+
+AsyncCallbackWebHandler &AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+    AsyncCallbackWebHandler *handler = new AsyncCallbackWebHandler(uri, method, onRequest, onUpload, onBody);
+    _owned.push_back(handler);
+    _handlers.push_back(handler);
+    return *handler;
+}
+
+AsyncWebHandler &AsyncWebServer::addHandler(AsyncWebHandler *handler) {
+    _handlers.push_back(handler);
+    return *handler;
+}
+
+void AsyncWebServer::begin() {
+    if (_running) return;
+
+    _listen = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_listen < 0) return;
+
+    const int one = 1;
+    setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(bs_host_port(_port));
+
+    if (bind(_listen, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(_listen, 8) != 0) {
+        fprintf(stderr, "web server: cannot listen on :%u (%s)\n", bs_host_port(_port), strerror(errno));
+        ::close(_listen);
+        _listen = -1;
+        return;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(_listen, (struct sockaddr *) &addr, &len);
+    _boundPort = ntohs(addr.sin_port);
+    fprintf(stderr, "web server on :%u\n", _boundPort);
+
+    _running = true;
+    _thread = std::thread(&AsyncWebServer::run, this);
+}
+
+void AsyncWebServer::end() {
+    if (!_running) return;
+
+    _running = false;
+    if (_thread.joinable()) _thread.join();
+    ::close(_listen);
+    _listen = -1;
+}
+
+void AsyncWebServer::run() {
+    while (_running) {
+        for (AsyncWebHandler *handler : _handlers) handler->tick();
+
+        struct pollfd pfd = { _listen, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0) continue;
+
+        struct sockaddr_in peer;
+        socklen_t len = sizeof(peer);
+        const int fd = accept4(_listen, (struct sockaddr *) &peer, &len, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+
+        const struct timeval tv = { BS_HOST_WEB_TIMEOUT_MS / 1000, (BS_HOST_WEB_TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        const uint8_t *ip = (const uint8_t *) &peer.sin_addr.s_addr;
+        serve(fd, IPAddress(ip[0], ip[1], ip[2], ip[3]), ntohs(peer.sin_port));
+    }
+}
+
+AsyncWebHandler *AsyncWebServer::find(AsyncWebServerRequest *request) {
+    for (AsyncWebHandler *handler : _handlers) {
+        if (handler->canHandle(request)) return handler;
+    }
+    return NULL;
+}
+
+void AsyncWebServer::serve(const int fd, const IPAddress &remote, const uint16_t remote_port) {
+    // the request head
+    std::string buf;
+    size_t head_end;
+    char chunk[BS_HOST_WEB_SEGMENT];
+    while ((head_end = buf.find("\r\n\r\n")) == std::string::npos) {
+        if (buf.length() > BS_HOST_WEB_HEAD_MAX) {
+            static const char too_big[] = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            sendAll(fd, too_big, sizeof(too_big) - 1);
+            ::close(fd);
+            return;
+        }
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            ::close(fd);
+            return;
+        }
+        buf.append(chunk, n);
+    }
+
+    AsyncWebServerRequest *request = new AsyncWebServerRequest(this, remote, remote_port);
+
+    const std::string head = buf.substr(0, head_end);
+    std::string pending = buf.substr(head_end + 4);
+
+    size_t line_end = head.find("\r\n");
+    const std::string request_line = head.substr(0, line_end);
+    const size_t sp1 = request_line.find(' ');
+    const size_t sp2 = request_line.find(' ', sp1 + 1);
+    const std::string method = request_line.substr(0, sp1);
+    const std::string target = sp1 == std::string::npos ? std::string("/") : request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    if (method == "GET") request->_method = HTTP_GET;
+    else if (method == "POST") request->_method = HTTP_POST;
+    else if (method == "DELETE") request->_method = HTTP_DELETE;
+    else if (method == "PUT") request->_method = HTTP_PUT;
+    else if (method == "PATCH") request->_method = HTTP_PATCH;
+    else if (method == "HEAD") request->_method = HTTP_HEAD;
+    else if (method == "OPTIONS") request->_method = HTTP_OPTIONS;
+
+    const size_t q = target.find('?');
+    request->_url = String(urlDecode(target.substr(0, q), false));
+    if (q != std::string::npos) parsePairs(request->_params, target.substr(q + 1), false);
+
+    while (line_end != std::string::npos && line_end < head.length()) {
+        const size_t start = line_end + 2;
+        line_end = head.find("\r\n", start);
+        const std::string line = head.substr(start, line_end == std::string::npos ? std::string::npos : line_end - start);
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+
+        size_t value_at = colon + 1;
+        while (value_at < line.length() && line[value_at] == ' ') value_at++;
+        request->_headers.push_back(AsyncWebHeader(String(line.substr(0, colon)), String(line.substr(value_at))));
+    }
+
+    const AsyncWebHeader *length = request->getHeader("Content-Length");
+    const AsyncWebHeader *type = request->getHeader("Content-Type");
+    request->_contentLength = length != NULL ? strtoul(length->value().c_str(), NULL, 10) : 0;
+    if (type != NULL) request->_contentType = type->value();
+
+    AsyncWebHandler *handler = find(request);
+
+    // an event stream keeps the socket, the request is done with
+    if (handler != NULL && handler->adopt(request, fd)) {
+        delete request;
+        return;
+    }
+
+    if (request->_contentLength > BS_HOST_WEB_BODY_MAX) {
+        request->send(413);
+    } else if (!readBody(fd, request, handler, pending)) {
+        // the client went away mid body -- onDisconnect fires on delete
+        ::close(fd);
+        delete request;
+        return;
+    } else if (handler != NULL) {
+        handler->handleRequest(request);
+    } else if (_notFound) {
+        _notFound(request);
+    } else {
+        request->send(404);
+    }
+
+    if (request->_response == NULL) request->send(500);
+    respond(fd, request);
+
+    shutdown(fd, SHUT_WR);
+    ::close(fd);
+    delete request;
+}
+
+bool AsyncWebServer::readBody(const int fd, AsyncWebServerRequest *request, AsyncWebHandler *handler, std::string &pending) {
+    const size_t total = request->_contentLength;
+    if (total == 0) return true;
+
+    String type = request->_contentType;
+    type.toLowerCase();
+    const bool form = type.startsWith("application/x-www-form-urlencoded");
+    const bool multipart = type.startsWith("multipart/form-data");
+
+    std::string body;
+    size_t index = 0;
+    char chunk[BS_HOST_WEB_SEGMENT];
+
+    while (index < total) {
+        if (pending.empty()) {
+            const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            pending.assign(chunk, n);
+        }
+
+        size_t n = pending.length() < total - index ? pending.length() : total - index;
+        if (n > BS_HOST_WEB_SEGMENT) n = BS_HOST_WEB_SEGMENT;
+
+        if (form || multipart) {
+            body.append(pending, 0, n);
+        } else if (handler != NULL) {
+            handler->handleBody(request, (uint8_t *) pending.data(), n, index, total);
+        }
+        pending.erase(0, n);
+        index += n;
+    }
+
+    if (form) parseForm(request, body);
+    if (multipart) parseMultipart(request, handler, body, headerParam(request->_contentType, "boundary"));
+    return true;
+}
+
+void AsyncWebServer::parseForm(AsyncWebServerRequest *request, const std::string &body) {
+    parsePairs(request->_params, body, true);
+}
+
+void AsyncWebServer::parseMultipart(AsyncWebServerRequest *request, AsyncWebHandler *handler, const std::string &body, const String &boundary) {
+    if (boundary.length() == 0) return;
+
+    const std::string delimiter = std::string("--") + boundary.c_str();
+    size_t at = body.find(delimiter);
+
+    while (at != std::string::npos) {
+        size_t part = at + delimiter.length();
+        if (body.compare(part, 2, "--") == 0) break;
+        part += 2;
+
+        const size_t head_end = body.find("\r\n\r\n", part);
+        if (head_end == std::string::npos) break;
+        const size_t content = head_end + 4;
+
+        size_t next = body.find("\r\n" + delimiter, content);
+        if (next == std::string::npos) break;
+
+        String name, filename;
+        const std::string headers = body.substr(part, head_end - part);
+        size_t line = 0;
+        while (line < headers.length()) {
+            size_t end = headers.find("\r\n", line);
+            if (end == std::string::npos) end = headers.length();
+            const String header = String(headers.substr(line, end - line));
+            if (strncasecmp(header.c_str(), "Content-Disposition:", 20) == 0) {
+                name = headerParam(header, "name");
+                filename = headerParam(header, "filename");
+            }
+            line = end + 2;
+        }
+
+        const size_t len = next - content;
+        if (filename.length() > 0) {
+            // the upload handler sees the file a segment at a time
+            size_t index = 0;
+            do {
+                const size_t n = len - index < BS_HOST_WEB_SEGMENT ? len - index : BS_HOST_WEB_SEGMENT;
+                if (handler != NULL) handler->handleUpload(request, filename, index, (uint8_t *) body.data() + content + index, n, index + n >= len);
+                index += n;
+            } while (index < len);
+            request->_params.push_back(AsyncWebParameter(name, filename, true, true, len));
+        } else {
+            request->_params.push_back(AsyncWebParameter(name, String(body.substr(content, len)), true));
+        }
+
+        at = next + 2;
+    }
+}
+
+void AsyncWebServer::respond(const int fd, AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *response = request->_response;
+
+    std::string head;
+    char line[96];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", response->code(), reasonPhrase(response->code()));
+    head += line;
+    if (response->contentType().length() > 0) {
+        head += "Content-Type: ";
+        head += response->contentType().c_str();
+        head += "\r\n";
+    }
+    if (response->chunked()) {
+        head += "Transfer-Encoding: chunked\r\n";
+    } else {
+        snprintf(line, sizeof(line), "Content-Length: %lld\r\n", (long long) response->contentLength());
+        head += line;
+    }
+    head += "Connection: close\r\n";
+    for (const AsyncWebHeader &h : response->headers()) {
+        head += h.name().c_str();
+        head += ": ";
+        head += h.value().c_str();
+        head += "\r\n";
+    }
+    head += "\r\n";
+    if (!sendAll(fd, head.data(), head.length())) return;
+    if (request->_method == HTTP_HEAD) return;
+
+    uint8_t buf[BS_HOST_WEB_SEGMENT];
+    size_t index = 0;
+    while (response->chunked() || index < (size_t) response->contentLength()) {
+        size_t max_len = sizeof(buf);
+        if (!response->chunked() && (size_t) response->contentLength() - index < max_len) max_len = response->contentLength() - index;
+
+        const size_t n = response->fill(buf, max_len, index);
+        if (n == RESPONSE_TRY_AGAIN) {
+            usleep(1000);
+            continue;
+        }
+        if (n == 0) break;
+
+        if (response->chunked()) {
+            snprintf(line, sizeof(line), "%zx\r\n", n);
+            if (!sendAll(fd, line, strlen(line)) || !sendAll(fd, (const char *) buf, n) || !sendAll(fd, "\r\n", 2)) return;
+        } else if (!sendAll(fd, (const char *) buf, n)) {
+            return;
+        }
+        index += n;
+    }
+
+    if (response->chunked()) sendAll(fd, "0\r\n\r\n", 5);
+}
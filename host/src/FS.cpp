@@ -0,0 +1,226 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "LittleFS.h"
+#include "BSHost.h"
+
+#include <cerrno>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <filesystem>
+
+LittleFSFS LittleFS;
+
+class HostFileImpl {
+    public:
+        ~HostFileImpl() { close(); }
+
+        void close() {
+            if (fp != NULL) fclose(fp);
+            if (dir != NULL) closedir(dir);
+            fp = NULL;
+            dir = NULL;
+        }
+
+        std::string path;
+        std::string host_path;
+        FILE *fp = NULL;
+        DIR *dir = NULL;
+};
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *data, size_t n) {
+    if (!impl || impl->fp == NULL) return 0;
+    return fwrite(data, 1, n, impl->fp);
+}
+
+int File::available() {
+    if (!impl || impl->fp == NULL) return 0;
+    const size_t pos = position();
+    const size_t len = size();
+    return pos < len ? (int) (len - pos) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!impl || impl->fp == NULL) return -1;
+    const int c = fgetc(impl->fp);
+    if (c != EOF) ungetc(c, impl->fp);
+    return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buf, size_t n) {
+    if (!impl || impl->fp == NULL) return 0;
+    return fread(buf, 1, n, impl->fp);
+}
+
+void File::flush() {
+    if (impl && impl->fp != NULL) fflush(impl->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl || impl->fp == NULL) return false;
+    return fseek(impl->fp, pos, mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    if (!impl || impl->fp == NULL) return 0;
+    const long pos = ftell(impl->fp);
+    return pos > 0 ? pos : 0;
+}
+
+size_t File::size() const {
+    if (!impl || impl->fp == NULL) return 0;
+    fflush(impl->fp);
+    struct stat st;
+    return fstat(fileno(impl->fp), &st) == 0 ? st.st_size : 0;
+}
+
+void File::close() {
+    if (impl) impl->close();
+    impl.reset();
+}
+
+File::operator bool() const {
+    return impl && (impl->fp != NULL || impl->dir != NULL);
+}
+
+const char* File::name() const {
+    if (!impl) return "";
+    const size_t slash = impl->path.rfind('/');
+    return slash == std::string::npos ? impl->path.c_str() : impl->path.c_str() + slash + 1;
+}
+
+const char* File::path() const {
+    return impl ? impl->path.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return impl && impl->dir != NULL;
+}
+
+File File::openNextFile(const char *mode) {
+    if (!impl || impl->dir == NULL) return File();
+
+    struct dirent *entry;
+    while ((entry = readdir(impl->dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        std::string child = impl->path;
+        if (child.empty() || child.back() != '/') child += "/";
+        child += entry->d_name;
+        return LittleFS.open(child.c_str(), mode);
+    }
+    return File();
+}
+
+time_t File::getLastWrite() {
+    if (!impl) return 0;
+    struct stat st;
+    return stat(impl->host_path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+std::string FS::hostPath(const char *path) {
+    std::string host = root;
+    if (path[0] != '/') host += "/";
+    host += path;
+    return host;
+}
+
+File FS::open(const char *path, const char *mode, const bool create) {
+    if (!mounted || path == NULL || path[0] != '/') return File();
+
+    std::shared_ptr<HostFileImpl> impl = std::make_shared<HostFileImpl>();
+    impl->path = path;
+    impl->host_path = hostPath(path);
+
+    struct stat st;
+    if (stat(impl->host_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (mode[0] != 'r') return File();
+        impl->dir = opendir(impl->host_path.c_str());
+        return impl->dir != NULL ? File(impl) : File();
+    }
+
+    if (create && mode[0] != 'r') {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(impl->host_path).parent_path(), ec);
+    }
+
+    // binary, whatever the device code asked for
+    char host_mode[4] = { mode[0], mode[1] == '+' ? '+' : '\0', '\0', '\0' };
+    strcat(host_mode, "b");
+
+    impl->fp = fopen(impl->host_path.c_str(), host_mode);
+    return impl->fp != NULL ? File(impl) : File();
+}
+
+bool FS::exists(const char *path) {
+    struct stat st;
+    return mounted && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+    return mounted && unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+    return mounted && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+    return mounted && (::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+bool FS::rmdir(const char *path) {
+    return mounted && ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::begin(const bool format_on_fail, const char *base_path, const uint8_t max_open, const char *label) {
+    (void) format_on_fail;
+    (void) base_path;
+    (void) max_open;
+    (void) label;
+
+    root = bs_host_path("littlefs");
+
+    std::error_code ec;
+    const bool fresh = !std::filesystem::exists(root, ec) || std::filesystem::is_empty(root, ec);
+    std::filesystem::create_directories(root, ec);
+    if (!std::filesystem::is_directory(root, ec)) return false;
+
+    const char *image = getenv("BS_HOST_FS_IMAGE");
+    if (fresh && image != NULL && image[0] != '\0') {
+        std::filesystem::copy(image, root, std::filesystem::copy_options::recursive, ec);
+        if (ec) return false;
+    }
+
+    mounted = true;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    std::error_code ec;
+    std::filesystem::remove_all(root, ec);
+    std::filesystem::create_directories(root, ec);
+    return !ec;
+}
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(root, ec)) {
+        if (entry.is_regular_file(ec)) used += entry.file_size(ec);
+    }
+    return used;
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "Update.h"
+#include "ArduinoOTA.h"
+#include "ElegantOTA.h"
+#include "BSHost.h"
+
+#include <string>
+
+UpdateClass Update;
+ArduinoOTAClass ArduinoOTA;
+ElegantOTAClass ElegantOTA;
+
+static std::string firmwarePath(const bool temp) {
+    return bs_host_path(temp ? "firmware.bin.tmp" : "firmware.bin");
+}
+
+bool UpdateClass::begin(size_t size, int command) {
+    (void) command;
+    abort();
+
+    file = fopen(firmwarePath(true).c_str(), "wb");
+    expected = size;
+    written = 0;
+    failed = file == NULL;
+    return !failed;
+}
+
+size_t UpdateClass::write(uint8_t *data, size_t len) {
+    if (file == NULL || failed) return 0;
+    if (expected != UPDATE_SIZE_UNKNOWN && written + len > expected) {
+        failed = true;
+        return 0;
+    }
+
+    const size_t n = fwrite(data, 1, len, file);
+    written += n;
+    if (n != len) failed = true;
+    return n;
+}
+
+bool UpdateClass::end(bool even_if_remaining) {
+    if (file == NULL) return false;
+
+    fclose(file);
+    file = NULL;
+
+    const bool complete = expected == UPDATE_SIZE_UNKNOWN || written == expected;
+    if (failed || (!complete && !even_if_remaining) || written == 0) {
+        unlink(firmwarePath(true).c_str());
+        return false;
+    }
+    return rename(firmwarePath(true).c_str(), firmwarePath(false).c_str()) == 0;
+}
+
+void UpdateClass::abort() {
+    if (file == NULL) return;
+
+    fclose(file);
+    file = NULL;
+    unlink(firmwarePath(true).c_str());
+}
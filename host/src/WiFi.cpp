@@ -0,0 +1,143 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "WiFi.h"
+#include "BSHost.h"
+
+#include <thread>
+
+WiFiClass WiFi;
+
+bool WiFiClass::mode(WiFiMode_t m) {
+    if (m == WIFI_OFF || m == WIFI_AP) {
+        if (wifi_status == WL_CONNECTED) disconnect();
+    }
+    wifi_mode = m;
+    return true;
+}
+
+WiFiEventId_t WiFiClass::onEvent(WiFiEventFuncCb cb, WiFiEvent_t event) {
+    handlers.push_back({ cb, event });
+    return (WiFiEventId_t) handlers.size();
+}
+
+void WiFiClass::fire(WiFiEvent_t event, WiFiEventInfo_t info) {
+    for (const HOST_HANDLER_TYPE &h : handlers) {
+        if (h.event == event || h.event == ARDUINO_EVENT_MAX) h.cb(event, info);
+    }
+}
+
+void WiFiClass::hostScan(const char *spec) {
+    networks.clear();
+    scripted = true;
+
+    std::string rest = spec != NULL ? spec : "";
+    while (!rest.empty()) {
+        const size_t comma = rest.find(',');
+        std::string item = rest.substr(0, comma);
+        rest = comma == std::string::npos ? "" : rest.substr(comma + 1);
+
+        const size_t c1 = item.find(':');
+        if (c1 == std::string::npos || c1 == 0) continue;
+        const size_t c2 = item.find(':', c1 + 1);
+
+        HOST_NETWORK_TYPE net;
+        net.ssid = String(item.substr(0, c1));
+        net.rssi = strtol(item.substr(c1 + 1, c2 == std::string::npos ? std::string::npos : c2 - c1 - 1).c_str(), NULL, 10);
+        net.password = c2 == std::string::npos ? String() : String(item.substr(c2 + 1));
+
+        // a locally administered address per entry
+        const uint8_t bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, (uint8_t) (networks.size() + 1) };
+        memcpy(net.bssid, bssid, 6);
+        networks.push_back(net);
+    }
+}
+
+int16_t WiFiClass::scanNetworks() {
+    if (!scripted) hostScan(getenv("BS_HOST_WIFI_SCAN"));
+    return (int16_t) networks.size();
+}
+
+String WiFiClass::SSID(uint8_t i) {
+    return i < networks.size() ? networks[i].ssid : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t i) {
+    return i < networks.size() ? networks[i].rssi : 0;
+}
+
+int8_t WiFiClass::RSSI() {
+    return wifi_status == WL_CONNECTED ? connected_rssi : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t i) {
+    return i < networks.size() ? networks[i].bssid : NULL;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect) {
+    (void) channel;
+    if (!connect) return wifi_status;
+    if (!scripted) hostScan(getenv("BS_HOST_WIFI_SCAN"));
+
+    wifi_status = WL_NO_SSID_AVAIL;
+    for (const HOST_NETWORK_TYPE &net : networks) {
+        if (!net.ssid.equals(ssid)) continue;
+        if (bssid != NULL && memcmp(bssid, net.bssid, 6) != 0) continue;
+        if (!net.password.isEmpty() && !net.password.equals(passphrase != NULL ? passphrase : "")) {
+            wifi_status = WL_CONNECT_FAILED;
+            continue;
+        }
+
+        connected_ssid = net.ssid;
+        connected_rssi = (int8_t) net.rssi;
+        wifi_status = WL_CONNECTED;
+        break;
+    }
+    if (wifi_status != WL_CONNECTED) return wifi_status;
+
+    const long drop_ms = bs_host_env("BS_HOST_WIFI_DROP_MS", 0);
+    if (drop_ms > 0) {
+        const uint32_t this_link = ++link;
+        std::thread([this, this_link, drop_ms]()
+            {
+                delay(drop_ms);
+                if (link == this_link && wifi_status == WL_CONNECTED) hostDisconnect();
+            }).detach();
+    }
+    return wifi_status;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    (void) eraseap;
+    link++;
+    wifi_status = WL_DISCONNECTED;
+    connected_ssid = String();
+    if (wifioff) wifi_mode = WIFI_OFF;
+    return true;
+}
+
+void WiFiClass::hostDisconnect(const uint8_t reason) {
+    if (wifi_status != WL_CONNECTED) return;
+    link++;
+    wifi_status = WL_CONNECTION_LOST;
+
+    WiFiEventInfo_t info;
+    info.wifi_sta_disconnected.reason = reason;
+    fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+}
+
+IPAddress WiFiClass::localIP() {
+    return wifi_status == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+bool WiFiClass::softAP(const char *ssid, const char *passphrase) {
+    (void) ssid;
+    (void) passphrase;
+    if (wifi_mode == WIFI_STA) wifi_mode = WIFI_AP_STA;
+    else if (wifi_mode == WIFI_OFF) wifi_mode = WIFI_AP;
+    return true;
+}
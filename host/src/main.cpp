@@ -0,0 +1,23 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSHost.h"
+
+// the sketch
+void setup();
+void loop();
+
+int main(int argc, char **argv) {
+    bs_host_init(argc, argv);
+    setup();
+
+    const long loops = bs_host_env("BS_HOST_LOOPS", 0);
+    for (long i = 0; bs_host_running() && (loops == 0 || i < loops); i++) loop();
+
+    Serial.flush();
+    return 0;
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "rom/miniz.h"
+
+static voidpf arenaAlloc(voidpf opaque, uInt items, uInt size) {
+    tinfl_decompressor *r = (tinfl_decompressor *) opaque;
+    const size_t n = ((size_t) items * size + 15) & ~(size_t) 15;
+    if (r->arena_used + n > TINFL_ARENA_LEN) return Z_NULL;
+
+    void *p = r->arena + r->arena_used;
+    r->arena_used += n;
+    return p;
+}
+
+static void arenaFree(voidpf opaque, voidpf address) {
+    (void) opaque;
+    (void) address;
+}
+
+void tinfl_init(tinfl_decompressor *r) {
+    r->arena_used = 0;
+    r->zs.zalloc = arenaAlloc;
+    r->zs.zfree = arenaFree;
+    r->zs.opaque = r;
+    r->zs.next_in = Z_NULL;
+    r->zs.avail_in = 0;
+    r->ready = inflateInit2(&r->zs, -15) == Z_OK;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in_buf_next, size_t *in_buf_size,
+                              uint8_t *out_buf_start, uint8_t *out_buf_next, size_t *out_buf_size, const uint32_t flags) {
+    (void) out_buf_start;
+    (void) flags;
+    if (!r->ready) {
+        *in_buf_size = 0;
+        *out_buf_size = 0;
+        return TINFL_STATUS_BAD_PARAM;
+    }
+
+    // zlib keeps its own window, the caller's wrapping buffer is only output
+    r->zs.next_in = (Bytef *) in_buf_next;
+    r->zs.avail_in = (uInt) *in_buf_size;
+    r->zs.next_out = out_buf_next;
+    r->zs.avail_out = (uInt) *out_buf_size;
+
+    const int rc = inflate(&r->zs, Z_NO_FLUSH);
+
+    *in_buf_size -= r->zs.avail_in;
+    *out_buf_size -= r->zs.avail_out;
+
+    if (rc == Z_STREAM_END) return TINFL_STATUS_DONE;
+    if (rc != Z_OK && rc != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+    // a full window may still leave output inside zlib
+    if (r->zs.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+    return r->zs.avail_in == 0 ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_HAS_MORE_OUTPUT;
+}
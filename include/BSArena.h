@@ -0,0 +1,40 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_ARENA_H
+#define BS_ARENA_H
+
+#include "BSPlatform.h"
+
+#define BS_ARENA_LEN                  1024
+#define BS_ARENA_ALIGN                4
+
+// per-loop scratch memory
+//
+// a bump allocator over a fixed block that loop() resets at the top of
+// every iteration, so nothing handed out survives the iteration it was
+// allocated in.  for short lived strings (formatted values, template
+// tokens) that would otherwise go through the heap.  housekeeping context
+// only -- web handlers run on another task and must not touch it
+class BSArena {
+    public:
+        void* alloc(const size_t size);
+        char* strdup(const char *s);
+        char* printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+        void reset();
+
+        size_t used() { return top; }
+        size_t highWater() { return high_water; }
+        uint32_t failures() { return failed; }
+
+    private:
+        uint8_t block[BS_ARENA_LEN] __attribute__ ((aligned (BS_ARENA_ALIGN)));
+        size_t top = 0;
+        size_t high_water = 0;
+        uint32_t failed = 0;
+};
+#endif
@@ -0,0 +1,49 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_ASSETS_H
+#define BS_ASSETS_H
+
+#include "BSPlatform.h"
+
+#define BS_ASSET_CACHE_CONTROL        "max-age=604800"
+
+// one file of a bundle generated by tools/bs_pack.py -- data is PROGMEM
+typedef struct bs_asset_type {
+    const char *path;
+    const uint8_t *data;
+    uint32_t len;
+    const char *mime;
+    const char *etag;
+    bool gzip;
+} BS_ASSET_TYPE;
+
+// read-only asset bundle linked into flash
+//
+// the packer sorts the index by path so a lookup is a binary search with
+// no file system involved; the data is served straight from its flash
+// address
+class BSAssets {
+    public:
+        void begin(const BS_ASSET_TYPE *assets, const uint16_t count);
+        const BS_ASSET_TYPE* find(const char *path);
+
+        uint16_t count() { return asset_count; }
+        void served(const BS_ASSET_TYPE *asset, const bool not_modified);
+
+        void printTo(Print *out);
+
+    private:
+        const BS_ASSET_TYPE *assets = NULL;
+        uint16_t asset_count = 0;
+        uint32_t bundle_bytes = 0;
+
+        uint32_t hits = 0;
+        uint32_t not_modified_hits = 0;
+        uint32_t bytes_served = 0;
+};
+#endif
@@ -0,0 +1,100 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_BENCH_H
+#define BS_BENCH_H
+
+#include "BSPlatform.h"
+#include <functional>
+
+#define BS_BENCH_MAX_RESULTS          16
+#define BS_BENCH_NAME_LEN             24
+#define BS_BENCH_MIN_US               100000
+#define BS_BENCH_MAX_BATCH            65536
+#define BS_BENCH_MAX_NOTES            4
+#define BS_BENCH_NOT_COUNTED          -1
+
+typedef std::function<void()> BSBenchFn;
+
+typedef struct bs_bench_result_type {
+    char name[BS_BENCH_NAME_LEN];
+    uint32_t iterations;
+    uint32_t ns_per_op;
+    int32_t heap_milli_bytes_per_op;
+    int32_t milli_blocks_per_op;
+    // BS_BENCH_NOT_COUNTED where the platform keeps no count
+    int32_t milli_allocs_per_op;
+    uint32_t bytes_per_op;
+} BS_BENCH_RESULT_TYPE;
+
+// reads a fixed buffer as a Stream -- synthetic template input
+class BSBenchStream : public Stream {
+    public:
+        BSBenchStream(const char *data, const size_t len) { this->data = data; this->len = len; }
+        void rewind() { pos = 0; }
+
+        int available() override { return len - pos; }
+        int read() override { return pos < len ? (uint8_t) data[pos++] : -1; }
+        int peek() { return pos < len ? (uint8_t) data[pos] : -1; }
+        size_t readBytes(char *buf, size_t n) override {
+            if (n > len - pos) n = len - pos;
+            memcpy(buf, data + pos, n);
+            pos += n;
+            return n;
+        }
+        size_t write(uint8_t) override { return 0; }
+
+    private:
+        const char *data;
+        size_t len;
+        size_t pos = 0;
+};
+
+// swallows and counts whatever is rendered into it
+class BSBenchSink : public Print {
+    public:
+        size_t write(uint8_t) override { written++; return 1; }
+        size_t write(const uint8_t *, size_t n) override { written += n; return n; }
+        uint32_t written = 0;
+};
+
+// micro-benchmark runner
+//
+// each case is run in doubling batches until one batch takes at least
+// min_us, so timer resolution never dominates.  heap per op is the net
+// change in free heap across the whole case (what the path retains, not
+// what it churns); on the esp32 the net change in allocated blocks is
+// reported as well.  allocs per op is the churn -- every malloc, freed or
+// not -- where the platform counts them (the host build).  bytes per op
+// is whatever the case says it produced
+class BSBench {
+    public:
+        void begin(const char *suite);
+        bool run(const char *name, BSBenchFn fn, const uint32_t bytes_per_op = 0, const uint32_t min_us = BS_BENCH_MIN_US);
+
+        // a static figure reported next to the results (key must be a literal)
+        void note(const char *key, const uint32_t value);
+
+        uint8_t count() { return result_count; }
+        const BS_BENCH_RESULT_TYPE* result(const uint8_t i) { return i < result_count ? &results[i] : NULL; }
+
+        void printTo(Print *out);
+        void printJson(Print *out);
+
+    private:
+        static uint32_t freeHeap();
+        static uint32_t allocatedBlocks();
+
+        const char *suite = "";
+        BS_BENCH_RESULT_TYPE results[BS_BENCH_MAX_RESULTS];
+        uint8_t result_count = 0;
+
+        const char *note_keys[BS_BENCH_MAX_NOTES];
+        uint32_t note_values[BS_BENCH_MAX_NOTES];
+        uint8_t note_count = 0;
+};
+#endif
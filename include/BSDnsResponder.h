@@ -0,0 +1,100 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_DNS_RESPONDER_H
+#define BS_DNS_RESPONDER_H
+
+#include "BSPlatform.h"
+
+#ifdef BS_HOST
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #ifdef esp32
+        // the full host build (host/) has the arduino stand-ins
+        #include <Arduino.h>
+    #endif
+#else
+    #include <lwip/udp.h>
+    #include <lwip/pbuf.h>
+    #ifdef esp32
+        #include <lwip/tcpip.h>
+        #include <lwip/priv/tcpip_priv.h>
+    #endif
+#endif
+
+#define BS_DNS_PACKET_LEN             512
+#define BS_DNS_HEADER_LEN             12
+#define BS_DNS_ANSWER_LEN             16
+#define BS_DNS_TTL_S                  60
+
+#define BS_DNS_TYPE_A                 1
+#define BS_DNS_CLASS_IN               1
+
+#define BS_DNS_RCODE_FORMERR          1
+#define BS_DNS_RCODE_NOTIMP           4
+
+// captive portal dns responder
+//
+// answers every A query with our own address and everything else (AAAA,
+// HTTPS, ...) with an empty NOERROR so clients stop asking quickly.  a
+// reply is the query's header and question copied back with the flags and
+// counts patched, plus a prebuilt answer record -- nothing is parsed beyond
+// the question.  on the esp the lwip receive callback answers each
+// datagram the moment it arrives, independent of loop(); the host build
+// (BS_HOST) drains a non-blocking socket from loop() instead
+class BSDnsResponder {
+    public:
+        bool begin(const uint16_t port, const uint8_t ip[4]);
+        #if !defined(BS_HOST) || defined(esp32)
+            bool begin(const uint16_t port, IPAddress ip);
+        #endif
+        void stop();
+        void loop();
+
+        uint32_t queries() { return total; }
+        uint32_t dropped() { return malformed; }
+        uint32_t qps();
+        uint32_t peakQps() { return peak_qps; }
+
+        void printTo(Print *out);
+
+        // pure -- no state, no io.  returns the reply length or 0 to drop
+        static size_t buildReply(const uint8_t *query, const size_t query_len, uint8_t *reply, const size_t reply_cap, const uint8_t answer[BS_DNS_ANSWER_LEN]);
+        static void buildAnswer(uint8_t answer[BS_DNS_ANSWER_LEN], const uint8_t ip[4], const uint32_t ttl_s);
+
+    private:
+        void count(const bool answered);
+
+        #ifdef BS_HOST
+            int sock = -1;
+        #else
+            static void onDatagram(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
+            #ifdef esp32
+                typedef struct bs_dns_call_type {
+                    struct tcpip_api_call_data call;
+                    BSDnsResponder *self;
+                } BS_DNS_CALL_TYPE;
+
+                static err_t bindInTcpip(struct tcpip_api_call_data *call);
+                static err_t stopInTcpip(struct tcpip_api_call_data *call);
+            #endif
+
+            struct udp_pcb *pcb = NULL;
+        #endif
+
+        uint16_t port = 0;
+        uint8_t answer[BS_DNS_ANSWER_LEN];
+        uint8_t query_buf[BS_DNS_PACKET_LEN];
+
+        volatile uint32_t total = 0;
+        volatile uint32_t malformed = 0;
+        volatile uint32_t window_count = 0;
+        volatile uint32_t window_started = 0;
+        volatile uint32_t last_qps = 0;
+        volatile uint32_t peak_qps = 0;
+};
+#endif
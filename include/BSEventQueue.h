@@ -0,0 +1,126 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_EVENT_QUEUE_H
+#define BS_EVENT_QUEUE_H
+
+#include "BSPlatform.h"
+#include <atomic>
+
+#define BS_EVENT_QUEUE_LEN            8
+// a few bytes inline -- anything bigger (a config update) travels as a
+// pointer to a heap block the consumer frees
+#define BS_EVENT_DATA_LEN             16
+
+#define BS_EVENT_NONE                 0
+#define BS_EVENT_CONFIG_UPDATE        1
+#define BS_EVENT_LOAD_CONFIG          2
+#define BS_EVENT_WIPE_CONFIG          3
+#define BS_EVENT_RUN_BENCHMARKS       4
+
+typedef struct bs_event_type {
+    uint8_t type;
+    unsigned short len;
+    char data[BS_EVENT_DATA_LEN];
+} BS_EVENT_TYPE;
+
+// bounded multi-producer / single-consumer queue
+//
+// every cell carries a sequence number that tells producers whether it is
+// free and the consumer whether it has been published (D. Vyukov's bounded
+// queue).  producers only contend on a single compare-and-swap of the
+// enqueue position, the consumer never writes anything a producer spins on.
+// N must be a power of two
+template <typename T, unsigned short N>
+class BSQueue {
+    static_assert(N > 1 && (N & (N - 1)) == 0, "BSQueue length must be a power of two");
+
+    public:
+        BSQueue() {
+            for (unsigned short i = 0; i < N; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+            enqueue_pos.store(0, std::memory_order_relaxed);
+        }
+
+        // safe to call from any task (web handlers, wifi events)
+        bool push(const T &item) {
+            uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            cell_type *cell;
+
+            while (true) {
+                cell = &cells[pos & (N - 1)];
+                const uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+                const int32_t diff = (int32_t) (seq - pos);
+
+                if (diff == 0) {
+                    if (claim(pos)) break;
+                } else if (diff < 0) {
+                    drops++;
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->data = item;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // main loop only
+        bool pop(T *item) {
+            cell_type *cell = &cells[dequeue_pos & (N - 1)];
+            const uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+
+            if ((int32_t) (seq - (dequeue_pos + 1)) < 0) return false;
+
+            *item = cell->data;
+            cell->sequence.store(dequeue_pos + N, std::memory_order_release);
+            dequeue_pos++;
+            return true;
+        }
+
+        // main loop only
+        bool empty() {
+            const uint32_t seq = cells[dequeue_pos & (N - 1)].sequence.load(std::memory_order_acquire);
+            return (int32_t) (seq - (dequeue_pos + 1)) < 0;
+        }
+
+        // approximate -- concurrent drops may be counted once
+        uint32_t dropped() {
+            return drops;
+        }
+
+    private:
+        typedef struct {
+            std::atomic<uint32_t> sequence;
+            T data;
+        } cell_type;
+
+        bool claim(uint32_t &pos) {
+            #ifdef BS_PLATFORM_HAS_CAS
+                return enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed);
+            #else
+                // the lx106 has no compare-and-swap instruction; masking
+                // interrupts around the claim is the single core equivalent
+                const uint32_t ps = xt_rsil(15);
+                const bool claimed = enqueue_pos.load(std::memory_order_relaxed) == pos;
+                if (claimed) {
+                    enqueue_pos.store(pos + 1, std::memory_order_relaxed);
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+                xt_wsr_ps(ps);
+                return claimed;
+            #endif
+        }
+
+        cell_type cells[N];
+        std::atomic<uint32_t> enqueue_pos;
+        uint32_t dequeue_pos = 0;
+        volatile uint32_t drops = 0;
+};
+#endif
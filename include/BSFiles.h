@@ -0,0 +1,75 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_FILES_H
+#define BS_FILES_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "LittleFS.h"
+
+#include "BSPlatform.h"
+#include "BSString.h"
+#include "BSJson.h"
+
+#define BS_FILES_ETAG_LEN             24
+#define BS_FILES_PATH_LEN             96
+#define BS_FILES_OUT_LEN              384
+#define BS_FILES_DEFAULT_LIMIT        50
+#define BS_FILES_MAX_LIMIT            200
+
+#define BS_RANGE_NONE                 0
+#define BS_RANGE_OK                   1
+#define BS_RANGE_UNSATISFIABLE        2
+
+// littlefs downloads that can be resumed
+//
+// a single "bytes=" range is answered with a 206 read straight from the
+// file as the response drains; anything fancier (several ranges) gets the
+// whole file, which the spec allows.  the etag is size and modification
+// time, so If-Range only resumes a file that has not changed since
+class BSFiles {
+    public:
+        static AsyncWebServerResponse* beginResponse(AsyncWebServerRequest *request, const char *path);
+
+        static uint8_t parseRange(const char *header, const size_t size, size_t *start, size_t *end);
+        static void etag(File &file, char *out);
+        static const char* contentType(const char *path);
+};
+
+// one page of a directory listing, produced as the response asks for it --
+// only the current entry is ever held in memory
+class BSDirListing {
+    public:
+        BSDirListing(const char *dir, const uint32_t offset, const uint32_t limit);
+        size_t fill(uint8_t *out, const size_t max_len);
+
+    private:
+        enum { STATE_HEADER, STATE_SKIP, STATE_ENTRIES, STATE_FOOTER, STATE_DONE };
+
+        bool produce();
+        bool nextEntry(const char **name, size_t *size, bool *is_dir);
+
+        BSString<BS_FILES_PATH_LEN> dir;
+        uint32_t offset;
+        uint32_t limit;
+        uint32_t emitted = 0;
+        bool more = false;
+        uint8_t state = STATE_HEADER;
+
+        #ifdef esp32
+            File root;
+            File entry;
+        #else
+            Dir root;
+            BSString<BS_FILES_PATH_LEN> name_buf;
+        #endif
+
+        BSString<BS_FILES_OUT_LEN> out_buf;
+        size_t out_pos = 0;
+};
+#endif
@@ -0,0 +1,102 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_HEAP_MONITOR_H
+#define BS_HEAP_MONITOR_H
+
+#include <Arduino.h>
+#include "BSPlatform.h"
+
+#define BS_HEAP_SUBSYS_WEB            0
+#define BS_HEAP_SUBSYS_TEMPLATE       1
+#define BS_HEAP_SUBSYS_LOG            2
+#define BS_HEAP_SUBSYS_CONFIG         3
+#define BS_HEAP_MAX_SUBSYS            4
+
+// heap is sampled every BS_HEAP_SAMPLE_MS, the ring keeps the worst sample
+// of each period -- 48 x 5 minutes is four hours of history
+#define BS_HEAP_SAMPLE_MS             10000
+#define BS_HEAP_DEFAULT_PERIOD_MS     300000
+#define BS_HEAP_RING_LEN              48
+
+// a leak is reported once at least BS_HEAP_TREND_MIN_PERIODS periods are in,
+// 3/4 of the steps between them went down and the total drop is real
+#define BS_HEAP_TREND_MIN_PERIODS     8
+#define BS_HEAP_TREND_MIN_DROP        1024
+
+typedef struct bs_heap_sample_type {
+    uint32_t free_min;
+    uint32_t largest_min;
+    uint8_t frag_max;
+} BS_HEAP_SAMPLE_TYPE;
+
+typedef struct bs_heap_subsys_type {
+    uint32_t count;
+    int32_t heap_delta;
+    int32_t max_heap_delta;
+    uint32_t started_free;
+    uint64_t allocs;
+    uint64_t started_allocs;
+} BS_HEAP_SUBSYS_TYPE;
+
+// heap and fragmentation telemetry
+//
+// per subsystem, across each begin() / end() pair:
+//
+//   allocs      allocations the pair's own thread made -- counted where
+//               the platform counts them (the host build), null elsewhere
+//   heap delta  free heap before less free heap after.  not an allocation
+//               count: on the esp32 other tasks allocate concurrently, so a
+//               subsystem that keeps a delta across many calls is the signal
+//
+// web has no heap delta -- a response outlives the handler that built it,
+// so its pair would only ever measure the response still being sent
+class BSHeapMonitor {
+    public:
+        void sample();
+        void setPeriod(const uint32_t period_ms);
+
+        void begin(const uint8_t subsystem);
+        void end(const uint8_t subsystem);
+
+        bool leaking() { return leak_suspected; }
+        int32_t trendPerHour() { return trend_per_hour; }
+        uint32_t minEver();
+
+        // minimum free heap since the last reset, read at every sample and
+        // around every begin() / end() pair -- brackets a load test
+        uint32_t lowWater();
+        void resetLowWater() { low_water = freeHeap(); }
+
+        static uint32_t freeHeap();
+        static uint32_t largestBlock();
+        static uint8_t fragmentation();
+
+        void printTo(Print *out);
+        void printJson(Print *out);
+
+    private:
+        void closePeriod();
+        void evaluateTrend();
+        const BS_HEAP_SAMPLE_TYPE* at(const uint8_t age);
+
+        BS_HEAP_SAMPLE_TYPE ring[BS_HEAP_RING_LEN];
+        uint8_t ring_head = 0;
+        uint8_t ring_count = 0;
+
+        BS_HEAP_SAMPLE_TYPE current = { UINT32_MAX, UINT32_MAX, 0 };
+        unsigned long period_started = 0;
+        uint32_t period_ms = BS_HEAP_DEFAULT_PERIOD_MS;
+
+        BS_HEAP_SUBSYS_TYPE subsystems[BS_HEAP_MAX_SUBSYS] = {};
+
+        uint32_t min_free = UINT32_MAX;
+        uint32_t low_water = UINT32_MAX;
+        int32_t trend_per_hour = 0;
+        bool leak_suspected = false;
+};
+#endif
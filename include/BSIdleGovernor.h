@@ -0,0 +1,68 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_IDLE_GOVERNOR_H
+#define BS_IDLE_GOVERNOR_H
+
+#include "BSPlatform.h"
+
+#define BS_IDLE_DEFAULT_BUDGET_MS     250
+#define BS_IDLE_MIN_SLEEP_MS          2
+
+// one beacon interval is 100 TU (102.4 ms); a station in modem sleep hears
+// the ap once every dtim beacons
+#define BS_IDLE_BEACON_US             102400
+#define BS_IDLE_DEFAULT_DTIM          1
+
+// idle governor
+//
+// once a loop pass finds nothing to do the loop is put to sleep until the
+// next scheduler deadline, but never longer than the wake latency budget.
+// the cpu sleeps in the rtos idle task (esp32) or in delay() (esp8266),
+// which is where light sleep happens when the sdk is allowed to.  the
+// radio is only put in modem sleep when a dtim period fits the budget --
+// otherwise a request could sit at the ap longer than promised.  the web
+// server and dns run outside the loop and are not held up by it
+class BSIdleGovernor {
+    public:
+        void begin(const uint32_t latency_budget_ms = BS_IDLE_DEFAULT_BUDGET_MS);
+        void end();
+        bool enabled() { return _enabled; }
+
+        void setLatencyBudget(const uint32_t ms);
+        uint32_t latencyBudget() { return budget_ms; }
+        void setDtim(const uint8_t dtim);
+
+        // radio power save for the current wifi mode -- call after connecting
+        void applyRadio(const bool station);
+        bool modemSleep() { return modem_sleep; }
+
+        // sleeps for up to ms_until (capped by the budget), returns ms slept
+        uint32_t idle(const uint32_t ms_until);
+
+        uint32_t sleeps() { return sleep_count; }
+        uint64_t asleepMs() { return asleep_us / 1000; }
+        uint8_t idlePercent();
+        uint32_t avgWakeLatencyUs() { return sleep_count > 0 ? (uint32_t) (latency_us / sleep_count) : 0; }
+        uint32_t maxWakeLatencyUs() { return max_latency_us; }
+        void reset();
+
+        void printTo(Print *out);
+
+    private:
+        bool _enabled = false;
+        bool modem_sleep = false;
+        uint32_t budget_ms = BS_IDLE_DEFAULT_BUDGET_MS;
+        uint8_t dtim = BS_IDLE_DEFAULT_DTIM;
+
+        uint64_t since_us = 0;
+        uint64_t asleep_us = 0;
+        uint64_t latency_us = 0;
+        uint32_t max_latency_us = 0;
+        uint32_t sleep_count = 0;
+};
+#endif
@@ -0,0 +1,75 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_JSON_H
+#define BS_JSON_H
+
+#include "BSPlatform.h"
+
+#define BS_JSON_KEY_LEN               32
+#define BS_JSON_VALUE_LEN             128
+
+#define BS_JSON_MORE                  0
+#define BS_JSON_PAIR                  1
+#define BS_JSON_DONE                  2
+#define BS_JSON_ERROR                 3
+
+class BSJson {
+    public:
+        // "..." with quotes, backslashes and control characters escaped
+        static void printString(Print *out, const char *s);
+};
+
+// streaming parser for one flat object of scalars -- {"name": value, ...}
+//
+// fed a byte at a time, so a body can be parsed as it arrives in chunks.
+// memory is the object itself (plain data, fine to malloc); strings come
+// out unescaped, numbers / true / false / null as their literal text.
+// nested objects and arrays, over-long keys or values, \u0000 and lone
+// surrogates are errors
+class BSJsonParser {
+    public:
+        void begin();
+        uint8_t feed(const char c);
+
+        const char* key() { return _key; }
+        const char* value() { return _value; }
+        size_t valueLen() { return value_len; }
+        bool isString() { return value_string; }
+
+        // true once the closing '}' is seen -- check it after the last byte
+        bool done() { return state == STATE_DONE; }
+        const char* error() { return _error; }
+        uint32_t offset() { return consumed; }
+
+    private:
+        enum {
+            STATE_START, STATE_KEY_OR_END, STATE_COLON, STATE_VALUE, STATE_STRING,
+            STATE_ESCAPE, STATE_UNICODE, STATE_LITERAL, STATE_AFTER_VALUE, STATE_NEXT_KEY, STATE_DONE, STATE_ERROR
+        };
+
+        uint8_t fail(const char *reason);
+        bool put(const char c);
+        bool putCodePoint(const uint32_t cp);
+        uint8_t endValue();
+
+        uint8_t state;
+        bool in_key;
+        bool value_string;
+        const char *_error;
+        uint32_t consumed;
+
+        char _key[BS_JSON_KEY_LEN];
+        size_t key_len;
+        char _value[BS_JSON_VALUE_LEN];
+        size_t value_len;
+
+        uint32_t unicode;
+        uint32_t high_surrogate;
+        uint8_t unicode_digits;
+};
+#endif
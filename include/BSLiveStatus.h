@@ -0,0 +1,75 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_LIVE_STATUS_H
+#define BS_LIVE_STATUS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "BSPlatform.h"
+
+#define BS_LIVE_PATH                  "/events"
+#define BS_LIVE_MAX_VARS              16
+#define BS_LIVE_NAME_LEN              24
+#define BS_LIVE_VALUE_LEN             48
+#define BS_LIVE_EVENT_LEN             512
+
+// every subscriber costs a socket and a send queue
+#define BS_LIVE_MAX_CLIENTS           4
+#define BS_LIVE_BUSY_RETRY_MS         30000
+
+// changes are sent at most once per flush; while the average client still
+// has more than BS_LIVE_MAX_BACKLOG messages queued they keep coalescing
+#define BS_LIVE_FLUSH_MS              1000
+#define BS_LIVE_MAX_BACKLOG           4
+
+// the page that binds to the stream is static and can be cached
+#define BS_LIVE_PAGE                  "/index.html"
+#define BS_LIVE_PAGE_CACHE_CONTROL    "max-age=3600"
+
+typedef struct bs_live_var_type {
+    char name[BS_LIVE_NAME_LEN];
+    char value[BS_LIVE_VALUE_LEN];
+    bool dirty;
+} BS_LIVE_VAR_TYPE;
+
+// server-sent events status channel
+//
+// publish() only updates a table; flush() sends what changed since the last
+// flush as one "delta" event with a sequence id.  a new subscriber gets a
+// "snapshot" of the whole table instead, so a client that falls behind --
+// the server drops messages once its queue is full -- sees a gap in the
+// ids, reconnects and catches up in a single message
+class BSLiveStatus {
+    public:
+        void begin(AsyncWebServer *server);
+        bool publish(const char *name, const char *value);
+        void flush();
+
+        uint8_t clients() { return started ? source.count() : 0; }
+        void printTo(Print *out);
+
+    private:
+        void onConnect(AsyncEventSourceClient *client);
+        size_t toJson(char *out, const size_t cap, const bool all);
+
+        AsyncEventSource source = AsyncEventSource(BS_LIVE_PATH);
+        bs_mutex_t lock = bs_mutex_create();
+        bool started = false;
+
+        BS_LIVE_VAR_TYPE vars[BS_LIVE_MAX_VARS];
+        uint8_t var_count = 0;
+        uint32_t seq = 1;
+
+        uint32_t deltas = 0;
+        uint32_t snapshots = 0;
+        uint32_t deferred = 0;
+        uint32_t rejected = 0;
+        uint32_t bytes_sent = 0;
+};
+#endif
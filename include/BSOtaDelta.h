@@ -0,0 +1,100 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_OTA_DELTA_H
+#define BS_OTA_DELTA_H
+
+#include "BSOtaStream.h"
+
+#ifdef esp32
+    #include <esp_ota_ops.h>
+    #include <esp_partition.h>
+    #include <esp_task_wdt.h>
+#endif
+
+// patch layout (little endian) as produced by tools/bs_delta.py
+//
+//   "BSDP" version(1) reserved(3) base_md5(16) image_size(4) image_sha256(32)
+//   then a run of ops terminated by BS_DELTA_OP_END:
+//     BS_DELTA_OP_COPY offset(4) length(4)  -- bytes from the running image
+//     BS_DELTA_OP_ADD  length(4) bytes...   -- literal bytes
+#define BS_DELTA_MAGIC                "BSDP"
+#define BS_DELTA_VERSION              1
+#define BS_DELTA_HEADER_LEN           60
+#define BS_DELTA_MD5_LEN              16
+
+#define BS_DELTA_OP_END               0
+#define BS_DELTA_OP_COPY              1
+#define BS_DELTA_OP_ADD               2
+
+// how much of the running image is read per flash access during a copy
+#define BS_DELTA_COPY_CHUNK           512
+
+// patch parser states
+#define BS_DELTA_IDLE                 0
+#define BS_DELTA_HEADER               1
+#define BS_DELTA_OP                   2
+#define BS_DELTA_ARGS                 3
+#define BS_DELTA_LITERAL              4
+#define BS_DELTA_DONE                 5
+
+// applies a delta patch to the running image while it streams in
+//
+// the rebuilt image goes through the BSOtaStream it is given, so it is
+// written, hashed and only committed when it matches the digest carried in
+// the patch.  a patch built against a different base image is refused up
+// front (md5 of the running sketch).  RAM use is fixed: the header, one op
+// and a BS_DELTA_COPY_CHUNK flash read buffer
+class BSOtaDelta {
+    public:
+        BSOtaDelta(BSOtaStream *image);
+
+        bool begin();
+        bool write(const uint8_t *data, size_t len);
+        bool end();
+        void abort();
+
+        bool active() { return state != BS_DELTA_IDLE; }
+        const char* error();
+
+        uint32_t bytesIn() { return bytes_in; }
+        uint32_t bytesOut() { return image->bytesOut(); }
+        uint32_t elapsedMs() { return image->elapsedMs(); }
+        uint32_t bytesPerSecond();
+
+    private:
+        bool parseHeader();
+        bool parseArgs();
+        bool copyFromBase(uint32_t offset, uint32_t len);
+        bool setError(const char *msg);
+        bool fail(const char *msg);
+
+        static uint32_t readLE32(const uint8_t *p);
+
+        BSOtaStream *image;
+
+        uint8_t state = BS_DELTA_IDLE;
+        uint8_t op = BS_DELTA_OP_END;
+        uint8_t pending[BS_DELTA_HEADER_LEN];
+        uint8_t pending_len = 0;
+        uint8_t pending_need = 0;
+
+        uint32_t literal_left = 0;
+        uint32_t image_size = 0;
+        uint32_t base_size = 0;
+        uint32_t bytes_in = 0;
+
+        char last_error[BS_OTA_ERROR_LEN];
+
+        // word aligned with slack for the esp8266 flash read alignment
+        uint32_t copy_buf[(BS_DELTA_COPY_CHUNK + 8) / 4];
+
+        #ifdef esp32
+            const esp_partition_t *base = NULL;
+        #endif
+};
+#endif
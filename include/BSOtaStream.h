@@ -0,0 +1,97 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_OTA_STREAM_H
+#define BS_OTA_STREAM_H
+
+#include <Arduino.h>
+
+#ifdef esp32
+    #include <Update.h>
+    #include <mbedtls/sha256.h>
+    #include <rom/miniz.h>
+#else
+    #include <Updater.h>
+    #include <bearssl/bearssl_hash.h>
+#endif
+
+#define BS_OTA_SHA256_LEN             32
+#define BS_OTA_ERROR_LEN              48
+
+#define BS_OTA_GZIP_MAGIC_1           0x1f
+#define BS_OTA_GZIP_MAGIC_2           0x8b
+
+// gzip header parser states
+#define BS_OTA_GZ_FIXED               0
+#define BS_OTA_GZ_EXTRA_LEN           1
+#define BS_OTA_GZ_EXTRA               2
+#define BS_OTA_GZ_NAME                3
+#define BS_OTA_GZ_COMMENT             4
+#define BS_OTA_GZ_HCRC                5
+#define BS_OTA_GZ_BODY                6
+#define BS_OTA_GZ_DONE                7
+
+// streaming OTA pipeline stage
+//
+// bytes are hashed (SHA-256) as they arrive and written to the update
+// partition through a fixed buffer.  gzip images are inflated on the fly on
+// the esp32 (32 KB window); the esp8266 bootloader inflates gzip images
+// itself so they are written as-is.  end() only commits the update -- and
+// so switches the boot partition -- when the digest matches.  begin() without
+// a digest is refused unless built with BS_OTA_ALLOW_UNVERIFIED
+class BSOtaStream {
+    public:
+        bool begin(const char *sha256_hex, const int command = U_FLASH);
+        bool begin(const uint8_t *sha256, const int command = U_FLASH);
+        bool write(const uint8_t *data, size_t len);
+        bool end();
+        void abort();
+
+        bool active() { return running; }
+        bool compressed() { return gzip; }
+        const char* error() { return last_error; }
+
+        uint32_t bytesIn() { return bytes_in; }
+        uint32_t bytesOut() { return bytes_out; }
+        uint32_t elapsedMs();
+        uint32_t bytesPerSecond();
+
+    private:
+        bool writeImage(const uint8_t *data, size_t len);
+        bool setError(const char *msg);
+        void release();
+
+        #ifdef esp32
+            size_t parseGzipHeader(const uint8_t *data, size_t len);
+            bool inflate(const uint8_t *data, size_t len);
+
+            mbedtls_sha256_context sha;
+            tinfl_decompressor *inflator = NULL;
+            uint8_t *window = NULL;
+            size_t window_pos = 0;
+        #else
+            br_sha256_context sha;
+        #endif
+
+        bool running = false;
+        bool gzip = false;
+        bool sniffed = false;
+        bool verify = false;
+        uint8_t expected[BS_OTA_SHA256_LEN];
+        char last_error[BS_OTA_ERROR_LEN];
+
+        uint8_t gz_state = BS_OTA_GZ_FIXED;
+        uint8_t gz_flags = 0;
+        unsigned short gz_count = 0;
+        unsigned short gz_extra = 0;
+
+        uint32_t bytes_in = 0;
+        uint32_t bytes_out = 0;
+        unsigned long started = 0;
+        unsigned long finished = 0;
+};
+#endif
@@ -0,0 +1,216 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_PLATFORM_H
+#define BS_PLATFORM_H
+
+// the handful of primitives the platform neutral parts of the library
+// (scheduler, queues, housekeeping task) need -- esp32 (FreeRTOS, dual
+// core), esp8266 (single core, no tasks) and a pthread host build (BS_HOST)
+//
+// BS_HOST alone covers the modules that include only this header --
+// scheduler, event queue, strings, arena, templates, time, dns responder
+// and idle governor -- e.g.
+//     g++ -std=gnu++17 -DBS_HOST -Iinclude src/BSScheduler.cpp ... -lpthread
+// BS_HOST together with esp32 builds all of it, Bootstrap included, on
+// the arduino stand-ins under host/ (file backed eeprom, directory backed
+// littlefs, scripted wifi, a socket web server) -- see CMakeLists.txt
+
+#ifdef BS_HOST
+    #include <cstdint>
+    #include <cstddef>
+    #include <cstring>
+    #include <cstdlib>
+    #include <cstdio>
+    #include <cstdarg>
+    #include <functional>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+    #include <unistd.h>
+
+    #define IRAM_ATTR
+    #define BS_PLATFORM_HAS_CAS
+    #define BS_PLATFORM_HAS_TASKS
+
+    inline uint64_t bs_micros64() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    }
+    inline unsigned long millis() { return (unsigned long) (bs_micros64() / 1000); }
+    inline unsigned long micros() { return (unsigned long) bs_micros64(); }
+    inline void delay(unsigned long ms) { usleep(ms * 1000); }
+    inline void yield() { sched_yield(); }
+
+    // allocations the calling thread made so far -- the host build's malloc
+    // counts them (host/src/BSHost.cpp), nothing does for BS_HOST alone or
+    // under asan
+    extern "C" uint64_t bs_host_alloc_count() __attribute__((weak));
+    inline bool bs_alloc_counted() { return bs_host_alloc_count != NULL; }
+    inline uint64_t bs_alloc_count() { return bs_alloc_counted() ? bs_host_alloc_count() : 0; }
+
+    typedef pthread_mutex_t* bs_mutex_t;
+    typedef pthread_t bs_task_t;
+
+    inline bs_mutex_t bs_mutex_create() {
+        pthread_mutex_t *m = (pthread_mutex_t *) malloc(sizeof(pthread_mutex_t));
+        pthread_mutex_init(m, NULL);
+        return m;
+    }
+    inline void bs_mutex_lock(bs_mutex_t m) { pthread_mutex_lock(m); }
+    inline void bs_mutex_unlock(bs_mutex_t m) { pthread_mutex_unlock(m); }
+
+    typedef struct bs_task_start_type {
+        void (*fn)(void *);
+        void *arg;
+    } BS_TASK_START_TYPE;
+
+    // pthreads want void *(*)(void *) -- calling fn through a cast to that
+    // is undefined, so the thread starts here and calls it properly
+    inline void* bs_task_trampoline(void *start) {
+        const BS_TASK_START_TYPE task = *(BS_TASK_START_TYPE *) start;
+        free(start);
+        task.fn(task.arg);
+        return NULL;
+    }
+
+    // core pinning is meaningless on the host -- the scheduler decides
+    inline bool bs_task_start(void (*fn)(void *), void *arg, const char *name, const uint32_t stack, const uint8_t core, bs_task_t *task) {
+        (void) name;
+        (void) stack;
+        (void) core;
+
+        BS_TASK_START_TYPE *start = (BS_TASK_START_TYPE *) malloc(sizeof(BS_TASK_START_TYPE));
+        if (start == NULL) return false;
+        start->fn = fn;
+        start->arg = arg;
+
+        if (pthread_create(task, NULL, bs_task_trampoline, start) == 0) return true;
+        free(start);
+        return false;
+    }
+    inline void bs_task_sleep(const uint32_t ms) { usleep(ms * 1000); }
+    // BS_HOST_CORES stands in for the cpu count, so a single cpu machine
+    // can still take the dual core path (time sliced)
+    inline uint8_t bs_core_count() {
+        const char *cores = getenv("BS_HOST_CORES");
+        return (uint8_t) (cores != NULL ? atoi(cores) : sysconf(_SC_NPROCESSORS_ONLN));
+    }
+
+    class String;
+    class Printable;
+
+    // the part of arduino's Print / Stream the library talks to -- String
+    // and Printable only exist with the arduino stand-ins under host/
+    class Print {
+        public:
+            virtual ~Print() {}
+            virtual size_t write(uint8_t c) = 0;
+            virtual size_t write(const uint8_t *data, size_t n) {
+                size_t i = 0;
+                while (i < n && write(data[i]) == 1) i++;
+                return i;
+            }
+            size_t write(const char *s) { return write((const uint8_t *) s, strlen(s)); }
+            virtual void flush() {}
+
+            size_t print(const char *s) { return write(s); }
+            size_t print(char c) { return write((uint8_t) c); }
+            size_t print(int n) { return printf("%d", n); }
+            size_t print(unsigned int n) { return printf("%u", n); }
+            size_t print(long n) { return printf("%ld", n); }
+            size_t print(unsigned long n) { return printf("%lu", n); }
+            size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+            size_t print(const String &s);
+            size_t print(const Printable &p);
+
+            size_t println() { return print("\n"); }
+            template <typename T> size_t println(const T &value) { return print(value) + println(); }
+
+            size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3))) {
+                char buf[256];
+                va_list args;
+                va_start(args, format);
+                const int n = vsnprintf(buf, sizeof(buf), format, args);
+                va_end(args);
+                if (n <= 0) return 0;
+                if ((size_t) n < sizeof(buf)) return write((const uint8_t *) buf, n);
+
+                // too long for the stack, like arduino's it goes to the heap
+                char *big = (char *) malloc(n + 1);
+                if (big == NULL) return 0;
+                va_start(args, format);
+                vsnprintf(big, n + 1, format, args);
+                va_end(args);
+                const size_t written = write((const uint8_t *) big, n);
+                free(big);
+                return written;
+            }
+    };
+
+    class Stream : public Print {
+        public:
+            virtual int available() = 0;
+            virtual int read() = 0;
+            virtual int peek() { return -1; }
+            virtual size_t readBytes(char *buf, size_t n) {
+                size_t i = 0;
+                int c;
+                while (i < n && (c = read()) >= 0) buf[i++] = (char) c;
+                return i;
+            }
+    };
+
+#elif defined(esp32)
+    #include <Arduino.h>
+    #include <esp_timer.h>
+
+    #define BS_PLATFORM_HAS_CAS
+    #define BS_PLATFORM_HAS_TASKS
+
+    inline uint64_t bs_micros64() { return (uint64_t) esp_timer_get_time(); }
+
+    // the sdk keeps no count of allocations
+    inline bool bs_alloc_counted() { return false; }
+    inline uint64_t bs_alloc_count() { return 0; }
+
+    typedef SemaphoreHandle_t bs_mutex_t;
+    typedef TaskHandle_t bs_task_t;
+
+    inline bs_mutex_t bs_mutex_create() { return xSemaphoreCreateMutex(); }
+    inline void bs_mutex_lock(bs_mutex_t m) { while (xSemaphoreTake(m, portMAX_DELAY) != pdTRUE) {}; }
+    inline void bs_mutex_unlock(bs_mutex_t m) { xSemaphoreGive(m); }
+
+    inline bool bs_task_start(void (*fn)(void *), void *arg, const char *name, const uint32_t stack, const uint8_t core, bs_task_t *task) {
+        return xTaskCreatePinnedToCore(fn, name, stack, arg, 1, task, core) == pdPASS;
+    }
+    inline void bs_task_sleep(const uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms) > 0 ? pdMS_TO_TICKS(ms) : 1); }
+    inline uint8_t bs_core_count() { return portNUM_PROCESSORS; }
+
+#else
+    #include <Arduino.h>
+
+    // single core, everything runs cooperatively on the loop context
+    inline uint64_t bs_micros64() { return micros64(); }
+
+    inline bool bs_alloc_counted() { return false; }
+    inline uint64_t bs_alloc_count() { return 0; }
+
+    typedef void* bs_mutex_t;
+    typedef void* bs_task_t;
+
+    inline bs_mutex_t bs_mutex_create() { return NULL; }
+    inline void bs_mutex_lock(bs_mutex_t m) {}
+    inline void bs_mutex_unlock(bs_mutex_t m) {}
+
+    inline bool bs_task_start(void (*fn)(void *), void *arg, const char *name, const uint32_t stack, const uint8_t core, bs_task_t *task) { return false; }
+    inline void bs_task_sleep(const uint32_t ms) { delay(ms); }
+    inline uint8_t bs_core_count() { return 1; }
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_PROFILER_H
+#define BS_PROFILER_H
+
+#include <Arduino.h>
+
+#define BS_PROF_STEP_TELNET           0
+#define BS_PROF_STEP_DNS              1
+#define BS_PROF_STEP_OTA              2
+#define BS_PROF_STEP_TEMPLATE         3
+#define BS_PROF_STEP_APP              4
+#define BS_PROF_STEP_TASKS            5
+#define BS_PROF_STEP_EVENTS           6
+#define BS_PROF_MAX_STEPS             8
+
+// bucket 0 holds iterations under 64 us, each following bucket doubles
+#define BS_PROF_BUCKETS               16
+#define BS_PROF_BUCKET_SHIFT          6
+
+#define BS_PROF_DEFAULT_BUDGET_US     10000
+
+typedef struct bs_prof_step_type {
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t histogram[BS_PROF_BUCKETS];
+} BS_PROF_STEP_TYPE;
+
+// main loop iteration profiler
+//
+// an iteration runs from one begin() to the next, so it includes the time
+// the application spends in its own loop() (reported as the app step) but
+// not the time the loop slept in between (idled()).
+// every iteration lands in the histogram of the step that dominated it,
+// which is what tells you who blew the sampling deadline
+class BSProfiler {
+    public:
+        void begin();
+        void end();
+        void stepBegin(const uint8_t step);
+        void stepEnd(const uint8_t step);
+        // slept since end() -- left out of the iteration
+        void idled(const uint32_t us);
+
+        void setBudget(const uint32_t budget_us);
+        void reset();
+
+        void printTo(Print *out);
+        void printJson(Print *out);
+
+    private:
+        static uint8_t bucket(const uint32_t us);
+
+        BS_PROF_STEP_TYPE steps[BS_PROF_MAX_STEPS];
+        uint32_t iterations = 0;
+        uint32_t overruns = 0;
+        uint32_t max_iteration_us = 0;
+        uint32_t budget_us = BS_PROF_DEFAULT_BUDGET_US;
+
+        uint32_t iteration_started = 0;
+        uint32_t iteration_ended = 0;
+        uint32_t step_started = 0;
+        uint32_t idle_us = 0;
+        uint32_t step_us[BS_PROF_MAX_STEPS];
+        bool running = false;
+};
+#endif
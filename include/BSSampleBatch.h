@@ -0,0 +1,105 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_SAMPLE_BATCH_H
+#define BS_SAMPLE_BATCH_H
+
+#include <Arduino.h>
+#include <functional>
+
+#include "BSTime.h"
+
+#define BS_BATCH_MAX_CHANNELS         4
+#define BS_BATCH_DATA_LEN             384
+
+// esp8266 rtc user memory blocks (4 bytes each) the batch lives in -- after
+// the watchdog stall record (0-3) and the parked clock (4-7).  header plus
+// data is 456 bytes, the remaining 480 fit it
+#define BS_BATCH_RTC_OFFSET           8
+#define BS_BATCH_RTC_BYTES            480
+#define BS_BATCH_RTC_MAGIC            0x42415432
+
+// worst case record -- varint time delta plus a zigzag varint per channel
+#define BS_BATCH_MAX_RECORD_LEN       (5 + 5 * BS_BATCH_MAX_CHANNELS)
+
+typedef struct bs_batch_rtc_type {
+    uint32_t magic;
+    uint32_t check;
+    // 64 bits -- a 32 bit millisecond clock wraps after 49.7 days
+    uint64_t clock_ms;
+    uint32_t first_s;
+    uint32_t base_s;
+    uint32_t last_s;
+    int32_t base[BS_BATCH_MAX_CHANNELS];
+    int32_t last[BS_BATCH_MAX_CHANNELS];
+    uint16_t count;
+    uint16_t used;
+    uint16_t evicted;
+    uint8_t channels;
+    uint8_t reserved;
+    uint8_t data[BS_BATCH_DATA_LEN];
+} BS_BATCH_RTC_TYPE;
+
+static_assert(sizeof(BS_BATCH_RTC_TYPE) <= BS_BATCH_RTC_BYTES, "sample batch does not fit rtc user memory");
+
+class BSSampleBatch;
+
+// hands the whole batch over in one go, true once it is on its way
+typedef std::function<bool(BSSampleBatch *batch)> BSSampleSink;
+typedef std::function<void(const uint32_t t_s, const int32_t *values)> BSSampleVisitor;
+
+// rtc memory sample batching across deep sleep
+//
+// every sample is stored as the difference to the one before it -- seconds
+// since the previous sample as a varint, each channel as a zigzag varint --
+// so a slowly moving sensor costs two or three bytes a wake.  time is a
+// batch clock (uptime plus every deep sleep since the batch started) that
+// needs neither wifi nor ntp; epochOffset() maps it to wall time once the
+// clock is known.  when a flush keeps failing the oldest samples are
+// dropped to make room
+class BSSampleBatch {
+    public:
+        void begin(const uint8_t channels, const uint32_t max_age_s, BSSampleSink sink);
+        bool enabled() { return _channels > 0; }
+
+        bool add(const int32_t *values);
+        bool flushDue();
+        bool flush();
+        void clear();
+
+        uint16_t count() { return rec.count; }
+        uint16_t bytesUsed() { return rec.used; }
+        uint16_t evicted() { return rec.evicted; }
+        uint8_t channels() { return rec.channels; }
+        uint32_t clockS();
+        uint32_t epochOffset();
+
+        void forEach(BSSampleVisitor visitor);
+        const uint8_t* encoded() { return rec.data; }
+        void printJson(Print *out);
+
+        void prepareDeepSleep(const uint64_t sleep_us);
+        void restore(const bool woke_from_deep_sleep);
+
+        void printTo(Print *out);
+
+    private:
+        size_t decode(const size_t pos, uint32_t *t_s, int32_t *values);
+        void evictOldest();
+        uint32_t checksum();
+
+        static size_t putVarint(uint8_t *out, uint32_t v);
+        static size_t getVarint(const uint8_t *in, const size_t len, uint32_t *v);
+
+        BS_BATCH_RTC_TYPE rec = {};
+        uint8_t _channels = 0;
+        uint32_t max_age_s = 0;
+        BSSampleSink sink = NULL;
+        uint32_t flushes = 0;
+        uint32_t failed_flushes = 0;
+};
+#endif
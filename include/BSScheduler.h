@@ -0,0 +1,65 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_SCHEDULER_H
+#define BS_SCHEDULER_H
+
+#include "BSPlatform.h"
+
+#define BS_SCHED_MAX_TASKS            16
+#define BS_SCHED_DEFAULT_BUDGET_MS    20
+#define BS_SCHED_NO_TASK              0
+
+#define BS_SCHED_PRIORITY_LOW         0
+#define BS_SCHED_PRIORITY_NORMAL      1
+// high priority tasks run even when the iteration budget is exhausted
+#define BS_SCHED_PRIORITY_HIGH        2
+
+typedef std::function<void()> BSTask;
+
+typedef struct bs_sched_task_type {
+    uint32_t due;
+    uint32_t period;
+    unsigned short id;
+    uint8_t priority;
+    BSTask callable;
+} BS_SCHED_TASK_TYPE;
+
+// cooperative one-shot / periodic task scheduler
+//
+// tasks live in a fixed size min-heap ordered by deadline (then priority).
+// deadlines are compared wrap-safe so millis() rolling over after ~49 days
+// is harmless.  run() executes everything that is due until the per
+// iteration budget is used up; what is left over runs on the next call
+class BSScheduler {
+    public:
+        unsigned short once(const uint32_t delay_ms, BSTask callable, const uint8_t priority = BS_SCHED_PRIORITY_NORMAL);
+        unsigned short every(const uint32_t period_ms, BSTask callable, const uint8_t priority = BS_SCHED_PRIORITY_NORMAL);
+        bool cancel(const unsigned short id);
+        bool pending(const unsigned short id);
+
+        void run(const uint32_t budget_ms = BS_SCHED_DEFAULT_BUDGET_MS);
+        bool nextDeadline(uint32_t *ms_until);
+        uint8_t count() { return task_count; }
+
+    private:
+        unsigned short add(const uint32_t delay_ms, const uint32_t period_ms, BSTask callable, const uint8_t priority);
+        bool before(const BS_SCHED_TASK_TYPE *a, const BS_SCHED_TASK_TYPE *b);
+        void siftUp(uint8_t i);
+        void siftDown(uint8_t i);
+        void removeAt(const uint8_t i);
+
+        void lock();
+        void unlock();
+
+        BS_SCHED_TASK_TYPE tasks[BS_SCHED_MAX_TASKS];
+        uint8_t task_count = 0;
+        unsigned short next_id = 1;
+
+        bs_mutex_t sched_mutex = bs_mutex_create();
+};
+#endif
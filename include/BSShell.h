@@ -0,0 +1,70 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_SHELL_H
+#define BS_SHELL_H
+
+#include <Arduino.h>
+
+#define BS_SHELL_LINE_LEN             96
+#define BS_SHELL_MAX_ARGS             8
+
+// Bootstrap's own commands (one fewer without BS_USE_PROFILER) and room on
+// top for the application's -- define BS_SHELL_APP_COMMANDS to reserve more
+#define BS_SHELL_BUILTIN_COMMANDS     21
+#ifndef BS_SHELL_APP_COMMANDS
+    #define BS_SHELL_APP_COMMANDS     12
+#endif
+#define BS_SHELL_MAX_COMMANDS         (BS_SHELL_BUILTIN_COMMANDS + BS_SHELL_APP_COMMANDS)
+
+#define BS_SHELL_PROMPT_TIMEOUT_MS    30000
+
+typedef std::function<void(int argc, char **argv)> BSShellCommand;
+typedef std::function<void(const char *line)> BSShellPrompt;
+
+typedef struct bs_shell_command_type {
+    const char *name;
+    const char *help;
+    BSShellCommand callable;
+} BS_SHELL_COMMAND_TYPE;
+
+// line oriented command shell
+//
+// characters are consumed incrementally from a fixed line buffer -- step()
+// never waits for input so it is safe to call once per loop().  a command
+// can hand the next line to a prompt callback instead of the dispatcher
+// which is how multi-step interactions (SSID / password entry) are handled
+class BSShell {
+    public:
+        void begin(Stream *io);
+        void step();
+
+        bool addCommand(const char *name, const char *help, BSShellCommand callable);
+        void prompt(const char *text, BSShellPrompt callable);
+        void cancelPrompt();
+        void printHelp();
+
+        bool feed(const char c);
+        void dispatch();
+
+    private:
+        unsigned char tokenize(char **argv);
+
+        Stream *_io = NULL;
+
+        char line[BS_SHELL_LINE_LEN];
+        unsigned short line_len = 0;
+        bool line_overflow = false;
+        bool line_ready = false;
+
+        BS_SHELL_COMMAND_TYPE commands[BS_SHELL_MAX_COMMANDS];
+        unsigned char command_count = 0;
+
+        BSShellPrompt prompt_callback = NULL;
+        unsigned long prompt_started = 0;
+};
+#endif
@@ -0,0 +1,97 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_STRING_H
+#define BS_STRING_H
+
+#include "BSPlatform.h"
+#include <stdarg.h>
+
+// fixed capacity string -- lives wherever it is declared (stack, member,
+// static) and never touches the heap.  anything that does not fit is
+// dropped and remembered in truncated().  N includes the terminator
+template <size_t N>
+class BSString : public Print {
+    static_assert(N > 1, "BSString needs room for at least one character");
+
+    public:
+        BSString() { clear(); }
+        BSString(const char *s) { clear(); append(s); }
+
+        size_t write(uint8_t c) override {
+            if (len >= N - 1) {
+                overflow = true;
+                return 0;
+            }
+            buf[len++] = c;
+            buf[len] = '\0';
+            return 1;
+        }
+        size_t write(const uint8_t *data, size_t n) override {
+            return append((const char *) data, n);
+        }
+
+        size_t append(const char *s) {
+            return s == NULL ? 0 : append(s, strlen(s));
+        }
+        size_t append(const char *s, size_t n) {
+            if (n > N - 1 - len) {
+                n = N - 1 - len;
+                overflow = true;
+            }
+            memcpy(buf + len, s, n);
+            len += n;
+            buf[len] = '\0';
+            return n;
+        }
+
+        // formats straight into the buffer -- Print::printf would malloc for
+        // anything longer than its small stack buffer
+        size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3))) {
+            va_list args;
+            va_start(args, format);
+            const int n = vsnprintf(buf + len, N - len, format, args);
+            va_end(args);
+
+            if (n < 0) {
+                buf[len] = '\0';
+                return 0;
+            }
+            if ((size_t) n > N - 1 - len) {
+                overflow = true;
+                const size_t added = N - 1 - len;
+                len = N - 1;
+                return added;
+            }
+            len += n;
+            return n;
+        }
+
+        BSString& operator=(const char *s) { clear(); append(s); return *this; }
+        BSString& operator+=(const char *s) { append(s); return *this; }
+        BSString& operator+=(const char c) { write((uint8_t) c); return *this; }
+
+        bool operator==(const char *s) const { return s != NULL && strcmp(buf, s) == 0; }
+        bool operator!=(const char *s) const { return !(*this == s); }
+
+        void clear() {
+            len = 0;
+            buf[0] = '\0';
+            overflow = false;
+        }
+
+        const char* c_str() const { return buf; }
+        size_t length() const { return len; }
+        size_t capacity() const { return N - 1; }
+        bool truncated() const { return overflow; }
+
+    private:
+        char buf[N];
+        size_t len;
+        bool overflow;
+};
+#endif
@@ -0,0 +1,159 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_TELEMETRY_H
+#define BS_TELEMETRY_H
+
+#include <Arduino.h>
+#include "LittleFS.h"
+
+#ifdef esp32
+    #include <AsyncTCP.h>
+#else
+    #include <ESPAsyncTCP.h>
+#endif
+
+#include "BSPlatform.h"
+#include "BSString.h"
+
+#define BS_TELEMETRY_DIR              "/tq"
+#define BS_TELEMETRY_PATH_LEN         24
+#define BS_TELEMETRY_HOST_LEN         64
+#define BS_TELEMETRY_URL_PATH_LEN     96
+#define BS_TELEMETRY_AUTH_LEN         96
+#define BS_TELEMETRY_HEAD_LEN         384
+#define BS_TELEMETRY_CONTENT_TYPE     "application/x-ndjson"
+
+// records wait in ram, one line each, until batched or spilled
+#define BS_TELEMETRY_RING_LEN         16
+#define BS_TELEMETRY_RECORD_LEN       96
+
+// a batch is sent once it is full or its oldest record is this old
+#define BS_TELEMETRY_BATCH_BYTES      1024
+#define BS_TELEMETRY_BATCH_RECORDS    32
+#define BS_TELEMETRY_LINGER_MS        5000
+
+// the spill log -- the oldest segment goes when it would grow past the cap
+#define BS_TELEMETRY_SEGMENT_BYTES    4096
+#define BS_TELEMETRY_MAX_SEGMENTS     8
+
+#define BS_TELEMETRY_POLL_MS          250
+#define BS_TELEMETRY_TIMEOUT_MS       10000
+#define BS_TELEMETRY_BACKOFF_MIN_MS   2000
+#define BS_TELEMETRY_BACKOFF_MAX_MS   300000
+
+#define BS_TELEMETRY_BATCH_NONE       0
+#define BS_TELEMETRY_BATCH_RAM        1
+#define BS_TELEMETRY_BATCH_SEGMENT    2
+
+typedef struct bs_telemetry_record_type {
+    uint8_t len;
+    char data[BS_TELEMETRY_RECORD_LEN];
+} BS_TELEMETRY_RECORD_TYPE;
+
+// store-and-forward queue for outbound records
+//
+// enqueue() only touches the ram ring (or, when it is full, appends to the
+// spill log) so it never blocks on the network.  process() runs from the
+// scheduler: offline it moves the ring to littlefs, online it drains the
+// log first and then the ring, oldest first, as newline delimited batches
+// POSTed over a non-blocking AsyncClient.  a batch stays put until the
+// endpoint answers 2xx (or rejects it with a 4xx), failures back off
+// exponentially with jitter.  delivery is at least once -- after a reboot
+// the log is resent from the start of its oldest segment
+class BSTelemetry {
+    public:
+        bool setEndpoint(const char *url);
+        void setAuthorization(const char *value);
+        bool enabled() { return host.length() > 0; }
+
+        bool begin(const char *dir = BS_TELEMETRY_DIR);
+        bool stored() { return store_ready; }
+
+        // false when the record was not taken -- too long, has a newline
+        // or there is nowhere left to put it
+        bool enqueue(const char *record);
+
+        void process(const bool online);
+        // the ring and any batch still in ram go to the log, before a
+        // reboot or deep sleep
+        void persist();
+        bool needsStore(const bool online);
+
+        uint16_t pending() { return ring_count; }
+        uint32_t storedBytes() { return store_bytes; }
+        bool inFlight() { return state != STATE_IDLE; }
+
+        uint32_t delivered() { return records_delivered; }
+        uint32_t dropped() { return records_dropped; }
+        uint32_t rejected() { return records_rejected; }
+
+        void printTo(Print *out);
+
+    private:
+        enum { STATE_IDLE, STATE_CONNECTING, STATE_SENT, STATE_DONE };
+
+        void spillRing();
+        bool spill(const BS_TELEMETRY_RECORD_TYPE *record);
+        bool append(const char *data, const size_t len, const uint16_t records);
+        void dropOldestSegment();
+        bool buildBatch();
+        void send();
+        void resolve();
+        void path(char *out, const uint32_t seq);
+
+        void wireClient();
+        void onConnect();
+        void onData(const char *data, const size_t len);
+
+        bs_mutex_t lock = bs_mutex_create();
+
+        BSString<BS_TELEMETRY_HOST_LEN> host;
+        uint16_t port = 80;
+        BSString<BS_TELEMETRY_URL_PATH_LEN> url_path;
+        BSString<BS_TELEMETRY_AUTH_LEN> authorization;
+
+        BS_TELEMETRY_RECORD_TYPE ring[BS_TELEMETRY_RING_LEN];
+        uint16_t ring_head = 0;
+        uint16_t ring_count = 0;
+        unsigned long oldest_ms = 0;
+
+        bool store_ready = false;
+        bool store_tried = false;
+        char dir[BS_TELEMETRY_PATH_LEN] = "";
+        uint32_t head_seq = 0;
+        uint32_t tail_seq = 0;
+        uint32_t head_offset = 0;
+        uint32_t store_bytes = 0;
+
+        char batch[BS_TELEMETRY_BATCH_BYTES];
+        size_t batch_len = 0;
+        uint16_t batch_records = 0;
+        uint8_t batch_source = BS_TELEMETRY_BATCH_NONE;
+        uint32_t batch_end = 0;
+
+        AsyncClient client;
+        bool client_wired = false;
+        BSString<BS_TELEMETRY_HEAD_LEN> head;
+        volatile uint8_t state = STATE_IDLE;
+        volatile int http_status = 0;
+        unsigned long sent_ms = 0;
+        unsigned long next_attempt_ms = 0;
+        unsigned long backoff_ms = BS_TELEMETRY_BACKOFF_MIN_MS;
+
+        uint32_t records_enqueued = 0;
+        uint32_t records_delivered = 0;
+        uint32_t records_dropped = 0;
+        uint32_t records_rejected = 0;
+        uint32_t records_spilled = 0;
+        uint32_t batches_sent = 0;
+        uint32_t batches_failed = 0;
+        uint32_t bytes_sent = 0;
+        int last_status = 0;
+        unsigned long last_rtt_ms = 0;
+};
+#endif
@@ -0,0 +1,31 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_TEMPLATE_H
+#define BS_TEMPLATE_H
+
+#include "BSPlatform.h"
+#include <functional>
+
+#define BS_TEMPLATE_TOKEN_LEN         32
+#define BS_TEMPLATE_CHUNK_LEN         128
+#define BS_TEMPLATE_OUT_LEN           128
+
+// returns the replacement for a {token} or NULL to leave it as is
+typedef std::function<const char*(const char *token)> BSTemplateResolver;
+
+// streaming {token} renderer
+//
+// reads the template a chunk at a time and writes the result as it goes, so
+// memory use is fixed no matter how big the page is.  a token is
+// {[A-Za-z0-9_]+} of at most BS_TEMPLATE_TOKEN_LEN characters -- anything
+// else (css and script blocks) passes through untouched
+class BSTemplate {
+    public:
+        static bool render(Stream *in, Print *out, BSTemplateResolver resolve);
+};
+#endif
@@ -0,0 +1,85 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_TIME_H
+#define BS_TIME_H
+
+#include "BSPlatform.h"
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef BS_HOST
+    // the host clock is already kept by the os
+#elif defined(esp32)
+    #include <esp_sntp.h>
+#else
+    #include <coredecls.h>
+#endif
+
+#define BS_TIME_STRING_LEN            24
+
+// anything before 2020-01-01 means the wall clock has not been set
+#define BS_TIME_VALID_EPOCH           1577836800
+
+// esp8266 rtc user memory blocks (4 bytes each) the clock is parked in
+// across deep sleep -- right after the watchdog stall record
+#define BS_TIME_RTC_OFFSET            4
+#define BS_TIME_RTC_MAGIC             0x54494d45
+
+typedef struct bs_time_rtc_type {
+    uint32_t magic;
+    uint32_t epoch_s;
+    uint32_t sleep_ms;
+    uint32_t check;
+} BS_TIME_RTC_TYPE;
+
+// wall clock and timestamp service
+//
+// now() re-formats only when the second changes, so it is cheap enough to
+// call from every render and log line.  sntp runs in the background -- no
+// call here ever waits for it.  every sync is compared against where the
+// local clock would have been to track crystal drift.  until the first
+// sync the timestamp is seconds of uptime, unless a deep sleep left an
+// estimate behind (the esp32 rtc keeps time across deep sleep on its own)
+class BSTime {
+    public:
+        void begin(const char *ntp_server, const char *tz);
+        void setTimeZone(const char *tz);
+
+        const char* now();
+        static uint64_t micros64() { return bs_micros64(); }
+
+        bool valid();
+        bool synced() { return sync_count > 0; }
+        bool estimated() { return restored && sync_count == 0; }
+
+        uint32_t syncCount() { return sync_count; }
+        uint32_t lastSyncAgeS();
+        int32_t driftPpm() { return drift_ppm; }
+        int32_t lastCorrectionMs() { return last_correction_ms; }
+
+        void prepareDeepSleep(const uint64_t sleep_us);
+        void restore(const bool woke_from_deep_sleep);
+
+        void printTo(Print *out);
+
+    private:
+        static void onSync();
+        static BSTime *instance;
+
+        char cached[BS_TIME_STRING_LEN];
+        time_t cached_key = -1;
+        bool cached_wall = false;
+
+        volatile uint32_t sync_count = 0;
+        volatile int32_t drift_ppm = 0;
+        volatile int32_t last_correction_ms = 0;
+        uint64_t last_sync_mono_us = 0;
+        int64_t last_sync_wall_us = 0;
+        bool restored = false;
+};
+#endif
@@ -0,0 +1,175 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_TIME_SERIES_H
+#define BS_TIME_SERIES_H
+
+#include <Arduino.h>
+#include "LittleFS.h"
+
+#include "BSPlatform.h"
+#include "BSTime.h"
+
+#define BS_TS_DIR                     "/ts"
+#define BS_TS_PATH_LEN                24
+#define BS_TS_MAX_SERIES              8
+
+// records wait in ram until compacted -- on a timer, or when the ring fills
+#define BS_TS_RING_LEN                128
+#define BS_TS_COMPACT_MS              300000
+
+// a block is at most 64 records; worst case a record costs 80 bits
+// (36 for the timestamp, 44 for the value)
+#define BS_TS_BLOCK_MAX_RECORDS       64
+#define BS_TS_BLOCK_MAX_BYTES         640
+#define BS_TS_BLOCK_MAGIC             0x31425354
+
+// each series keeps a current and a previous file of at most this size
+#define BS_TS_MAX_FILE_BYTES          32768
+
+#define BS_TS_DEFAULT_POINTS          120
+#define BS_TS_OUT_LEN                 96
+
+typedef struct bs_ts_record_type {
+    uint32_t t;
+    float value;
+    uint8_t series;
+} BS_TS_RECORD_TYPE;
+
+typedef struct bs_ts_block_type {
+    uint32_t magic;
+    uint32_t t_first;
+    uint32_t t_last;
+    float v_min;
+    float v_max;
+    uint16_t count;
+    uint16_t bytes;
+} BS_TS_BLOCK_TYPE;
+
+// gorilla (facebook tsdb) style block encoder / decoder -- timestamps as a
+// delta of deltas in 1 to 36 bits, values as the xor to the previous value
+// with its leading / trailing zeros elided
+class BSTimeSeriesCodec {
+    public:
+        void begin(uint8_t *buf, const size_t cap);
+        bool append(const uint32_t t, const float value);
+        bool full();
+        size_t bytes() { return (bits + 7) / 8; }
+
+        void open(uint8_t *buf, const BS_TS_BLOCK_TYPE *block);
+        bool next(uint32_t *t, float *value);
+
+        BS_TS_BLOCK_TYPE header;
+
+    private:
+        void put(const uint32_t v, const uint8_t n);
+        uint32_t get(const uint8_t n);
+
+        uint8_t *buf = NULL;
+        size_t cap = 0;
+        size_t bits = 0;
+
+        uint32_t prev_t = 0;
+        int32_t prev_delta = 0;
+        uint32_t prev_bits = 0;
+        uint8_t leading = 0xff;
+        uint8_t trailing = 0;
+        uint16_t done = 0;
+};
+
+class BSTimeSeriesQuery;
+
+// on-device time series store
+//
+// record() only touches the ram ring; compact() moves it to littlefs one
+// block per series at a time.  files rotate instead of growing, so the
+// store never holds more than 2 x BS_TS_MAX_FILE_BYTES per series.  queries
+// walk the blocks (skipping the ones out of range by header) and then the
+// ring, one block in memory at a time
+class BSTimeSeries {
+    friend class BSTimeSeriesQuery;
+
+    public:
+        bool begin(const char *dir = BS_TS_DIR);
+        bool record(const uint8_t series, const float value);
+        void compact();
+        bool ready() { return lock != NULL; }
+
+        uint32_t records() { return recorded; }
+        uint32_t dropped() { return dropped_records; }
+        uint32_t blocks() { return blocks_written; }
+        uint32_t bytesWritten() { return bytes_written; }
+        uint16_t pending() { return ring_count; }
+
+        void printTo(Print *out);
+
+    private:
+        void compactSeries(const uint8_t series);
+        bool writeBlock(const uint8_t series, BSTimeSeriesCodec *codec);
+        void path(char *out, const uint8_t series, const bool old);
+
+        bs_mutex_t lock = NULL;
+        char dir[BS_TS_PATH_LEN] = "";
+
+        BS_TS_RECORD_TYPE ring[BS_TS_RING_LEN];
+        uint16_t ring_head = 0;
+        uint16_t ring_count = 0;
+        uint8_t block_buf[BS_TS_BLOCK_MAX_BYTES];
+
+        volatile uint32_t generation = 0;
+        volatile uint32_t compactions = 0;
+
+        uint32_t recorded = 0;
+        uint32_t dropped_records = 0;
+        uint32_t blocks_written = 0;
+        uint32_t bytes_written = 0;
+};
+
+// one streaming min / max / avg query -- fill() hands out json as the
+// response asks for it, nothing is buffered beyond the current block
+class BSTimeSeriesQuery {
+    public:
+        BSTimeSeriesQuery(BSTimeSeries *store, const uint8_t series, const uint32_t from, const uint32_t to, const uint32_t step);
+        size_t fill(uint8_t *out, const size_t max_len);
+
+    private:
+        enum { STATE_HEADER, STATE_FILES, STATE_RING, STATE_FOOTER, STATE_DONE };
+
+        bool produce();
+        bool nextBlock();
+        void accumulate(const uint32_t t, const float value);
+        void emit();
+
+        BSTimeSeries *store;
+        uint8_t series;
+        uint32_t from;
+        uint32_t to;
+        uint32_t step;
+
+        uint8_t state = STATE_HEADER;
+        uint8_t file_index = 0;
+        uint32_t file_offset = 0;
+        uint32_t generation = 0;
+        uint32_t compactions = 0;
+        uint16_t ring_index = 0;
+        bool in_block = false;
+
+        BSTimeSeriesCodec codec;
+        uint8_t block_buf[BS_TS_BLOCK_MAX_BYTES];
+
+        uint32_t bucket = 0;
+        uint32_t n = 0;
+        float v_min = 0;
+        float v_max = 0;
+        double sum = 0;
+        bool first_point = true;
+
+        char out_buf[BS_TS_OUT_LEN];
+        size_t out_len = 0;
+        size_t out_pos = 0;
+};
+#endif
@@ -0,0 +1,85 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_WATCHDOG_H
+#define BS_WATCHDOG_H
+
+#include <Arduino.h>
+
+// the isr runs once per tick and checks every armed channel
+#define BS_WDT_TICK_US                1000000
+#define BS_WDT_MAX_CHANNELS           8
+
+#define BS_WDT_CHANNEL_LOOP           0
+#define BS_WDT_CHANNEL_WEB            1
+#define BS_WDT_CHANNEL_WIFI           2
+#define BS_WDT_CHANNEL_TEMPLATE       3
+#define BS_WDT_CHANNEL_OTA            4
+#define BS_WDT_CHANNEL_APP            5
+#define BS_WDT_CHANNEL_BENCH          6
+
+#define BS_WDT_STALL_MAGIC            0x57445447
+
+// esp8266 rtc user memory block (4 bytes each) the stall record lives at
+#define BS_WDT_RTC_OFFSET             0
+
+typedef struct bs_wdt_stall_type {
+    uint32_t magic;
+    uint32_t channel;
+    uint32_t checkpoint;
+    uint32_t uptime_s;
+} BS_WDT_STALL_TYPE;
+
+// multi-channel software watchdog
+//
+// every subsystem owns a channel with its own deadline (in seconds).  a
+// channel is only checked while it is armed, so work that happens in bursts
+// (web handlers, template renders, OTA) arms on entry and idles on exit.
+// refresh() is a compare and a store so it can be called from hot loops, a
+// channel out of range is ignored.  the checkpoint id is free-form --
+// Bootstrap uses the source line number
+class BSWatchdog {
+    public:
+        static void begin();
+        static void setChannel(const uint8_t channel, const char *name, const unsigned short timeout_s);
+
+        static void arm(const uint8_t channel, const unsigned short checkpoint = 0) {
+            if (channel >= BS_WDT_MAX_CHANNELS) return;
+            beats[channel] = ticks;
+            checkpoints[channel] = checkpoint;
+            armed[channel] = true;
+        }
+        static void idle(const uint8_t channel) {
+            if (channel >= BS_WDT_MAX_CHANNELS) return;
+            armed[channel] = false;
+        }
+        static inline void refresh(const uint8_t channel) {
+            if (channel >= BS_WDT_MAX_CHANNELS) return;
+            beats[channel] = ticks;
+        }
+        static inline void checkpoint(const uint8_t channel, const unsigned short id) {
+            if (channel >= BS_WDT_MAX_CHANNELS) return;
+            checkpoints[channel] = id;
+            beats[channel] = ticks;
+        }
+
+        static bool lastStall(BS_WDT_STALL_TYPE *stall);
+        static const char* channelName(const uint8_t channel);
+
+    private:
+        static void IRAM_ATTR tick();
+
+        static volatile uint32_t ticks;
+        static volatile uint32_t beats[BS_WDT_MAX_CHANNELS];
+        static volatile unsigned short checkpoints[BS_WDT_MAX_CHANNELS];
+        static volatile bool armed[BS_WDT_MAX_CHANNELS];
+        static unsigned short timeouts[BS_WDT_MAX_CHANNELS];
+        static const char *names[BS_WDT_MAX_CHANNELS];
+
+        static BS_WDT_STALL_TYPE last_stall;
+};
+#endif
@@ -42,6 +42,16 @@ static TelnetSpy *SandT;
     #define BS_LOG_FLUSH()
 #endif
 
+#ifdef BS_USE_PROFILER
+    #define BS_PROFILE_BEGIN()           profiler.begin()
+    #define BS_PROFILE_END()             profiler.end()
+    #define BS_PROFILE_STEP(step, ...)   { profiler.stepBegin(step); __VA_ARGS__; profiler.stepEnd(step); }
+#else
+    #define BS_PROFILE_BEGIN()
+    #define BS_PROFILE_END()
+    #define BS_PROFILE_STEP(step, ...)   { __VA_ARGS__; }
+#endif
+
 // LED is connected to GPIO2 on these boards
 #ifdef esp32
     #define INIT_LED { pinMode(2, OUTPUT); digitalWrite(2, LOW); }
@@ -62,6 +72,10 @@ static TelnetSpy *SandT;
 
 #define WATCHDOG_TIMEOUT_S 15
 
+// BS_USE_DUAL_CORE runs housekeeping as its own task on the other core
+#define BS_HOUSEKEEPING_CORE          0
+#define BS_HOUSEKEEPING_STACK         8192
+
 #ifdef esp32
     #include <WiFi.h>
     #include <AsyncTCP.h>
@@ -69,11 +83,7 @@ static TelnetSpy *SandT;
     #include <rom/rtc.h>
 
     #define WIFI_DISCONNECTED WIFI_EVENT_STA_DISCONNECTED
-
-    static hw_timer_t* watchDogTimer = NULL;
-
 #else
-    #define USING_TIM_DIV256 true
     #define WIFI_DISCONNECTED WIFI_EVENT_STAMODE_DISCONNECTED
     #define FILE_READ "r"
     #define FILE_WRITE "w"
@@ -81,29 +91,88 @@ static TelnetSpy *SandT;
 
     #include <ESP8266Wifi.h>
     #include <ESPAsyncTCP.h>
-    #include "ESP8266TimerInterrupt.h"
-
-    static volatile bool timer_pinged;
 #endif
 
-#include <DNSServer.h>
 #include <EEPROM.h>
 #include "LittleFS.h"
 
 #include <ESPAsyncWebServer.h>
 #include <ElegantOTA.h>
 
+#include "BSPlatform.h"
+#include "BSShell.h"
+#include "BSWatchdog.h"
+#include "BSProfiler.h"
+#include "BSScheduler.h"
+#include "BSEventQueue.h"
+#include "BSOtaStream.h"
+#include "BSOtaDelta.h"
+#include "BSString.h"
+#include "BSArena.h"
+#include "BSTemplate.h"
+#include "BSHeapMonitor.h"
+#include "BSTime.h"
+#include "BSDnsResponder.h"
+#include "BSSampleBatch.h"
+#include "BSIdleGovernor.h"
+#include "BSTimeSeries.h"
+#include "BSBench.h"
+#include "BSLiveStatus.h"
+#include "BSJson.h"
+#include "BSAssets.h"
+#include "BSFiles.h"
+#include "BSTelemetry.h"
+#include <memory>
+
 #define HOSTNAME_LEN                  32
 #define WIFI_SSID_LEN                 32
 #define WIFI_SSID_PWD_LEN             64
 #define WIFI_BSSID_LEN                6
+#define PROJECT_NAME_LEN              64
+#define NTP_SERVER_LEN                64
+#define TZ_LEN                        48
+#define BS_TEMPLATE_PATH_LEN          48
+
+// a /save carries at most this many name / value pairs
+#define BS_CONFIG_MAX_PARAMS          16
+// a /save carrying this parameter goes the whole way to loop() and is
+// checked against a copy there -- nothing applied, nothing written
+#define BS_CONFIG_DRY_RUN             "bs_dry_run"
+
+// secrets read back as this, and writing it back leaves them unchanged
+#define BS_CONFIG_REDACTED            "********"
+#define BS_CONFIG_MAX_EXTRA           8
+#define BS_API_CONFIG_MAX_BODY        1024
+
+// with fast boot, littlefs, ota and the web server come up this long
+// after the first loop
+#define BS_BOOT_DEFER_MS              1000
 
 #define RESET_REASON_DEEP_SLEEP_AWAKE 5
 #define DEFAULT_HOSTNAME              HOSTNAME
+#define DEFAULT_NTP_SERVER            "pool.ntp.org"
+#define DEFAULT_TZ                    "EST+5EDT,M3.2.0/2,M11.1.0/2"
 
 #define CFG_NOT_SET                   0x0
 #define CFG_SET                       0x9
 
+// the stored config is this header, then CONFIG_TYPE and the app's fields
+// behind it.  an image without the header was written before ntp server
+// and tz joined CONFIG_TYPE and is moved into the current layout on load
+#define BS_CONFIG_MAGIC               "BSC"
+#define BS_CONFIG_VERSION             2
+#define BS_CONFIG_HEADER_LEN          4
+
+// pages waiting for a render -- bits of a flag rather than events, so a
+// full queue cannot lose one and a second ask before it runs is free
+#define BS_RENDER_SETUP               0x1
+#define BS_RENDER_INDEX               0x2
+
+// where a queued benchmark run prints its results when done
+#define BS_BENCH_REPORT_NONE          0
+#define BS_BENCH_REPORT_TEXT          1
+#define BS_BENCH_REPORT_JSON          2
+
 #define LOCK_STATE_LOCK               0
 #define LOCK_STATE_UNLOCK             1
 
@@ -118,90 +187,295 @@ typedef struct config_type {
     char ssid_pwd[WIFI_SSID_PWD_LEN];
     tiny_int bssid_flag;
     byte bssid[WIFI_BSSID_LEN];
+    tiny_int ntp_server_flag;
+    char ntp_server[NTP_SERVER_LEN];
+    tiny_int tz_flag;
+    char tz[TZ_LEN];
+    // the block from ntp_server_flag on is a multiple of 8 bytes, so the
+    // app's fields moved by exactly that much whatever their alignment
+    byte reserved[6];
 } CONFIG_TYPE;
 
+typedef struct bs_config_item_type {
+    const char *name;
+    unsigned short max_len;
+    bool secret;
+} BS_CONFIG_ITEM_TYPE;
+
+// name\0value\0 pairs on their way to loop() -- data follows the struct
+// in the same heap block, which travels through the event queue as a
+// pointer and is freed once applied
+typedef struct bs_config_update_type {
+    unsigned short len;
+    unsigned short size;
+    bool dry_run;
+    char *data;
+} BS_CONFIG_UPDATE_TYPE;
+
+// one POST /api/config in flight -- plain data, lives in the request's
+// _tempObject until the body is complete.  the staging area follows it,
+// sized for every registered item at its longest
+typedef struct bs_api_config_type {
+    BSJsonParser parser;
+    BS_CONFIG_UPDATE_TYPE staged;
+    const char *error;
+    unsigned short status;
+    tiny_int items;
+} BS_API_CONFIG_TYPE;
+
+typedef std::function<void(const char *item, const char *value)> BSConfigItemCallback;
+// a web route -- sends its response (Bootstrap::respond) and returns what the
+// log line says about the request
+typedef std::function<const char*(AsyncWebServerRequest *request)> BSWebRoute;
+
 class Bootstrap {
     public:
         #ifdef BS_USE_TELNETSPY
-            Bootstrap(String project_name, TelnetSpy *spy, long serial_baud_rate=1500000);
-            void setExtraRemoteCommands(std::function<void(char c)> callable);
-            const String builtInRemoteCommandsMenu = "\n\nCommands:\n\nC = Current Timestamp\nD = Disconnect WiFi\nF = Filesystem Info\nS - Set SSID / Password\nB - Clear saved BSSID (if set)\nL = Reload Config\nW = Wipe Config\nX = Close Session\nR = Reboot ESP\n";
+            Bootstrap(const char *project_name, TelnetSpy *spy, long serial_baud_rate=1500000);
+            bool addRemoteCommand(const char *name, const char *help, BSShellCommand callable);
         #else
-            Bootstrap(String project_name);
+            Bootstrap(const char *project_name);
         #endif
 
         bool setup();
         void loop();
+
+        // fast boot -- setup() returns once config and wifi are up, littlefs,
+        // ota and the web server follow from the scheduler defer_ms into the
+        // loop, or as soon as something needs them.  call before setup()
+        void useFastBoot(const unsigned long defer_ms = BS_BOOT_DEFER_MS);
+        // wire whatever fast boot left for later, now -- from the loop task
+        void ensureServices();
+        bool ensureLittleFS();
+        // setup() duration and millis() at the first loop()
+        void printBootTimes(Print *out);
         void watchDogRefresh();
+        void watchDogRefresh(const tiny_int channel);
+        void watchDogCheckpoint(const tiny_int channel, const unsigned short id);
+        // BS_WDT_CHANNEL_APP is the application's -- once armed it has to be
+        // refreshed within WATCHDOG_TIMEOUT_S until idled again, or the device
+        // restarts and reports the stall on the next boot
+        void watchDogArm(const tiny_int channel, const unsigned short checkpoint = 0);
+        void watchDogIdle(const tiny_int channel);
 
         // void setConfigSize(const short size);
         // void cfg(void *cfg);
         void setConfig(void *cfg, const short size);
         void wipeConfig();
-        void updateConfigItem(const String item, String value);
-        void updateExtraConfigItem(std::function<void(const String item, String value)> callable);
+        void updateConfigItem(const char *item, const char *value);
+        void updateExtraConfigItem(BSConfigItemCallback callable);
         void saveConfig();
 
+        // extra items on GET / POST /api/config -- read back through the
+        // template resolver, written through the config item callback
+        bool addConfigItem(const char *name, const unsigned short max_len, const bool secret = false);
+        void printConfigJson(Print *out);
+        // the body of a POST /api/config, staged as it arrives -- what the
+        // web handler runs, callable without one (fuzzing).  free() the
+        // update when done, NULL when out of memory
+        BS_API_CONFIG_TYPE* newConfigUpdate(const size_t total);
+        void feedConfigUpdate(BS_API_CONFIG_TYPE *update, const uint8_t *data, const size_t len);
+        // each name / value pair of a staged update
+        static void unpackConfigItems(const BS_CONFIG_UPDATE_TYPE *update, BSConfigItemCallback callable);
+
         void wireWebServerAndPaths();
 
         void requestReboot();
         void requestDeepSleep(const unsigned long usec);
+
+        // samples kept in rtc memory across deep sleep -- call before setup()
+        void useSampleBatch(const uint8_t channels, const uint32_t max_age_s, BSSampleSink sink);
+        bool addSample(const int32_t *values);
+        bool flushSamples();
+        BSSampleBatch* sampleBatch();
+
+        // on-device history, queried with GET /ts
+        bool recordValue(const uint8_t series, const float value);
+        BSTimeSeries* timeSeries();
+
+        // live values pushed to pages over GET /events, at most once per
+        // BS_LIVE_FLUSH_MS and only what changed
+        bool publish(const char *name, const char *value);
+        BSLiveStatus* liveStatus();
+
+        // store-and-forward records POSTed in batches to url
+        // (http://host[:port]/path), spilled to littlefs while offline --
+        // call before setup()
+        bool useTelemetry(const char *url, const char *authorization = NULL);
+        bool queueTelemetry(const char *record);
+        BSTelemetry* telemetry();
+
+        // hot path micro-benchmarks, also POST / GET /bench.  request...
+        // queues a run for the loop, false when one is already pending
+        void runBenchmarks();
+        bool requestBenchmarks(const uint8_t report = BS_BENCH_REPORT_NONE);
+        BSBench* benchmarks();
+
+        unsigned short scheduleOnce(const unsigned long delay_ms, BSTask callable, const tiny_int priority = BS_SCHED_PRIORITY_NORMAL);
+        unsigned short scheduleEvery(const unsigned long period_ms, BSTask callable, const tiny_int priority = BS_SCHED_PRIORITY_NORMAL);
+        bool cancelScheduled(const unsigned short id);
+        void setSchedulerBudget(const unsigned long msec);
+
+        // sleep between idle loop passes, never longer than the budget
+        void setIdleGovernor(const bool enabled, const unsigned long latency_budget_ms = BS_IDLE_DEFAULT_BUDGET_MS);
+        // the application has work pending -- loop() does not sleep on its
+        // next pass, or for ms from now, so the sketch's own loop comes
+        // straight back.  call it from loop() whenever there is more to do:
+        //
+        //   void loop() {
+        //       bs.loop();
+        //       if (uart.available()) { handleByte(uart.read()); bs.busy(); }
+        //   }
+        //
+        // only the inline (single core) loop ever sleeps -- with the
+        // housekeeping task the sketch's loop is never held up
+        void busy(const unsigned long ms = 0);
         
         void updateSetupHtml();
         void updateIndexHtml();
 
-        void updateHtmlTemplate(String template_filename, bool show_time = true);
-        void updateExtraHtmlTemplateItems(std::function<void(String *html)> callable);
+        // read-only files served from flash ahead of littlefs -- the bundle
+        // tools/bs_pack.py generates, call before setup()
+        void useAssets(const BS_ASSET_TYPE *assets, const uint16_t count);
+
+        void updateHtmlTemplate(const char *template_filename, bool show_time = true);
+        void updateExtraHtmlTemplateItems(BSTemplateResolver callable);
+
+        // per-loop scratch memory, reset at the top of every housekeeping pass
+        BSArena* scratchArena();
         
+        #ifdef BS_USE_PROFILER
+            void setLoopBudget(const unsigned long usec);
+        #endif
+
         void blink();
-        String getTimestamp();
+        const char* getTimestamp();
+        uint64_t micros64();
         void setActiveAP();
 
         WiFiMode_t wifimode = WIFI_AP;
-        int wifistate = WIFI_EVENT_MAX;
+        volatile int wifistate = WIFI_EVENT_MAX;
         tiny_int resetReason = 0;
 
     private:
         void wireConfig();
         void wireLittleFS();
+        void wireTimeSeries();
+        void wireTelemetryStore();
+        void processTelemetry();
+        void persistTelemetry();
+        void wireWatchDog();
         bool wireWiFi();
         void wireArduinoOTA();
         void wireElegantOTA();
+        void wireStreamingOTA();
+        // the web watchdog checkpoint is the line that registered the route
+        ArRequestHandlerFunction route(BSWebRoute handler, const unsigned short checkpoint = __builtin_LINE());
+        static void respond(AsyncWebServerRequest *request, AsyncWebServerResponse *response);
         const char* getHttpMethodName(const WebRequestMethodComposite method);
+        const char* resolveTemplateToken(const char *token, const bool show_time, BSArena *arena = NULL);
+        const BS_CONFIG_ITEM_TYPE* findConfigItem(const char *name);
+        static bool applyBaseConfigItem(CONFIG_TYPE *cfg, const char *item, const char *value);
+        const char* stageConfigItem(BS_API_CONFIG_TYPE *update);
+        size_t configUpdateSize();
+        static BS_CONFIG_UPDATE_TYPE* allocConfigUpdate(const size_t size);
+        static bool packConfigItem(BS_CONFIG_UPDATE_TYPE *update, const char *name, const size_t name_len, const char *value, const size_t value_len);
+        bool postConfigUpdate(BS_CONFIG_UPDATE_TYPE *update);
 
         void setLockState(tiny_int state);
+        void reboot();
+
+        void housekeeping();
+        static void housekeepingTask(void *arg);
+
+        bool postEvent(const tiny_int type, const char *data = NULL, const unsigned short len = 0);
+        void processEvents();
+        bool idle();
+        void processEvent(BS_EVENT_TYPE *event);
+        void scheduleRenders();
 
         #ifdef BS_USE_TELNETSPY
             void checkForRemoteCommand();
+            void wireRemoteCommands();
+            void promptForSsidPassword();
+            void promptForSsidConfirm();
             long _serial_baud_rate;
-            std::function<void(char c)> setExtraRemoteCommandsCallback = NULL;
+
+            BSShell shell;
+            char pending_ssid[WIFI_SSID_LEN];
+            char pending_ssid_pwd[WIFI_SSID_PWD_LEN];
         #endif
 
-        String _project_name;
+        BSString<PROJECT_NAME_LEN> _project_name;
 
-        DNSServer dnsServer;
-        const byte DNS_PORT = 53;
+        BSDnsResponder dns;
+        const uint16_t DNS_PORT = 53;
 
         char *config;
         short config_size;
         CONFIG_TYPE *base_config;
 
-        bool esp_reboot_requested;
+        volatile bool esp_reboot_requested = false;
         unsigned long esp_sleep_time = 0;
 
-        bool ap_mode_activity;
-        bool setup_needs_update;
-        bool index_needs_update;
+        volatile bool ap_mode_activity;
+
+        BSOtaStream ota_stream;
+        BSOtaDelta ota_delta = BSOtaDelta(&ota_stream);
+        AsyncWebServerRequest *ota_owner = NULL;
+        unsigned long ota_progress_millis = 0;
+
+        // the only way web handlers and other tasks hand work to loop()
+        BSQueue<BS_EVENT_TYPE, BS_EVENT_QUEUE_LEN> events;
+
+        BSScheduler scheduler;
+        unsigned long scheduler_budget_ms = BS_SCHED_DEFAULT_BUDGET_MS;
+        // pages asked for from any task (BS_RENDER_*), taken by housekeeping
+        std::atomic<uint8_t> render_pending{0};
+        unsigned short setup_task = BS_SCHED_NO_TASK;
+        unsigned short index_task = BS_SCHED_NO_TASK;
+        unsigned short reboot_task = BS_SCHED_NO_TASK;
+
+        BSConfigItemCallback updateExtraConfigItemCallback = NULL;
+        BS_CONFIG_ITEM_TYPE extra_items[BS_CONFIG_MAX_EXTRA];
+        tiny_int extra_item_count = 0;
+        BSTemplateResolver updateExtraHtmlTemplateItemsCallback = NULL;
+
+        BSArena scratch;
+        BSHeapMonitor heap;
+        BSTime bs_time;
+        BSSampleBatch batch;
+        BSIdleGovernor governor;
+        bool busy_pass = false;
+        uint64_t busy_until_us = 0;
+        BSTimeSeries ts;
+        BSBench bench;
+        BSLiveStatus live;
+        BSAssets assets;
+        BSTelemetry tq;
+        // set from a request until the run it queued is done
+        std::atomic<bool> bench_running{false};
+        bool wifi_deferred = false;
+
+        bool fast_boot = false;
+        unsigned long boot_defer_ms = BS_BOOT_DEFER_MS;
+        unsigned short services_task = BS_SCHED_NO_TASK;
+        bool services_wired = false;
+        volatile bool services_ready = false;
+        bool fs_wired = false;
+        bool fs_mounted = false;
+        unsigned long setup_ms = 0;
+        unsigned long first_loop_ms = 0;
+        unsigned long services_ms = 0;
+
+        #ifdef BS_USE_PROFILER
+            BSProfiler profiler;
+            BSProfiler app_profiler;
+        #endif
 
-        std::function<void(const String item, String value)> updateExtraConfigItemCallback = NULL;
-        std::function<void(String *html)> updateExtraHtmlTemplateItemsCallback = NULL;
+        bs_task_t housekeeping_task;
+        bool housekeeping_started = false;
 
-        #ifdef esp32
-            SemaphoreHandle_t bs_mutex = xSemaphoreCreateMutex();
-            static void IRAM_ATTR watchDogInterrupt();
-        #else
-            ESP8266Timer iTimer;
-            static void IRAM_ATTR timerHandler();
-        #endif
+        bs_mutex_t bs_mutex = bs_mutex_create();
 };
 #endif
\ No newline at end of file
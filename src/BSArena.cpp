@@ -0,0 +1,53 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSArena.h"
+#include <stdarg.h>
+
+void* BSArena::alloc(const size_t size) {
+    const size_t aligned = (size + BS_ARENA_ALIGN - 1) & ~(size_t) (BS_ARENA_ALIGN - 1);
+
+    if (aligned > BS_ARENA_LEN - top) {
+        failed++;
+        return NULL;
+    }
+
+    void *p = block + top;
+    top += aligned;
+    if (top > high_water) high_water = top;
+
+    return p;
+}
+
+char* BSArena::strdup(const char *s) {
+    const size_t n = strlen(s) + 1;
+    char *p = (char *) alloc(n);
+    if (p != NULL) memcpy(p, s, n);
+    return p;
+}
+
+char* BSArena::printf(const char *format, ...) {
+    // format into whatever is left, then claim only what was used
+    char *p = (char *) block + top;
+    const size_t room = BS_ARENA_LEN - top;
+
+    va_list args;
+    va_start(args, format);
+    const int n = room > 0 ? vsnprintf(p, room, format, args) : -1;
+    va_end(args);
+
+    if (n < 0 || (size_t) n >= room) {
+        failed++;
+        return NULL;
+    }
+
+    return (char *) alloc(n + 1);
+}
+
+void BSArena::reset() {
+    top = 0;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSAssets.h"
+
+void BSAssets::begin(const BS_ASSET_TYPE *assets, const uint16_t count) {
+    this->assets = assets;
+    asset_count = count;
+
+    bundle_bytes = 0;
+    for (uint16_t i = 0; i < count; i++) bundle_bytes += assets[i].len;
+}
+
+const BS_ASSET_TYPE* BSAssets::find(const char *path) {
+    uint16_t lo = 0;
+    uint16_t hi = asset_count;
+
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        const int cmp = strcmp(path, assets[mid].path);
+        if (cmp == 0) return &assets[mid];
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return NULL;
+}
+
+void BSAssets::served(const BS_ASSET_TYPE *asset, const bool not_modified) {
+    hits++;
+    if (not_modified) {
+        not_modified_hits++;
+    } else {
+        bytes_served += asset->len;
+    }
+}
+
+void BSAssets::printTo(Print *out) {
+    out->printf("\nAssets: [%u] in flash  [%u] B  Served: [%u]  Not modified: [%u]  Sent: [%u] B\n\n", asset_count, bundle_bytes, hits, not_modified_hits, bytes_served);
+    for (uint16_t i = 0; i < asset_count; i++) {
+        out->printf("  %-32s %7u B %s %s\n", assets[i].path, assets[i].len, assets[i].gzip ? "gzip" : "    ", assets[i].mime);
+    }
+    out->println();
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSBench.h"
+
+#ifdef esp32
+    #include <esp_heap_caps.h>
+#endif
+
+void BSBench::begin(const char *suite) {
+    this->suite = suite;
+    result_count = 0;
+    note_count = 0;
+}
+
+void BSBench::note(const char *key, const uint32_t value) {
+    if (note_count >= BS_BENCH_MAX_NOTES) return;
+    note_keys[note_count] = key;
+    note_values[note_count++] = value;
+}
+
+bool BSBench::run(const char *name, BSBenchFn fn, const uint32_t bytes_per_op, const uint32_t min_us) {
+    if (result_count >= BS_BENCH_MAX_RESULTS) return false;
+
+    // warm up caches (and anything lazily allocated) outside the measurement
+    fn();
+
+    const uint32_t heap_before = freeHeap();
+    const uint32_t blocks_before = allocatedBlocks();
+    const uint64_t allocs_before = bs_alloc_count();
+
+    uint32_t batch = 1;
+    uint32_t iterations = 0;
+    uint64_t elapsed_us = 0;
+
+    while (true) {
+        const uint64_t started = bs_micros64();
+        for (uint32_t i = 0; i < batch; i++) fn();
+        elapsed_us = bs_micros64() - started;
+        iterations += batch;
+
+        if (elapsed_us >= min_us || batch >= BS_BENCH_MAX_BATCH) break;
+        batch *= 2;
+
+        // long cases must not trip the soft watchdog
+        yield();
+    }
+
+    const int32_t heap_delta = (int32_t) (heap_before - freeHeap());
+    const int32_t blocks_delta = (int32_t) (allocatedBlocks() - blocks_before);
+    const uint64_t allocs = bs_alloc_count() - allocs_before;
+
+    BS_BENCH_RESULT_TYPE *r = &results[result_count++];
+    strncpy(r->name, name, BS_BENCH_NAME_LEN - 1);
+    r->name[BS_BENCH_NAME_LEN - 1] = '\0';
+    r->iterations = batch;
+    r->ns_per_op = (uint32_t) (elapsed_us * 1000 / batch);
+    r->heap_milli_bytes_per_op = (int32_t) ((int64_t) heap_delta * 1000 / iterations);
+    r->milli_blocks_per_op = (int32_t) ((int64_t) blocks_delta * 1000 / iterations);
+    r->milli_allocs_per_op = bs_alloc_counted() ? (int32_t) (allocs * 1000 / iterations) : BS_BENCH_NOT_COUNTED;
+    r->bytes_per_op = bytes_per_op;
+
+    return true;
+}
+
+uint32_t BSBench::freeHeap() {
+    #ifdef BS_HOST
+        return 0;
+    #else
+        return ESP.getFreeHeap();
+    #endif
+}
+
+uint32_t BSBench::allocatedBlocks() {
+    #ifdef esp32
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+        return info.allocated_blocks;
+    #else
+        return 0;
+    #endif
+}
+
+void BSBench::printTo(Print *out) {
+    out->printf("%-24s %10s %12s %12s %12s %10s\n", "benchmark", "ns/op", "heap B/op", "blocks/op", "allocs/op", "bytes/op");
+    for (uint8_t i = 0; i < result_count; i++) {
+        const BS_BENCH_RESULT_TYPE *r = &results[i];
+        out->printf("%-24s %10u %12.3f %12.3f ", r->name, r->ns_per_op, r->heap_milli_bytes_per_op / 1000.0, r->milli_blocks_per_op / 1000.0);
+        if (r->milli_allocs_per_op == BS_BENCH_NOT_COUNTED) {
+            out->printf("%12s", "-");
+        } else {
+            out->printf("%12.3f", r->milli_allocs_per_op / 1000.0);
+        }
+        out->printf(" %10u\n", r->bytes_per_op);
+    }
+    for (uint8_t i = 0; i < note_count; i++) out->printf("%s: [%u]\n", note_keys[i], note_values[i]);
+    out->println();
+}
+
+void BSBench::printJson(Print *out) {
+    out->printf("{\"suite\":\"%s\",\"build\":\"%s %s\",", suite, __DATE__, __TIME__);
+    #ifdef BS_HOST
+        out->print("\"platform\":\"host\",\"cpu_mhz\":0,");
+    #elif defined(esp32)
+        out->printf("\"platform\":\"esp32\",\"cpu_mhz\":%u,", getCpuFrequencyMhz());
+    #else
+        out->printf("\"platform\":\"esp8266\",\"cpu_mhz\":%u,", ESP.getCpuFreqMHz());
+    #endif
+    out->print("\"notes\":{");
+    for (uint8_t i = 0; i < note_count; i++) out->printf("%s\"%s\":%u", i > 0 ? "," : "", note_keys[i], note_values[i]);
+    out->print("},\"results\":[");
+
+    for (uint8_t i = 0; i < result_count; i++) {
+        const BS_BENCH_RESULT_TYPE *r = &results[i];
+        out->printf("%s{\"name\":\"%s\",\"iterations\":%u,\"ns_per_op\":%u,\"heap_bytes_per_op\":%.3f,\"blocks_per_op\":%.3f,",
+            i > 0 ? "," : "", r->name, r->iterations, r->ns_per_op, r->heap_milli_bytes_per_op / 1000.0, r->milli_blocks_per_op / 1000.0);
+        if (r->milli_allocs_per_op == BS_BENCH_NOT_COUNTED) {
+            out->print("\"allocs_per_op\":null,");
+        } else {
+            out->printf("\"allocs_per_op\":%.3f,", r->milli_allocs_per_op / 1000.0);
+        }
+        out->printf("\"bytes_per_op\":%u}", r->bytes_per_op);
+    }
+
+    out->print("]}");
+}
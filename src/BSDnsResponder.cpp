@@ -0,0 +1,283 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSDnsResponder.h"
+
+#ifdef BS_HOST
+    #include <fcntl.h>
+    #ifdef esp32
+        #include <BSHost.h>
+    #endif
+#endif
+
+size_t BSDnsResponder::buildReply(const uint8_t *query, const size_t query_len, uint8_t *reply, const size_t reply_cap, const uint8_t answer[BS_DNS_ANSWER_LEN]) {
+    if (query_len < BS_DNS_HEADER_LEN || reply_cap < BS_DNS_HEADER_LEN) return 0;
+
+    // never answer a response
+    if (query[2] & 0x80) return 0;
+
+    const uint8_t opcode = (query[2] >> 3) & 0x0f;
+    const uint16_t qdcount = (query[4] << 8) | query[5];
+
+    if (opcode != 0 || qdcount != 1) {
+        // header only -- id, opcode and rd echoed back
+        memset(reply, 0, BS_DNS_HEADER_LEN);
+        reply[0] = query[0];
+        reply[1] = query[1];
+        reply[2] = 0x80 | (query[2] & 0x79);
+        reply[3] = opcode != 0 ? BS_DNS_RCODE_NOTIMP : BS_DNS_RCODE_FORMERR;
+        return BS_DNS_HEADER_LEN;
+    }
+
+    // walk the name -- a question never carries compression pointers
+    size_t pos = BS_DNS_HEADER_LEN;
+    while (true) {
+        if (pos >= query_len) return 0;
+        const uint8_t label = query[pos];
+        if (label == 0) break;
+        if (label & 0xc0) return 0;
+        pos += label + 1;
+    }
+    pos++;
+
+    if (pos + 4 > query_len) return 0;
+    const uint16_t qtype = (query[pos] << 8) | query[pos + 1];
+    const uint16_t qclass = (query[pos + 2] << 8) | query[pos + 3];
+    const size_t question_end = pos + 4;
+
+    const bool with_answer = qtype == BS_DNS_TYPE_A && qclass == BS_DNS_CLASS_IN;
+    const size_t reply_len = question_end + (with_answer ? BS_DNS_ANSWER_LEN : 0);
+    if (reply_len > reply_cap) return 0;
+
+    // header and question as they came in, anything after (edns opt) dropped
+    memcpy(reply, query, question_end);
+
+    reply[2] = 0x84 | (query[2] & 0x01);    // qr, aa, rd echoed
+    reply[3] = 0;                           // noerror
+    reply[6] = 0;
+    reply[7] = with_answer ? 1 : 0;
+    memset(reply + 8, 0, 4);
+
+    // everything but A gets an empty noerror -- no aaaa / https records
+    // means clients fall back to the v4 address straight away
+    if (with_answer) memcpy(reply + question_end, answer, BS_DNS_ANSWER_LEN);
+
+    return reply_len;
+}
+
+void BSDnsResponder::buildAnswer(uint8_t answer[BS_DNS_ANSWER_LEN], const uint8_t ip[4], const uint32_t ttl_s) {
+    // name is a pointer back to the question at offset 12
+    answer[0] = 0xc0;
+    answer[1] = BS_DNS_HEADER_LEN;
+    answer[2] = 0;
+    answer[3] = BS_DNS_TYPE_A;
+    answer[4] = 0;
+    answer[5] = BS_DNS_CLASS_IN;
+    answer[6] = ttl_s >> 24;
+    answer[7] = ttl_s >> 16;
+    answer[8] = ttl_s >> 8;
+    answer[9] = ttl_s;
+    answer[10] = 0;
+    answer[11] = 4;
+    memcpy(answer + 12, ip, 4);
+}
+
+void BSDnsResponder::count(const bool answered) {
+    total++;
+    if (!answered) malformed++;
+
+    const uint32_t now = millis();
+    if (now - window_started >= 1000) {
+        last_qps = now - window_started < 2000 ? window_count : 0;
+        window_started = now;
+        window_count = 0;
+    }
+
+    window_count++;
+    if (window_count > peak_qps) peak_qps = window_count;
+}
+
+uint32_t BSDnsResponder::qps() {
+    // the window only rolls on traffic -- a quiet second reads as zero
+    const uint32_t age = millis() - window_started;
+    return age < 1000 ? last_qps : age < 2000 ? window_count : 0;
+}
+
+#if !defined(BS_HOST) || defined(esp32)
+bool BSDnsResponder::begin(const uint16_t port, IPAddress ip) {
+    const uint8_t octets[4] = { ip[0], ip[1], ip[2], ip[3] };
+    #ifdef BS_HOST
+        // the full host build keeps clear of privileged ports
+        return begin(bs_host_port(port), octets);
+    #else
+        return begin(port, octets);
+    #endif
+}
+#endif
+
+#ifdef BS_HOST
+
+bool BSDnsResponder::begin(const uint16_t port, const uint8_t ip[4]) {
+    stop();
+    buildAnswer(answer, ip, BS_DNS_TTL_S);
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return false;
+
+    const int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        stop();
+        return false;
+    }
+
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    this->port = port;
+    return true;
+}
+
+void BSDnsResponder::stop() {
+    if (sock >= 0) close(sock);
+    sock = -1;
+    port = 0;
+}
+
+void BSDnsResponder::loop() {
+    if (sock < 0) return;
+
+    // everything that queued up since the last pass
+    uint8_t reply[BS_DNS_PACKET_LEN];
+    while (true) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        const ssize_t n = recvfrom(sock, query_buf, BS_DNS_PACKET_LEN, 0, (struct sockaddr *) &from, &from_len);
+        if (n < 0) break;
+
+        const size_t len = buildReply(query_buf, n, reply, BS_DNS_PACKET_LEN, answer);
+        count(len > 0);
+        if (len > 0) sendto(sock, reply, len, 0, (struct sockaddr *) &from, from_len);
+    }
+}
+
+#else
+
+bool BSDnsResponder::begin(const uint16_t port, const uint8_t ip[4]) {
+    stop();
+    buildAnswer(answer, ip, BS_DNS_TTL_S);
+    this->port = port;
+
+    // the raw api belongs to the tcpip thread on the esp32 -- the call
+    // blocks until it has run there and hands back the bind result
+    #ifdef esp32
+        BS_DNS_CALL_TYPE call;
+        call.self = this;
+        if (tcpip_api_call(bindInTcpip, &call.call) == ERR_OK) return true;
+        this->port = 0;
+        return false;
+    #else
+        pcb = udp_new();
+        if (pcb == NULL) return false;
+
+        if (udp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK) {
+            udp_remove(pcb);
+            pcb = NULL;
+            return false;
+        }
+
+        udp_recv(pcb, onDatagram, this);
+        return true;
+    #endif
+}
+
+void BSDnsResponder::stop() {
+    #ifdef esp32
+        // synchronous too, no datagram reaches us once this returns
+        if (pcb != NULL) {
+            BS_DNS_CALL_TYPE call;
+            call.self = this;
+            tcpip_api_call(stopInTcpip, &call.call);
+        }
+    #else
+        if (pcb != NULL) udp_remove(pcb);
+        pcb = NULL;
+    #endif
+    port = 0;
+}
+
+#ifdef esp32
+err_t BSDnsResponder::bindInTcpip(struct tcpip_api_call_data *call) {
+    BSDnsResponder *self = ((BS_DNS_CALL_TYPE *) call)->self;
+
+    struct udp_pcb *pcb = udp_new();
+    if (pcb == NULL) return ERR_MEM;
+
+    const err_t err = udp_bind(pcb, IP_ADDR_ANY, self->port);
+    if (err != ERR_OK) {
+        udp_remove(pcb);
+        return err;
+    }
+
+    udp_recv(pcb, onDatagram, self);
+    self->pcb = pcb;
+    return ERR_OK;
+}
+
+err_t BSDnsResponder::stopInTcpip(struct tcpip_api_call_data *call) {
+    BSDnsResponder *self = ((BS_DNS_CALL_TYPE *) call)->self;
+    if (self->pcb != NULL) udp_remove(self->pcb);
+    self->pcb = NULL;
+    return ERR_OK;
+}
+#endif
+
+// called by lwip for every datagram as it arrives -- nothing waits on loop()
+void BSDnsResponder::onDatagram(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    BSDnsResponder *self = (BSDnsResponder *) arg;
+    if (p == NULL) return;
+
+    // parse in place unless the stack handed us a chain
+    const size_t query_len = p->tot_len < BS_DNS_PACKET_LEN ? p->tot_len : BS_DNS_PACKET_LEN;
+    const uint8_t *query = (const uint8_t *) p->payload;
+    if (p->len < query_len) {
+        pbuf_copy_partial(p, self->query_buf, query_len, 0);
+        query = self->query_buf;
+    }
+
+    // the reply is never longer than the query plus one answer record
+    const size_t cap = query_len + BS_DNS_ANSWER_LEN;
+    struct pbuf *r = pbuf_alloc(PBUF_TRANSPORT, cap, PBUF_RAM);
+    size_t len = 0;
+
+    if (r != NULL) {
+        len = buildReply(query, query_len, (uint8_t *) r->payload, cap, self->answer);
+        if (len > 0) {
+            pbuf_realloc(r, len);
+            udp_sendto(pcb, r, addr, port);
+        }
+        pbuf_free(r);
+    }
+
+    pbuf_free(p);
+    self->count(len > 0);
+}
+
+void BSDnsResponder::loop() {
+    // lwip already answered everything as it arrived
+}
+
+#endif
+
+void BSDnsResponder::printTo(Print *out) {
+    out->printf("DNS port: [%u]  Queries: [%u]  Dropped: [%u]  QPS: [%u]  Peak QPS: [%u]\n\n", port, total, malformed, qps(), peak_qps);
+}
@@ -0,0 +1,243 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSFiles.h"
+
+AsyncWebServerResponse* BSFiles::beginResponse(AsyncWebServerRequest *request, const char *path) {
+    File file = LittleFS.open(path, "r");
+    if (!file || file.isDirectory()) return NULL;
+
+    char tag[BS_FILES_ETAG_LEN];
+    etag(file, tag);
+
+    const size_t size = file.size();
+    size_t start = 0;
+    size_t end = 0;
+    uint8_t range = BS_RANGE_NONE;
+
+    const AsyncWebHeader *header = request->getHeader("Range");
+    if (header != NULL) {
+        range = parseRange(header->value().c_str(), size, &start, &end);
+
+        // resuming a file that changed since means starting over
+        const AsyncWebHeader *if_range = request->getHeader("If-Range");
+        if (if_range != NULL && strcmp(if_range->value().c_str(), tag) != 0) range = BS_RANGE_NONE;
+    }
+
+    BSString<48> content_range;
+    AsyncWebServerResponse *response;
+
+    if (range == BS_RANGE_UNSATISFIABLE) {
+        file.close();
+        response = request->beginResponse(416);
+        content_range.printf("bytes */%u", (unsigned int) size);
+        response->addHeader("Content-Range", content_range.c_str());
+    } else if (range == BS_RANGE_OK) {
+        const size_t len = end - start + 1;
+        response = request->beginResponse(contentType(path), len, [file, start, len](uint8_t *buffer, size_t max_len, size_t index) mutable -> size_t
+            {
+                if (index >= len) return 0;
+                if (max_len > len - index) max_len = len - index;
+                if (!file.seek(start + index)) return 0;
+                return file.read(buffer, max_len);
+            });
+        response->setCode(206);
+        content_range.printf("bytes %u-%u/%u", (unsigned int) start, (unsigned int) end, (unsigned int) size);
+        response->addHeader("Content-Range", content_range.c_str());
+    } else {
+        response = request->beginResponse(file, path, String());
+    }
+
+    response->addHeader("Accept-Ranges", "bytes");
+    response->addHeader("ETag", tag);
+
+    return response;
+}
+
+static bool isDigit(const char c) {
+    return c >= '0' && c <= '9';
+}
+
+// BS_RANGE_NONE means "ignore the header and send it all" -- malformed and
+// multi-range requests end up there
+uint8_t BSFiles::parseRange(const char *header, const size_t size, size_t *start, size_t *end) {
+    if (strncmp(header, "bytes=", 6) != 0) return BS_RANGE_NONE;
+
+    const char *spec = header + 6;
+    if (strchr(spec, ',') != NULL) return BS_RANGE_NONE;
+    while (*spec == ' ') spec++;
+
+    char *rest;
+
+    // bytes=-n is the last n bytes
+    if (*spec == '-') {
+        if (!isDigit(spec[1])) return BS_RANGE_NONE;
+        const unsigned long n = strtoul(spec + 1, &rest, 10);
+        if (*rest != '\0') return BS_RANGE_NONE;
+        if (n == 0 || size == 0) return BS_RANGE_UNSATISFIABLE;
+
+        *start = n >= size ? 0 : size - n;
+        *end = size - 1;
+        return BS_RANGE_OK;
+    }
+
+    if (!isDigit(*spec)) return BS_RANGE_NONE;
+    const unsigned long first = strtoul(spec, &rest, 10);
+    if (*rest != '-') return BS_RANGE_NONE;
+
+    unsigned long last = size > 0 ? size - 1 : 0;
+    const char *e = rest + 1;
+    if (*e != '\0') {
+        if (!isDigit(*e)) return BS_RANGE_NONE;
+        last = strtoul(e, &rest, 10);
+        if (*rest != '\0' || last < first) return BS_RANGE_NONE;
+        if (last >= size) last = size - 1;
+    }
+
+    if (first >= size) return BS_RANGE_UNSATISFIABLE;
+
+    *start = first;
+    *end = last;
+    return BS_RANGE_OK;
+}
+
+void BSFiles::etag(File &file, char *out) {
+    snprintf(out, BS_FILES_ETAG_LEN, "\"%x-%lx\"", (unsigned int) file.size(), (unsigned long) file.getLastWrite());
+}
+
+const char* BSFiles::contentType(const char *path) {
+    static const char *types[][2] = {
+        { ".html", "text/html" }, { ".htm", "text/html" }, { ".css", "text/css" }, { ".js", "application/javascript" },
+        { ".json", "application/json" }, { ".txt", "text/plain" }, { ".log", "text/plain" }, { ".csv", "text/csv" },
+        { ".xml", "text/xml" }, { ".svg", "image/svg+xml" }, { ".png", "image/png" }, { ".jpg", "image/jpeg" },
+        { ".ico", "image/x-icon" }, { ".gz", "application/x-gzip" },
+    };
+
+    const char *ext = strrchr(path, '.');
+    if (ext != NULL) {
+        for (uint8_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+            if (strcasecmp(ext, types[i][0]) == 0) return types[i][1];
+        }
+    }
+    return "application/octet-stream";
+}
+
+BSDirListing::BSDirListing(const char *dir, const uint32_t offset, const uint32_t limit) {
+    if (dir[0] != '/') this->dir.append("/");
+    this->dir.append(dir);
+    this->offset = offset;
+    this->limit = limit;
+
+    #ifdef esp32
+        root = LittleFS.open(this->dir.c_str());
+        if (root && !root.isDirectory()) root.close();
+    #else
+        root = LittleFS.openDir(this->dir.c_str());
+    #endif
+}
+
+bool BSDirListing::nextEntry(const char **name, size_t *size, bool *is_dir) {
+    #ifdef esp32
+        if (!root) return false;
+        entry = root.openNextFile();
+        if (!entry) return false;
+
+        // older cores hand out the full path
+        const char *slash = strrchr(entry.name(), '/');
+        *name = slash != NULL ? slash + 1 : entry.name();
+        *size = entry.size();
+        *is_dir = entry.isDirectory();
+    #else
+        if (!root.next()) return false;
+        name_buf = root.fileName().c_str();
+        *name = name_buf.c_str();
+        *size = root.fileSize();
+        *is_dir = root.isDirectory();
+    #endif
+
+    return true;
+}
+
+size_t BSDirListing::fill(uint8_t *out, const size_t max_len) {
+    size_t len = 0;
+
+    while (len < max_len) {
+        if (out_pos < out_buf.length()) {
+            const size_t n = out_buf.length() - out_pos < max_len - len ? out_buf.length() - out_pos : max_len - len;
+            memcpy(out + len, out_buf.c_str() + out_pos, n);
+            out_pos += n;
+            len += n;
+            continue;
+        }
+
+        out_pos = 0;
+        out_buf.clear();
+        if (!produce()) break;
+    }
+
+    return len;
+}
+
+bool BSDirListing::produce() {
+    const char *name;
+    size_t size;
+    bool is_dir;
+
+    switch (state) {
+        case STATE_HEADER:
+            out_buf.print("{\"dir\":");
+            BSJson::printString(&out_buf, dir.c_str());
+            out_buf.printf(",\"offset\":%u,\"limit\":%u,\"entries\":[", offset, limit);
+            state = STATE_SKIP;
+            return true;
+
+        case STATE_SKIP:
+            for (uint32_t i = 0; i < offset; i++) {
+                if (!nextEntry(&name, &size, &is_dir)) {
+                    state = STATE_FOOTER;
+                    return true;
+                }
+            }
+            state = STATE_ENTRIES;
+            return true;
+
+        case STATE_ENTRIES:
+            // one entry past the page tells whether there is a next one
+            if (!nextEntry(&name, &size, &is_dir)) {
+                state = STATE_FOOTER;
+                return true;
+            }
+            if (emitted == limit) {
+                more = true;
+                state = STATE_FOOTER;
+                return true;
+            }
+
+            out_buf.print(emitted > 0 ? ",{\"name\":" : "{\"name\":");
+            BSJson::printString(&out_buf, name);
+            out_buf.printf(",\"size\":%u,\"type\":\"%s\"}", (unsigned int) size, is_dir ? "dir" : "file");
+            emitted++;
+            return true;
+
+        case STATE_FOOTER:
+            if (more) {
+                out_buf.printf("],\"count\":%u,\"next\":%u}", emitted, offset + limit);
+            } else {
+                out_buf.printf("],\"count\":%u,\"next\":null}", emitted);
+            }
+            state = STATE_DONE;
+
+            #ifdef esp32
+                entry.close();
+                root.close();
+            #endif
+            return true;
+
+        default:
+            return false;
+    }
+}
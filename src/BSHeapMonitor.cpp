@@ -0,0 +1,200 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSHeapMonitor.h"
+
+static const char *subsys_names[BS_HEAP_MAX_SUBSYS] = { "web", "template", "log", "config" };
+static const bool subsys_deltas[BS_HEAP_MAX_SUBSYS] = { false, true, true, true };
+
+void BSHeapMonitor::sample() {
+    const uint32_t free_now = freeHeap();
+    const uint32_t largest = largestBlock();
+    const uint8_t frag = fragmentation();
+
+    if (free_now < min_free) min_free = free_now;
+    if (free_now < low_water) low_water = free_now;
+
+    if (free_now < current.free_min) current.free_min = free_now;
+    if (largest < current.largest_min) current.largest_min = largest;
+    if (frag > current.frag_max) current.frag_max = frag;
+
+    if (period_started == 0) {
+        period_started = millis();
+    } else if (millis() - period_started >= period_ms) {
+        closePeriod();
+    }
+}
+
+void BSHeapMonitor::setPeriod(const uint32_t period) {
+    period_ms = period > BS_HEAP_SAMPLE_MS ? period : BS_HEAP_SAMPLE_MS;
+}
+
+void BSHeapMonitor::begin(const uint8_t subsystem) {
+    if (subsystem >= BS_HEAP_MAX_SUBSYS) return;
+
+    const uint32_t free_now = freeHeap();
+    if (free_now < low_water) low_water = free_now;
+    subsystems[subsystem].started_free = free_now;
+    subsystems[subsystem].started_allocs = bs_alloc_count();
+}
+
+void BSHeapMonitor::end(const uint8_t subsystem) {
+    if (subsystem >= BS_HEAP_MAX_SUBSYS) return;
+
+    const uint32_t free_now = freeHeap();
+    if (free_now < min_free) min_free = free_now;
+    if (free_now < low_water) low_water = free_now;
+
+    BS_HEAP_SUBSYS_TYPE *s = &subsystems[subsystem];
+    s->count++;
+    s->allocs += bs_alloc_count() - s->started_allocs;
+
+    if (!subsys_deltas[subsystem]) return;
+    const int32_t delta = (int32_t) (s->started_free - free_now);
+    s->heap_delta += delta;
+    if (delta > s->max_heap_delta) s->max_heap_delta = delta;
+}
+
+uint32_t BSHeapMonitor::minEver() {
+    #ifdef esp32
+        // the allocator tracks a true low water mark, our samples may miss it
+        const uint32_t tracked = ESP.getMinFreeHeap();
+        return tracked < min_free ? tracked : min_free;
+    #else
+        return min_free;
+    #endif
+}
+
+uint32_t BSHeapMonitor::lowWater() {
+    const uint32_t free_now = freeHeap();
+    return free_now < low_water ? free_now : low_water;
+}
+
+uint32_t BSHeapMonitor::freeHeap() {
+    return ESP.getFreeHeap();
+}
+
+uint32_t BSHeapMonitor::largestBlock() {
+    #ifdef esp32
+        return ESP.getMaxAllocHeap();
+    #else
+        return ESP.getMaxFreeBlockSize();
+    #endif
+}
+
+uint8_t BSHeapMonitor::fragmentation() {
+    #ifdef esp32
+        const uint32_t free_now = freeHeap();
+        return free_now > 0 ? 100 - (uint8_t) ((uint64_t) largestBlock() * 100 / free_now) : 0;
+    #else
+        return ESP.getHeapFragmentation();
+    #endif
+}
+
+void BSHeapMonitor::closePeriod() {
+    ring[ring_head] = current;
+    ring_head = (ring_head + 1) % BS_HEAP_RING_LEN;
+    if (ring_count < BS_HEAP_RING_LEN) ring_count++;
+
+    current = { UINT32_MAX, UINT32_MAX, 0 };
+    period_started = millis();
+
+    evaluateTrend();
+}
+
+// age 0 is the most recent closed period
+const BS_HEAP_SAMPLE_TYPE* BSHeapMonitor::at(const uint8_t age) {
+    return &ring[(ring_head + BS_HEAP_RING_LEN - 1 - age) % BS_HEAP_RING_LEN];
+}
+
+void BSHeapMonitor::evaluateTrend() {
+    if (ring_count < 2) {
+        trend_per_hour = 0;
+        leak_suspected = false;
+        return;
+    }
+
+    // least squares slope of the per-period minimum, oldest first
+    const float n = ring_count;
+    float sx = 0, sy = 0, sxy = 0, sxx = 0;
+    uint8_t declines = 0;
+
+    for (uint8_t i = 0; i < ring_count; i++) {
+        const float y = at(ring_count - 1 - i)->free_min;
+        sx += i;
+        sy += y;
+        sxy += i * y;
+        sxx += (float) i * i;
+
+        if (i > 0 && at(ring_count - 1 - i)->free_min < at(ring_count - i)->free_min) declines++;
+    }
+
+    const float slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    trend_per_hour = (int32_t) (slope * 3600000.0f / period_ms);
+
+    const int32_t drop = (int32_t) (at(ring_count - 1)->free_min - at(0)->free_min);
+
+    leak_suspected = ring_count >= BS_HEAP_TREND_MIN_PERIODS
+        && slope < 0
+        && declines * 4 >= (ring_count - 1) * 3
+        && drop >= BS_HEAP_TREND_MIN_DROP;
+}
+
+void BSHeapMonitor::printTo(Print *out) {
+    out->printf("\nFree: [%u] B  Largest block: [%u] B  Fragmentation: [%u]%%  Min ever: [%u] B  Low water: [%u] B\n", freeHeap(), largestBlock(), fragmentation(), minEver(), lowWater());
+    out->printf("Trend: [%d] B/h over [%u] x [%u] s  %s\n\n", trend_per_hour, ring_count, period_ms / 1000, leak_suspected ? "** LEAK SUSPECTED **" : "stable");
+
+    out->printf("%-9s %10s %12s %12s %12s\n", "subsystem", "calls", "allocs", "heap delta B", "max delta B");
+    for (uint8_t i = 0; i < BS_HEAP_MAX_SUBSYS; i++) {
+        const BS_HEAP_SUBSYS_TYPE *s = &subsystems[i];
+        out->printf("%-9s %10u ", subsys_names[i], s->count);
+        if (bs_alloc_counted()) {
+            out->printf("%12llu ", (unsigned long long) s->allocs);
+        } else {
+            out->printf("%12s ", "-");
+        }
+        if (subsys_deltas[i]) {
+            out->printf("%12d %12d\n", s->heap_delta, s->max_heap_delta);
+        } else {
+            out->printf("%12s %12s\n", "-", "-");
+        }
+    }
+
+    out->print("\nFree heap minimum per period (newest first):");
+    for (uint8_t i = 0; i < ring_count; i++) {
+        if (i % 8 == 0) out->print("\n   ");
+        out->printf(" %7u", at(i)->free_min);
+    }
+    out->print("\n\n");
+}
+
+void BSHeapMonitor::printJson(Print *out) {
+    out->printf("{\"free\":%u,\"largest_block\":%u,\"fragmentation\":%u,\"min_ever\":%u,\"low_water\":%u,\"trend_per_hour\":%d,\"leak_suspected\":%s,\"period_ms\":%u,\"subsystems\":{",
+        freeHeap(), largestBlock(), fragmentation(), minEver(), lowWater(), trend_per_hour, leak_suspected ? "true" : "false", period_ms);
+
+    for (uint8_t i = 0; i < BS_HEAP_MAX_SUBSYS; i++) {
+        const BS_HEAP_SUBSYS_TYPE *s = &subsystems[i];
+        out->printf("%s\"%s\":{\"calls\":%u,", i ? "," : "", subsys_names[i], s->count);
+        if (bs_alloc_counted()) {
+            out->printf("\"allocs\":%llu,", (unsigned long long) s->allocs);
+        } else {
+            out->print("\"allocs\":null,");
+        }
+        if (subsys_deltas[i]) {
+            out->printf("\"heap_delta\":%d,\"max_heap_delta\":%d}", s->heap_delta, s->max_heap_delta);
+        } else {
+            out->print("\"heap_delta\":null,\"max_heap_delta\":null}");
+        }
+    }
+
+    out->print("},\"history\":[");
+    for (uint8_t i = 0; i < ring_count; i++) {
+        const BS_HEAP_SAMPLE_TYPE *h = at(i);
+        out->printf("%s{\"free_min\":%u,\"largest_min\":%u,\"frag_max\":%u}", i ? "," : "", h->free_min, h->largest_min, h->frag_max);
+    }
+    out->print("]}");
+}
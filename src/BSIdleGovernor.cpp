@@ -0,0 +1,133 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSIdleGovernor.h"
+
+#ifndef BS_HOST
+    #ifdef esp32
+        #include <WiFi.h>
+        #if defined(CONFIG_PM_ENABLE) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+            #define BS_IDLE_LIGHT_SLEEP
+            #include <esp_pm.h>
+        #endif
+    #else
+        #include <ESP8266WiFi.h>
+    #endif
+#endif
+
+#ifdef BS_IDLE_LIGHT_SLEEP
+static void configureLightSleep(const bool enable) {
+    // with tickless idle every vTaskDelay long enough becomes light sleep
+    #if ESP_IDF_VERSION_MAJOR >= 5
+        esp_pm_config_t pm;
+    #else
+        esp_pm_config_esp32_t pm;
+    #endif
+    pm.max_freq_mhz = getCpuFrequencyMhz();
+    pm.min_freq_mhz = enable ? getXtalFrequencyMhz() : getCpuFrequencyMhz();
+    pm.light_sleep_enable = enable;
+    esp_pm_configure(&pm);
+}
+#endif
+
+void BSIdleGovernor::begin(const uint32_t latency_budget_ms) {
+    budget_ms = latency_budget_ms;
+    _enabled = true;
+    reset();
+
+    #ifdef BS_IDLE_LIGHT_SLEEP
+        configureLightSleep(true);
+    #endif
+}
+
+void BSIdleGovernor::end() {
+    _enabled = false;
+
+    #ifdef BS_IDLE_LIGHT_SLEEP
+        configureLightSleep(false);
+    #endif
+}
+
+void BSIdleGovernor::setLatencyBudget(const uint32_t ms) {
+    budget_ms = ms;
+}
+
+void BSIdleGovernor::setDtim(const uint8_t dtim) {
+    this->dtim = dtim > 0 ? dtim : 1;
+}
+
+void BSIdleGovernor::applyRadio(const bool station) {
+    // an ap cannot doze, and a station only when the ap is heard within budget
+    const bool allowed = _enabled && station && (uint64_t) dtim * BS_IDLE_BEACON_US <= (uint64_t) budget_ms * 1000;
+
+    #ifndef BS_HOST
+        if (_enabled && station) {
+            #ifdef esp32
+                WiFi.setSleep(allowed);
+            #else
+                if (allowed) {
+                    WiFi.setSleepMode(WIFI_LIGHT_SLEEP, dtim);
+                } else {
+                    WiFi.setSleepMode(WIFI_NONE_SLEEP);
+                }
+            #endif
+        }
+    #endif
+
+    modem_sleep = allowed;
+}
+
+uint32_t BSIdleGovernor::idle(const uint32_t ms_until) {
+    if (!_enabled) return 0;
+
+    const uint32_t ms = ms_until < budget_ms ? ms_until : budget_ms;
+    if (ms < BS_IDLE_MIN_SLEEP_MS) return 0;
+
+    const uint64_t started = bs_micros64();
+    bs_task_sleep(ms);
+    const uint64_t slept_us = bs_micros64() - started;
+
+    // whatever we overslept by is what a waiting caller paid
+    const uint64_t requested_us = (uint64_t) ms * 1000;
+    const uint32_t late_us = slept_us > requested_us ? (uint32_t) (slept_us - requested_us) : 0;
+
+    asleep_us += slept_us;
+    latency_us += late_us;
+    if (late_us > max_latency_us) max_latency_us = late_us;
+    sleep_count++;
+
+    return (uint32_t) (slept_us / 1000);
+}
+
+uint8_t BSIdleGovernor::idlePercent() {
+    const uint64_t elapsed_us = bs_micros64() - since_us;
+    return elapsed_us > 0 ? (uint8_t) (asleep_us * 100 / elapsed_us) : 0;
+}
+
+void BSIdleGovernor::reset() {
+    since_us = bs_micros64();
+    asleep_us = 0;
+    latency_us = 0;
+    max_latency_us = 0;
+    sleep_count = 0;
+}
+
+void BSIdleGovernor::printTo(Print *out) {
+    if (!_enabled) {
+        out->println("Idle governor: [off]\n");
+        return;
+    }
+
+    out->printf("Idle governor: [on]  Budget: [%u] ms  Modem sleep: [%s]  Light sleep: [%s]\n", budget_ms, modem_sleep ? "on" : "off",
+        #ifdef BS_IDLE_LIGHT_SLEEP
+            "on"
+        #else
+            "off"
+        #endif
+        );
+    out->printf("Asleep: [%u%%]  [%llu] ms in [%u] sleeps  Wake latency avg: [%u] us  max: [%u] us\n\n", idlePercent(), (unsigned long long) asleepMs(), sleep_count, avgWakeLatencyUs(), max_latency_us);
+}
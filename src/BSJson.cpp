@@ -0,0 +1,241 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSJson.h"
+
+void BSJson::printString(Print *out, const char *s) {
+    out->write('"');
+
+    // runs of plain characters go out in one write
+    const char *run = s;
+    for (; *s != '\0'; s++) {
+        const unsigned char c = *s;
+        if (c >= ' ' && c != '"' && c != '\\') continue;
+
+        if (s > run) out->write((const uint8_t *) run, s - run);
+        if (c == '"' || c == '\\') {
+            out->write('\\');
+            out->write(c);
+        } else {
+            out->printf("\\u%04x", c);
+        }
+        run = s + 1;
+    }
+    if (s > run) out->write((const uint8_t *) run, s - run);
+
+    out->write('"');
+}
+
+static bool isSpace(const char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int hexDigit(const char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void BSJsonParser::begin() {
+    state = STATE_START;
+    in_key = false;
+    value_string = false;
+    _error = NULL;
+    consumed = 0;
+    key_len = 0;
+    value_len = 0;
+    _key[0] = '\0';
+    _value[0] = '\0';
+    high_surrogate = 0;
+}
+
+uint8_t BSJsonParser::fail(const char *reason) {
+    state = STATE_ERROR;
+    _error = reason;
+    return BS_JSON_ERROR;
+}
+
+bool BSJsonParser::put(const char c) {
+    if (in_key) {
+        if (key_len >= BS_JSON_KEY_LEN - 1) return false;
+        _key[key_len++] = c;
+        _key[key_len] = '\0';
+    } else {
+        if (value_len >= BS_JSON_VALUE_LEN - 1) return false;
+        _value[value_len++] = c;
+        _value[value_len] = '\0';
+    }
+    return true;
+}
+
+bool BSJsonParser::putCodePoint(const uint32_t cp) {
+    if (cp < 0x80) return put(cp);
+    if (cp < 0x800) return put(0xc0 | (cp >> 6)) && put(0x80 | (cp & 0x3f));
+    if (cp < 0x10000) return put(0xe0 | (cp >> 12)) && put(0x80 | ((cp >> 6) & 0x3f)) && put(0x80 | (cp & 0x3f));
+    return put(0xf0 | (cp >> 18)) && put(0x80 | ((cp >> 12) & 0x3f)) && put(0x80 | ((cp >> 6) & 0x3f)) && put(0x80 | (cp & 0x3f));
+}
+
+uint8_t BSJsonParser::endValue() {
+    state = STATE_AFTER_VALUE;
+    return BS_JSON_PAIR;
+}
+
+uint8_t BSJsonParser::feed(const char c) {
+    if (state == STATE_ERROR) return BS_JSON_ERROR;
+    consumed++;
+
+    switch (state) {
+        case STATE_START:
+            if (isSpace(c)) return BS_JSON_MORE;
+            if (c != '{') return fail("expected an object");
+            state = STATE_KEY_OR_END;
+            return BS_JSON_MORE;
+
+        case STATE_KEY_OR_END:
+        case STATE_NEXT_KEY:
+            if (isSpace(c)) return BS_JSON_MORE;
+            if (c == '}' && state == STATE_KEY_OR_END) {
+                state = STATE_DONE;
+                return BS_JSON_DONE;
+            }
+            if (c != '"') return fail("expected a name");
+            in_key = true;
+            key_len = 0;
+            _key[0] = '\0';
+            state = STATE_STRING;
+            return BS_JSON_MORE;
+
+        case STATE_COLON:
+            if (isSpace(c)) return BS_JSON_MORE;
+            if (c != ':') return fail("expected ':'");
+            state = STATE_VALUE;
+            return BS_JSON_MORE;
+
+        case STATE_VALUE:
+            if (isSpace(c)) return BS_JSON_MORE;
+            value_len = 0;
+            _value[0] = '\0';
+            if (c == '"') {
+                in_key = false;
+                value_string = true;
+                state = STATE_STRING;
+                return BS_JSON_MORE;
+            }
+            if (c == '{' || c == '[') return fail("nested values are not supported");
+            if (!(c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')) return fail("expected a value");
+            value_string = false;
+            in_key = false;
+            put(c);
+            state = STATE_LITERAL;
+            return BS_JSON_MORE;
+
+        case STATE_STRING:
+            if (high_surrogate != 0 && c != '\\') return fail("lone surrogate");
+            if (c == '"') {
+                if (in_key) {
+                    in_key = false;
+                    state = STATE_COLON;
+                    return BS_JSON_MORE;
+                }
+                return endValue();
+            }
+            if (c == '\\') {
+                state = STATE_ESCAPE;
+                return BS_JSON_MORE;
+            }
+            if ((unsigned char) c < ' ') return fail("control character in string");
+            return put(c) ? BS_JSON_MORE : fail(in_key ? "name too long" : "value too long");
+
+        case STATE_ESCAPE:
+            {
+                if (high_surrogate != 0 && c != 'u') return fail("lone surrogate");
+                char e;
+                switch (c) {
+                    case '"': e = '"'; break;
+                    case '\\': e = '\\'; break;
+                    case '/': e = '/'; break;
+                    case 'b': e = '\b'; break;
+                    case 'f': e = '\f'; break;
+                    case 'n': e = '\n'; break;
+                    case 'r': e = '\r'; break;
+                    case 't': e = '\t'; break;
+                    case 'u':
+                        unicode = 0;
+                        unicode_digits = 0;
+                        state = STATE_UNICODE;
+                        return BS_JSON_MORE;
+                    default:
+                        return fail("bad escape");
+                }
+                state = STATE_STRING;
+                return put(e) ? BS_JSON_MORE : fail(in_key ? "name too long" : "value too long");
+            }
+
+        case STATE_UNICODE:
+            {
+                const int d = hexDigit(c);
+                if (d < 0) return fail("bad \\u escape");
+                unicode = (unicode << 4) | d;
+                if (++unicode_digits < 4) return BS_JSON_MORE;
+
+                state = STATE_STRING;
+                if (unicode == 0) return fail("nul in string");
+
+                if (unicode >= 0xd800 && unicode <= 0xdbff) {
+                    if (high_surrogate != 0) return fail("lone surrogate");
+                    high_surrogate = unicode;
+                    return BS_JSON_MORE;
+                }
+
+                uint32_t cp = unicode;
+                if (unicode >= 0xdc00 && unicode <= 0xdfff) {
+                    if (high_surrogate == 0) return fail("lone surrogate");
+                    cp = 0x10000 + ((high_surrogate - 0xd800) << 10) + (unicode - 0xdc00);
+                } else if (high_surrogate != 0) {
+                    return fail("lone surrogate");
+                }
+                high_surrogate = 0;
+
+                return putCodePoint(cp) ? BS_JSON_MORE : fail(in_key ? "name too long" : "value too long");
+            }
+
+        case STATE_LITERAL:
+            if (isSpace(c) || c == ',' || c == '}') {
+                // true / false / null must be exactly that, numbers are
+                // left for whoever knows what the field should hold
+                if (_value[0] == 't' && strcmp(_value, "true") != 0) return fail("bad literal");
+                if (_value[0] == 'f' && strcmp(_value, "false") != 0) return fail("bad literal");
+                if (_value[0] == 'n' && strcmp(_value, "null") != 0) return fail("bad literal");
+
+                // the terminator belongs to the object, take its step too --
+                // after a closing '}' done() is already true
+                state = c == ',' ? STATE_NEXT_KEY : c == '}' ? STATE_DONE : STATE_AFTER_VALUE;
+                return BS_JSON_PAIR;
+            }
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '.' || c == '+' || c == '-' || c == 'E')) return fail("bad literal");
+            return put(c) ? BS_JSON_MORE : fail("value too long");
+
+        case STATE_AFTER_VALUE:
+            if (isSpace(c)) return BS_JSON_MORE;
+            if (c == ',') {
+                state = STATE_NEXT_KEY;
+                return BS_JSON_MORE;
+            }
+            if (c == '}') {
+                state = STATE_DONE;
+                return BS_JSON_DONE;
+            }
+            return fail("expected ',' or '}'");
+
+        case STATE_DONE:
+            if (isSpace(c)) return BS_JSON_MORE;
+            return fail("trailing characters");
+    }
+
+    return fail("bad state");
+}
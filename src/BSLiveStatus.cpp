@@ -0,0 +1,150 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSLiveStatus.h"
+
+void BSLiveStatus::begin(AsyncWebServer *server) {
+    source.onConnect([this](AsyncEventSourceClient *client) { onConnect(client); });
+    server->addHandler(&source);
+    started = true;
+}
+
+bool BSLiveStatus::publish(const char *name, const char *value) {
+    bool changed = false;
+
+    bs_mutex_lock(lock);
+
+    BS_LIVE_VAR_TYPE *var = NULL;
+    for (uint8_t i = 0; i < var_count && var == NULL; i++) {
+        if (strcmp(vars[i].name, name) == 0) var = &vars[i];
+    }
+    if (var == NULL && var_count < BS_LIVE_MAX_VARS) {
+        var = &vars[var_count++];
+        strncpy(var->name, name, BS_LIVE_NAME_LEN - 1);
+        var->name[BS_LIVE_NAME_LEN - 1] = '\0';
+        var->value[0] = '\0';
+        var->dirty = true;
+    }
+
+    // unchanged values cost nothing on the wire
+    if (var != NULL && (var->dirty || strncmp(var->value, value, BS_LIVE_VALUE_LEN - 1) != 0)) {
+        strncpy(var->value, value, BS_LIVE_VALUE_LEN - 1);
+        var->value[BS_LIVE_VALUE_LEN - 1] = '\0';
+        var->dirty = true;
+        changed = true;
+    }
+
+    bs_mutex_unlock(lock);
+
+    return changed;
+}
+
+void BSLiveStatus::flush() {
+    if (!started) return;
+
+    // nobody listening -- whoever connects next gets a snapshot anyway
+    if (source.count() == 0) {
+        bs_mutex_lock(lock);
+        for (uint8_t i = 0; i < var_count; i++) vars[i].dirty = false;
+        bs_mutex_unlock(lock);
+        return;
+    }
+
+    if (source.avgPacketsWaiting() > BS_LIVE_MAX_BACKLOG) {
+        deferred++;
+        return;
+    }
+
+    char json[BS_LIVE_EVENT_LEN];
+
+    bs_mutex_lock(lock);
+    const size_t len = toJson(json, sizeof(json), false);
+    const uint32_t id = len > 0 ? ++seq : seq;
+    bs_mutex_unlock(lock);
+
+    if (len == 0) return;
+
+    // sent outside the lock, the server calls onConnect() holding its own.
+    // a snapshot taken meanwhile already carries these values and the page
+    // ignores deltas at or below its snapshot id
+    source.send(json, "delta", id);
+    deltas++;
+    bytes_sent += len * source.count();
+}
+
+void BSLiveStatus::onConnect(AsyncEventSourceClient *client) {
+    if (source.count() > BS_LIVE_MAX_CLIENTS) {
+        // tell the browser to back off before it reconnects on its own
+        client->send("busy", "busy", 0, BS_LIVE_BUSY_RETRY_MS);
+        client->close();
+        rejected++;
+        return;
+    }
+
+    char json[BS_LIVE_EVENT_LEN];
+
+    bs_mutex_lock(lock);
+    const size_t len = toJson(json, sizeof(json), true);
+    const uint32_t id = seq;
+    bs_mutex_unlock(lock);
+
+    client->send(json, "snapshot", id);
+    snapshots++;
+    bytes_sent += len;
+}
+
+// {"name":"value",...} of the dirty (or all) vars, clearing their dirty
+// flag -- a var that does not fit stays dirty for the next flush
+size_t BSLiveStatus::toJson(char *out, const size_t cap, const bool all) {
+    size_t len = 0;
+    out[len++] = '{';
+
+    for (uint8_t i = 0; i < var_count; i++) {
+        BS_LIVE_VAR_TYPE *var = &vars[i];
+        if (!all && !var->dirty) continue;
+
+        // worst case every value character needs a six character escape
+        char item[BS_LIVE_NAME_LEN + BS_LIVE_VALUE_LEN * 6 + 8];
+        size_t n = 0;
+        if (len > 1) item[n++] = ',';
+        n += sprintf(item + n, "\"%s\":\"", var->name);
+
+        for (const char *c = var->value; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                item[n++] = '\\';
+                item[n++] = *c;
+            } else if ((unsigned char) *c < ' ') {
+                n += sprintf(item + n, "\\u%04x", *c);
+            } else {
+                item[n++] = *c;
+            }
+        }
+        item[n++] = '"';
+
+        if (len + n + 2 > cap) continue;
+
+        memcpy(out + len, item, n);
+        len += n;
+        if (!all) var->dirty = false;
+    }
+
+    if (!all && len == 1) return 0;
+
+    out[len++] = '}';
+    out[len] = '\0';
+    return len;
+}
+
+void BSLiveStatus::printTo(Print *out) {
+    out->printf("\nLive status: [%u] of [%u] clients  [%u] vars  Seq: [%u]\n", clients(), BS_LIVE_MAX_CLIENTS, var_count, seq);
+    out->printf("Deltas: [%u]  Snapshots: [%u]  Deferred: [%u]  Rejected: [%u]  Sent: [%u] B\n\n", deltas, snapshots, deferred, rejected, bytes_sent);
+
+    bs_mutex_lock(lock);
+    for (uint8_t i = 0; i < var_count; i++) out->printf("  %-*s = [%s]%s\n", BS_LIVE_NAME_LEN, vars[i].name, vars[i].value, vars[i].dirty ? " *" : "");
+    bs_mutex_unlock(lock);
+    out->println();
+}
@@ -0,0 +1,190 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSOtaDelta.h"
+
+BSOtaDelta::BSOtaDelta(BSOtaStream *image) {
+    this->image = image;
+    last_error[0] = '\0';
+}
+
+bool BSOtaDelta::begin() {
+    if (active() || image->active()) return setError("update already in progress");
+
+    last_error[0] = '\0';
+    state = BS_DELTA_HEADER;
+    pending_len = 0;
+    pending_need = BS_DELTA_HEADER_LEN;
+    literal_left = 0;
+    bytes_in = 0;
+
+    return true;
+}
+
+bool BSOtaDelta::write(const uint8_t *data, size_t len) {
+    if (!active()) return false;
+    bytes_in += len;
+
+    while (len > 0) {
+        switch (state) {
+            case BS_DELTA_HEADER:
+            case BS_DELTA_ARGS: {
+                const size_t want = pending_need - pending_len;
+                const size_t n = want < len ? want : len;
+                memcpy(pending + pending_len, data, n);
+                pending_len += n;
+                data += n;
+                len -= n;
+
+                if (pending_len < pending_need) break;
+                if (!(state == BS_DELTA_HEADER ? parseHeader() : parseArgs())) return false;
+                break;
+            }
+            case BS_DELTA_OP:
+                op = *data++;
+                len--;
+
+                if (op == BS_DELTA_OP_END) {
+                    state = BS_DELTA_DONE;
+                } else if (op == BS_DELTA_OP_COPY || op == BS_DELTA_OP_ADD) {
+                    state = BS_DELTA_ARGS;
+                    pending_len = 0;
+                    pending_need = op == BS_DELTA_OP_COPY ? 8 : 4;
+                } else {
+                    return fail("unknown patch op");
+                }
+                break;
+            case BS_DELTA_LITERAL: {
+                const size_t n = literal_left < len ? literal_left : len;
+                if (!image->write(data, n)) return fail(image->error());
+                literal_left -= n;
+                data += n;
+                len -= n;
+
+                if (literal_left == 0) state = BS_DELTA_OP;
+                break;
+            }
+            case BS_DELTA_DONE:
+                return fail("trailing bytes after patch end");
+        }
+    }
+
+    return true;
+}
+
+bool BSOtaDelta::end() {
+    if (!active()) return false;
+
+    if (state != BS_DELTA_DONE) return fail("truncated patch");
+    if (image->bytesOut() != image_size) return fail("rebuilt image has the wrong size");
+
+    state = BS_DELTA_IDLE;
+    if (!image->end()) return fail(image->error());
+
+    return true;
+}
+
+void BSOtaDelta::abort() {
+    image->abort();
+    state = BS_DELTA_IDLE;
+}
+
+const char* BSOtaDelta::error() {
+    return last_error;
+}
+
+uint32_t BSOtaDelta::bytesPerSecond() {
+    const uint32_t ms = elapsedMs();
+    return ms > 0 ? (uint32_t) ((uint64_t) bytes_in * 1000 / ms) : bytes_in;
+}
+
+bool BSOtaDelta::parseHeader() {
+    if (memcmp(pending, BS_DELTA_MAGIC, 4) != 0) return fail("not a delta patch");
+    if (pending[4] != BS_DELTA_VERSION) return fail("unsupported patch version");
+
+    // refuse patches that were not built against what we are running
+    char base_md5[BS_DELTA_MD5_LEN * 2 + 1];
+    for (uint8_t i = 0; i < BS_DELTA_MD5_LEN; i++) sprintf(base_md5 + i * 2, "%02x", pending[8 + i]);
+    if (!ESP.getSketchMD5().equalsIgnoreCase(base_md5)) return fail("patch does not match the running image");
+
+    base_size = ESP.getSketchSize();
+    image_size = readLE32(pending + 24);
+
+    #ifdef esp32
+        base = esp_ota_get_running_partition();
+        if (base == NULL) return fail("running partition not found");
+    #endif
+
+    if (!image->begin(pending + 28)) return fail(image->error());
+
+    state = BS_DELTA_OP;
+    return true;
+}
+
+bool BSOtaDelta::parseArgs() {
+    if (op == BS_DELTA_OP_COPY) {
+        const uint32_t offset = readLE32(pending);
+        const uint32_t length = readLE32(pending + 4);
+
+        if (offset > base_size || length > base_size - offset) return fail("copy outside the running image");
+        if (!copyFromBase(offset, length)) return false;
+
+        state = BS_DELTA_OP;
+    } else {
+        literal_left = readLE32(pending);
+        state = literal_left > 0 ? BS_DELTA_LITERAL : BS_DELTA_OP;
+    }
+
+    return true;
+}
+
+bool BSOtaDelta::copyFromBase(uint32_t offset, uint32_t len) {
+    while (len > 0) {
+        const uint32_t n = len < BS_DELTA_COPY_CHUNK ? len : BS_DELTA_COPY_CHUNK;
+
+        #ifdef esp32
+            if (esp_partition_read(base, offset, copy_buf, n) != ESP_OK) return fail("running image read failed");
+            const uint8_t *chunk = (const uint8_t *) copy_buf;
+        #else
+            // flash reads must be word aligned -- the sketch starts at 0
+            const uint32_t skew = offset & 3;
+            if (!ESP.flashRead(offset - skew, copy_buf, (skew + n + 3) & ~3)) return fail("running image read failed");
+            const uint8_t *chunk = (const uint8_t *) copy_buf + skew;
+        #endif
+
+        if (!image->write(chunk, n)) return fail(image->error());
+
+        offset += n;
+        len -= n;
+
+        // a long copy runs inside a single upload callback
+        #ifdef esp32
+            esp_task_wdt_reset();
+        #else
+            ESP.wdtFeed();
+        #endif
+    }
+
+    return true;
+}
+
+bool BSOtaDelta::setError(const char *msg) {
+    strncpy(last_error, msg, BS_OTA_ERROR_LEN - 1);
+    last_error[BS_OTA_ERROR_LEN - 1] = '\0';
+    return false;
+}
+
+// a broken patch poisons everything after it -- drop the whole update
+bool BSOtaDelta::fail(const char *msg) {
+    setError(msg);
+    abort();
+    return false;
+}
+
+uint32_t BSOtaDelta::readLE32(const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
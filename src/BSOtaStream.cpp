@@ -0,0 +1,278 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSOtaStream.h"
+
+static int8_t hexValue(const char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool BSOtaStream::begin(const char *sha256_hex, const int command) {
+    if (sha256_hex == NULL || strlen(sha256_hex) == 0) return begin((const uint8_t *) NULL, command);
+    if (strlen(sha256_hex) != BS_OTA_SHA256_LEN * 2) return setError("sha256 must be 64 hex characters");
+
+    uint8_t digest[BS_OTA_SHA256_LEN];
+    for (uint8_t i = 0; i < BS_OTA_SHA256_LEN; i++) {
+        const int8_t hi = hexValue(sha256_hex[i * 2]);
+        const int8_t lo = hexValue(sha256_hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return setError("sha256 must be 64 hex characters");
+        digest[i] = (hi << 4) | lo;
+    }
+
+    return begin(digest, command);
+}
+
+bool BSOtaStream::begin(const uint8_t *sha256, const int command) {
+    if (running) return setError("update already in progress");
+
+    last_error[0] = '\0';
+    #ifndef BS_OTA_ALLOW_UNVERIFIED
+        if (sha256 == NULL) return setError("sha256 required -- image rejected");
+    #endif
+    verify = sha256 != NULL;
+    if (verify) memcpy(expected, sha256, BS_OTA_SHA256_LEN);
+
+    #ifdef esp32
+        if (!Update.begin(UPDATE_SIZE_UNKNOWN, command)) return setError("update begin failed");
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts(&sha, 0);
+    #else
+        // we are called from the async tcp context which must never yield
+        Update.runAsync(true);
+        // the real size is unknown up front -- claim the whole free slot
+        if (!Update.begin((ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000, command)) return setError("update begin failed");
+        br_sha256_init(&sha);
+    #endif
+
+    gzip = false;
+    sniffed = false;
+    gz_state = BS_OTA_GZ_FIXED;
+    gz_flags = 0;
+    gz_count = 0;
+    gz_extra = 0;
+
+    bytes_in = 0;
+    bytes_out = 0;
+    started = millis();
+    finished = 0;
+    running = true;
+
+    return true;
+}
+
+bool BSOtaStream::write(const uint8_t *data, size_t len) {
+    if (!running) return false;
+    if (len == 0) return true;
+
+    #ifdef esp32
+        mbedtls_sha256_update(&sha, data, len);
+    #else
+        br_sha256_update(&sha, data, len);
+    #endif
+    bytes_in += len;
+
+    if (!sniffed) {
+        gzip = data[0] == BS_OTA_GZIP_MAGIC_1 && (len < 2 || data[1] == BS_OTA_GZIP_MAGIC_2);
+        sniffed = true;
+    }
+
+    #ifdef esp32
+        if (gzip) {
+            if (inflator == NULL) {
+                inflator = (tinfl_decompressor *) malloc(sizeof(tinfl_decompressor));
+                window = (uint8_t *) malloc(TINFL_LZ_DICT_SIZE);
+                if (inflator == NULL || window == NULL) {
+                    abort();
+                    return setError("not enough memory to inflate");
+                }
+                tinfl_init(inflator);
+                window_pos = 0;
+            }
+
+            const size_t consumed = parseGzipHeader(data, len);
+            if (!running) return false;
+
+            if (!inflate(data + consumed, len - consumed)) {
+                abort();
+                return false;
+            }
+            return true;
+        }
+    #endif
+
+    if (!writeImage(data, len)) {
+        abort();
+        return false;
+    }
+    return true;
+}
+
+bool BSOtaStream::end() {
+    if (!running) return false;
+
+    #ifdef esp32
+        if (gzip && gz_state != BS_OTA_GZ_DONE) {
+            abort();
+            return setError("truncated gzip stream");
+        }
+    #endif
+
+    uint8_t digest[BS_OTA_SHA256_LEN];
+    #ifdef esp32
+        mbedtls_sha256_finish(&sha, digest);
+        mbedtls_sha256_free(&sha);
+    #else
+        br_sha256_out(&sha, digest);
+    #endif
+
+    if (verify && memcmp(digest, expected, BS_OTA_SHA256_LEN) != 0) {
+        abort();
+        return setError("sha256 mismatch -- image rejected");
+    }
+
+    finished = millis();
+    running = false;
+    release();
+
+    if (!Update.end(true)) return setError("update finalize failed");
+    return true;
+}
+
+void BSOtaStream::abort() {
+    if (!running) return;
+
+    #ifdef esp32
+        Update.abort();
+        mbedtls_sha256_free(&sha);
+    #else
+        // with the whole slot claimed the update is never complete here so
+        // this discards it without writing the boot command
+        Update.end(false);
+    #endif
+
+    finished = millis();
+    running = false;
+    release();
+}
+
+uint32_t BSOtaStream::elapsedMs() {
+    return (finished ? finished : millis()) - started;
+}
+
+uint32_t BSOtaStream::bytesPerSecond() {
+    const uint32_t ms = elapsedMs();
+    return ms > 0 ? (uint32_t) ((uint64_t) bytes_in * 1000 / ms) : bytes_in;
+}
+
+bool BSOtaStream::writeImage(const uint8_t *data, size_t len) {
+    if (Update.write((uint8_t *) data, len) != len) return setError("flash write failed");
+    bytes_out += len;
+    return true;
+}
+
+bool BSOtaStream::setError(const char *msg) {
+    strncpy(last_error, msg, BS_OTA_ERROR_LEN - 1);
+    last_error[BS_OTA_ERROR_LEN - 1] = '\0';
+    return false;
+}
+
+void BSOtaStream::release() {
+    #ifdef esp32
+        free(inflator);
+        free(window);
+        inflator = NULL;
+        window = NULL;
+    #endif
+}
+
+#ifdef esp32
+    // walk the optional header fields in the order rfc 1952 lays them out
+    static uint8_t nextGzipState(const uint8_t state, const uint8_t flags) {
+        if (state < BS_OTA_GZ_EXTRA_LEN && (flags & 0x04)) return BS_OTA_GZ_EXTRA_LEN;
+        if (state < BS_OTA_GZ_NAME && (flags & 0x08)) return BS_OTA_GZ_NAME;
+        if (state < BS_OTA_GZ_COMMENT && (flags & 0x10)) return BS_OTA_GZ_COMMENT;
+        if (state < BS_OTA_GZ_HCRC && (flags & 0x02)) return BS_OTA_GZ_HCRC;
+        return BS_OTA_GZ_BODY;
+    }
+
+    size_t BSOtaStream::parseGzipHeader(const uint8_t *data, size_t len) {
+        size_t i = 0;
+
+        while (i < len && gz_state < BS_OTA_GZ_BODY) {
+            const uint8_t c = data[i++];
+
+            switch (gz_state) {
+                case BS_OTA_GZ_FIXED:
+                    // id1 id2 cm flg mtime(4) xfl os
+                    if (gz_count == 2 && c != 8) {
+                        abort();
+                        setError("unsupported gzip compression method");
+                        return len;
+                    }
+                    if (gz_count == 3) gz_flags = c;
+                    if (++gz_count == 10) {
+                        gz_count = 0;
+                        gz_state = nextGzipState(gz_state, gz_flags);
+                    }
+                    break;
+                case BS_OTA_GZ_EXTRA_LEN:
+                    gz_extra |= c << (8 * gz_count);
+                    if (++gz_count == 2) {
+                        gz_count = 0;
+                        gz_state = gz_extra > 0 ? BS_OTA_GZ_EXTRA : nextGzipState(BS_OTA_GZ_EXTRA, gz_flags);
+                    }
+                    break;
+                case BS_OTA_GZ_EXTRA:
+                    if (--gz_extra == 0) gz_state = nextGzipState(gz_state, gz_flags);
+                    break;
+                case BS_OTA_GZ_NAME:
+                case BS_OTA_GZ_COMMENT:
+                    if (c == 0) gz_state = nextGzipState(gz_state, gz_flags);
+                    break;
+                case BS_OTA_GZ_HCRC:
+                    if (++gz_count == 2) {
+                        gz_count = 0;
+                        gz_state = BS_OTA_GZ_BODY;
+                    }
+                    break;
+            }
+        }
+
+        return i;
+    }
+
+    bool BSOtaStream::inflate(const uint8_t *data, size_t len) {
+        while (gz_state == BS_OTA_GZ_BODY) {
+            size_t in_bytes = len;
+            size_t out_bytes = TINFL_LZ_DICT_SIZE - window_pos;
+
+            // the window doubles as the deflate dictionary so it must wrap
+            const tinfl_status status = tinfl_decompress(inflator, data, &in_bytes, window, window + window_pos, &out_bytes, TINFL_FLAG_HAS_MORE_INPUT);
+
+            data += in_bytes;
+            len -= in_bytes;
+
+            if (out_bytes > 0) {
+                if (!writeImage(window + window_pos, out_bytes)) return false;
+                window_pos = (window_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+            }
+
+            // whatever follows (crc32 + isize trailer) is covered by the sha
+            if (status == TINFL_STATUS_DONE) {
+                gz_state = BS_OTA_GZ_DONE;
+                break;
+            }
+            if (status < TINFL_STATUS_DONE) return setError("corrupt gzip stream");
+            if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) break;
+        }
+
+        return true;
+    }
+#endif
@@ -0,0 +1,141 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSProfiler.h"
+
+static const char *step_names[BS_PROF_MAX_STEPS] = { "telnet", "dns", "ota", "template", "app", "tasks", "events", "step7" };
+
+void BSProfiler::begin() {
+    const uint32_t now = micros();
+
+    if (running) {
+        // whatever happened between our end() and now belongs to the app,
+        // apart from the sleep
+        const uint32_t gap = now - iteration_ended;
+        const uint32_t slept = idle_us < gap ? idle_us : gap;
+        step_us[BS_PROF_STEP_APP] += gap - slept;
+
+        const uint32_t duration = now - iteration_started - slept;
+
+        uint8_t dominant = BS_PROF_STEP_APP;
+        uint32_t dominant_us = 0;
+        for (uint8_t i = 0; i < BS_PROF_MAX_STEPS; i++) {
+            if (step_us[i] == 0) continue;
+
+            BS_PROF_STEP_TYPE *s = &steps[i];
+            s->count++;
+            s->total_us += step_us[i];
+            if (step_us[i] > s->max_us) s->max_us = step_us[i];
+
+            // the app always runs so it only dominates when nothing else did
+            if (i != BS_PROF_STEP_APP && step_us[i] > dominant_us) {
+                dominant = i;
+                dominant_us = step_us[i];
+            }
+        }
+
+        steps[dominant].histogram[bucket(duration)]++;
+
+        iterations++;
+        if (duration > max_iteration_us) max_iteration_us = duration;
+        if (duration > budget_us) overruns++;
+    }
+
+    memset(step_us, 0, sizeof(step_us));
+    idle_us = 0;
+    iteration_started = now;
+    running = true;
+}
+
+void BSProfiler::end() {
+    iteration_ended = micros();
+}
+
+void BSProfiler::stepBegin(const uint8_t step) {
+    step_started = micros();
+}
+
+void BSProfiler::stepEnd(const uint8_t step) {
+    if (step >= BS_PROF_MAX_STEPS) return;
+    step_us[step] += micros() - step_started;
+}
+
+void BSProfiler::idled(const uint32_t us) {
+    idle_us += us;
+}
+
+void BSProfiler::setBudget(const uint32_t budget) {
+    budget_us = budget;
+}
+
+void BSProfiler::reset() {
+    memset(steps, 0, sizeof(steps));
+    iterations = 0;
+    overruns = 0;
+    max_iteration_us = 0;
+    running = false;
+}
+
+uint8_t BSProfiler::bucket(const uint32_t us) {
+    uint32_t v = us >> BS_PROF_BUCKET_SHIFT;
+    uint8_t b = 0;
+    while (v > 0 && b < BS_PROF_BUCKETS - 1) {
+        v >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void BSProfiler::printTo(Print *out) {
+    out->printf("\nIterations: [%u]  Max: [%u] us  Budget: [%u] us  Overruns: [%u]\n\n", iterations, max_iteration_us, budget_us, overruns);
+    out->printf("%-9s %10s %10s %10s\n", "step", "count", "avg us", "max us");
+    for (uint8_t i = 0; i < BS_PROF_MAX_STEPS; i++) {
+        const BS_PROF_STEP_TYPE *s = &steps[i];
+        if (s->count == 0) continue;
+        out->printf("%-9s %10u %10u %10u\n", step_names[i], s->count, s->count ? (uint32_t) (s->total_us / s->count) : 0, s->max_us);
+    }
+
+    out->printf("\n%-9s", "< us");
+    for (uint8_t b = 0; b < BS_PROF_BUCKETS; b++) {
+        if (b == BS_PROF_BUCKETS - 1) {
+            out->printf(" %7s", "more");
+        } else {
+            out->printf(" %7lu", (unsigned long) (1UL << (b + BS_PROF_BUCKET_SHIFT)));
+        }
+    }
+    out->println();
+
+    for (uint8_t i = 0; i < BS_PROF_MAX_STEPS; i++) {
+        const BS_PROF_STEP_TYPE *s = &steps[i];
+        if (s->count == 0) continue;
+        out->printf("%-9s", step_names[i]);
+        for (uint8_t b = 0; b < BS_PROF_BUCKETS; b++) {
+            out->printf(" %7u", s->histogram[b]);
+        }
+        out->println();
+    }
+    out->println();
+}
+
+void BSProfiler::printJson(Print *out) {
+    out->printf("{\"iterations\":%u,\"max_us\":%u,\"budget_us\":%u,\"overruns\":%u,\"bucket_shift\":%u,\"steps\":{", iterations, max_iteration_us, budget_us, overruns, BS_PROF_BUCKET_SHIFT);
+
+    bool first = true;
+    for (uint8_t i = 0; i < BS_PROF_MAX_STEPS; i++) {
+        const BS_PROF_STEP_TYPE *s = &steps[i];
+        if (s->count == 0) continue;
+
+        out->printf("%s\"%s\":{\"count\":%u,\"avg_us\":%u,\"max_us\":%u,\"histogram\":[", first ? "" : ",", step_names[i], s->count, s->count ? (uint32_t) (s->total_us / s->count) : 0, s->max_us);
+        for (uint8_t b = 0; b < BS_PROF_BUCKETS; b++) {
+            out->printf("%s%u", b ? "," : "", s->histogram[b]);
+        }
+        out->print("]}");
+        first = false;
+    }
+
+    out->print("}}");
+}
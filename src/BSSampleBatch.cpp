@@ -0,0 +1,218 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSSampleBatch.h"
+
+#ifdef esp32
+    RTC_DATA_ATTR static BS_BATCH_RTC_TYPE rtc_batch;
+#endif
+
+void BSSampleBatch::begin(const uint8_t channels, const uint32_t max_age_s, BSSampleSink sink) {
+    _channels = channels < BS_BATCH_MAX_CHANNELS ? channels : BS_BATCH_MAX_CHANNELS;
+    this->max_age_s = max_age_s;
+    this->sink = sink;
+
+    // a batch restored with another layout cannot be decoded
+    if (rec.channels != _channels) clear();
+}
+
+uint32_t BSSampleBatch::clockS() {
+    return (uint32_t) ((rec.clock_ms + bs_micros64() / 1000) / 1000);
+}
+
+uint32_t BSSampleBatch::epochOffset() {
+    const time_t t = time(NULL);
+    return t > BS_TIME_VALID_EPOCH ? (uint32_t) t - clockS() : 0;
+}
+
+bool BSSampleBatch::add(const int32_t *values) {
+    if (!enabled()) return false;
+
+    const uint32_t t_s = clockS();
+    if (rec.count == 0) {
+        rec.first_s = t_s;
+        rec.base_s = t_s;
+        rec.last_s = t_s;
+        memcpy(rec.base, values, _channels * sizeof(int32_t));
+        memcpy(rec.last, values, _channels * sizeof(int32_t));
+    }
+
+    uint8_t record[BS_BATCH_MAX_RECORD_LEN];
+    size_t len = putVarint(record, t_s - rec.last_s);
+
+    for (uint8_t ch = 0; ch < _channels; ch++) {
+        const int32_t delta = (int32_t) ((uint32_t) values[ch] - (uint32_t) rec.last[ch]);
+        len += putVarint(record + len, ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31));
+    }
+
+    while (rec.used + len > BS_BATCH_DATA_LEN) evictOldest();
+
+    memcpy(rec.data + rec.used, record, len);
+    rec.used += len;
+    rec.count++;
+    rec.last_s = t_s;
+    memcpy(rec.last, values, _channels * sizeof(int32_t));
+
+    return true;
+}
+
+bool BSSampleBatch::flushDue() {
+    if (rec.count == 0) return false;
+    if (rec.used + BS_BATCH_MAX_RECORD_LEN > BS_BATCH_DATA_LEN) return true;
+    return max_age_s > 0 && clockS() - rec.first_s >= max_age_s;
+}
+
+bool BSSampleBatch::flush() {
+    if (rec.count == 0) return true;
+    if (sink == NULL) return false;
+
+    if (!sink(this)) {
+        failed_flushes++;
+        return false;
+    }
+
+    flushes++;
+    clear();
+    return true;
+}
+
+void BSSampleBatch::clear() {
+    // the batch clock keeps running across batches
+    const uint64_t clock_ms = rec.clock_ms;
+    memset(&rec, 0, sizeof(BS_BATCH_RTC_TYPE));
+    rec.clock_ms = clock_ms;
+    rec.channels = _channels;
+}
+
+void BSSampleBatch::forEach(BSSampleVisitor visitor) {
+    uint32_t t_s = rec.base_s;
+    int32_t values[BS_BATCH_MAX_CHANNELS];
+    memcpy(values, rec.base, sizeof(values));
+
+    size_t pos = 0;
+    for (uint16_t i = 0; i < rec.count; i++) {
+        const size_t n = decode(pos, &t_s, values);
+        if (n == 0) return;
+        pos += n;
+        visitor(t_s, values);
+    }
+}
+
+void BSSampleBatch::printJson(Print *out) {
+    out->printf("{\"epoch_offset\":%u,\"channels\":%u,\"evicted\":%u,\"samples\":[", epochOffset(), rec.channels, rec.evicted);
+
+    bool first = true;
+    forEach([out, &first, this](const uint32_t t_s, const int32_t *values)
+        {
+            out->printf("%s[%u", first ? "" : ",", t_s);
+            for (uint8_t ch = 0; ch < rec.channels; ch++) out->printf(",%d", values[ch]);
+            out->print("]");
+            first = false;
+        });
+
+    out->print("]}");
+}
+
+// applies the record at pos to the running t_s / values, returns its length
+size_t BSSampleBatch::decode(const size_t pos, uint32_t *t_s, int32_t *values) {
+    size_t n = 0;
+    uint32_t v;
+
+    const size_t dt_len = getVarint(rec.data + pos, rec.used - pos, &v);
+    if (dt_len == 0) return 0;
+    *t_s += v;
+    n += dt_len;
+
+    for (uint8_t ch = 0; ch < rec.channels; ch++) {
+        const size_t len = getVarint(rec.data + pos + n, rec.used - pos - n, &v);
+        if (len == 0) return 0;
+        values[ch] = (int32_t) ((uint32_t) values[ch] + (uint32_t) ((v >> 1) ^ -(v & 1)));
+        n += len;
+    }
+
+    return n;
+}
+
+void BSSampleBatch::evictOldest() {
+    // the oldest sample becomes the base the next one is relative to
+    uint32_t t_s = rec.base_s;
+    const size_t n = decode(0, &t_s, rec.base);
+    if (n == 0) {
+        clear();
+        return;
+    }
+
+    rec.base_s = t_s;
+    memmove(rec.data, rec.data + n, rec.used - n);
+    rec.used -= n;
+    rec.count--;
+    rec.evicted++;
+}
+
+size_t BSSampleBatch::putVarint(uint8_t *out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+size_t BSSampleBatch::getVarint(const uint8_t *in, const size_t len, uint32_t *v) {
+    *v = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        *v |= (uint32_t) (in[n] & 0x7f) << (7 * n);
+        if ((in[n] & 0x80) == 0) return n + 1;
+    }
+    return 0;
+}
+
+uint32_t BSSampleBatch::checksum() {
+    // everything after magic and check
+    const uint8_t *p = (const uint8_t *) &rec + 2 * sizeof(uint32_t);
+    const size_t len = offsetof(BS_BATCH_RTC_TYPE, data) - 2 * sizeof(uint32_t) + rec.used;
+
+    uint32_t sum = BS_BATCH_RTC_MAGIC;
+    for (size_t i = 0; i < len; i++) sum = (sum << 5) + sum + p[i];
+    return sum;
+}
+
+void BSSampleBatch::prepareDeepSleep(const uint64_t sleep_us) {
+    if (!enabled()) return;
+
+    rec.clock_ms += (bs_micros64() + sleep_us) / 1000;
+    rec.magic = BS_BATCH_RTC_MAGIC;
+    rec.check = checksum();
+
+    #ifdef esp32
+        memcpy(&rtc_batch, &rec, sizeof(BS_BATCH_RTC_TYPE));
+    #else
+        ESP.rtcUserMemoryWrite(BS_BATCH_RTC_OFFSET, (uint32_t *) &rec, sizeof(BS_BATCH_RTC_TYPE));
+    #endif
+}
+
+void BSSampleBatch::restore(const bool woke_from_deep_sleep) {
+    // anything but a deep sleep wake starts over -- the clock gap is unknown
+    if (woke_from_deep_sleep) {
+        #ifdef esp32
+            memcpy(&rec, &rtc_batch, sizeof(BS_BATCH_RTC_TYPE));
+        #else
+            ESP.rtcUserMemoryRead(BS_BATCH_RTC_OFFSET, (uint32_t *) &rec, sizeof(BS_BATCH_RTC_TYPE));
+        #endif
+
+        if (rec.magic == BS_BATCH_RTC_MAGIC && rec.used <= BS_BATCH_DATA_LEN && rec.channels == _channels && rec.check == checksum()) return;
+    }
+
+    memset(&rec, 0, sizeof(BS_BATCH_RTC_TYPE));
+    rec.channels = _channels;
+}
+
+void BSSampleBatch::printTo(Print *out) {
+    out->printf("Batched samples: [%u]  Bytes: [%u / %u]  Evicted: [%u]  Age: [%u] s\n", rec.count, rec.used, BS_BATCH_DATA_LEN, rec.evicted, rec.count > 0 ? clockS() - rec.first_s : 0);
+    out->printf("Flushes: [%u]  Failed: [%u]  Flush due: [%s]\n\n", flushes, failed_flushes, flushDue() ? "yes" : "no");
+}
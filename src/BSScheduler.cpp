@@ -0,0 +1,165 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSScheduler.h"
+
+unsigned short BSScheduler::once(const uint32_t delay_ms, BSTask callable, const uint8_t priority) {
+    return add(delay_ms, 0, callable, priority);
+}
+
+unsigned short BSScheduler::every(const uint32_t period_ms, BSTask callable, const uint8_t priority) {
+    return add(period_ms, period_ms, callable, priority);
+}
+
+unsigned short BSScheduler::add(const uint32_t delay_ms, const uint32_t period_ms, BSTask callable, const uint8_t priority) {
+    lock();
+
+    if (task_count >= BS_SCHED_MAX_TASKS) {
+        unlock();
+        return BS_SCHED_NO_TASK;
+    }
+
+    const unsigned short id = next_id++;
+    if (next_id == BS_SCHED_NO_TASK) next_id++;
+
+    BS_SCHED_TASK_TYPE *t = &tasks[task_count];
+    t->due = millis() + delay_ms;
+    t->period = period_ms;
+    t->id = id;
+    t->priority = priority;
+    t->callable = callable;
+
+    siftUp(task_count++);
+
+    unlock();
+    return id;
+}
+
+bool BSScheduler::cancel(const unsigned short id) {
+    if (id == BS_SCHED_NO_TASK) return false;
+
+    lock();
+    for (uint8_t i = 0; i < task_count; i++) {
+        if (tasks[i].id == id) {
+            removeAt(i);
+            unlock();
+            return true;
+        }
+    }
+    unlock();
+    return false;
+}
+
+bool BSScheduler::pending(const unsigned short id) {
+    if (id == BS_SCHED_NO_TASK) return false;
+
+    lock();
+    for (uint8_t i = 0; i < task_count; i++) {
+        if (tasks[i].id == id) {
+            unlock();
+            return true;
+        }
+    }
+    unlock();
+    return false;
+}
+
+void BSScheduler::run(const uint32_t budget_ms) {
+    const uint32_t started = millis();
+
+    while (true) {
+        lock();
+
+        if (task_count == 0) break;
+
+        const uint32_t now = millis();
+        BS_SCHED_TASK_TYPE *t = &tasks[0];
+
+        if ((int32_t) (now - t->due) < 0) break;
+        if (now - started >= budget_ms && t->priority < BS_SCHED_PRIORITY_HIGH) break;
+
+        // never run the callable from inside the heap -- it may (re)schedule
+        BSTask callable = t->callable;
+
+        if (t->period > 0) {
+            // skip missed periods rather than firing a burst of catch-up runs
+            t->due += t->period;
+            if ((int32_t) (now - t->due) >= 0) t->due = now + t->period;
+            siftDown(0);
+        } else {
+            removeAt(0);
+        }
+
+        unlock();
+        callable();
+    }
+
+    unlock();
+}
+
+bool BSScheduler::nextDeadline(uint32_t *ms_until) {
+    lock();
+
+    if (task_count == 0) {
+        unlock();
+        return false;
+    }
+
+    const int32_t remaining = (int32_t) (tasks[0].due - millis());
+    *ms_until = remaining > 0 ? remaining : 0;
+
+    unlock();
+    return true;
+}
+
+bool BSScheduler::before(const BS_SCHED_TASK_TYPE *a, const BS_SCHED_TASK_TYPE *b) {
+    const int32_t diff = (int32_t) (a->due - b->due);
+    if (diff != 0) return diff < 0;
+    return a->priority > b->priority;
+}
+
+void BSScheduler::siftUp(uint8_t i) {
+    while (i > 0) {
+        const uint8_t parent = (i - 1) / 2;
+        if (!before(&tasks[i], &tasks[parent])) break;
+        std::swap(tasks[i], tasks[parent]);
+        i = parent;
+    }
+}
+
+void BSScheduler::siftDown(uint8_t i) {
+    while (true) {
+        const uint8_t left = 2 * i + 1;
+        const uint8_t right = left + 1;
+        uint8_t first = i;
+
+        if (left < task_count && before(&tasks[left], &tasks[first])) first = left;
+        if (right < task_count && before(&tasks[right], &tasks[first])) first = right;
+        if (first == i) break;
+
+        std::swap(tasks[i], tasks[first]);
+        i = first;
+    }
+}
+
+void BSScheduler::removeAt(const uint8_t i) {
+    task_count--;
+    if (i != task_count) {
+        std::swap(tasks[i], tasks[task_count]);
+        siftDown(i);
+        siftUp(i);
+    }
+    tasks[task_count].callable = NULL;
+}
+
+void BSScheduler::lock() {
+    bs_mutex_lock(sched_mutex);
+}
+
+void BSScheduler::unlock() {
+    bs_mutex_unlock(sched_mutex);
+}
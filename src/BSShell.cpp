@@ -0,0 +1,159 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSShell.h"
+
+void BSShell::begin(Stream *io) {
+    _io = io;
+}
+
+void BSShell::step() {
+    if (_io == NULL) return;
+
+    // an abandoned prompt must not swallow the next command forever
+    if (prompt_callback != NULL && millis() - prompt_started > BS_SHELL_PROMPT_TIMEOUT_MS) {
+        cancelPrompt();
+        _io->println("\n\nTimed out!\n");
+        _io->flush();
+    }
+
+    // consume whatever is buffered but never more than one line per call
+    while (!line_ready && _io->available() > 0) {
+        feed(_io->read());
+    }
+
+    if (line_ready) dispatch();
+}
+
+bool BSShell::feed(const char c) {
+    if (line_ready) return true;
+
+    switch (c) {
+        case '\r':
+        case '\n':
+            // ignore the second half of CR/LF pairs and bare <ENTER> presses
+            if (line_len == 0 && !line_overflow) return false;
+            line[line_len] = '\0';
+            line_ready = true;
+            return true;
+        case 8:
+        case 127:
+            if (line_len > 0) line_len--;
+            return false;
+        default:
+            // other control characters (terminal negotiation, stray nuls)
+            // would end up inside an argument unseen
+            if ((unsigned char) c < ' ' && c != '\t') return false;
+            if (line_len < BS_SHELL_LINE_LEN - 1) {
+                line[line_len++] = c;
+            } else {
+                line_overflow = true;
+            }
+            return false;
+    }
+}
+
+void BSShell::dispatch() {
+    if (!line_ready) return;
+
+    if (line_overflow) {
+        if (_io != NULL) _io->printf("\nLine too long (max %d characters)\n\n", BS_SHELL_LINE_LEN - 1);
+        cancelPrompt();
+    } else if (prompt_callback != NULL) {
+        // the callback may chain another prompt so release ours first
+        BSShellPrompt callable = prompt_callback;
+        prompt_callback = NULL;
+        callable(line);
+    } else {
+        char *argv[BS_SHELL_MAX_ARGS];
+        const unsigned char argc = tokenize(argv);
+
+        if (argc > 0) {
+            bool found = false;
+            for (unsigned char i = 0; i < command_count; i++) {
+                if (strcasecmp(commands[i].name, argv[0]) == 0) {
+                    commands[i].callable(argc, argv);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found && _io != NULL) _io->printf("\nUnknown command [%s] - type ? for a list of commands\n\n", argv[0]);
+        }
+    }
+
+    if (_io != NULL) _io->flush();
+
+    line_len = 0;
+    line_overflow = false;
+    line_ready = false;
+}
+
+unsigned char BSShell::tokenize(char **argv) {
+    unsigned char argc = 0;
+    char *p = line;
+
+    while (*p != '\0' && argc < BS_SHELL_MAX_ARGS) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0') break;
+
+        // double quotes allow arguments with embedded spaces (SSIDs)
+        if (*p == '"') {
+            argv[argc++] = ++p;
+            while (*p != '\0' && *p != '"') p++;
+        } else {
+            argv[argc++] = p;
+            while (*p != '\0' && *p != ' ' && *p != '\t') p++;
+        }
+
+        if (*p != '\0') *p++ = '\0';
+    }
+
+    return argc;
+}
+
+bool BSShell::addCommand(const char *name, const char *help, BSShellCommand callable) {
+    for (unsigned char i = 0; i < command_count; i++) {
+        if (strcasecmp(commands[i].name, name) == 0) {
+            commands[i].help = help;
+            commands[i].callable = callable;
+            return true;
+        }
+    }
+
+    if (command_count >= BS_SHELL_MAX_COMMANDS) return false;
+
+    commands[command_count].name = name;
+    commands[command_count].help = help;
+    commands[command_count].callable = callable;
+    command_count++;
+
+    return true;
+}
+
+void BSShell::prompt(const char *text, BSShellPrompt callable) {
+    prompt_callback = callable;
+    prompt_started = millis();
+
+    if (_io != NULL) {
+        _io->print(text);
+        _io->flush();
+    }
+}
+
+void BSShell::cancelPrompt() {
+    prompt_callback = NULL;
+}
+
+void BSShell::printHelp() {
+    if (_io == NULL) return;
+
+    _io->println("\n\nCommands:\n");
+    for (unsigned char i = 0; i < command_count; i++) {
+        _io->printf("%s = %s\n", commands[i].name, commands[i].help);
+    }
+    _io->println();
+}
@@ -0,0 +1,452 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSTelemetry.h"
+
+// http://host[:port][/path] -- plain http, AsyncClient has no tls here
+bool BSTelemetry::setEndpoint(const char *url) {
+    host.clear();
+    url_path.clear();
+    port = 80;
+
+    if (strncmp(url, "http://", 7) != 0) return false;
+
+    const char *start = url + 7;
+    const char *slash = strchr(start, '/');
+    const char *end = slash != NULL ? slash : start + strlen(start);
+    const char *colon = (const char *) memchr(start, ':', end - start);
+
+    const char *host_end = colon != NULL ? colon : end;
+    if (host_end == start || (size_t) (host_end - start) >= BS_TELEMETRY_HOST_LEN) return false;
+
+    if (colon != NULL) {
+        char *rest;
+        const unsigned long p = strtoul(colon + 1, &rest, 10);
+        if (rest != end || p == 0 || p > 65535) return false;
+        port = (uint16_t) p;
+    }
+
+    url_path.print(slash != NULL ? slash : "/");
+    if (url_path.truncated()) {
+        url_path.clear();
+        return false;
+    }
+
+    host.append(start, host_end - start);
+    return true;
+}
+
+void BSTelemetry::setAuthorization(const char *value) {
+    authorization.clear();
+    if (value != NULL) authorization.print(value);
+}
+
+bool BSTelemetry::begin(const char *dir) {
+    store_tried = true;
+    strncpy(this->dir, dir, BS_TELEMETRY_PATH_LEN - 1);
+
+    if (!LittleFS.exists(this->dir)) LittleFS.mkdir(this->dir);
+    if (!LittleFS.exists(this->dir)) return false;
+
+    // pick up whatever an earlier boot left behind
+    bool found = false;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    uint32_t bytes = 0;
+
+    auto segment = [&](const char *name, const size_t size)
+        {
+            char *rest;
+            const uint32_t seq = strtoul(name, &rest, 16);
+            if (*rest != '\0' || rest == name) return;
+
+            if (!found || seq < first) first = seq;
+            if (!found || seq > last) last = seq;
+            bytes += size;
+            found = true;
+        };
+
+    #ifdef esp32
+        File root = LittleFS.open(this->dir);
+        while (root) {
+            File entry = root.openNextFile();
+            if (!entry) break;
+
+            // older cores hand out the full path
+            const char *slash = strrchr(entry.name(), '/');
+            segment(slash != NULL ? slash + 1 : entry.name(), entry.size());
+            entry.close();
+        }
+        if (root) root.close();
+    #else
+        Dir root = LittleFS.openDir(this->dir);
+        while (root.next()) segment(root.fileName().c_str(), root.fileSize());
+    #endif
+
+    bs_mutex_lock(lock);
+    head_seq = first;
+    tail_seq = last;
+    head_offset = 0;
+    store_bytes = bytes;
+    store_ready = true;
+    bs_mutex_unlock(lock);
+
+    return true;
+}
+
+bool BSTelemetry::enqueue(const char *record) {
+    if (!enabled()) return false;
+
+    const size_t len = strnlen(record, BS_TELEMETRY_RECORD_LEN);
+    if (len == 0 || len >= BS_TELEMETRY_RECORD_LEN || memchr(record, '\n', len) != NULL) {
+        records_dropped++;
+        return false;
+    }
+
+    bs_mutex_lock(lock);
+
+    // a full ring makes room by moving its oldest record to the log
+    if (ring_count == BS_TELEMETRY_RING_LEN) {
+        if (!spill(&ring[ring_head])) {
+            bs_mutex_unlock(lock);
+            records_dropped++;
+            return false;
+        }
+        ring_head = (ring_head + 1) % BS_TELEMETRY_RING_LEN;
+        ring_count--;
+    }
+
+    BS_TELEMETRY_RECORD_TYPE *slot = &ring[(ring_head + ring_count) % BS_TELEMETRY_RING_LEN];
+    memcpy(slot->data, record, len);
+    slot->len = len;
+    if (ring_count == 0) oldest_ms = millis();
+    ring_count++;
+    records_enqueued++;
+
+    bs_mutex_unlock(lock);
+    return true;
+}
+
+bool BSTelemetry::needsStore(const bool online) {
+    if (!enabled() || store_tried) return false;
+    return ring_count == BS_TELEMETRY_RING_LEN || (!online && (ring_count > 0 || batch_source == BS_TELEMETRY_BATCH_RAM));
+}
+
+void BSTelemetry::process(const bool online) {
+    if (!enabled()) return;
+
+    if (state == STATE_DONE || (state != STATE_IDLE && millis() - sent_ms > BS_TELEMETRY_TIMEOUT_MS)) resolve();
+    if (state != STATE_IDLE) return;
+
+    // nothing leaves while offline, so get the ram out of a reboot's way
+    if (!online) {
+        bs_mutex_lock(lock);
+        spillRing();
+        bs_mutex_unlock(lock);
+        return;
+    }
+
+    if ((long) (millis() - next_attempt_ms) < 0) return;
+
+    if (batch_source == BS_TELEMETRY_BATCH_NONE) {
+        bs_mutex_lock(lock);
+        const bool built = buildBatch();
+        bs_mutex_unlock(lock);
+        if (!built) return;
+    }
+
+    send();
+}
+
+void BSTelemetry::persist() {
+    if (!store_ready) return;
+
+    bs_mutex_lock(lock);
+
+    // a batch that came from the ring is older than anything left in it
+    if (batch_source == BS_TELEMETRY_BATCH_RAM && append(batch, batch_len, batch_records)) batch_source = BS_TELEMETRY_BATCH_NONE;
+    spillRing();
+
+    bs_mutex_unlock(lock);
+}
+
+// caller holds the lock
+void BSTelemetry::spillRing() {
+    while (ring_count > 0 && spill(&ring[ring_head])) {
+        ring_head = (ring_head + 1) % BS_TELEMETRY_RING_LEN;
+        ring_count--;
+    }
+}
+
+bool BSTelemetry::spill(const BS_TELEMETRY_RECORD_TYPE *record) {
+    char line[BS_TELEMETRY_RECORD_LEN + 1];
+    memcpy(line, record->data, record->len);
+    line[record->len] = '\n';
+    return append(line, record->len + 1, 1);
+}
+
+// caller holds the lock
+bool BSTelemetry::append(const char *data, const size_t len, const uint16_t records) {
+    if (!store_ready) return false;
+
+    char name[BS_TELEMETRY_PATH_LEN + 12];
+    path(name, tail_seq);
+
+    File file = LittleFS.open(name, "a");
+    if (!file) return false;
+
+    if (file.size() > 0 && file.size() + len > BS_TELEMETRY_SEGMENT_BYTES) {
+        file.close();
+        tail_seq++;
+        if (tail_seq - head_seq >= BS_TELEMETRY_MAX_SEGMENTS) dropOldestSegment();
+
+        path(name, tail_seq);
+        file = LittleFS.open(name, "a");
+        if (!file) return false;
+    }
+
+    const size_t written = file.write((const uint8_t *) data, len);
+    file.close();
+
+    store_bytes += written;
+    if (written != len) return false;
+
+    records_spilled += records;
+    return true;
+}
+
+// caller holds the lock
+void BSTelemetry::dropOldestSegment() {
+    char name[BS_TELEMETRY_PATH_LEN + 12];
+    path(name, head_seq);
+
+    // whatever is in flight from it still counts as sent
+    const uint32_t from = batch_source == BS_TELEMETRY_BATCH_SEGMENT ? batch_end : head_offset;
+    uint32_t size = 0;
+
+    File file = LittleFS.open(name, "r");
+    if (file) {
+        size = file.size();
+        if (from < size && file.seek(from)) {
+            char buf[64];
+            size_t n;
+            while ((n = file.read((uint8_t *) buf, sizeof(buf))) > 0) {
+                for (size_t i = 0; i < n; i++) if (buf[i] == '\n') records_dropped++;
+            }
+        }
+        file.close();
+    }
+    LittleFS.remove(name);
+
+    const uint32_t remaining = size > head_offset ? size - head_offset : 0;
+    store_bytes = store_bytes > remaining ? store_bytes - remaining : 0;
+
+    // the batch now owns its records outright
+    if (batch_source == BS_TELEMETRY_BATCH_SEGMENT) batch_source = BS_TELEMETRY_BATCH_RAM;
+
+    head_seq++;
+    head_offset = 0;
+}
+
+// caller holds the lock -- the log first, it holds the oldest records
+bool BSTelemetry::buildBatch() {
+    char name[BS_TELEMETRY_PATH_LEN + 12];
+
+    while (store_ready && store_bytes > 0) {
+        path(name, head_seq);
+        File file = LittleFS.open(name, "r");
+        uint32_t size = 0;
+
+        if (file) {
+            size = file.size();
+            if (head_offset < size && file.seek(head_offset)) {
+                const size_t n = file.read((uint8_t *) batch, BS_TELEMETRY_BATCH_BYTES);
+                file.close();
+
+                // whole lines only
+                size_t end = 0;
+                uint16_t count = 0;
+                for (size_t i = 0; i < n && count < BS_TELEMETRY_BATCH_RECORDS; i++) {
+                    if (batch[i] == '\n') {
+                        end = i + 1;
+                        count++;
+                    }
+                }
+
+                if (count > 0) {
+                    batch_len = end;
+                    batch_records = count;
+                    batch_end = head_offset + end;
+                    batch_source = BS_TELEMETRY_BATCH_SEGMENT;
+                    return true;
+                }
+                // a torn last line from a failed write -- the segment is done
+            } else {
+                file.close();
+            }
+        }
+
+        const uint32_t remaining = size > head_offset ? size - head_offset : 0;
+        store_bytes = store_bytes > remaining ? store_bytes - remaining : 0;
+        LittleFS.remove(name);
+        head_offset = 0;
+
+        if (head_seq == tail_seq) {
+            store_bytes = 0;
+            break;
+        }
+        head_seq++;
+    }
+
+    if (ring_count == 0) return false;
+
+    // let a batch fill up unless its oldest record has waited long enough
+    size_t bytes = 0;
+    for (uint16_t i = 0; i < ring_count; i++) bytes += ring[(ring_head + i) % BS_TELEMETRY_RING_LEN].len + 1;
+    if (ring_count < BS_TELEMETRY_BATCH_RECORDS && bytes < BS_TELEMETRY_BATCH_BYTES && millis() - oldest_ms < BS_TELEMETRY_LINGER_MS) return false;
+
+    batch_len = 0;
+    batch_records = 0;
+    while (ring_count > 0 && batch_records < BS_TELEMETRY_BATCH_RECORDS) {
+        const BS_TELEMETRY_RECORD_TYPE *record = &ring[ring_head];
+        if (batch_len + record->len + 1 > BS_TELEMETRY_BATCH_BYTES) break;
+
+        memcpy(batch + batch_len, record->data, record->len);
+        batch_len += record->len;
+        batch[batch_len++] = '\n';
+        batch_records++;
+
+        ring_head = (ring_head + 1) % BS_TELEMETRY_RING_LEN;
+        ring_count--;
+    }
+    if (ring_count > 0) oldest_ms = millis();
+
+    batch_source = BS_TELEMETRY_BATCH_RAM;
+    return true;
+}
+
+void BSTelemetry::send() {
+    head.clear();
+    head.printf("POST %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP-Bootstrap\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n",
+        url_path.c_str(), host.c_str(), BS_TELEMETRY_CONTENT_TYPE, (unsigned int) batch_len);
+    if (authorization.length() > 0) head.printf("Authorization: %s\r\n", authorization.c_str());
+    head.print("\r\n");
+
+    wireClient();
+
+    http_status = 0;
+    sent_ms = millis();
+    state = STATE_CONNECTING;
+    if (!client.connect(host.c_str(), port)) state = STATE_DONE;
+}
+
+void BSTelemetry::resolve() {
+    // timed out -- whatever the connection does next no longer matters
+    if (state != STATE_DONE) client.close(true);
+
+    const int status = http_status;
+    last_status = status;
+    last_rtt_ms = millis() - sent_ms;
+
+    // a 4xx other than 408 / 429 would fail the same way forever
+    const bool delivered = status >= 200 && status < 300;
+    const bool refused = status >= 400 && status < 500 && status != 408 && status != 429;
+
+    if (delivered || refused) {
+        bs_mutex_lock(lock);
+        if (batch_source == BS_TELEMETRY_BATCH_SEGMENT) {
+            const uint32_t consumed = batch_end - head_offset;
+            store_bytes = store_bytes > consumed ? store_bytes - consumed : 0;
+            head_offset = batch_end;
+
+            // drained -- leave nothing for the next boot to resend
+            if (store_bytes == 0) {
+                char name[BS_TELEMETRY_PATH_LEN + 12];
+                path(name, head_seq);
+                LittleFS.remove(name);
+                head_seq = tail_seq;
+                head_offset = 0;
+            }
+        }
+        bs_mutex_unlock(lock);
+
+        if (delivered) {
+            records_delivered += batch_records;
+            batches_sent++;
+            bytes_sent += batch_len;
+        } else {
+            records_rejected += batch_records;
+        }
+
+        batch_source = BS_TELEMETRY_BATCH_NONE;
+        backoff_ms = BS_TELEMETRY_BACKOFF_MIN_MS;
+        next_attempt_ms = millis();
+    } else {
+        // the batch stays as it is for the next attempt
+        batches_failed++;
+        next_attempt_ms = millis() + backoff_ms + random(backoff_ms / 4);
+        backoff_ms = backoff_ms * 2 > BS_TELEMETRY_BACKOFF_MAX_MS ? BS_TELEMETRY_BACKOFF_MAX_MS : backoff_ms * 2;
+    }
+
+    state = STATE_IDLE;
+}
+
+// the callbacks run on the tcp task, they only ever move the state along
+void BSTelemetry::wireClient() {
+    if (client_wired) return;
+    client_wired = true;
+
+    client.onConnect([this](void *arg, AsyncClient *c) { onConnect(); });
+    client.onData([this](void *arg, AsyncClient *c, void *data, size_t len) { onData((const char *) data, len); });
+    client.onDisconnect([this](void *arg, AsyncClient *c)
+        {
+            if (state == STATE_CONNECTING || state == STATE_SENT) state = STATE_DONE;
+        });
+    client.onError([this](void *arg, AsyncClient *c, int8_t error)
+        {
+            if (state == STATE_CONNECTING || state == STATE_SENT) state = STATE_DONE;
+        });
+    client.onTimeout([this](void *arg, AsyncClient *c, uint32_t time) { c->close(true); });
+    client.setRxTimeout(BS_TELEMETRY_TIMEOUT_MS / 1000);
+}
+
+void BSTelemetry::onConnect() {
+    // header and batch go out in one go or not at all
+    if (client.space() < head.length() + batch_len) {
+        client.close(true);
+        return;
+    }
+
+    client.add(head.c_str(), head.length());
+    client.add(batch, batch_len);
+    client.send();
+    state = STATE_SENT;
+}
+
+void BSTelemetry::onData(const char *data, const size_t len) {
+    // the status line is all that matters
+    if (http_status == 0 && len >= 12 && strncmp(data, "HTTP/1.", 7) == 0) {
+        http_status = atoi(data + 9);
+    }
+    client.close();
+}
+
+void BSTelemetry::path(char *out, const uint32_t seq) {
+    snprintf(out, BS_TELEMETRY_PATH_LEN + 12, "%s/%08lx", dir, (unsigned long) seq);
+}
+
+void BSTelemetry::printTo(Print *out) {
+    static const char *states[] = { "idle", "connecting", "sent", "done" };
+
+    out->printf("\nTelemetry: [http://%s:%u%s]  State: [%s]\n", host.c_str(), port, url_path.c_str(), states[state]);
+    out->printf("Enqueued: [%u]  Delivered: [%u]  Rejected: [%u]  Dropped: [%u]  Spilled: [%u]\n",
+        records_enqueued, records_delivered, records_rejected, records_dropped, records_spilled);
+    out->printf("Batches: [%u] sent  [%u] failed  Bytes: [%u]  Last status: [%d]  Round trip: [%lu] ms  Backoff: [%lu] ms\n",
+        batches_sent, batches_failed, bytes_sent, last_status, last_rtt_ms, backoff_ms);
+    out->printf("Pending: [%u / %u]  Log: [%u] B in [%u] segments%s\n\n", ring_count, BS_TELEMETRY_RING_LEN, store_bytes,
+        store_bytes > 0 ? tail_seq - head_seq + 1 : 0, store_ready ? "" : " (not mounted)");
+}
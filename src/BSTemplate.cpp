@@ -0,0 +1,96 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSTemplate.h"
+
+// batches output so the file system sees a few large writes
+class BSTemplateOutput {
+    public:
+        BSTemplateOutput(Print *out) { this->out = out; }
+
+        void put(const char c) {
+            if (len == BS_TEMPLATE_OUT_LEN) flush();
+            buf[len++] = c;
+        }
+        void put(const char *s, size_t n) {
+            while (n-- > 0) put(*s++);
+        }
+        void flush() {
+            if (len > 0 && out->write((const uint8_t *) buf, len) != len) ok = false;
+            len = 0;
+        }
+
+        bool ok = true;
+
+    private:
+        Print *out;
+        char buf[BS_TEMPLATE_OUT_LEN];
+        size_t len = 0;
+};
+
+static bool isTokenChar(const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool BSTemplate::render(Stream *in, Print *out, BSTemplateResolver resolve) {
+    BSTemplateOutput output(out);
+
+    char chunk[BS_TEMPLATE_CHUNK_LEN];
+    char token[BS_TEMPLATE_TOKEN_LEN + 1];
+    size_t token_len = 0;
+    bool in_token = false;
+    size_t n;
+
+    // a failed write (file system full) ends the render, there is no point
+    // reading the rest of the template
+    while (output.ok && (n = in->readBytes(chunk, BS_TEMPLATE_CHUNK_LEN)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const char c = chunk[i];
+
+            if (in_token) {
+                if (c == '}' && token_len > 0) {
+                    token[token_len] = '\0';
+                    const char *value = resolve != NULL ? resolve(token) : NULL;
+                    if (value != NULL) {
+                        output.put(value, strlen(value));
+                    } else {
+                        output.put('{');
+                        output.put(token, token_len);
+                        output.put('}');
+                    }
+                    in_token = false;
+                    continue;
+                }
+                if (isTokenChar(c) && token_len < BS_TEMPLATE_TOKEN_LEN) {
+                    token[token_len++] = c;
+                    continue;
+                }
+
+                // not a token after all -- emit what we held back and treat
+                // this character normally (it may open the next token)
+                output.put('{');
+                output.put(token, token_len);
+                in_token = false;
+            }
+
+            if (c == '{') {
+                in_token = true;
+                token_len = 0;
+            } else {
+                output.put(c);
+            }
+        }
+    }
+
+    if (in_token) {
+        output.put('{');
+        output.put(token, token_len);
+    }
+    output.flush();
+
+    return output.ok;
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSTime.h"
+
+BSTime* BSTime::instance = NULL;
+
+void BSTime::begin(const char *ntp_server, const char *tz) {
+    instance = this;
+
+    #ifdef BS_HOST
+        // the os keeps the clock -- count it as one sync
+        (void) ntp_server;
+        onSync();
+    #else
+        #ifdef esp32
+            sntp_set_time_sync_notification_cb([](struct timeval *tv) { onSync(); });
+        #else
+            settimeofday_cb([](bool from_sntp) { if (from_sntp) onSync(); });
+        #endif
+
+        // sntp keeps a pointer to the server name -- it must outlive us
+        configTime(0, 0, ntp_server);
+    #endif
+    setTimeZone(tz);
+}
+
+void BSTime::setTimeZone(const char *tz) {
+    setenv("TZ", tz, 1);
+    tzset();
+    cached_key = -1;
+}
+
+const char* BSTime::now() {
+    const time_t t = time(NULL);
+    const bool wall = t > BS_TIME_VALID_EPOCH;
+    const time_t key = wall ? t : (time_t) (millis() / 1000);
+
+    if (key == cached_key && wall == cached_wall) return cached;
+
+    if (wall) {
+        struct tm timeinfo;
+        localtime_r(&t, &timeinfo);
+        strftime(cached, BS_TIME_STRING_LEN, "%Y-%m-%d %H:%M:%S", &timeinfo);
+    } else {
+        snprintf(cached, BS_TIME_STRING_LEN, "%06lu", (unsigned long) key);
+    }
+
+    cached_key = key;
+    cached_wall = wall;
+    return cached;
+}
+
+bool BSTime::valid() {
+    return time(NULL) > BS_TIME_VALID_EPOCH;
+}
+
+uint32_t BSTime::lastSyncAgeS() {
+    return sync_count > 0 ? (uint32_t) ((bs_micros64() - last_sync_mono_us) / 1000000ULL) : 0;
+}
+
+// runs on the sntp (lwip) context right after the clock was set
+void BSTime::onSync() {
+    if (instance == NULL) return;
+    BSTime *self = instance;
+
+    const uint64_t mono_us = bs_micros64();
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    const int64_t wall_us = (int64_t) tv.tv_sec * 1000000LL + tv.tv_usec;
+
+    if (self->sync_count > 0) {
+        // where the local clock would be had nobody corrected it
+        const int64_t interval_us = (int64_t) (mono_us - self->last_sync_mono_us);
+        const int64_t correction_us = wall_us - (self->last_sync_wall_us + interval_us);
+
+        self->last_correction_ms = (int32_t) (correction_us / 1000);
+        if (interval_us > 60000000LL) self->drift_ppm = (int32_t) (correction_us * 1000000LL / interval_us);
+    }
+
+    self->last_sync_mono_us = mono_us;
+    self->last_sync_wall_us = wall_us;
+    self->cached_key = -1;
+    self->sync_count++;
+}
+
+void BSTime::prepareDeepSleep(const uint64_t sleep_us) {
+    #if !defined(esp32) && !defined(BS_HOST)
+        if (!valid()) return;
+
+        BS_TIME_RTC_TYPE rec;
+        rec.magic = BS_TIME_RTC_MAGIC;
+        rec.epoch_s = (uint32_t) time(NULL);
+        rec.sleep_ms = (uint32_t) (sleep_us / 1000);
+        rec.check = rec.magic ^ rec.epoch_s ^ rec.sleep_ms;
+
+        ESP.rtcUserMemoryWrite(BS_TIME_RTC_OFFSET, (uint32_t *) &rec, sizeof(BS_TIME_RTC_TYPE));
+    #else
+        (void) sleep_us;
+    #endif
+}
+
+void BSTime::restore(const bool woke_from_deep_sleep) {
+    #if !defined(esp32) && !defined(BS_HOST)
+        BS_TIME_RTC_TYPE rec;
+        ESP.rtcUserMemoryRead(BS_TIME_RTC_OFFSET, (uint32_t *) &rec, sizeof(BS_TIME_RTC_TYPE));
+
+        // one shot -- a later cold boot must not resurrect a stale clock
+        BS_TIME_RTC_TYPE cleared;
+        memset(&cleared, 0, sizeof(BS_TIME_RTC_TYPE));
+        ESP.rtcUserMemoryWrite(BS_TIME_RTC_OFFSET, (uint32_t *) &cleared, sizeof(BS_TIME_RTC_TYPE));
+
+        if (!woke_from_deep_sleep || valid()) return;
+        if (rec.magic != BS_TIME_RTC_MAGIC || rec.check != (rec.magic ^ rec.epoch_s ^ rec.sleep_ms)) return;
+
+        // the sleep itself plus however long we have been up since
+        const uint64_t elapsed_ms = (uint64_t) rec.sleep_ms + millis();
+        struct timeval tv;
+        tv.tv_sec = rec.epoch_s + elapsed_ms / 1000;
+        tv.tv_usec = (elapsed_ms % 1000) * 1000;
+        settimeofday(&tv, NULL);
+
+        restored = true;
+        cached_key = -1;
+    #else
+        (void) woke_from_deep_sleep;
+    #endif
+}
+
+void BSTime::printTo(Print *out) {
+    out->printf("Current timestamp: [%s]  %s\n", now(), synced() ? "synced" : estimated() ? "estimated (deep sleep)" : valid() ? "set" : "uptime");
+    if (synced()) {
+        out->printf("Syncs: [%u]  Last: [%u] s ago  Last correction: [%d] ms  Drift: [%d] ppm\n", sync_count, lastSyncAgeS(), last_correction_ms, drift_ppm);
+    }
+    out->println();
+}
@@ -0,0 +1,471 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSTimeSeries.h"
+#include <math.h>
+
+static int32_t signExtend(const uint32_t v, const uint8_t n) {
+    return (int32_t) (v << (32 - n)) >> (32 - n);
+}
+
+void BSTimeSeriesCodec::begin(uint8_t *buf, const size_t cap) {
+    this->buf = buf;
+    this->cap = cap;
+    memset(buf, 0, cap);
+    memset(&header, 0, sizeof(BS_TS_BLOCK_TYPE));
+    header.magic = BS_TS_BLOCK_MAGIC;
+
+    bits = 0;
+    prev_t = 0;
+    prev_delta = 0;
+    prev_bits = 0;
+    leading = 0xff;
+    trailing = 0;
+    done = 0;
+}
+
+void BSTimeSeriesCodec::open(uint8_t *buf, const BS_TS_BLOCK_TYPE *block) {
+    this->buf = buf;
+    cap = block->bytes;
+    header = *block;
+
+    bits = 0;
+    prev_t = 0;
+    prev_delta = 0;
+    prev_bits = 0;
+    leading = 0xff;
+    trailing = 0;
+    done = 0;
+}
+
+bool BSTimeSeriesCodec::full() {
+    return header.count >= BS_TS_BLOCK_MAX_RECORDS || bits + 80 > cap * 8;
+}
+
+bool BSTimeSeriesCodec::append(const uint32_t t, const float value) {
+    if (full()) return false;
+
+    uint32_t vb;
+    memcpy(&vb, &value, sizeof(uint32_t));
+
+    if (header.count == 0) {
+        header.t_first = t;
+        header.v_min = value;
+        header.v_max = value;
+        put(vb, 32);
+    } else {
+        const int32_t delta = (int32_t) (t - prev_t);
+        const int32_t dod = (int32_t) ((uint32_t) delta - (uint32_t) prev_delta);
+
+        if (dod == 0) {
+            put(0, 1);
+        } else if (dod >= -64 && dod <= 63) {
+            put(0x2, 2);
+            put((uint32_t) dod & 0x7f, 7);
+        } else if (dod >= -256 && dod <= 255) {
+            put(0x6, 3);
+            put((uint32_t) dod & 0x1ff, 9);
+        } else if (dod >= -2048 && dod <= 2047) {
+            put(0xe, 4);
+            put((uint32_t) dod & 0xfff, 12);
+        } else {
+            put(0xf, 4);
+            put((uint32_t) dod, 32);
+        }
+        prev_delta = delta;
+
+        const uint32_t x = vb ^ prev_bits;
+        if (x == 0) {
+            put(0, 1);
+        } else {
+            const uint8_t lz = __builtin_clz(x);
+            const uint8_t tz = __builtin_ctz(x);
+
+            if (leading != 0xff && lz >= leading && tz >= trailing) {
+                // fits the previous window
+                put(0x2, 2);
+                put(x >> trailing, 32 - leading - trailing);
+            } else {
+                const uint8_t len = 32 - lz - tz;
+                put(0x3, 2);
+                put(lz, 5);
+                put(len - 1, 5);
+                put(x >> tz, len);
+                leading = lz;
+                trailing = tz;
+            }
+        }
+
+        if (value < header.v_min) header.v_min = value;
+        if (value > header.v_max) header.v_max = value;
+    }
+
+    prev_t = t;
+    prev_bits = vb;
+    header.t_last = t;
+    header.count++;
+    header.bytes = bytes();
+
+    return true;
+}
+
+bool BSTimeSeriesCodec::next(uint32_t *t, float *value) {
+    if (done >= header.count) return false;
+
+    uint32_t vb;
+
+    if (done == 0) {
+        *t = header.t_first;
+        vb = get(32);
+    } else {
+        int32_t dod;
+        if (get(1) == 0) {
+            dod = 0;
+        } else if (get(1) == 0) {
+            dod = signExtend(get(7), 7);
+        } else if (get(1) == 0) {
+            dod = signExtend(get(9), 9);
+        } else if (get(1) == 0) {
+            dod = signExtend(get(12), 12);
+        } else {
+            dod = (int32_t) get(32);
+        }
+
+        prev_delta = (int32_t) ((uint32_t) prev_delta + (uint32_t) dod);
+        *t = prev_t + prev_delta;
+
+        if (get(1) == 0) {
+            vb = prev_bits;
+        } else if (get(1) == 0) {
+            vb = prev_bits ^ (get(32 - leading - trailing) << trailing);
+        } else {
+            leading = get(5);
+            const uint8_t len = get(5) + 1;
+            trailing = 32 - leading - len;
+            vb = prev_bits ^ (get(len) << trailing);
+        }
+    }
+
+    prev_t = *t;
+    prev_bits = vb;
+    memcpy(value, &vb, sizeof(float));
+    done++;
+
+    return true;
+}
+
+void BSTimeSeriesCodec::put(const uint32_t v, const uint8_t n) {
+    for (int8_t i = n - 1; i >= 0; i--) {
+        if ((v >> i) & 1) buf[bits >> 3] |= 0x80 >> (bits & 7);
+        bits++;
+    }
+}
+
+uint32_t BSTimeSeriesCodec::get(const uint8_t n) {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        // a truncated block reads as zeros rather than past the buffer
+        const uint8_t bit = bits < cap * 8 ? (buf[bits >> 3] >> (7 - (bits & 7))) & 1 : 0;
+        v = (v << 1) | bit;
+        bits++;
+    }
+    return v;
+}
+
+bool BSTimeSeries::begin(const char *dir) {
+    if (lock == NULL) lock = bs_mutex_create();
+    strncpy(this->dir, dir, BS_TS_PATH_LEN - 1);
+
+    if (!LittleFS.exists(this->dir)) LittleFS.mkdir(this->dir);
+    return LittleFS.exists(this->dir);
+}
+
+bool BSTimeSeries::record(const uint8_t series, const float value) {
+    // without a wall clock the samples could never be placed
+    const time_t t = time(NULL);
+    if (lock == NULL || series >= BS_TS_MAX_SERIES || !isfinite(value) || t <= BS_TIME_VALID_EPOCH) {
+        dropped_records++;
+        return false;
+    }
+
+    if (ring_count == BS_TS_RING_LEN) compact();
+
+    bs_mutex_lock(lock);
+
+    // littlefs refused the compaction -- make room at the old end
+    if (ring_count == BS_TS_RING_LEN) {
+        ring_head = (ring_head + 1) % BS_TS_RING_LEN;
+        ring_count--;
+        dropped_records++;
+    }
+
+    BS_TS_RECORD_TYPE *rec = &ring[(ring_head + ring_count) % BS_TS_RING_LEN];
+    rec->t = (uint32_t) t;
+    rec->value = value;
+    rec->series = series;
+    ring_count++;
+    recorded++;
+
+    bs_mutex_unlock(lock);
+    return true;
+}
+
+void BSTimeSeries::compact() {
+    if (lock == NULL || ring_count == 0) return;
+
+    bs_mutex_lock(lock);
+
+    for (uint8_t series = 0; series < BS_TS_MAX_SERIES; series++) compactSeries(series);
+
+    // keep whatever could not be written, in order
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < ring_count; i++) {
+        const BS_TS_RECORD_TYPE *rec = &ring[(ring_head + i) % BS_TS_RING_LEN];
+        if (rec->series < BS_TS_MAX_SERIES) ring[(ring_head + kept++) % BS_TS_RING_LEN] = *rec;
+    }
+    ring_count = kept;
+    compactions++;
+
+    bs_mutex_unlock(lock);
+}
+
+// called with the lock held
+void BSTimeSeries::compactSeries(const uint8_t series) {
+    BSTimeSeriesCodec codec;
+    codec.begin(block_buf, BS_TS_BLOCK_MAX_BYTES);
+
+    // written -- mark the block's records for removal from the ring, so a
+    // later block that fails does not put them on flash a second time
+    auto written = [this, series](const uint16_t from, const uint16_t to)
+        {
+            for (uint16_t i = from; i < to; i++) {
+                BS_TS_RECORD_TYPE *rec = &ring[(ring_head + i) % BS_TS_RING_LEN];
+                if (rec->series == series) rec->series = 0xff;
+            }
+        };
+
+    // ring index of the current block's first record
+    uint16_t block_start = 0;
+    for (uint16_t i = 0; i < ring_count; i++) {
+        const BS_TS_RECORD_TYPE *rec = &ring[(ring_head + i) % BS_TS_RING_LEN];
+        if (rec->series != series) continue;
+
+        if (codec.full()) {
+            if (!writeBlock(series, &codec)) return;
+            written(block_start, i);
+            block_start = i;
+            codec.begin(block_buf, BS_TS_BLOCK_MAX_BYTES);
+        }
+        codec.append(rec->t, rec->value);
+    }
+
+    if (codec.header.count == 0 || !writeBlock(series, &codec)) return;
+    written(block_start, ring_count);
+}
+
+bool BSTimeSeries::writeBlock(const uint8_t series, BSTimeSeriesCodec *codec) {
+    char current[BS_TS_PATH_LEN];
+    path(current, series, false);
+
+    const size_t len = sizeof(BS_TS_BLOCK_TYPE) + codec->bytes();
+
+    File file = LittleFS.open(current, "a");
+    if (!file) return false;
+
+    if (file.size() + len > BS_TS_MAX_FILE_BYTES) {
+        file.close();
+
+        char old[BS_TS_PATH_LEN];
+        path(old, series, true);
+        LittleFS.remove(old);
+        LittleFS.rename(current, old);
+        generation++;
+
+        file = LittleFS.open(current, "a");
+        if (!file) return false;
+    }
+
+    const bool written = file.write((const uint8_t *) &codec->header, sizeof(BS_TS_BLOCK_TYPE)) == sizeof(BS_TS_BLOCK_TYPE)
+        && file.write(block_buf, codec->bytes()) == codec->bytes();
+    file.close();
+
+    if (written) {
+        blocks_written++;
+        bytes_written += len;
+    }
+
+    return written;
+}
+
+void BSTimeSeries::path(char *out, const uint8_t series, const bool old) {
+    snprintf(out, BS_TS_PATH_LEN, "%s/%u.%s", dir, series, old ? "old" : "dat");
+}
+
+void BSTimeSeries::printTo(Print *out) {
+    out->printf("Time series records: [%u]  Pending: [%u / %u]  Dropped: [%u]\n", recorded, ring_count, BS_TS_RING_LEN, dropped_records);
+    out->printf("Blocks written: [%u]  Bytes: [%u]  Avg bytes / record: [%.2f]\n\n", blocks_written, bytes_written,
+        recorded > ring_count ? (double) bytes_written / (recorded - ring_count) : 0.0);
+}
+
+BSTimeSeriesQuery::BSTimeSeriesQuery(BSTimeSeries *store, const uint8_t series, const uint32_t from, const uint32_t to, const uint32_t step) {
+    this->store = store;
+    this->series = series;
+    this->from = from;
+    this->to = to;
+    this->step = step > 0 ? step : 1;
+    generation = store->generation;
+}
+
+size_t BSTimeSeriesQuery::fill(uint8_t *out, const size_t max_len) {
+    size_t len = 0;
+
+    while (len < max_len) {
+        if (out_pos < out_len) {
+            const size_t n = out_len - out_pos < max_len - len ? out_len - out_pos : max_len - len;
+            memcpy(out + len, out_buf + out_pos, n);
+            out_pos += n;
+            len += n;
+            continue;
+        }
+
+        out_pos = 0;
+        out_len = 0;
+        if (!produce()) break;
+    }
+
+    return len;
+}
+
+bool BSTimeSeriesQuery::produce() {
+    switch (state) {
+        case STATE_HEADER:
+            out_len = snprintf(out_buf, BS_TS_OUT_LEN, "{\"series\":%u,\"from\":%u,\"to\":%u,\"step\":%u,\"points\":[", series, from, to, step);
+            state = STATE_FILES;
+            return true;
+
+        case STATE_FILES: {
+            uint32_t t;
+            float value;
+
+            if (in_block && codec.next(&t, &value)) {
+                accumulate(t, value);
+                return true;
+            }
+
+            in_block = nextBlock();
+            if (!in_block) {
+                state = STATE_RING;
+                compactions = store->compactions;
+            }
+            return true;
+        }
+
+        case STATE_RING: {
+            // a compaction since the files were read moved the ring to disk
+            // behind us -- the tail of this one response is short, no more
+            bs_mutex_lock(store->lock);
+            if (store->compactions != compactions || ring_index >= store->ring_count) {
+                bs_mutex_unlock(store->lock);
+                state = STATE_FOOTER;
+                return true;
+            }
+            const BS_TS_RECORD_TYPE rec = store->ring[(store->ring_head + ring_index) % BS_TS_RING_LEN];
+            ring_index++;
+            bs_mutex_unlock(store->lock);
+
+            if (rec.series == series) accumulate(rec.t, rec.value);
+            return true;
+        }
+
+        case STATE_FOOTER:
+            if (n > 0) {
+                emit();
+                return true;
+            }
+            out_len = snprintf(out_buf, BS_TS_OUT_LEN, "]}");
+            state = STATE_DONE;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool BSTimeSeriesQuery::nextBlock() {
+    bs_mutex_lock(store->lock);
+
+    // a rotation turned the current file into the previous one
+    if (store->generation != generation) {
+        if (file_index == 0) {
+            file_offset = 0;
+        } else {
+            file_index = 0;
+        }
+        generation = store->generation;
+    }
+
+    while (file_index < 2) {
+        char name[BS_TS_PATH_LEN];
+        store->path(name, series, file_index == 0);
+
+        File file = LittleFS.open(name, "r");
+        BS_TS_BLOCK_TYPE block;
+
+        if (!file || !file.seek(file_offset) || file.read((uint8_t *) &block, sizeof(BS_TS_BLOCK_TYPE)) != sizeof(BS_TS_BLOCK_TYPE)
+            || block.magic != BS_TS_BLOCK_MAGIC || block.bytes > BS_TS_BLOCK_MAX_BYTES) {
+            if (file) file.close();
+            file_index++;
+            file_offset = 0;
+            continue;
+        }
+
+        file_offset += sizeof(BS_TS_BLOCK_TYPE) + block.bytes;
+
+        // out of range blocks are skipped on their header alone
+        if (block.t_last < from || block.t_first > to) {
+            file.close();
+            continue;
+        }
+
+        const bool read = file.read(block_buf, block.bytes) == block.bytes;
+        file.close();
+        if (!read) continue;
+
+        bs_mutex_unlock(store->lock);
+        codec.open(block_buf, &block);
+        return true;
+    }
+
+    bs_mutex_unlock(store->lock);
+    return false;
+}
+
+void BSTimeSeriesQuery::accumulate(const uint32_t t, const float value) {
+    if (t < from || t > to) return;
+
+    const uint32_t b = from + (t - from) / step * step;
+    if (n > 0 && b != bucket) emit();
+
+    if (n == 0) {
+        bucket = b;
+        v_min = value;
+        v_max = value;
+        sum = 0;
+    }
+
+    if (value < v_min) v_min = value;
+    if (value > v_max) v_max = value;
+    sum += value;
+    n++;
+}
+
+void BSTimeSeriesQuery::emit() {
+    out_len = snprintf(out_buf, BS_TS_OUT_LEN, "%s[%u,%.6g,%.6g,%.6g,%u]", first_point ? "" : ",", bucket, v_min, v_max, sum / n, n);
+    out_pos = 0;
+    first_point = false;
+    n = 0;
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#include "BSWatchdog.h"
+
+#ifdef esp32
+    static hw_timer_t* watchDogTimer = NULL;
+
+    // survives ESP.restart() but not a power cycle
+    RTC_NOINIT_ATTR static BS_WDT_STALL_TYPE rtc_stall;
+#else
+    #define USING_TIM_DIV256 true
+    #include "ESP8266TimerInterrupt.h"
+
+    static ESP8266Timer iTimer;
+
+    // rtc user memory starts at block 64 of the rtc segment
+    #define BS_WDT_RTC_USER_MEM ((volatile uint32_t *) (0x60001100 + BS_WDT_RTC_OFFSET * 4))
+#endif
+
+volatile uint32_t BSWatchdog::ticks = 0;
+volatile uint32_t BSWatchdog::beats[BS_WDT_MAX_CHANNELS];
+volatile unsigned short BSWatchdog::checkpoints[BS_WDT_MAX_CHANNELS];
+volatile bool BSWatchdog::armed[BS_WDT_MAX_CHANNELS];
+unsigned short BSWatchdog::timeouts[BS_WDT_MAX_CHANNELS];
+const char *BSWatchdog::names[BS_WDT_MAX_CHANNELS];
+BS_WDT_STALL_TYPE BSWatchdog::last_stall;
+
+void BSWatchdog::begin() {
+    // pick up (and clear) the record left behind by a watchdog reset
+    #ifdef esp32
+        memcpy(&last_stall, &rtc_stall, sizeof(BS_WDT_STALL_TYPE));
+        memset(&rtc_stall, 0, sizeof(BS_WDT_STALL_TYPE));
+    #else
+        ESP.rtcUserMemoryRead(BS_WDT_RTC_OFFSET, (uint32_t *) &last_stall, sizeof(BS_WDT_STALL_TYPE));
+        BS_WDT_STALL_TYPE cleared;
+        memset(&cleared, 0, sizeof(BS_WDT_STALL_TYPE));
+        ESP.rtcUserMemoryWrite(BS_WDT_RTC_OFFSET, (uint32_t *) &cleared, sizeof(BS_WDT_STALL_TYPE));
+    #endif
+
+    #ifdef esp32
+        watchDogTimer = timerBegin(2, 80, true);
+        timerAttachInterrupt(watchDogTimer, &tick, true);
+        timerAlarmWrite(watchDogTimer, BS_WDT_TICK_US, true);
+        timerAlarmEnable(watchDogTimer);
+    #else
+        iTimer.attachInterruptInterval(BS_WDT_TICK_US, tick);
+    #endif
+}
+
+void BSWatchdog::setChannel(const uint8_t channel, const char *name, const unsigned short timeout_s) {
+    if (channel >= BS_WDT_MAX_CHANNELS) return;
+    names[channel] = name;
+    timeouts[channel] = timeout_s;
+}
+
+bool BSWatchdog::lastStall(BS_WDT_STALL_TYPE *stall) {
+    if (last_stall.magic != BS_WDT_STALL_MAGIC) return false;
+    memcpy(stall, &last_stall, sizeof(BS_WDT_STALL_TYPE));
+    return true;
+}
+
+const char* BSWatchdog::channelName(const uint8_t channel) {
+    if (channel < BS_WDT_MAX_CHANNELS && names[channel] != NULL) return names[channel];
+    return "unknown";
+}
+
+void IRAM_ATTR BSWatchdog::tick() {
+    ticks++;
+
+    for (uint8_t ch = 0; ch < BS_WDT_MAX_CHANNELS; ch++) {
+        if (!armed[ch] || timeouts[ch] == 0) continue;
+        if ((uint32_t) (ticks - beats[ch]) <= timeouts[ch]) continue;
+
+        // no logging from here -- the record is reported on the next boot
+        #ifdef esp32
+            rtc_stall.channel = ch;
+            rtc_stall.checkpoint = checkpoints[ch];
+            rtc_stall.uptime_s = ticks;
+            rtc_stall.magic = BS_WDT_STALL_MAGIC;
+        #else
+            BS_WDT_RTC_USER_MEM[1] = ch;
+            BS_WDT_RTC_USER_MEM[2] = checkpoints[ch];
+            BS_WDT_RTC_USER_MEM[3] = ticks;
+            BS_WDT_RTC_USER_MEM[0] = BS_WDT_STALL_MAGIC;
+        #endif
+
+        ESP.restart();
+        while (1) {} // will never get here
+    }
+}
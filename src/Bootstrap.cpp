@@ -7,26 +7,36 @@ as published by Sam Hocevar. See the COPYING file for more details.
 ****************************************************************************/
 #include "Bootstrap.h"
 
+#include <new>
+
 AsyncWebServer server(80);
 
 #ifdef BS_USE_TELNETSPY
-    Bootstrap::Bootstrap(String project_name, TelnetSpy *spy, long serial_baud_rate) {
+    Bootstrap::Bootstrap(const char *project_name, TelnetSpy *spy, long serial_baud_rate) {
         SandT = spy;
         _project_name = project_name;
         _serial_baud_rate = serial_baud_rate;
+
+        shell.begin(spy);
+        wireRemoteCommands();
     }
 #else
-    Bootstrap::Bootstrap(String project_name) {
+    Bootstrap::Bootstrap(const char *project_name) {
         _project_name = project_name;
     }
 #endif
 
 bool Bootstrap::setup() {
+    const unsigned long setup_start = millis();
     INIT_LED;
 
-    BS_LOG_WELCOME_MSG("\n" + _project_name + " - Press ? for a list of commands\n");
+    #ifdef BS_USE_TELNETSPY
+        BSString<PROJECT_NAME_LEN + 64> welcome;
+        welcome.printf("\n%s - Type ? and press <ENTER> for a list of commands\n", _project_name.c_str());
+        BS_LOG_WELCOME_MSG(welcome.c_str());
+    #endif
     BS_LOG_BEGIN(_serial_baud_rate);
-    BS_LOG_PRINTLN("\n\n" + _project_name + " Start Up\n");
+    BS_LOG_PRINTF("\n\n%s Start Up\n\n", _project_name.c_str());
 
     #ifdef esp32
         resetReason = rtc_get_reset_reason(0);
@@ -39,54 +49,126 @@ bool Bootstrap::setup() {
 
     wireConfig();
 
-    if (resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) wireLittleFS();
-   
-    if (!wireWiFi()) return false;
+    // local time is meaningful before wifi (or without it, after deep sleep)
+    bs_time.restore(resetReason == RESET_REASON_DEEP_SLEEP_AWAKE);
+    bs_time.setTimeZone(base_config->tz);
 
     if (resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) {
-        wireArduinoOTA();
-        wireElegantOTA();
-        wireWebServerAndPaths();
+        if (!fast_boot) wireLittleFS();
+        wireWatchDog();
+    }
 
-        // defer updating setup.html
-        updateSetupHtml();
+    // a wake with nothing to flush leaves the radio off
+    if (batch.enabled()) batch.restore(resetReason == RESET_REASON_DEEP_SLEEP_AWAKE);
+    if (resetReason == RESET_REASON_DEEP_SLEEP_AWAKE && batch.enabled() && !batch.flushDue()) {
+        BS_LOG_PRINTF("\nWiFi deferred -- [%u] samples batched\n", batch.count());
+        WiFi.mode(WIFI_OFF);
+        wifi_deferred = true;
+    } else {
+        if (!wireWiFi()) return false;
+        if (batch.flushDue()) flushSamples();
+    }
 
-        // wire up our custom watchdog
-        #ifdef esp32
-            watchDogTimer = timerBegin(2, 80, true);
-            timerAttachInterrupt(watchDogTimer, &watchDogInterrupt, true);
-            timerAlarmWrite(watchDogTimer, WATCHDOG_TIMEOUT_S * 1000000, false);
-            timerAlarmEnable(watchDogTimer);
-        #else
-            iTimer.attachInterruptInterval(WATCHDOG_TIMEOUT_S * 1000000, timerHandler);
-        #endif
+    if (resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) {
+        // the captive portal is the only way into a device in ap mode, so
+        // that never waits
+        if (fast_boot && wifimode == WIFI_STA) {
+            services_task = scheduler.once(boot_defer_ms, [this]()
+                {
+                    services_task = BS_SCHED_NO_TASK;
+                    ensureServices();
+                }, BS_SCHED_PRIORITY_LOW);
+            BS_LOG_PRINTF("\nFast boot -- littlefs, ota and web server deferred [%lu] ms\n", boot_defer_ms);
+        } else {
+            ensureServices();
+        }
+
+        // send live value changes to /events subscribers
+        scheduler.every(BS_LIVE_FLUSH_MS, [this]() { live.flush(); });
+
+        // reboot if in AP mode and no activity for 5 minutes
+        if (wifimode == WIFI_AP) {
+            scheduler.once(300000UL, [this]()
+                {
+                    if (ap_mode_activity) return;
+                    BS_LOG_PRINTF("\nNo AP activity for 5 minutes -- triggering reboot");
+                    requestReboot();
+                });
+        }
 
-        BS_LOG_PRINTLN("Watchdog started");
+        // the main loop is supervised from here on
+        BSWatchdog::arm(BS_WDT_CHANNEL_LOOP);
     }
+
+    // outbound records, asleep or awake
+    if (tq.enabled()) scheduler.every(BS_TELEMETRY_POLL_MS, [this]() { processTelemetry(); });
+
+    // memory telemetry
+    heap.sample();
+    scheduler.every(BS_HEAP_SAMPLE_MS, [this]()
+        {
+            const bool was_leaking = heap.leaking();
+            heap.sample();
+            if (heap.leaking() && !was_leaking) {
+                BS_LOG_PRINTF("\nFree heap trending down [%d] B/h -- possible leak (min ever [%u] B)\n", heap.trendPerHour(), heap.minEver());
+            }
+        }, BS_SCHED_PRIORITY_LOW);
+
+    #ifdef BS_USE_DUAL_CORE
+        // leave the arduino loop task to the application
+        if (bs_core_count() > 1 && bs_task_start(housekeepingTask, this, "bs_housekeeping", BS_HOUSEKEEPING_STACK, BS_HOUSEKEEPING_CORE, &housekeeping_task)) {
+            housekeeping_started = true;
+            BS_LOG_PRINTF("Housekeeping task started on core [%d]\n", BS_HOUSEKEEPING_CORE);
+        }
+    #endif
+
+    setup_ms = millis() - setup_start;
+    BS_LOG_PRINTF("\nSetup took [%lu] ms\n", setup_ms);
     
     return true;
 }
 
 void Bootstrap::loop() {
-    // handle TelnetSpy if BS_USE_TELNETSPY is defined
-    BS_LOG_HANDLE();
+    // whatever the application did between setup() and here counts too
+    if (first_loop_ms == 0) first_loop_ms = millis();
+
+    if (housekeeping_started) {
+        // only the application's own loop timing is of interest here
+        #ifdef BS_USE_PROFILER
+            app_profiler.begin();
+            app_profiler.end();
+        #endif
+        return;
+    }
 
-    // handle a reboot request if pending
-    if (esp_reboot_requested) {
-        ElegantOTA.loop();
+    housekeeping();
+    idle();
+}
 
-        WiFi.disconnect();
-        delay(1000);
+void Bootstrap::housekeepingTask(void *arg) {
+    Bootstrap *bs = (Bootstrap *) arg;
 
-        BS_LOG_PRINTLN("\nReboot triggered. . .");
-        BS_LOG_HANDLE();
-        BS_LOG_FLUSH();
-        ESP.restart();
-        while (1) {} // will never get here
+    while (true) {
+        bs->housekeeping();
+        // lets the idle task on this core run (and feed the task watchdog)
+        if (!bs->idle()) bs_task_sleep(1);
     }
+}
+
+void Bootstrap::housekeeping() {
+    BS_PROFILE_BEGIN();
+
+    // nothing allocated from the scratch arena outlives an iteration
+    scratch.reset();
+
+    // handle TelnetSpy if BS_USE_TELNETSPY is defined
+    BS_PROFILE_STEP(BS_PROF_STEP_TELNET, heap.begin(BS_HEAP_SUBSYS_LOG); BS_LOG_HANDLE(); heap.end(BS_HEAP_SUBSYS_LOG));
 
     // handle a sleep request if pending
     if (esp_sleep_time) {
+        persistTelemetry();
+        bs_time.prepareDeepSleep(esp_sleep_time);
+        batch.prepareDeepSleep(esp_sleep_time);
         #ifdef esp32
             esp_sleep_enable_timer_wakeup(esp_sleep_time);
             esp_deep_sleep_start();
@@ -97,9 +179,12 @@ void Bootstrap::loop() {
 
     // captive portal if in AP mode
     if (wifimode == WIFI_AP) {
-        dnsServer.processNextRequest();
+        BS_PROFILE_STEP(BS_PROF_STEP_DNS, dns.loop());
     } else {
         if (wifistate == WIFI_DISCONNECTED && !esp_sleep_time && !esp_reboot_requested) {
+            // nothing queued survives the reboot unless it is on littlefs
+            persistTelemetry();
+
             BS_LOG_PRINTLN("sleeping for 180 seconds. . .");
             for (tiny_int x = 0; x < 180; x++) {
               delay(1000);
@@ -111,58 +196,110 @@ void Bootstrap::loop() {
         }
 
         // check for OTA
-        if (resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) {
-            ArduinoOTA.handle();
-            ElegantOTA.loop();
+        if (services_ready) {
+            BS_PROFILE_STEP(BS_PROF_STEP_OTA, ArduinoOTA.handle(); ElegantOTA.loop());
         }
     }
 
-    // reboot if in AP mode and no activity for 5 minutes
-    if (wifimode == WIFI_AP && !ap_mode_activity && millis() >= 300000UL) {
-        BS_LOG_PRINTF("\nNo AP activity for 5 minutes -- triggering reboot");
-        requestReboot();
-    }
+    // work handed over by the web handlers and other tasks
+    BS_PROFILE_STEP(BS_PROF_STEP_EVENTS, processEvents());
+    scheduleRenders();
 
-    if (setup_needs_update && resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) {
-        updateHtmlTemplate("/setup.template.html", false);
-        setup_needs_update = false;
+    // whatever was queued ahead of a reboot request (a wipe, a save) is
+    // applied first
+    if (esp_reboot_requested && events.empty() && !scheduler.pending(reboot_task)) {
+        reboot_task = scheduler.once(0, [this]() { reboot(); }, BS_SCHED_PRIORITY_HIGH);
     }
 
-    if (index_needs_update && resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) {
-        updateHtmlTemplate("/index.template.html", false);
-        index_needs_update = false;
-    }
+    // deferred work (template rebuilds, reboot requests, app tasks)
+    scheduler.run(scheduler_budget_ms);
 
     if (resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) watchDogRefresh();
+
+    BS_PROFILE_END();
 }
 
 void Bootstrap::watchDogRefresh() {
-    #ifdef esp32
-        timerWrite(watchDogTimer, 0);
-    #else
-        if (timer_pinged) {
-            timer_pinged = false;
-            BS_LOG_PRINTLN("PONG");
-            BS_LOG_FLUSH();
-        }
-    #endif    
+    BSWatchdog::refresh(BS_WDT_CHANNEL_LOOP);
+}
+void Bootstrap::watchDogRefresh(const tiny_int channel) {
+    BSWatchdog::refresh(channel);
+}
+void Bootstrap::watchDogCheckpoint(const tiny_int channel, const unsigned short id) {
+    BSWatchdog::checkpoint(channel, id);
+}
+void Bootstrap::watchDogArm(const tiny_int channel, const unsigned short checkpoint) {
+    BSWatchdog::arm(channel, checkpoint);
 }
+void Bootstrap::watchDogIdle(const tiny_int channel) {
+    BSWatchdog::idle(channel);
+}
+
+void Bootstrap::wireWatchDog() {
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_LOOP, "loop", WATCHDOG_TIMEOUT_S);
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_WEB, "web", 10);
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_WIFI, "wifi", 90);
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_TEMPLATE, "template", 10);
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_OTA, "ota", 30);
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_APP, "app", WATCHDOG_TIMEOUT_S);
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_BENCH, "bench", WATCHDOG_TIMEOUT_S);
+
+    BSWatchdog::begin();
+
+    BS_WDT_STALL_TYPE stall;
+    if (BSWatchdog::lastStall(&stall)) {
+        BS_LOG_PRINTF("\n  Last Watchdog Stall: [%s] checkpoint [%u] after [%u] s\n", BSWatchdog::channelName(stall.channel), stall.checkpoint, stall.uptime_s);
+    }
+
+    BS_LOG_PRINTLN("\nWatchdog started");
+}
+
+// CONFIG_TYPE up to where ntp server and tz were added -- an image without
+// the header holds this much, then the app's fields
+#define BS_CONFIG_LEGACY_LEN          offsetof(CONFIG_TYPE, ntp_server_flag)
+static_assert((sizeof(CONFIG_TYPE) - BS_CONFIG_LEGACY_LEN) % 8 == 0, "the added config block has to keep app fields aligned");
+
+static const uint8_t config_header[BS_CONFIG_HEADER_LEN] = { BS_CONFIG_MAGIC[0], BS_CONFIG_MAGIC[1], BS_CONFIG_MAGIC[2], BS_CONFIG_VERSION };
 
 void Bootstrap::wireConfig() {
     // configuration storage
-    EEPROM.begin(config_size);
+    EEPROM.begin(BS_CONFIG_HEADER_LEN + config_size);
+    bool legacy = false;
+    for (short i = 0; i < BS_CONFIG_HEADER_LEN; i++) {
+        if (EEPROM.read(i) != config_header[i]) legacy = true;
+    }
     uint8_t* p = (uint8_t*)(config);
-    for (short i = 0; i < config_size; i++) {
-        *(p + i) = EEPROM.read(i);
+    if (!legacy) {
+        for (short i = 0; i < config_size; i++) {
+            *(p + i) = EEPROM.read(BS_CONFIG_HEADER_LEN + i);
+        }
+    } else {
+        // the old base as it was, the new fields unset and the app's fields
+        // from where they used to start
+        const short moved = sizeof(CONFIG_TYPE) - BS_CONFIG_LEGACY_LEN;
+        for (short i = 0; i < (short) BS_CONFIG_LEGACY_LEN; i++) {
+            *(p + i) = EEPROM.read(i);
+        }
+        memset(p + BS_CONFIG_LEGACY_LEN, CFG_NOT_SET, moved);
+        for (short i = sizeof(CONFIG_TYPE); i < config_size; i++) {
+            *(p + i) = EEPROM.read(i - moved);
+        }
     }
     EEPROM.end();
 
+    // a torn or foreign image must not leave a string without its terminator
+    base_config->hostname[HOSTNAME_LEN - 1] = '\0';
+    base_config->ssid[WIFI_SSID_LEN - 1] = '\0';
+    base_config->ssid_pwd[WIFI_SSID_PWD_LEN - 1] = '\0';
+    base_config->ntp_server[NTP_SERVER_LEN - 1] = '\0';
+    base_config->tz[TZ_LEN - 1] = '\0';
+
     if (base_config->hostname_flag != CFG_SET) {
         strcpy(base_config->hostname, DEFAULT_HOSTNAME);
     }
 
     if (base_config->ssid_flag == CFG_SET) {
-        if (String(base_config->ssid).length() > 0) wifimode = WIFI_STA;
+        if (strlen(base_config->ssid) > 0) wifimode = WIFI_STA;
     } else {
         memset(base_config->ssid, CFG_NOT_SET, WIFI_SSID_LEN);
         wifimode = WIFI_AP;
@@ -170,12 +307,23 @@ void Bootstrap::wireConfig() {
 
     if (base_config->ssid_pwd_flag != CFG_SET) memset(base_config->ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
     if (base_config->bssid_flag != CFG_SET) memset(base_config->bssid, CFG_NOT_SET, WIFI_BSSID_LEN);
+    if (base_config->ntp_server_flag != CFG_SET) strcpy(base_config->ntp_server, DEFAULT_NTP_SERVER);
+    if (base_config->tz_flag != CFG_SET) strcpy(base_config->tz, DEFAULT_TZ);
 
     BS_LOG_PRINTLN();
-    BS_LOG_PRINTLN("        config size: [" + String(config_size) + "]");
-    BS_LOG_PRINTLN("        config host: [" + String(base_config->hostname) + "] stored: " + (base_config->hostname_flag == CFG_SET ? "true" : "false"));
-    BS_LOG_PRINTLN("        config ssid: [" + String(base_config->ssid) + "] stored: " + (base_config->ssid_flag == CFG_SET ? "true" : "false"));
-    BS_LOG_PRINTLN("    config ssid pwd: [" + String(base_config->ssid_pwd_flag == CFG_SET ? "********] stored: " : "] stored: ") + String(base_config->ssid_pwd_flag == CFG_SET ? "true" : "false"));
+    BS_LOG_PRINTF("        config size: [%d]\n", config_size);
+    BS_LOG_PRINTF("        config host: [%s] stored: %s\n", base_config->hostname, base_config->hostname_flag == CFG_SET ? "true" : "false");
+    BS_LOG_PRINTF("        config ssid: [%s] stored: %s\n", base_config->ssid, base_config->ssid_flag == CFG_SET ? "true" : "false");
+    BS_LOG_PRINTF("    config ssid pwd: [%s] stored: %s\n", base_config->ssid_pwd_flag == CFG_SET ? "********" : "", base_config->ssid_pwd_flag == CFG_SET ? "true" : "false");
+    BS_LOG_PRINTF("  config ntp server: [%s] stored: %s\n", base_config->ntp_server, base_config->ntp_server_flag == CFG_SET ? "true" : "false");
+    BS_LOG_PRINTF("          config tz: [%s] stored: %s\n", base_config->tz, base_config->tz_flag == CFG_SET ? "true" : "false");
+
+    // a blank device has nothing to carry over
+    if (legacy && (base_config->hostname_flag == CFG_SET || base_config->ssid_flag == CFG_SET ||
+                   base_config->ssid_pwd_flag == CFG_SET || base_config->bssid_flag == CFG_SET)) {
+        saveConfig();
+        BS_LOG_PRINTLN("    config migrated: [ntp server and tz added]");
+    }
 }
 
 void Bootstrap::setConfig(void *cfg, const short size) {
@@ -184,49 +332,247 @@ void Bootstrap::setConfig(void *cfg, const short size) {
     config_size = size;
 }
 
-void Bootstrap::updateConfigItem(const String item, String value) {
-    if (item == "hostname") {
-        memset(base_config->hostname, CFG_NOT_SET, HOSTNAME_LEN);
-        if (value.length() > 0) {
-            base_config->hostname_flag = CFG_SET;
+static const BS_CONFIG_ITEM_TYPE base_items[] = {
+    { "hostname", HOSTNAME_LEN - 1, false },
+    { "ssid", WIFI_SSID_LEN - 1, false },
+    { "ssid_pwd", WIFI_SSID_PWD_LEN - 1, true },
+    { "ntp_server", NTP_SERVER_LEN - 1, false },
+    { "tz", TZ_LEN - 1, false },
+};
+
+void Bootstrap::updateConfigItem(const char *item, const char *value) {
+    // a secret sent back as it was read means "keep it"
+    const BS_CONFIG_ITEM_TYPE *known = findConfigItem(item);
+    if (known != NULL && known->secret && strcmp(value, BS_CONFIG_REDACTED) == 0) return;
+
+    if (applyBaseConfigItem(base_config, item, value)) {
+        if (strcmp(item, "tz") == 0) bs_time.setTimeZone(base_config->tz);
+        return;
+    }
+    if (updateExtraConfigItemCallback != NULL) updateExtraConfigItemCallback(item, value);
+}
+
+// writes one of the base items into cfg -- false when item is not one
+bool Bootstrap::applyBaseConfigItem(CONFIG_TYPE *cfg, const char *item, const char *value) {
+    if (strcmp(item, "hostname") == 0) {
+        memset(cfg->hostname, CFG_NOT_SET, HOSTNAME_LEN);
+        if (strlen(value) > 0) {
+            cfg->hostname_flag = CFG_SET;
         } else {
-            base_config->hostname_flag = CFG_NOT_SET;
+            cfg->hostname_flag = CFG_NOT_SET;
             value = DEFAULT_HOSTNAME;
         }
-        value.toCharArray(base_config->hostname, HOSTNAME_LEN);
-        return;
+        strncpy(cfg->hostname, value, HOSTNAME_LEN - 1);
+        return true;
     }
-    if (item == "ssid") {
-        memset(base_config->ssid, CFG_NOT_SET, WIFI_SSID_LEN);
-        if (value.length() > 0) {
-            value.toCharArray(base_config->ssid, WIFI_SSID_LEN);
-            base_config->ssid_flag = CFG_SET;
+    if (strcmp(item, "ssid") == 0) {
+        memset(cfg->ssid, CFG_NOT_SET, WIFI_SSID_LEN);
+        if (strlen(value) > 0) {
+            strncpy(cfg->ssid, value, WIFI_SSID_LEN - 1);
+            cfg->ssid_flag = CFG_SET;
         } else {
-            base_config->ssid_flag = CFG_NOT_SET;
+            cfg->ssid_flag = CFG_NOT_SET;
         }
-        return;
+        return true;
     }
-    if (item == "ssid_pwd") {
-        memset(base_config->ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
-        if (value.length() > 0) {
-            value.toCharArray(base_config->ssid_pwd, WIFI_SSID_PWD_LEN);
-            base_config->ssid_pwd_flag = CFG_SET;
+    if (strcmp(item, "ssid_pwd") == 0) {
+        memset(cfg->ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
+        if (strlen(value) > 0) {
+            strncpy(cfg->ssid_pwd, value, WIFI_SSID_PWD_LEN - 1);
+            cfg->ssid_pwd_flag = CFG_SET;
         } else {
-            base_config->ssid_pwd_flag = CFG_NOT_SET;
+            cfg->ssid_pwd_flag = CFG_NOT_SET;
         }
-        return;
+        return true;
     }
-    if (updateExtraConfigItemCallback != NULL) updateExtraConfigItemCallback(item, value);
+    if (strcmp(item, "ntp_server") == 0) {
+        memset(cfg->ntp_server, CFG_NOT_SET, NTP_SERVER_LEN);
+        if (strlen(value) > 0) {
+            cfg->ntp_server_flag = CFG_SET;
+        } else {
+            cfg->ntp_server_flag = CFG_NOT_SET;
+            value = DEFAULT_NTP_SERVER;
+        }
+        strncpy(cfg->ntp_server, value, NTP_SERVER_LEN - 1);
+        return true;
+    }
+    if (strcmp(item, "tz") == 0) {
+        memset(cfg->tz, CFG_NOT_SET, TZ_LEN);
+        if (strlen(value) > 0) {
+            cfg->tz_flag = CFG_SET;
+        } else {
+            cfg->tz_flag = CFG_NOT_SET;
+            value = DEFAULT_TZ;
+        }
+        strncpy(cfg->tz, value, TZ_LEN - 1);
+        return true;
+    }
+    return false;
 }
-void Bootstrap::updateExtraConfigItem(std::function<void(const String item, String value)> callable) {
+void Bootstrap::updateExtraConfigItem(BSConfigItemCallback callable) {
     updateExtraConfigItemCallback = callable;    
 }
 
+bool Bootstrap::addConfigItem(const char *name, const unsigned short max_len, const bool secret) {
+    if (extra_item_count >= BS_CONFIG_MAX_EXTRA || findConfigItem(name) != NULL) return false;
+    extra_items[extra_item_count++] = { name, max_len, secret };
+    return true;
+}
+
+const BS_CONFIG_ITEM_TYPE* Bootstrap::findConfigItem(const char *name) {
+    for (tiny_int i = 0; i < sizeof(base_items) / sizeof(base_items[0]); i++) {
+        if (strcmp(base_items[i].name, name) == 0) return &base_items[i];
+    }
+    for (tiny_int i = 0; i < extra_item_count; i++) {
+        if (strcmp(extra_items[i].name, name) == 0) return &extra_items[i];
+    }
+    return NULL;
+}
+
+void Bootstrap::printConfigJson(Print *out) {
+    const tiny_int base_count = sizeof(base_items) / sizeof(base_items[0]);
+
+    out->print('{');
+    for (tiny_int i = 0; i < base_count + extra_item_count; i++) {
+        const BS_CONFIG_ITEM_TYPE *item = i < base_count ? &base_items[i] : &extra_items[i - base_count];
+        const char *value = resolveTemplateToken(item->name, false);
+        if (value == NULL) value = "";
+        if (item->secret && value[0] != '\0') value = BS_CONFIG_REDACTED;
+
+        if (i > 0) out->print(',');
+        BSJson::printString(out, item->name);
+        out->print(':');
+        BSJson::printString(out, value);
+    }
+    out->print('}');
+}
+
+BS_API_CONFIG_TYPE* Bootstrap::newConfigUpdate(const size_t total) {
+    const size_t size = configUpdateSize();
+    BS_API_CONFIG_TYPE *update = (BS_API_CONFIG_TYPE *) malloc(sizeof(BS_API_CONFIG_TYPE) + size);
+    if (update == NULL) return NULL;
+
+    update->parser.begin();
+    update->staged.len = 0;
+    update->staged.size = size;
+    update->staged.data = (char *) (update + 1);
+    update->items = 0;
+    update->status = total > BS_API_CONFIG_MAX_BODY ? 413 : 400;
+    update->error = total > BS_API_CONFIG_MAX_BODY ? "body too large" : NULL;
+
+    return update;
+}
+
+void Bootstrap::feedConfigUpdate(BS_API_CONFIG_TYPE *update, const uint8_t *data, const size_t len) {
+    for (size_t i = 0; i < len && update->error == NULL; i++) {
+        const uint8_t result = update->parser.feed(data[i]);
+        if (result == BS_JSON_ERROR) {
+            update->error = update->parser.error();
+        } else if (result == BS_JSON_PAIR) {
+            update->error = stageConfigItem(update);
+        }
+    }
+}
+
+// validates one parsed pair of a POST /api/config; an error rejects the
+// whole update, nothing is applied until every pair has passed
+const char* Bootstrap::stageConfigItem(BS_API_CONFIG_TYPE *update) {
+    const char *name = update->parser.key();
+    const char *value = update->parser.value();
+
+    const BS_CONFIG_ITEM_TYPE *item = findConfigItem(name);
+    if (item == NULL) return "unknown config item";
+    if (!update->parser.isString()) return "config values are strings";
+    if (update->parser.valueLen() > item->max_len) return "value too long";
+
+    // unchanged secret
+    if (item->secret && strcmp(value, BS_CONFIG_REDACTED) == 0) return NULL;
+
+    // only an item repeated in the body gets here
+    if (!packConfigItem(&update->staged, name, strlen(name), value, update->parser.valueLen())) {
+        update->status = 413;
+        return "config update too large";
+    }
+    update->items++;
+
+    return NULL;
+}
+
+// every registered item once, at its longest -- never more than a body
+// can carry, a pair packs smaller than its json
+size_t Bootstrap::configUpdateSize() {
+    const tiny_int base_count = sizeof(base_items) / sizeof(base_items[0]);
+    size_t size = 0;
+
+    for (tiny_int i = 0; i < base_count + extra_item_count; i++) {
+        const BS_CONFIG_ITEM_TYPE *item = i < base_count ? &base_items[i] : &extra_items[i - base_count];
+        size += strlen(item->name) + item->max_len + 2;
+    }
+
+    return size < BS_API_CONFIG_MAX_BODY ? size : BS_API_CONFIG_MAX_BODY;
+}
+
+BS_CONFIG_UPDATE_TYPE* Bootstrap::allocConfigUpdate(const size_t size) {
+    BS_CONFIG_UPDATE_TYPE *update = (BS_CONFIG_UPDATE_TYPE *) malloc(sizeof(BS_CONFIG_UPDATE_TYPE) + size);
+    if (update == NULL) return NULL;
+
+    update->len = 0;
+    update->size = size;
+    update->dry_run = false;
+    update->data = (char *) (update + 1);
+    return update;
+}
+
+// name\0value\0 appended to a config update
+bool Bootstrap::packConfigItem(BS_CONFIG_UPDATE_TYPE *update, const char *name, const size_t name_len, const char *value, const size_t value_len) {
+    if (update->len + name_len + value_len + 2 > update->size) return false;
+
+    memcpy(update->data + update->len, name, name_len);
+    update->len += name_len;
+    update->data[update->len++] = '\0';
+    memcpy(update->data + update->len, value, value_len);
+    update->len += value_len;
+    update->data[update->len++] = '\0';
+
+    return true;
+}
+
+// the update is loop()'s from here -- queued, or freed when it cannot be
+bool Bootstrap::postConfigUpdate(BS_CONFIG_UPDATE_TYPE *update) {
+    if (postEvent(BS_EVENT_CONFIG_UPDATE, (const char *) &update, sizeof(update))) return true;
+    free(update);
+    return false;
+}
+
+// the pairs packConfigItem appended, in order -- a pair cut short by the
+// end of the data is dropped
+void Bootstrap::unpackConfigItems(const BS_CONFIG_UPDATE_TYPE *update, BSConfigItemCallback callable) {
+    // never read past the data, whoever built it
+    const size_t len = update->len < update->size ? update->len : update->size;
+    size_t pos = 0;
+
+    while (pos < len) {
+        const char *name = update->data + pos;
+        const size_t name_len = strnlen(name, len - pos);
+        pos += name_len + 1;
+        if (pos >= len) break;
+        const char *value = update->data + pos;
+        const size_t value_len = strnlen(value, len - pos);
+        if (pos + value_len >= len) break;
+        pos += value_len + 1;
+
+        callable(name, value);
+    }
+}
+
 void Bootstrap::saveConfig() {
-    EEPROM.begin(config_size);
+    EEPROM.begin(BS_CONFIG_HEADER_LEN + config_size);
+    for (short i = 0; i < BS_CONFIG_HEADER_LEN; i++) {
+        EEPROM.write(i, config_header[i]);
+    }
     uint8_t* p = (uint8_t*)(config);
     for (short i = 0; i < config_size; i++) {
-        EEPROM.write(i, *(p + i));
+        EEPROM.write(BS_CONFIG_HEADER_LEN + i, *(p + i));
     }
     EEPROM.commit();
     EEPROM.end();
@@ -237,13 +583,91 @@ void Bootstrap::wipeConfig() {
     memset(config, CFG_NOT_SET, config_size);
     saveConfig();
     strcpy(base_config->hostname, DEFAULT_HOSTNAME);
+    strcpy(base_config->ntp_server, DEFAULT_NTP_SERVER);
+    strcpy(base_config->tz, DEFAULT_TZ);
 
     BS_LOG_PRINTF("\nConfig wiped\n");
 }
 
+void Bootstrap::useFastBoot(const unsigned long defer_ms) {
+    fast_boot = true;
+    boot_defer_ms = defer_ms;
+}
+
+void Bootstrap::ensureServices() {
+    if (services_wired || resetReason == RESET_REASON_DEEP_SLEEP_AWAKE) return;
+    services_wired = true;
+
+    // forced before the scheduler got to it
+    if (services_task != BS_SCHED_NO_TASK) {
+        scheduler.cancel(services_task);
+        services_task = BS_SCHED_NO_TASK;
+    }
+
+    const unsigned long start = millis();
+
+    ensureLittleFS();
+    wireArduinoOTA();
+    wireElegantOTA();
+    wireStreamingOTA();
+    wireWebServerAndPaths();
+    wireTimeSeries();
+
+    // resume whatever telemetry an earlier boot left in the log
+    wireTelemetryStore();
+
+    // defer updating setup.html
+    updateSetupHtml();
+
+    services_ms = millis() - start;
+    services_ready = true;
+    BS_LOG_PRINTF("\nServices up in [%lu] ms\n", services_ms);
+}
+
+bool Bootstrap::ensureLittleFS() {
+    if (!fs_wired) wireLittleFS();
+    return fs_mounted;
+}
+
+void Bootstrap::wireTimeSeries() {
+    if (ts.ready()) return;
+
+    // history lives on littlefs, so only once it is mounted
+    if (ensureLittleFS() && ts.begin()) scheduler.every(BS_TS_COMPACT_MS, [this]() { ts.compact(); }, BS_SCHED_PRIORITY_LOW);
+}
+
+void Bootstrap::wireTelemetryStore() {
+    if (tq.enabled() && !tq.stored() && ensureLittleFS()) tq.begin();
+}
+
+void Bootstrap::processTelemetry() {
+    const bool online = wifimode == WIFI_STA && WiFi.status() == WL_CONNECTED;
+
+    // the log only mounts littlefs once something has to go there
+    if (tq.needsStore(online)) wireTelemetryStore();
+    tq.process(online);
+}
+
+void Bootstrap::persistTelemetry() {
+    if (tq.needsStore(false)) wireTelemetryStore();
+    tq.persist();
+}
+
+void Bootstrap::printBootTimes(Print *out) {
+    out->printf("\nBoot: [%s]  Setup: [%lu] ms  First loop at: [%lu] ms\n", fast_boot ? "fast" : "eager", setup_ms, first_loop_ms);
+    if (services_ready) {
+        out->printf("Services: up in [%lu] ms\n\n", services_ms);
+    } else {
+        out->printf("Services: %s\n\n", services_task != BS_SCHED_NO_TASK ? "deferred" : "not wired");
+    }
+}
+
 void Bootstrap::wireLittleFS() {
+    fs_wired = true;
+
     // start and mount our littlefs file system
-    if (!LittleFS.begin()) {
+    fs_mounted = LittleFS.begin();
+    if (!fs_mounted) {
         BS_LOG_PRINTLN("\nAn Error has occurred while initializing LittleFS\n");
     } else {
         #ifdef BS_USE_TELNETSPY
@@ -257,9 +681,9 @@ void Bootstrap::wireLittleFS() {
                     const size_t fs_used = fs_info.usedBytes / 1000;
             #endif
             BS_LOG_PRINTLN();
-            BS_LOG_PRINTLN("    Filesystem size: [" + String(fs_size) + "] KB");
-            BS_LOG_PRINTLN("         Free space: [" + String(fs_size - fs_used) + "] KB");
-            BS_LOG_PRINTLN("          Free Heap: [" + String(ESP.getFreeHeap()) + "] B");
+            BS_LOG_PRINTF("    Filesystem size: [%u] KB\n", fs_size);
+            BS_LOG_PRINTF("         Free space: [%u] KB\n", fs_size - fs_used);
+            BS_LOG_PRINTF("          Free Heap: [%u] B\n", ESP.getFreeHeap());
         #endif
     }
 }
@@ -296,6 +720,8 @@ bool Bootstrap::wireWiFi() {
     uint8_t *bestBssid = NULL;
     short bestRssi = SHRT_MIN;
 
+    BSWatchdog::arm(BS_WDT_CHANNEL_WIFI, __LINE__);
+
     if (base_config->bssid_flag == CFG_SET) {
         bestRssi = 0;
         bestBssid = (uint8_t*) base_config->bssid;
@@ -303,6 +729,7 @@ bool Bootstrap::wireWiFi() {
         // WiFi.scanNetworks will return the number of networks found
         BS_LOG_PRINTLN("\nScanning Wi-Fi networks. . .");
         int n = WiFi.scanNetworks();
+        BSWatchdog::checkpoint(BS_WDT_CHANNEL_WIFI, __LINE__);
 
         // arduino is too stupid to know which AP has the best signal
         // when connecting to an SSID with multiple BSSIDs (WAPs / Repeaters)
@@ -323,6 +750,7 @@ bool Bootstrap::wireWiFi() {
         BS_LOG_PRINTF("\nConnecting to %s %s.", base_config->ssid, base_config->bssid_flag == CFG_SET ? "(SAVED)" : "");
         WiFi.begin(base_config->ssid, base_config->ssid_pwd, 0, bestBssid, true);
         for (tiny_int x = 0; x < 120 && WiFi.status() != WL_CONNECTED; x++) {
+            BSWatchdog::checkpoint(BS_WDT_CHANNEL_WIFI, __LINE__);
             blink();
             BS_LOG_PRINT(".");
             if (wifistate == WIFI_DISCONNECTED) break;
@@ -339,10 +767,8 @@ bool Bootstrap::wireWiFi() {
                 BS_LOG_PRINTLN("Saved new BSSID to EEPROM");
             }
             
-            // initialize time
-            configTime(0, 0, "pool.ntp.org");
-            setenv("TZ", "EST+5EDT,M3.2.0/2,M11.1.0/2", 1);
-            tzset();
+            // initialize time -- sntp syncs in the background
+            bs_time.begin(base_config->ntp_server, base_config->tz);
 
             BS_LOG_PRINT("\nCurrent Time: ");
             BS_LOG_PRINTLN(getTimestamp());
@@ -353,6 +779,7 @@ bool Bootstrap::wireWiFi() {
             memset(base_config->bssid, CFG_NOT_SET, WIFI_BSSID_LEN);
             saveConfig();
             requestReboot();
+            BSWatchdog::idle(BS_WDT_CHANNEL_WIFI);
             return false;
         }
     }
@@ -361,16 +788,19 @@ bool Bootstrap::wireWiFi() {
         wifimode = WIFI_AP;
         WiFi.mode(wifimode);
         WiFi.softAP(base_config->hostname);
-        dnsServer.start(DNS_PORT, "*", WiFi.softAPIP());
-        BS_LOG_PRINTLN("\nSoftAP [" + String(base_config->hostname) + "] started");
+        dns.begin(DNS_PORT, WiFi.softAPIP());
+        BS_LOG_PRINTF("\nSoftAP [%s] started\n", base_config->hostname);
     }
 
     BS_LOG_PRINTLN();
     BS_LOG_PRINT("    Hostname: "); BS_LOG_PRINTLN(base_config->hostname);
     BS_LOG_PRINT("Connected to: "); BS_LOG_PRINTLN(wifimode == WIFI_STA ? base_config->ssid : base_config->hostname);
-    BS_LOG_PRINT("  IP address: "); BS_LOG_PRINTLN(wifimode == WIFI_STA ? WiFi.localIP().toString() : WiFi.softAPIP().toString());
-    BS_LOG_PRINT("        RSSI: "); BS_LOG_PRINTLN(String(WiFi.RSSI()) + " dB");    
+    BS_LOG_PRINT("  IP address: "); BS_LOG_PRINTLN(wifimode == WIFI_STA ? WiFi.localIP() : WiFi.softAPIP());
+    BS_LOG_PRINTF("        RSSI: %d dB\n", WiFi.RSSI());
+
+    governor.applyRadio(wifimode == WIFI_STA);
 
+    BSWatchdog::idle(BS_WDT_CHANNEL_WIFI);
     return true;
 }
 
@@ -387,10 +817,12 @@ void Bootstrap::wireArduinoOTA() {
 
             // NOTE: if updating SPIFFS this would be the place to unmount SPIFFS using SPIFFS.end()
             BS_LOG_PRINTLN("\nOTA triggered for updating " + type);
+            BSWatchdog::arm(BS_WDT_CHANNEL_OTA, __LINE__);
         });
 
     ArduinoOTA.onEnd([this]()
         {
+            BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
             BS_LOG_PRINTLN("\nOTA End");
             BS_LOG_FLUSH();
             requestReboot();
@@ -398,13 +830,14 @@ void Bootstrap::wireArduinoOTA() {
 
     ArduinoOTA.onProgress([this](unsigned int progress, unsigned int total)
         {
-            watchDogRefresh();
+            BSWatchdog::refresh(BS_WDT_CHANNEL_OTA);
             BS_LOG_PRINTF("Progress: %u%%\r", (progress / (total / 100)));
             BS_LOG_FLUSH();
         });
 
     ArduinoOTA.onError([this](ota_error_t error)
         {
+            BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
             BS_LOG_PRINTF("\nError[%u]: ", error);
             if (error == OTA_AUTH_ERROR) BS_LOG_PRINTLN("Auth Failed");
             else if (error == OTA_BEGIN_ERROR) BS_LOG_PRINTLN("Begin Failed");
@@ -421,17 +854,18 @@ void Bootstrap::wireArduinoOTA() {
 void Bootstrap::wireElegantOTA() {
     ElegantOTA.onStart([this]() {
         BS_LOG_PRINTLN("\nOTA update started!");
+        BSWatchdog::arm(BS_WDT_CHANNEL_OTA, __LINE__);
     });
     ElegantOTA.onProgress([this](size_t current, size_t final) {
-        static unsigned long ota_progress_millis = 0;
+        BSWatchdog::refresh(BS_WDT_CHANNEL_OTA);
         if (millis() - ota_progress_millis > 1000) {
-            watchDogRefresh();
             ota_progress_millis = millis();
             BS_LOG_PRINTF("OTA Progress Current: %u bytes, Final: %u bytes\r", current, final);
             BS_LOG_FLUSH();
         }
     });
     ElegantOTA.onEnd([this](bool success) {
+        BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
         if (success) {
             BS_LOG_PRINTLN("\nOTA update finished successfully!");
             requestReboot();
@@ -445,324 +879,843 @@ void Bootstrap::wireElegantOTA() {
     BS_LOG_PRINTLN("ElegantOTA started");
 }
 
+void Bootstrap::wireStreamingOTA() {
+    // POST /ota -- multipart upload of a raw or gzip image, the expected
+    // digest comes in the X-Image-SHA256 header or the sha256 parameter and
+    // an upload without one is refused (BS_OTA_ALLOW_UNVERIFIED to allow)
+    server.on("/ota", HTTP_POST, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            const bool success = ota_owner == request && !ota_stream.active() && strlen(ota_stream.error()) == 0;
+
+            AsyncResponseStream *response = request->beginResponseStream("application/json");
+            response->setCode(success ? 200 : 400);
+            response->addHeader("Cache-Control", "no-store");
+
+            if (ota_owner == request) {
+                response->printf("{\"success\":%s,\"error\":\"%s\",\"compressed\":%s,\"bytes_in\":%u,\"bytes_out\":%u,\"elapsed_ms\":%u,\"bytes_per_sec\":%u}",
+                    success ? "true" : "false", ota_stream.error(), ota_stream.compressed() ? "true" : "false",
+                    ota_stream.bytesIn(), ota_stream.bytesOut(), ota_stream.elapsedMs(), ota_stream.bytesPerSecond());
+                ota_owner = NULL;
+            } else {
+                response->print("{\"success\":false,\"error\":\"no image received\"}");
+            }
+            respond(request, response);
+
+            if (success) requestReboot();
+            return success ? "image accepted" : "image rejected";
+        }),
+        [this](AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)
+        {
+            if (index == 0) {
+                // one upload at a time -- a second client simply gets rejected
+                if (ota_stream.active() || ota_delta.active()) return;
+
+                const char *sha256 = NULL;
+                if (request->hasHeader("X-Image-SHA256")) {
+                    sha256 = request->getHeader("X-Image-SHA256")->value().c_str();
+                } else if (request->hasParam("sha256")) {
+                    sha256 = request->getParam("sha256")->value().c_str();
+                }
+
+                ota_owner = request;
+                ota_progress_millis = millis();
+
+                // a client that goes away mid upload must not wedge the stream
+                request->onDisconnect([this, request]() {
+                    if (ota_owner != request) return;
+                    if (ota_stream.active()) {
+                        ota_stream.abort();
+                        BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                        BS_LOG_PRINTLN("\nOTA upload aborted: client disconnected");
+                    }
+                    ota_owner = NULL;
+                });
+                BSWatchdog::arm(BS_WDT_CHANNEL_OTA, __LINE__);
+
+                if (!ota_stream.begin(sha256)) {
+                    BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                    BS_LOG_PRINTF("\nOTA upload refused: %s\n", ota_stream.error());
+                    return;
+                }
+                BS_LOG_PRINTF("\nOTA upload started: %s%s\n", filename.c_str(), sha256 == NULL ? " (unverified)" : "");
+            }
+
+            if (ota_owner != request || !ota_stream.active()) return;
+
+            BSWatchdog::refresh(BS_WDT_CHANNEL_OTA);
+
+            if (!ota_stream.write(data, len)) {
+                BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                BS_LOG_PRINTF("\nOTA upload failed: %s\n", ota_stream.error());
+                return;
+            }
+
+            if (millis() - ota_progress_millis > 1000) {
+                ota_progress_millis = millis();
+                BS_LOG_PRINTF("OTA Progress: %u bytes in, %u bytes written, %u bytes/s\r", ota_stream.bytesIn(), ota_stream.bytesOut(), ota_stream.bytesPerSecond());
+                BS_LOG_FLUSH();
+            }
+
+            if (final) {
+                BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                if (ota_stream.end()) {
+                    BS_LOG_PRINTF("\nOTA upload verified: %u bytes (%u written) in %u ms, %u bytes/s\n", ota_stream.bytesIn(), ota_stream.bytesOut(), ota_stream.elapsedMs(), ota_stream.bytesPerSecond());
+                } else {
+                    BS_LOG_PRINTF("\nOTA upload failed: %s\n", ota_stream.error());
+                }
+            }
+        });
+
+    // POST /ota/delta -- multipart upload of a patch from tools/bs_delta.py,
+    // the rebuilt image is verified against the digest the patch carries
+    server.on("/ota/delta", HTTP_POST, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            const bool success = ota_owner == request && !ota_delta.active() && strlen(ota_delta.error()) == 0;
+
+            AsyncResponseStream *response = request->beginResponseStream("application/json");
+            response->setCode(success ? 200 : 400);
+            response->addHeader("Cache-Control", "no-store");
+
+            if (ota_owner == request) {
+                response->printf("{\"success\":%s,\"error\":\"%s\",\"patch_bytes\":%u,\"image_bytes\":%u,\"elapsed_ms\":%u,\"bytes_per_sec\":%u}",
+                    success ? "true" : "false", ota_delta.error(), ota_delta.bytesIn(), ota_delta.bytesOut(), ota_delta.elapsedMs(), ota_delta.bytesPerSecond());
+                ota_owner = NULL;
+            } else {
+                response->print("{\"success\":false,\"error\":\"no patch received\"}");
+            }
+            respond(request, response);
+
+            if (success) requestReboot();
+            return success ? "patch applied" : "patch rejected";
+        }),
+        [this](AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t *data, size_t len, bool final)
+        {
+            if (index == 0) {
+                if (ota_stream.active() || ota_delta.active()) return;
+
+                ota_owner = request;
+                ota_progress_millis = millis();
+
+                request->onDisconnect([this, request]() {
+                    if (ota_owner != request) return;
+                    if (ota_delta.active()) {
+                        ota_delta.abort();
+                        BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                        BS_LOG_PRINTLN("\nOTA patch aborted: client disconnected");
+                    }
+                    ota_owner = NULL;
+                });
+
+                BSWatchdog::arm(BS_WDT_CHANNEL_OTA, __LINE__);
+                ota_delta.begin();
+                BS_LOG_PRINTF("\nOTA patch started: %s\n", filename.c_str());
+            }
+
+            if (ota_owner != request || !ota_delta.active()) return;
+
+            BSWatchdog::refresh(BS_WDT_CHANNEL_OTA);
+
+            if (!ota_delta.write(data, len)) {
+                BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                BS_LOG_PRINTF("\nOTA patch failed: %s\n", ota_delta.error());
+                return;
+            }
+
+            if (millis() - ota_progress_millis > 1000) {
+                ota_progress_millis = millis();
+                BS_LOG_PRINTF("OTA Progress: %u patch bytes in, %u image bytes written\r", ota_delta.bytesIn(), ota_delta.bytesOut());
+                BS_LOG_FLUSH();
+            }
+
+            if (final) {
+                BSWatchdog::idle(BS_WDT_CHANNEL_OTA);
+                if (ota_delta.end()) {
+                    BS_LOG_PRINTF("\nOTA patch verified: %u patch bytes rebuilt %u image bytes in %u ms\n", ota_delta.bytesIn(), ota_delta.bytesOut(), ota_delta.elapsedMs());
+                } else {
+                    BS_LOG_PRINTF("\nOTA patch failed: %s\n", ota_delta.error());
+                }
+            }
+        });
+
+    BS_LOG_PRINTLN("Streaming OTA started");
+}
+
+static bool isDigitalAsset(const char *url) {
+    const char *ext = strrchr(url, '.');
+    if (ext == NULL) return false;
+    return strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".ico") == 0 || strcasecmp(ext, ".svg") == 0;
+}
+
+// chunked json from anything with fill(buffer, max_len) -- the source lives
+// exactly as long as the response that drains it
+template <typename T>
+static AsyncWebServerResponse* beginFillResponse(AsyncWebServerRequest *request, std::shared_ptr<T> source) {
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json", [source](uint8_t *buffer, size_t max_len, size_t index) -> size_t
+        {
+            return source->fill(buffer, max_len);
+        });
+    response->addHeader("Cache-Control", "no-store");
+    return response;
+}
+
+// every route through here: watchdog, heap accounting and the log line, with
+// the note the handler returns
+ArRequestHandlerFunction Bootstrap::route(BSWebRoute handler, const unsigned short checkpoint) {
+    return [this, handler, checkpoint](AsyncWebServerRequest *request)
+        {
+            BSWatchdog::arm(BS_WDT_CHANNEL_WEB, checkpoint);
+            heap.begin(BS_HEAP_SUBSYS_WEB);
+
+            const char *note = handler(request);
+
+            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), note);
+            heap.end(BS_HEAP_SUBSYS_WEB);
+            BSWatchdog::idle(BS_WDT_CHANNEL_WEB);
+        };
+}
+
+// and every response with the same headers
+void Bootstrap::respond(AsyncWebServerRequest *request, AsyncWebServerResponse *response) {
+    response->addHeader("Server", "ESP Async Web Server");
+    response->addHeader("X-Powered-By", "ESP-Bootstrap");
+    request->send(response);
+}
+
 void Bootstrap::wireWebServerAndPaths() {
     // define default document
-    server.on("/", HTTP_GET, [this](AsyncWebServerRequest* request)
+    server.on("/", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
             AsyncWebServerResponse *response = request->beginResponse(301); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
             response->addHeader("Location", "/index.html");
-            request->send(response);
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "redirected to /index.html");
-        });
+            respond(request, response);
+            return "redirected to /index.html";
+        }));
 
     // define setup document
-    server.on("/setup", HTTP_GET, [this](AsyncWebServerRequest* request)
+    server.on("/setup", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/setup.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
+            return "handled";
+        }));
 
     // captive portal
-    server.on("/hotspot-detect.html", HTTP_GET, [this](AsyncWebServerRequest* request)
+    server.on("/hotspot-detect.html", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
 
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
-    server.on("/library/test/success.html", HTTP_GET, [this](AsyncWebServerRequest* request)
+            return "handled";
+        }));
+    server.on("/library/test/success.html", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
 
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
-    server.on("/generate_204", HTTP_GET, [this](AsyncWebServerRequest* request)
+            return "handled";
+        }));
+    server.on("/generate_204", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
 
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
-    server.on("/gen_204", HTTP_GET, [this](AsyncWebServerRequest* request)
+            return "handled";
+        }));
+    server.on("/gen_204", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
 
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
-    server.on("/ncsi.txt", HTTP_GET, [this](AsyncWebServerRequest* request)
+            return "handled";
+        }));
+    server.on("/ncsi.txt", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
 
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
-    server.on("/check_network_status.txt", HTTP_GET, [this](AsyncWebServerRequest* request)
+            return "handled";
+        }));
+    server.on("/check_network_status.txt", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
 
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html", "text/html"); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
+            return "handled";
+        }));
 
     // request reboot
-    server.on("/reboot", HTTP_GET, [this](AsyncWebServerRequest* request)
+    server.on("/reboot", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
             setLockState(LOCK_STATE_LOCK);
 
             AsyncWebServerResponse *response = request->beginResponse(302); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
             response->addHeader("Location", "/index.html");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            respond(request, response);
 
             setLockState(LOCK_STATE_UNLOCK);
 
             requestReboot();
-        });
+            return "handled";
+        }));
 
     // save config
-    server.on("/save", HTTP_GET, [this](AsyncWebServerRequest* request)
+    server.on("/save", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
-            setLockState(LOCK_STATE_LOCK);
+            // pack every name / value pair into a single update so the whole
+            // of it is applied and committed by loop() in one go
+            const size_t params = request->params();
+            bool fits = params <= BS_CONFIG_MAX_PARAMS;
+            bool valid = true;
+            bool dry_run = false;
+            size_t size = 0;
+            for (size_t i = 0; i < params && fits && valid; i++) {
+                const String &name = request->getParam(i)->name();
+                const String &value = request->getParam(i)->value();
+                if (name == BS_CONFIG_DRY_RUN) {
+                    dry_run = true;
+                    continue;
+                }
 
-            for (tiny_int i = 0; i < request->params(); i++) {
-                updateConfigItem(request->getParam(i)->name(), request->getParam(i)->value());
+                // an embedded nul would shift every pair after it
+                if (name.length() == 0 || strlen(name.c_str()) != name.length() || strlen(value.c_str()) != value.length()) {
+                    valid = false;
+                }
+                size += name.length() + value.length() + 2;
+                fits = size <= BS_API_CONFIG_MAX_BODY;
             }
 
-            saveConfig();
-
-            AsyncWebServerResponse *response = request->beginResponse(302); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            response->addHeader("Location", "/index.html");
-            request->send(response);
-
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            BS_CONFIG_UPDATE_TYPE *update = valid && fits ? allocConfigUpdate(size) : NULL;
+            if (update != NULL) {
+                update->dry_run = dry_run;
+                for (size_t i = 0; i < params; i++) {
+                    const String &name = request->getParam(i)->name();
+                    const String &value = request->getParam(i)->value();
+                    if (name == BS_CONFIG_DRY_RUN) continue;
+                    packConfigItem(update, name.c_str(), name.length(), value.c_str(), value.length());
+                }
+            }
 
-            setLockState(LOCK_STATE_UNLOCK);
-        });
+            AsyncWebServerResponse *response;
+            if (!valid) {
+                response = request->beginResponse(400, "text/plain", "malformed config update");
+            } else if (!fits) {
+                response = request->beginResponse(413, "text/plain", "config update too large");
+            } else if (update == NULL || !postConfigUpdate(update)) {
+                response = request->beginResponse(503, "text/plain", "busy - try again");
+            } else {
+                response = request->beginResponse(302);
+                response->addHeader("Location", "/index.html");
+            }
+            respond(request, response);
+            return "handled";
+        }));
 
-    // load config
-    server.on("/load", HTTP_GET, [this](AsyncWebServerRequest* request)
+    // config as json -- secrets redacted
+    server.on("/api/config", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
-            setLockState(LOCK_STATE_LOCK);
-
-            BS_LOG_PRINTLN();
-            wireConfig();
-            updateSetupHtml();
+            AsyncResponseStream *response = request->beginResponseStream("application/json");
+            response->addHeader("Cache-Control", "no-store");
+            printConfigJson(response);
+            respond(request, response);
+            return "handled";
+        }));
+
+    // config update as json -- parsed as the body arrives, validated as a
+    // whole and applied by loop() in one go, like /save
+    server.on("/api/config", HTTP_POST, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            BS_API_CONFIG_TYPE *update = (BS_API_CONFIG_TYPE *) request->_tempObject;
+            unsigned short status = 202;
+            const char *error = NULL;
+
+            if (update == NULL) {
+                status = 400;
+                error = "expected a json body";
+            } else if (update->error != NULL) {
+                status = update->status;
+                error = update->error;
+            } else if (!update->parser.done()) {
+                status = 400;
+                error = "truncated json";
+            } else if (update->staged.len > 0) {
+                // a copy just big enough, the staging area goes with the request
+                BS_CONFIG_UPDATE_TYPE *queued = allocConfigUpdate(update->staged.len);
+                if (queued != NULL) {
+                    memcpy(queued->data, update->staged.data, update->staged.len);
+                    queued->len = update->staged.len;
+                }
+                if (queued == NULL || !postConfigUpdate(queued)) {
+                    status = 503;
+                    error = "busy - try again";
+                }
+            }
 
-            AsyncWebServerResponse *response = request->beginResponse(302); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            response->addHeader("Location", "/index.html");
-            request->send(response);
+            AsyncResponseStream *response = request->beginResponseStream("application/json");
+            response->setCode(status);
+            if (error != NULL) {
+                response->print("{\"error\":");
+                BSJson::printString(response, error);
+                response->printf(",\"offset\":%u}", update != NULL ? update->parser.offset() : 0);
+            } else {
+                response->printf("{\"status\":\"%s\",\"items\":%u}", update->staged.len > 0 ? "queued" : "unchanged", update->items);
+            }
+            respond(request, response);
+            return error != NULL ? error : "handled";
+        }), NULL, [this](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total)
+        {
+            // the server frees _tempObject with the request
+            if (index == 0 && request->_tempObject == NULL) {
+                request->_tempObject = newConfigUpdate(total);
+            }
 
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+            BS_API_CONFIG_TYPE *update = (BS_API_CONFIG_TYPE *) request->_tempObject;
+            if (update == NULL) return;
 
-            setLockState(LOCK_STATE_UNLOCK);
+            feedConfigUpdate(update, data, len);
         });
 
-    // wipe config
-    server.on("/wipe", HTTP_GET, [this](AsyncWebServerRequest* request)
+    // load config
+    server.on("/load", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
         {
-            setLockState(LOCK_STATE_LOCK);
+            AsyncWebServerResponse *response;
+            if (!postEvent(BS_EVENT_LOAD_CONFIG)) {
+                response = request->beginResponse(503, "text/plain", "busy - try again");
+            } else {
+                response = request->beginResponse(302);
+                response->addHeader("Location", "/index.html");
+            }
+            respond(request, response);
+            return "handled";
+        }));
 
+    // wipe config
+    server.on("/wipe", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
+        {
             const boolean reboot = !request->hasParam("noreboot");
 
-            AsyncWebServerResponse *response = request->beginResponse(302); 
-            response->addHeader("Server", "ESP Async Web Server");
-            response->addHeader("X-Powered-By", "ESP-Bootstrap");
-            response->addHeader("Location", "/index.html");
-            request->send(response);
+            // no reboot unless the wipe is queued ahead of it
+            AsyncWebServerResponse *response;
+            if (!postEvent(BS_EVENT_WIPE_CONFIG)) {
+                response = request->beginResponse(503, "text/plain", "busy - try again");
+            } else {
+                response = request->beginResponse(302);
+                response->addHeader("Location", "/index.html");
+                // taken once the wipe has been applied
+                if (reboot) requestReboot();
+            }
+            respond(request, response);
+            return "handled";
+        }));
 
-            wipeConfig();
+    // downsampled history -- /ts?series=<id>[&from=<epoch>][&to=<epoch>][&step=<s>]
+    server.on("/ts", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            const long series = request->hasParam("series") ? strtol(request->getParam("series")->value().c_str(), NULL, 10) : -1;
+
+            if (!ts.ready() || series < 0 || series >= BS_TS_MAX_SERIES) {
+                respond(request, request->beginResponse(ts.ready() ? 400 : 503, "application/json", ts.ready() ? "{\"error\":\"bad series\"}" : "{\"error\":\"no store\"}"));
+            } else {
+                const uint32_t now = (uint32_t) time(NULL);
+                const uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), NULL, 10) : now;
+                const uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), NULL, 10) : (to > 86400 ? to - 86400 : 0);
+                uint32_t step = request->hasParam("step") ? strtoul(request->getParam("step")->value().c_str(), NULL, 10) : 0;
+                if (step == 0) step = to > from ? (to - from) / BS_TS_DEFAULT_POINTS : 1;
 
-            BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), request->url().c_str(), "handled");
+                respond(request, beginFillResponse(request, std::make_shared<BSTimeSeriesQuery>(&ts, (uint8_t) series, from, to, step)));
+            }
 
-            setLockState(LOCK_STATE_UNLOCK);
+            return "handled";
+        }));
 
-            // trigger a reboot
-            if (reboot) esp_reboot_requested = true;
-        });
+    // littlefs listing -- /api/files[?dir=<path>][&offset=<n>][&limit=<n>]
+    server.on("/api/files", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            const String dir = request->hasParam("dir") ? request->getParam("dir")->value() : String("/");
+            const uint32_t offset = request->hasParam("offset") ? strtoul(request->getParam("offset")->value().c_str(), NULL, 10) : 0;
+            uint32_t limit = request->hasParam("limit") ? strtoul(request->getParam("limit")->value().c_str(), NULL, 10) : BS_FILES_DEFAULT_LIMIT;
+            if (limit == 0 || limit > BS_FILES_MAX_LIMIT) limit = BS_FILES_MAX_LIMIT;
+
+            if (dir.length() >= BS_FILES_PATH_LEN - 1) {
+                respond(request, request->beginResponse(400, "application/json", "{\"error\":\"bad dir\"}"));
+            } else if (!LittleFS.exists(dir)) {
+                respond(request, request->beginResponse(404, "application/json", "{\"error\":\"no such dir\"}"));
+            } else {
+                respond(request, beginFillResponse(request, std::make_shared<BSDirListing>(dir.c_str(), offset, limit)));
+            }
+
+            return "handled";
+        }));
+
+    // live values -- server-sent events
+    live.begin(&server);
+
+    // benchmarks -- POST starts a run on the loop, GET returns the last one
+    server.on("/bench", HTTP_POST, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            if (!requestBenchmarks()) {
+                respond(request, request->beginResponse(409, "application/json", "{\"error\":\"running\"}"));
+                return "benchmarks already running";
+            }
+
+            respond(request, request->beginResponse(202, "application/json", "{\"status\":\"queued\"}"));
+            return "benchmarks queued";
+        }));
+    server.on("/bench", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            if (bench_running || bench.count() == 0) {
+                respond(request, request->beginResponse(bench_running ? 503 : 404, "application/json", bench_running ? "{\"error\":\"running\"}" : "{\"error\":\"no results\"}"));
+            } else {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                response->addHeader("Cache-Control", "no-store");
+                bench.printJson(response);
+                respond(request, response);
+            }
+
+            return "handled";
+        }));
+
+    // heap telemetry
+    server.on("/heap", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
+        {
+            AsyncResponseStream *response = request->beginResponseStream("application/json");
+            response->addHeader("Cache-Control", "no-store");
+            heap.printJson(response);
+            respond(request, response);
+
+            // ?reset starts a new low water window (after reporting the last one)
+            if (request->hasParam("reset")) heap.resetLowWater();
+
+            return "handled";
+        }));
+
+    #ifdef BS_USE_PROFILER
+        // loop profile
+        server.on("/profile", HTTP_GET, route([this](AsyncWebServerRequest* request) -> const char *
+            {
+                AsyncResponseStream *response = request->beginResponseStream("application/json");
+                response->addHeader("Cache-Control", "no-store");
+                if (request->hasParam("app")) {
+                    app_profiler.printJson(response);
+                } else {
+                    profiler.printJson(response);
+                }
+                respond(request, response);
+                return "handled";
+            }));
+    #endif
 
     // 404 (includes file handling)
-    server.onNotFound([this](AsyncWebServerRequest* request)
+    server.onNotFound(route([this](AsyncWebServerRequest* request) -> const char *
         {
             setActiveAP();
             setLockState(LOCK_STATE_LOCK);
 
-            String url = request->url(); url.toLowerCase();
+            const char *url = request->url().c_str();
+            const BS_ASSET_TYPE *asset = assets.find(url);
+            AsyncWebServerResponse *file_response = NULL;
+            const char *note = "handled";
+
+            // a gzipped asset is only for clients that take gzip, the rest
+            // fall through to littlefs -- what the url serves then depends on
+            // Accept-Encoding, which a shared cache has to be told
+            const bool negotiated = asset != NULL && asset->gzip;
+            if (negotiated) {
+                const AsyncWebHeader *accept = request->getHeader("Accept-Encoding");
+                if (accept == NULL || strstr(accept->value().c_str(), "gzip") == NULL) asset = NULL;
+            }
 
-            if (LittleFS.exists(request->url())) {
-                AsyncWebServerResponse* response = request->beginResponse(LittleFS, request->url(), String());
-                response->addHeader("Server", "ESP Async Web Server");
-                response->addHeader("X-Powered-By", "ESP-Bootstrap");
+            if (asset != NULL) {
+                const AsyncWebHeader *match = request->getHeader("If-None-Match");
+                const bool not_modified = match != NULL && strcmp(match->value().c_str(), asset->etag) == 0;
+
+                AsyncWebServerResponse *response = not_modified ? request->beginResponse(304) : request->beginResponse_P(200, asset->mime, asset->data, asset->len);
+                response->addHeader("Cache-Control", BS_ASSET_CACHE_CONTROL);
+                response->addHeader("ETag", asset->etag);
+                if (asset->gzip && !not_modified) response->addHeader("Content-Encoding", "gzip");
+                if (negotiated) response->addHeader("Vary", "Accept-Encoding");
+                respond(request, response);
+                assets.served(asset, not_modified);
+                note = not_modified ? "not modified" : "handled from flash";
+            } else if (LittleFS.exists(request->url()) && (file_response = BSFiles::beginResponse(request, url)) != NULL) {
+                // honours Range / If-Range so large downloads can resume
+                AsyncWebServerResponse *response = file_response;
     
-                // only chache digital assets
-                if (url.indexOf(".png") != -1 || url.indexOf(".jpg") != -1 || url.indexOf(".ico") != -1 || url.indexOf(".svg") != -1) {
+                // only chache digital assets and the page that streams its values
+                if (isDigitalAsset(url)) {
                     response->addHeader("Cache-Control", "max-age=604800");
+                } else if (strcmp(url, BS_LIVE_PAGE) == 0) {
+                    response->addHeader("Cache-Control", BS_LIVE_PAGE_CACHE_CONTROL);
                 } else {
                     response->addHeader("Cache-Control", "no-store");
                 }
+                if (negotiated) response->addHeader("Vary", "Accept-Encoding");
 
-                request->send(response);
-
-                BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), url.c_str(), "handled");
+                respond(request, response);
             } else {
-                AsyncWebServerResponse *response = request->beginResponse(404, "text/plain", request->url() + " not found!");
-                response->addHeader("Server", "ESP Async Web Server");
-                response->addHeader("X-Powered-By", "ESP-Bootstrap");
-                request->send(response);
-                
-                BS_LOG_PRINTF("%s:%s: [%s] %s\n", request->client()->remoteIP().toString().c_str(), getHttpMethodName(request->method()), url.c_str(), "not found!");
+                respond(request, request->beginResponse(404, "text/plain", request->url() + " not found!"));
+                note = "not found!";
             }
 
             setLockState(LOCK_STATE_UNLOCK);
-        });
+            return note;
+        }));
 
     // begin the web server
     server.begin();
     BS_LOG_PRINTLN("HTTP server started");
 }
 
-void Bootstrap::updateHtmlTemplate(String template_filename, bool show_time) {
-    String output_filename = template_filename;
-    output_filename.replace(".template", "");
+void Bootstrap::updateHtmlTemplate(const char *template_filename, bool show_time) {
+    // foo.template.html -> foo.html, rendered next to it and swapped in
+    BSString<BS_TEMPLATE_PATH_LEN> output_filename;
+    const char *suffix = strstr(template_filename, ".template");
+    if (suffix != NULL) {
+        output_filename.append(template_filename, suffix - template_filename);
+        output_filename.append(suffix + strlen(".template"));
+    } else {
+        output_filename.printf("%s.html", template_filename);
+    }
+
+    BSString<BS_TEMPLATE_PATH_LEN + 4> temp_filename;
+    temp_filename.printf("%s.tmp", output_filename.c_str());
+
+    if (output_filename.truncated() || temp_filename.truncated()) {
+        BS_LOG_PRINTF("----- template path too long: %s\n", template_filename);
+        return;
+    }
+
+    // a rebuild asked for before fast boot mounted littlefs mounts it
+    if (!ensureLittleFS()) {
+        BS_LOG_PRINTF("----- %s not rebuilt, no littlefs\n", output_filename.c_str());
+        return;
+    }
+
+    BSWatchdog::arm(BS_WDT_CHANNEL_TEMPLATE, __LINE__);
+    heap.begin(BS_HEAP_SUBSYS_TEMPLATE);
 
     File _template = LittleFS.open(template_filename, FILE_READ);
 
     if (_template) {
-        String html = _template.readString();
+        BS_LOG_PRINTF("----- rebuilding %s\n", output_filename.c_str());
+
+        File _output = LittleFS.open(temp_filename.c_str(), FILE_WRITE);
+        const bool rendered = _output && BSTemplate::render(&_template, &_output, [this, show_time](const char *token)
+            {
+                return resolveTemplateToken(token, show_time);
+            });
+        _output.close();
         _template.close();
 
-        while (html.indexOf("{project_name}", 0) != -1) {
-            html.replace("{project_name}", String(_project_name));
+        // readers see either the old page or the new one, never half of it
+        setLockState(LOCK_STATE_LOCK);
+        if (rendered && LittleFS.rename(temp_filename.c_str(), output_filename.c_str())) {
+            BS_LOG_PRINTF("----- %s rebuilt\n", output_filename.c_str());
+        } else {
+            LittleFS.remove(temp_filename.c_str());
+            BS_LOG_PRINTF("----- %s could not be rebuilt\n", output_filename.c_str());
         }
+        setLockState(LOCK_STATE_UNLOCK);
+    }
 
-        while (html.indexOf("{hostname}", 0) != -1) {
-            html.replace("{hostname}", String(base_config->hostname));
-        }
+    heap.end(BS_HEAP_SUBSYS_TEMPLATE);
+    BSWatchdog::idle(BS_WDT_CHANNEL_TEMPLATE);
+}
 
-        while (html.indexOf("{ssid}", 0) != -1) {
-            html.replace("{ssid}", String(base_config->ssid));
-        }
+const char* Bootstrap::resolveTemplateToken(const char *token, const bool show_time, BSArena *arena) {
+    if (strcmp(token, "project_name") == 0) return _project_name.c_str();
+    if (strcmp(token, "hostname") == 0) return base_config->hostname;
+    if (strcmp(token, "ssid") == 0) return base_config->ssid;
+    // rendered pages are plain files -- never put the password in one
+    if (strcmp(token, "ssid_pwd") == 0) return base_config->ssid_pwd_flag == CFG_SET ? BS_CONFIG_REDACTED : "";
+    if (strcmp(token, "ntp_server") == 0) return base_config->ntp_server;
+    if (strcmp(token, "tz") == 0) return base_config->tz;
+
+    if (strcmp(token, "timestamp") == 0) {
+        const char *timestamp = getTimestamp();
+        if (show_time) BS_LOG_PRINTF("Timestamp   = %s\n", timestamp);
+        return timestamp;
+    }
 
-        while (html.indexOf("{ssid_pwd}", 0) != -1) {
-            html.replace("{ssid_pwd}", String(base_config->ssid_pwd));
-        }
+    if (strcmp(token, "ip_address") == 0) {
+        const IPAddress ip = wifimode == WIFI_STA ? WiFi.localIP() : WiFi.softAPIP();
+        return (arena != NULL ? arena : &scratch)->printf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    }
 
-        if (html.indexOf("{timestamp}", 0) != 1) {
-            String timestamp = getTimestamp();
-            while (html.indexOf("{timestamp}", 0) != -1) {
-                html.replace("{timestamp}", timestamp);
-            }
-            if (show_time)
-                BS_LOG_PRINTLN("Timestamp   = " + timestamp);
-        }
+    if (strcmp(token, "chipset_icon") == 0) {
+        #ifdef esp32
+            return "/favicon-32x32.png";
+        #else
+            return "/esp8266.jpg";
+        #endif
+    }
 
-        if (html.indexOf("{ip_address}", 0) != 1) {
-            const String ipAddr = wifimode == WIFI_STA ? WiFi.localIP().toString() : WiFi.softAPIP().toString();
-            while (html.indexOf("{ip_address}", 0) != -1) {
-                html.replace("{ip_address}", ipAddr);
-            }
-        }
+    return updateExtraHtmlTemplateItemsCallback != NULL ? updateExtraHtmlTemplateItemsCallback(token) : NULL;
+}
 
-        if (html.indexOf("{chipset_icon}", 0) != 1) {
-            #ifdef esp32
-                const String iconFile = "/favicon-32x32.png";
-            #else
-                const String iconFile = "/esp8266.jpg";
-            #endif
-            while (html.indexOf("{chipset_icon}", 0) != -1) {
-                html.replace("{chipset_icon}", iconFile);
-            }
-        }
+bool Bootstrap::requestBenchmarks(const uint8_t report) {
+    // claimed here, not when the run starts, so a second request in the
+    // meantime is refused rather than queueing another run
+    if (bench_running.exchange(true)) return false;
+
+    if (!postEvent(BS_EVENT_RUN_BENCHMARKS, (const char *) &report, sizeof(report))) {
+        bench_running = false;
+        return false;
+    }
+    return true;
+}
 
-        
+void Bootstrap::runBenchmarks() {
+    BSWatchdog::arm(BS_WDT_CHANNEL_BENCH, __LINE__);
+    bench_running = true;
+    bench.begin(_project_name.c_str());
 
-        if (updateExtraHtmlTemplateItemsCallback != NULL) updateExtraHtmlTemplateItemsCallback(&html);
+    // the cases format into their own arena -- resetting the loop's scratch
+    // would pull it from under whatever this pass still holds
+    BSArena *arena = new (std::nothrow) BSArena();
 
-        setLockState(LOCK_STATE_LOCK);
+    bench.run("timestamp", [this]() { getTimestamp(); });
 
-        BS_LOG_PRINTF("----- rebuilding %s\n", output_filename.c_str());
-        
-        File _index = LittleFS.open(output_filename, FILE_WRITE);
-        _index.print(html.c_str());
-        _index.close();
+    // the base item dispatch, written into a copy -- the last item, so
+    // every comparison before it is paid
+    CONFIG_TYPE cfg = *base_config;
+    bench.run("config_dispatch", [&cfg]() { applyBaseConfigItem(&cfg, "tz", DEFAULT_TZ); });
 
-        BS_LOG_PRINTF("----- %s rebuilt\n", output_filename.c_str());
+    // synthetic pages with the setup template's token mix, 1 KB and 8 KB
+    static const char row[] = "<tr><td>{hostname}</td><td>{ssid}</td><td>{ip_address}</td><td>{timestamp}</td></tr>\n";
+    const size_t page_len = 8192;
+    char *page = (char *) malloc(page_len);
 
-        setLockState(LOCK_STATE_UNLOCK);
+    if (page != NULL && arena != NULL) {
+        for (size_t i = 0; i < page_len; i++) page[i] = row[i % (sizeof(row) - 1)];
+
+        const size_t sizes[] = { 1024, page_len };
+        const char *names[] = { "template_1k", "template_8k" };
+
+        for (uint8_t i = 0; i < 2; i++) {
+            BSBenchStream in(page, sizes[i] - sizes[i] % (sizeof(row) - 1));
+            BSBenchSink out;
+            BSTemplateResolver resolve = [this, arena](const char *token) { return resolveTemplateToken(token, false, arena); };
+
+            BSTemplate::render(&in, &out, resolve);
+            arena->reset();
+            bench.run(names[i], [&in, &out, resolve, arena]()
+                {
+                    in.rewind();
+                    arena->reset();
+                    BSTemplate::render(&in, &out, resolve);
+                }, out.written);
+        }
+
+        free(page);
     }
+
+    if (arena != NULL) {
+        bench.run("arena_printf", [arena]()
+            {
+                arena->reset();
+                arena->printf("%u.%u.%u.%u", 192, 168, 4, 1);
+            });
+        delete arena;
+    }
+    bench.run("scheduler_once_cancel", [this]() { scheduler.cancel(scheduler.once(60000, []() {})); });
+
+    static BSQueue<BS_EVENT_TYPE, 2> queue;
+    bench.run("event_push_pop", []()
+        {
+            BS_EVENT_TYPE event;
+            event.type = BS_EVENT_LOAD_CONFIG;
+            event.len = 0;
+            queue.push(event);
+            queue.pop(&event);
+        });
+
+    static const uint8_t query[] = { 0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00, 0x00, 0x01, 0x00, 0x01 };
+    uint8_t answer[BS_DNS_ANSWER_LEN];
+    const uint8_t ip[4] = { 192, 168, 4, 1 };
+    BSDnsResponder::buildAnswer(answer, ip, BS_DNS_TTL_S);
+    bench.run("dns_reply", [&answer]()
+        {
+            uint8_t reply[BS_DNS_PACKET_LEN];
+            BSDnsResponder::buildReply(query, sizeof(query), reply, sizeof(reply), answer);
+        }, sizeof(query) + BS_DNS_ANSWER_LEN);
+
+    // one full block of a slowly drifting reading, one second apart
+    static uint8_t block[BS_TS_BLOCK_MAX_BYTES];
+    size_t block_bytes = 0;
+    bench.run("ts_codec", [&block_bytes]()
+        {
+            BSTimeSeriesCodec codec;
+            codec.begin(block, sizeof(block));
+            for (uint16_t i = 0; i < BS_TS_BLOCK_MAX_RECORDS; i++) codec.append(1700000000 + i, 21.5f + (i % 8) * 0.125f);
+            block_bytes = codec.bytes();
+        });
+    bench.note("ts_block_bytes", block_bytes);
+
+    bench.run("asset_lookup", []() { isDigitalAsset("/favicon-32x32.png"); });
+    if (assets.count() > 0) bench.run("asset_find", [this]() { assets.find("/favicon-32x32.png"); });
+    bench.run("heap_json", [this]()
+        {
+            BSBenchSink out;
+            heap.printJson(&out);
+        });
+
+    // saveConfig is not run -- every commit rewrites flash.  what it writes
+    // is the config image, rounded up to a flash sector by the core
+    bench.note("config_bytes", config_size);
+    bench.note("free_heap", ESP.getFreeHeap());
+
+    bench_running = false;
+    BSWatchdog::idle(BS_WDT_CHANNEL_BENCH);
+}
+
+void Bootstrap::useAssets(const BS_ASSET_TYPE *bundle, const uint16_t count) {
+    assets.begin(bundle, count);
 }
 
-void Bootstrap::updateExtraHtmlTemplateItems(std::function<void(String *html)> callable) {
+void Bootstrap::updateExtraHtmlTemplateItems(BSTemplateResolver callable) {
     updateExtraHtmlTemplateItemsCallback = callable;
 }
 
+BSArena* Bootstrap::scratchArena() {
+    return &scratch;
+}
+
 const char* Bootstrap::getHttpMethodName(const WebRequestMethodComposite method) {
     // typedef enum {
     // HTTP_GET     = 0b00000001,
@@ -799,14 +1752,10 @@ const char* Bootstrap::getHttpMethodName(const WebRequestMethodComposite method)
 void Bootstrap::setLockState(tiny_int state) {
     switch (state) {
         case LOCK_STATE_LOCK:
-            #ifdef esp32
-                while (xSemaphoreTake(bs_mutex, portMAX_DELAY) != pdTRUE) {};
-            #endif
+            bs_mutex_lock(bs_mutex);
             break;
         case LOCK_STATE_UNLOCK:
-            #ifdef esp32
-                xSemaphoreGive(bs_mutex); 
-            #endif
+            bs_mutex_unlock(bs_mutex);
             break;
         default:
             break;
@@ -815,216 +1764,222 @@ void Bootstrap::setLockState(tiny_int state) {
 
 #ifdef BS_USE_TELNETSPY
     void Bootstrap::checkForRemoteCommand() {
-        if (SandT->available() > 0) {
-            char c = SandT->read();
-            switch (c) {
-            case '\n':   
-                BS_LOG_PRINTLN();         
-                break;
-            case 'D':
+        shell.step();
+    }
+
+    void Bootstrap::wireRemoteCommands() {
+        addRemoteCommand("?", "This menu", [this](int argc, char **argv)
+            {
+                shell.printHelp();
+            });
+        addRemoteCommand("C", "Current Timestamp", [this](int argc, char **argv)
+            {
+                bs_time.printTo(SandT);
+            });
+        addRemoteCommand("D", "Disconnect WiFi", [this](int argc, char **argv)
+            {
                 BS_LOG_PRINTLN("\nDisconnecting Wi-Fi. . .");
                 BS_LOG_FLUSH();
                 WiFi.disconnect();
-                break;
-            case 'F':
-                {
-                    #ifdef esp32
-                        const size_t fs_size = LittleFS.totalBytes() / 1000;
-                        const size_t fs_used = LittleFS.usedBytes() / 1000;
-                    #else
-                        FSInfo fs_info;
-                        LittleFS.info(fs_info);
-                        const size_t fs_size = fs_info.totalBytes / 1000;
-                        const size_t fs_used = fs_info.usedBytes / 1000;
-                    #endif
-                    BS_LOG_PRINTLN("\n    Filesystem size: [" + String(fs_size) + "] KB");
-                    BS_LOG_PRINTLN("         Free space: [" + String(fs_size - fs_used) + "] KB\n");
+            });
+        addRemoteCommand("F", "Filesystem Info", [this](int argc, char **argv)
+            {
+                if (!ensureLittleFS()) {
+                    BS_LOG_PRINTLN("\nLittleFS not mounted\n");
+                    return;
                 }
-            break;
-            case 'S':
-                {
-                    const unsigned long startTime = millis();
-
-                    BS_LOG_PRINT("\n    Type SSID and press <ENTER>: ");
-                    BS_LOG_FLUSH();
-
-                    String ssid;
-                    do {
-                        if (SandT->available() > 0) {
-                            c = SandT->read();
-                            if (c != 10 && c != 13) {
-                                BS_LOG_PRINT(c);
-                                BS_LOG_FLUSH();
-                                ssid = ssid + String(c);
-                            }
-                        }
-                        if (startTime + 30000 < millis()) {
-                            BS_LOG_PRINTLN("\n\nTimed out!\n");
-                            BS_LOG_FLUSH();
-                            return;
-                        }
-                        watchDogRefresh();
-                    } while (c != 13);
-
-                    BS_LOG_PRINT("\nType PASSWORD and press <ENTER>: ");
-                    BS_LOG_FLUSH();
-                    String ssid_pwd;
-                    do {
-                        if (SandT->available() > 0) {
-                            c = SandT->read();
-                            if (c != 10 && c != 13) {
-                                BS_LOG_PRINT("*");
-                                BS_LOG_FLUSH();
-                                ssid_pwd = ssid_pwd + String(c);
-                            }
-                        }
-                        if (startTime + 30000 < millis()) {
-                            BS_LOG_PRINTLN("\n\nTimed out!\n");
-                            BS_LOG_FLUSH();
-                            return;
-                        }
-                        watchDogRefresh();
-                    } while (c != 13);
-
-                    BS_LOG_PRINTLN("\n\nSSID=[" + ssid + "] PWD=[********]\n");
-                    BS_LOG_FLUSH();
-
-                    while (SandT->available() > 0) {
-                        SandT->read();
-                    }
-
-                    BS_LOG_PRINT("Type YES to confirm settings: ");
-
-                    do {
-                        if (SandT->available() > 0) {
-                            c = SandT->read();
-                            if (c != 89) {
-                                BS_LOG_PRINTLN("\n\nAborted!\n");
-                                BS_LOG_FLUSH();
-                                return;
-                            }
-                        }
-                        if (startTime + 30000 < millis()) {
-                            BS_LOG_PRINTLN("\n\nTimed out!\n");
-                            BS_LOG_FLUSH();
-                            return;
-                        }
-                        watchDogRefresh();
-                    } while (c != 89);
-
-                    BS_LOG_PRINT("Y");
-                    BS_LOG_FLUSH();
-
-                    do {
-                        if (SandT->available() > 0) {
-                            c = SandT->read();
-                            if (c != 69) {
-                                BS_LOG_PRINTLN("\n\nAborted!\n");
-                                BS_LOG_FLUSH();
-                                return;
-                            }
-                        }
-                        if (startTime + 30000 < millis()) {
-                            BS_LOG_PRINTLN("\n\nTimed out!\n");
-                            BS_LOG_FLUSH();
-                            return;
-                        }
-                        watchDogRefresh();
-                    } while (c != 69);
-
-                    BS_LOG_PRINT("E");
-                    BS_LOG_FLUSH();
+                #ifdef esp32
+                    const size_t fs_size = LittleFS.totalBytes() / 1000;
+                    const size_t fs_used = LittleFS.usedBytes() / 1000;
+                #else
+                    FSInfo fs_info;
+                    LittleFS.info(fs_info);
+                    const size_t fs_size = fs_info.totalBytes / 1000;
+                    const size_t fs_used = fs_info.usedBytes / 1000;
+                #endif
+                BS_LOG_PRINTF("\n    Filesystem size: [%u] KB\n", fs_size);
+                BS_LOG_PRINTF("         Free space: [%u] KB\n\n", fs_size - fs_used);
+            });
+        addRemoteCommand("S", "Set SSID / Password (S [ssid] [password])", [this](int argc, char **argv)
+            {
+                memset(pending_ssid, CFG_NOT_SET, WIFI_SSID_LEN);
+                memset(pending_ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
 
-                    do {
-                        if (SandT->available() > 0) {
-                            c = SandT->read();
-                            if (c != 83) {
-                                BS_LOG_PRINTLN("\n\nAborted!\n");
-                                BS_LOG_FLUSH();
-                                return;
-                            }
-                        }
-                        if (startTime + 30000 < millis()) {
-                            BS_LOG_PRINTLN("\n\nTimed out!\n");
-                            BS_LOG_FLUSH();
-                            return;
-                        }
-                        watchDogRefresh();
-                    } while (c != 83);
-
-                    BS_LOG_PRINTLN("S");
-                    BS_LOG_FLUSH();                    
-
-                    memset(base_config->ssid, CFG_NOT_SET, WIFI_SSID_LEN);
-                    if (ssid.length() > 0) {
-                        ssid.toCharArray(base_config->ssid, WIFI_SSID_LEN);
-                        base_config->ssid_flag = CFG_SET;
-                    } else {
-                        base_config->ssid_flag = CFG_NOT_SET;
-                    }
-
-                    memset(base_config->ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
-                    if (ssid_pwd.length() > 0) {
-                        ssid_pwd.toCharArray(base_config->ssid_pwd, WIFI_SSID_PWD_LEN);
-                        base_config->ssid_pwd_flag = CFG_SET;
-                    } else {
-                        base_config->ssid_pwd_flag = CFG_NOT_SET;
-                    }
+                if (argc > 1) strncpy(pending_ssid, argv[1], WIFI_SSID_LEN - 1);
+                if (argc > 2) strncpy(pending_ssid_pwd, argv[2], WIFI_SSID_PWD_LEN - 1);
 
+                if (argc > 2) {
+                    promptForSsidConfirm();
+                } else if (argc > 1) {
+                    promptForSsidPassword();
+                } else {
+                    shell.prompt("\n    Type SSID and press <ENTER>: ", [this](const char *line)
+                        {
+                            strncpy(pending_ssid, line, WIFI_SSID_LEN - 1);
+                            promptForSsidPassword();
+                        });
+                }
+            });
+        addRemoteCommand("B", "Clear saved BSSID (if set)", [this](int argc, char **argv)
+            {
+                if (base_config->bssid_flag == CFG_SET) {
+                    base_config->bssid_flag = CFG_NOT_SET;
+                    memset(base_config->bssid, CFG_NOT_SET, WIFI_BSSID_LEN);
                     saveConfig();
-
-                    BS_LOG_PRINTLN("\nSSID and Password saved - reload config or reboot\n");
-                    BS_LOG_FLUSH();
+                    BS_LOG_PRINTLN("\nSaved BSSID cleared out\n");
+                } else {
+                    BS_LOG_PRINTLN("\nBSSID is not saved!\n");
                 }
-                break;
-            case 'L':
+            });
+        addRemoteCommand("L", "Reload Config", [this](int argc, char **argv)
+            {
                 wireConfig();
                 BS_LOG_PRINTLN();
-                setup_needs_update = true;
-                break;
-            case 'W':
+                updateSetupHtml();
+            });
+        addRemoteCommand("W", "Wipe Config", [this](int argc, char **argv)
+            {
                 wipeConfig();
                 BS_LOG_PRINTLN();
-                break;
-            case 'X':
+            });
+        addRemoteCommand("X", "Close Session", [this](int argc, char **argv)
+            {
                 BS_LOG_PRINTLN(F("\r\nClosing session..."));
                 SandT->disconnectClient();
-                break;
-            case 'R':
+            });
+        addRemoteCommand("R", "Reboot ESP", [this](int argc, char **argv)
+            {
                 BS_LOG_PRINTLN(F("\r\nSubmitting reboot request..."));
                 requestReboot();
-                return;
-            case ' ':
-                // do nothing -- just a simple echo
-                break;
-            case 'B':
-                // clear out saved BSSID
-                if (base_config->bssid_flag == CFG_SET) {
-                    base_config->bssid_flag = CFG_NOT_SET;
-                    memset(base_config->bssid, CFG_NOT_SET, WIFI_BSSID_LEN);
-                    saveConfig();
-                    BS_LOG_PRINTLN("\nSaved BSSID cleared out\n");
+            });
+        addRemoteCommand("H", "Heap Telemetry (H [reset])", [this](int argc, char **argv)
+            {
+                heap.printTo(SandT);
+                if (argc > 1 && strcasecmp(argv[1], "reset") == 0) heap.resetLowWater();
+            });
+        addRemoteCommand("E", "Live Status Events", [this](int argc, char **argv)
+            {
+                live.printTo(SandT);
+            });
+        addRemoteCommand("A", "Flash Assets", [this](int argc, char **argv)
+            {
+                assets.printTo(SandT);
+            });
+        addRemoteCommand("N", "Captive Portal DNS", [this](int argc, char **argv)
+            {
+                dns.printTo(SandT);
+            });
+        addRemoteCommand("I", "Idle Governor (I [on | off | budget <ms> | reset])", [this](int argc, char **argv)
+            {
+                if (argc > 1 && strcasecmp(argv[1], "on") == 0) {
+                    setIdleGovernor(true, governor.latencyBudget());
+                } else if (argc > 1 && strcasecmp(argv[1], "off") == 0) {
+                    setIdleGovernor(false);
+                } else if (argc > 2 && strcasecmp(argv[1], "budget") == 0) {
+                    governor.setLatencyBudget(strtoul(argv[2], NULL, 10));
+                    if (WiFi.status() == WL_CONNECTED) governor.applyRadio(wifimode == WIFI_STA);
+                } else if (argc > 1 && strcasecmp(argv[1], "reset") == 0) {
+                    governor.reset();
+                }
+                governor.printTo(SandT);
+            });
+        addRemoteCommand("U", "Boot Times (U [eager] wires deferred services now)", [this](int argc, char **argv)
+            {
+                if (argc > 1 && strcasecmp(argv[1], "eager") == 0) ensureServices();
+                printBootTimes(SandT);
+            });
+        addRemoteCommand("Q", "Telemetry Queue", [this](int argc, char **argv)
+            {
+                tq.printTo(SandT);
+            });
+        addRemoteCommand("T", "Time Series (T [compact])", [this](int argc, char **argv)
+            {
+                if (argc > 1 && strcasecmp(argv[1], "compact") == 0) ts.compact();
+                ts.printTo(SandT);
+            });
+        addRemoteCommand("Z", "Benchmarks (Z [json])", [this](int argc, char **argv)
+            {
+                // results print when the run is done, the shell stays live
+                const bool json = argc > 1 && strcasecmp(argv[1], "json") == 0;
+                if (requestBenchmarks(json ? BS_BENCH_REPORT_JSON : BS_BENCH_REPORT_TEXT)) {
+                    SandT->println("\nBenchmarks queued\n");
                 } else {
-                    BS_LOG_PRINTLN("\nBSSID is not saved!\n");
+                    SandT->println("\nBenchmarks already running\n");
                 }
-                break;
-            case 'C':
-                // current time
-                BS_LOG_PRINTF("Current timestamp: [%s]\n\n", getTimestamp().c_str());
-                break;
-            default:
-                if (setExtraRemoteCommandsCallback != NULL) setExtraRemoteCommandsCallback(c);
-                break;
-            }
-            SandT->flush();
-        }
+            });
+        addRemoteCommand("M", "Batched Samples (M [flush])", [this](int argc, char **argv)
+            {
+                if (argc > 1 && strcasecmp(argv[1], "flush") == 0) flushSamples();
+                batch.printTo(SandT);
+            });
+        #ifdef BS_USE_PROFILER
+            addRemoteCommand("P", "Loop Profile (P [app | reset | budget <us>])", [this](int argc, char **argv)
+                {
+                    if (argc > 1 && strcasecmp(argv[1], "reset") == 0) {
+                        profiler.reset();
+                        app_profiler.reset();
+                        BS_LOG_PRINTLN("\nLoop profile reset\n");
+                    } else if (argc > 2 && strcasecmp(argv[1], "budget") == 0) {
+                        setLoopBudget(strtoul(argv[2], NULL, 10));
+                        BS_LOG_PRINTF("\nLoop budget set to [%s] us\n\n", argv[2]);
+                    } else if (argc > 1 && strcasecmp(argv[1], "app") == 0) {
+                        app_profiler.printTo(SandT);
+                    } else {
+                        profiler.printTo(SandT);
+                    }
+                });
+        #endif
     }
 
-    void Bootstrap::setExtraRemoteCommands(std::function<void(char c)> callable) {
-        setExtraRemoteCommandsCallback = callable;
-}
+    void Bootstrap::promptForSsidPassword() {
+        shell.prompt("\nType PASSWORD and press <ENTER>: ", [this](const char *line)
+            {
+                strncpy(pending_ssid_pwd, line, WIFI_SSID_PWD_LEN - 1);
+                promptForSsidConfirm();
+            });
+    }
+
+    void Bootstrap::promptForSsidConfirm() {
+        BS_LOG_PRINTF("\n\nSSID=[%s] PWD=[********]\n\n", pending_ssid);
+        shell.prompt("Type YES to confirm settings: ", [this](const char *line)
+            {
+                if (strcmp(line, "YES") != 0) {
+                    BS_LOG_PRINTLN("\n\nAborted!\n");
+                    return;
+                }
+
+                memset(base_config->ssid, CFG_NOT_SET, WIFI_SSID_LEN);
+                if (strlen(pending_ssid) > 0) {
+                    strncpy(base_config->ssid, pending_ssid, WIFI_SSID_LEN - 1);
+                    base_config->ssid_flag = CFG_SET;
+                } else {
+                    base_config->ssid_flag = CFG_NOT_SET;
+                }
+
+                memset(base_config->ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
+                if (strlen(pending_ssid_pwd) > 0) {
+                    strncpy(base_config->ssid_pwd, pending_ssid_pwd, WIFI_SSID_PWD_LEN - 1);
+                    base_config->ssid_pwd_flag = CFG_SET;
+                } else {
+                    base_config->ssid_pwd_flag = CFG_NOT_SET;
+                }
+
+                memset(pending_ssid_pwd, CFG_NOT_SET, WIFI_SSID_PWD_LEN);
+                saveConfig();
+
+                BS_LOG_PRINTLN("\nSSID and Password saved - reload config or reboot\n");
+            });
+    }
+
+    bool Bootstrap::addRemoteCommand(const char *name, const char *help, BSShellCommand callable) {
+        if (shell.addCommand(name, help, callable)) return true;
+        BS_LOG_PRINTF("Command [%s] not added: all [%d] slots taken (BS_SHELL_APP_COMMANDS)\n", name, BS_SHELL_MAX_COMMANDS);
+        return false;
+    }
 #endif
 
+// a flag rather than an event -- a full queue must not lose the request
+// while the flag already keeps idle() and the no wifi path out of the way
 void Bootstrap::requestReboot() {
     esp_reboot_requested = true;
 }
@@ -1032,13 +1987,279 @@ void Bootstrap::requestDeepSleep(const unsigned long usec) {
     esp_sleep_time = usec;
 }
 
+void Bootstrap::useSampleBatch(const uint8_t channels, const uint32_t max_age_s, BSSampleSink sink) {
+    batch.begin(channels, max_age_s, sink);
+}
+
+bool Bootstrap::addSample(const int32_t *values) {
+    if (!batch.add(values)) return false;
+    if (batch.flushDue()) flushSamples();
+    return true;
+}
+
+bool Bootstrap::flushSamples() {
+    if (batch.count() == 0) return true;
+
+    // the radio only comes up once there is something to send
+    if (wifi_deferred) {
+        if (!wireWiFi()) return false;
+        wifi_deferred = false;
+    }
+
+    const uint16_t count = batch.count();
+    if (!batch.flush()) {
+        BS_LOG_PRINTF("\nSample flush failed -- [%u] samples kept\n", batch.count());
+        return false;
+    }
+
+    BS_LOG_PRINTF("\nFlushed [%u] batched samples\n", count);
+    return true;
+}
+
+BSSampleBatch* Bootstrap::sampleBatch() {
+    return &batch;
+}
+
+bool Bootstrap::recordValue(const uint8_t series, const float value) {
+    // the first sample mounts littlefs when fast boot has not yet
+    if (!ts.ready() && resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) wireTimeSeries();
+    return ts.record(series, value);
+}
+
+BSTimeSeries* Bootstrap::timeSeries() {
+    return &ts;
+}
+
+bool Bootstrap::useTelemetry(const char *url, const char *authorization) {
+    if (!tq.setEndpoint(url)) {
+        BS_LOG_PRINTF("\nTelemetry endpoint not usable: %s\n", url);
+        return false;
+    }
+    tq.setAuthorization(authorization);
+    return true;
+}
+
+bool Bootstrap::queueTelemetry(const char *record) {
+    return tq.enqueue(record);
+}
+
+BSTelemetry* Bootstrap::telemetry() {
+    return &tq;
+}
+
+bool Bootstrap::publish(const char *name, const char *value) {
+    return live.publish(name, value);
+}
+
+BSLiveStatus* Bootstrap::liveStatus() {
+    return &live;
+}
+
+BSBench* Bootstrap::benchmarks() {
+    return &bench;
+}
+
+void Bootstrap::reboot() {
+    ElegantOTA.loop();
+    ts.compact();
+
+    persistTelemetry();
+
+    WiFi.disconnect();
+    delay(1000);
+
+    BS_LOG_PRINTLN("\nReboot triggered. . .");
+    BS_LOG_HANDLE();
+    BS_LOG_FLUSH();
+    ESP.restart();
+    while (1) {} // will never get here
+}
+
+unsigned short Bootstrap::scheduleOnce(const unsigned long delay_ms, BSTask callable, const tiny_int priority) {
+    #ifdef BS_USE_PROFILER
+        return scheduler.once(delay_ms, [this, callable]() { BS_PROFILE_STEP(BS_PROF_STEP_TASKS, callable()); }, priority);
+    #else
+        return scheduler.once(delay_ms, callable, priority);
+    #endif
+}
+unsigned short Bootstrap::scheduleEvery(const unsigned long period_ms, BSTask callable, const tiny_int priority) {
+    #ifdef BS_USE_PROFILER
+        return scheduler.every(period_ms, [this, callable]() { BS_PROFILE_STEP(BS_PROF_STEP_TASKS, callable()); }, priority);
+    #else
+        return scheduler.every(period_ms, callable, priority);
+    #endif
+}
+bool Bootstrap::cancelScheduled(const unsigned short id) {
+    return scheduler.cancel(id);
+}
+void Bootstrap::setSchedulerBudget(const unsigned long msec) {
+    scheduler_budget_ms = msec;
+}
+
+void Bootstrap::setIdleGovernor(const bool enabled, const unsigned long latency_budget_ms) {
+    if (enabled) {
+        governor.begin(latency_budget_ms);
+    } else {
+        governor.end();
+    }
+
+    if (WiFi.status() == WL_CONNECTED) governor.applyRadio(wifimode == WIFI_STA);
+}
+
+void Bootstrap::busy(const unsigned long ms) {
+    const uint64_t until_us = bs_micros64() + (uint64_t) ms * 1000;
+    if (until_us > busy_until_us) busy_until_us = until_us;
+    busy_pass = true;
+}
+
+bool Bootstrap::idle() {
+    if (!governor.enabled()) return false;
+
+    // the application's own work first
+    const bool app_busy = busy_pass || bs_micros64() < busy_until_us;
+    busy_pass = false;
+    if (app_busy) return false;
+
+    // anything already waiting keeps the loop spinning
+    if (esp_sleep_time || esp_reboot_requested || !events.empty() || render_pending.load() != 0) return false;
+    if (ota_owner != NULL || ota_stream.active() || ota_delta.active()) return false;
+
+    uint32_t ms_until = UINT32_MAX;
+    scheduler.nextDeadline(&ms_until);
+
+    // the loop channel has to be refreshed well inside its timeout
+    const uint32_t wdt_ms = WATCHDOG_TIMEOUT_S * 1000UL / 4;
+    if (ms_until > wdt_ms) ms_until = wdt_ms;
+
+    #ifdef BS_USE_PROFILER
+        // the sleep is neither the app's time nor the next iteration's
+        const uint32_t started = micros();
+        const uint32_t slept = governor.idle(ms_until);
+        profiler.idled((uint32_t) micros() - started);
+        return slept > 0;
+    #else
+        return governor.idle(ms_until) > 0;
+    #endif
+}
+
 void Bootstrap::updateSetupHtml() {
-    setup_needs_update = true;
+    render_pending.fetch_or(BS_RENDER_SETUP);
 }
 void Bootstrap::updateIndexHtml() {
-    index_needs_update = true;
+    render_pending.fetch_or(BS_RENDER_INDEX);
+}
+
+void Bootstrap::scheduleRenders() {
+    const uint8_t render = render_pending.exchange(0);
+    if (render == 0 || resetReason == RESET_REASON_DEEP_SLEEP_AWAKE) return;
+
+    // one render per page, however often it was asked for
+    if ((render & BS_RENDER_SETUP) && !scheduler.pending(setup_task)) {
+        setup_task = scheduler.once(0, [this]()
+            {
+                BS_PROFILE_STEP(BS_PROF_STEP_TEMPLATE, updateHtmlTemplate("/setup.template.html", false));
+            });
+    }
+    if ((render & BS_RENDER_INDEX) && !scheduler.pending(index_task)) {
+        index_task = scheduler.once(0, [this]()
+            {
+                BS_PROFILE_STEP(BS_PROF_STEP_TEMPLATE, updateHtmlTemplate("/index.template.html", false));
+            });
+    }
 }
 
+bool Bootstrap::postEvent(const tiny_int type, const char *data, const unsigned short len) {
+    BS_EVENT_TYPE event;
+    event.type = type;
+    event.len = len > BS_EVENT_DATA_LEN ? BS_EVENT_DATA_LEN : len;
+    if (data != NULL) memcpy(event.data, data, event.len);
+
+    if (!events.push(event)) {
+        BS_LOG_PRINTF("\nEvent queue full -- dropped event [%d]\n", type);
+        return false;
+    }
+    return true;
+}
+
+void Bootstrap::processEvents() {
+    BS_EVENT_TYPE event;
+
+    // bounded so a busy producer cannot starve the rest of the loop
+    for (tiny_int i = 0; i < BS_EVENT_QUEUE_LEN && events.pop(&event); i++) {
+        processEvent(&event);
+    }
+}
+
+void Bootstrap::processEvent(BS_EVENT_TYPE *event) {
+    switch (event->type) {
+        case BS_EVENT_CONFIG_UPDATE:
+            {
+                BS_CONFIG_UPDATE_TYPE *update;
+                if (event->len != sizeof(update)) break;
+                memcpy(&update, event->data, sizeof(update));
+
+                heap.begin(BS_HEAP_SUBSYS_CONFIG);
+                if (update->dry_run) {
+                    // the base items into a copy, the rest only unpacked --
+                    // no callback, no commit
+                    CONFIG_TYPE cfg = *base_config;
+                    unsigned short items = 0;
+                    unpackConfigItems(update, [&cfg, &items](const char *name, const char *value)
+                        {
+                            applyBaseConfigItem(&cfg, name, value);
+                            items++;
+                        });
+                    BS_LOG_PRINTF("config dry run: [%u] items\n", items);
+                } else {
+                    unpackConfigItems(update, [this](const char *name, const char *value) { updateConfigItem(name, value); });
+                    saveConfig();
+                }
+                heap.end(BS_HEAP_SUBSYS_CONFIG);
+                free(update);
+            }
+            break;
+        case BS_EVENT_LOAD_CONFIG:
+            heap.begin(BS_HEAP_SUBSYS_CONFIG);
+            BS_LOG_PRINTLN();
+            wireConfig();
+            updateSetupHtml();
+            heap.end(BS_HEAP_SUBSYS_CONFIG);
+            break;
+        case BS_EVENT_WIPE_CONFIG:
+            heap.begin(BS_HEAP_SUBSYS_CONFIG);
+            wipeConfig();
+            heap.end(BS_HEAP_SUBSYS_CONFIG);
+            break;
+        case BS_EVENT_RUN_BENCHMARKS:
+            {
+                // low priority, so the rest of this pass goes first
+                const uint8_t report = event->len > 0 ? (uint8_t) event->data[0] : BS_BENCH_REPORT_NONE;
+                const unsigned short task = scheduler.once(0, [this, report]()
+                    {
+                        runBenchmarks();
+                        #ifdef BS_USE_TELNETSPY
+                            if (report == BS_BENCH_REPORT_JSON) {
+                                bench.printJson(SandT);
+                                SandT->println();
+                            } else if (report == BS_BENCH_REPORT_TEXT) {
+                                bench.printTo(SandT);
+                            }
+                        #endif
+                    }, BS_SCHED_PRIORITY_LOW);
+                if (task == BS_SCHED_NO_TASK) bench_running = false;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+#ifdef BS_USE_PROFILER
+    void Bootstrap::setLoopBudget(const unsigned long usec) {
+        profiler.setBudget(usec);
+    }
+#endif
+
 void Bootstrap::blink() {
     LED_ON;
     delay(200);
@@ -1049,41 +2270,14 @@ void Bootstrap::blink() {
     LED_OFF;
 }
 
-String Bootstrap::getTimestamp() {
-    if (resetReason != RESET_REASON_DEEP_SLEEP_AWAKE) {
-        struct tm timeinfo;
-        char timebuf[255];
+const char* Bootstrap::getTimestamp() {
+    return bs_time.now();
+}
 
-        if (wifimode == WIFI_AP || !getLocalTime(&timeinfo)) {
-            const unsigned long now = millis();
-            sprintf(timebuf, "%06lu.%03lu", now / 1000, now % 1000);
-        } else {
-            sprintf(timebuf, "%4d-%2.2d-%2.2d %2.2d:%2.2d:%2.2d", timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-        }
-        return String(timebuf);
-    }
-    return String("time not available in sleep mode");
+uint64_t Bootstrap::micros64() {
+    return BSTime::micros64();
 }
 
 void Bootstrap::setActiveAP() {
     ap_mode_activity = true;
 }
-
-#ifdef esp32
-    void IRAM_ATTR Bootstrap::watchDogInterrupt() {
-        BS_LOG_PRINTLN("watchdog triggered reboot");
-        BS_LOG_FLUSH();
-        ESP.restart();
-    }
-#else
-    void IRAM_ATTR Bootstrap::timerHandler() {
-        if (timer_pinged) {
-            BS_LOG_PRINTLN("watchdog triggered reboot");
-            BS_LOG_FLUSH();
-            ESP.restart();
-        } else {
-            timer_pinged = true;
-            BS_LOG_PRINTLN("PING");
-        }
-    }
-#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the micro-benchmark suite on the host build, queued the way POST /bench
+// queues it, with every allocation counted.  prints the table and fails
+// when a hot path that must not touch the heap allocates, or when a second
+// request is not refused while the first is queued
+#include "Bootstrap.h"
+#include "BSHost.h"
+
+TelnetSpy SerialAndTelnet;
+Bootstrap bs = Bootstrap("bench host", &SerialAndTelnet, 1500000);
+
+CONFIG_TYPE config;
+
+static int failures = 0;
+
+// per op, every time
+static const char *no_alloc[] = {
+    "config_dispatch", "template_1k", "template_8k", "arena_printf", "event_push_pop", "dns_reply", "ts_codec", "asset_lookup"
+};
+
+static void check() {
+    // nothing is counted under the sanitizers, which own malloc
+    if (!bs_alloc_counted()) {
+        printf("allocations not counted in this build\n");
+        return;
+    }
+
+    // the counter itself -- one malloc per op has to read as one
+    static BSBench probe;
+    probe.begin("probe");
+    probe.run("malloc_free", []()
+        {
+            // volatile, or the pair is optimized away
+            void *volatile p = malloc(16);
+            free(p);
+        });
+    if (probe.result(0)->milli_allocs_per_op != 1000) {
+        failures++;
+        printf("FAIL malloc_free: %.3f allocs/op, expected 1\n", probe.result(0)->milli_allocs_per_op / 1000.0);
+    }
+
+    BSBench *bench = bs.benchmarks();
+    for (const char *name : no_alloc) {
+        bool found = false;
+        for (uint8_t i = 0; i < bench->count(); i++) {
+            const BS_BENCH_RESULT_TYPE *r = bench->result(i);
+            if (strcmp(r->name, name) != 0) continue;
+            found = true;
+            if (r->milli_allocs_per_op != 0) {
+                failures++;
+                printf("FAIL %s: %.3f allocs/op\n", name, r->milli_allocs_per_op / 1000.0);
+            }
+        }
+        if (!found) {
+            failures++;
+            printf("FAIL %s: not run\n", name);
+        }
+    }
+}
+
+void setup() {
+    if (!bs_host_test_setup(&bs, &config, sizeof(config), "bench", BS_HOST_TEST_DATA)) return;
+
+    if (!bs.requestBenchmarks() || bs.requestBenchmarks()) {
+        failures++;
+        printf("FAIL a second request has to be refused while one is queued\n");
+    }
+}
+
+void loop() {
+    bs.loop();
+
+    // the run is a scheduler task, done within the pass that started it
+    if (bs.benchmarks()->count() == 0) return;
+
+    bs.benchmarks()->printTo(&Serial);
+    check();
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    fflush(stdout);
+    _exit(failures == 0 ? 0 : 1);
+}
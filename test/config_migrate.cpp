@@ -0,0 +1,95 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// an eeprom image from before ntp server and tz joined CONFIG_TYPE, with
+// an app config behind it, booted by the current layout -- the base and
+// the app's fields have to come back where they were, the new fields at
+// their defaults, and the image rewritten with the header
+#include "Bootstrap.h"
+#include "BSHost.h"
+
+#define STATION_ID_LEN                100
+
+// the layout as it was stored
+typedef struct legacy_config_type {
+    tiny_int hostname_flag;
+    char hostname[HOSTNAME_LEN];
+    tiny_int ssid_flag;
+    char ssid[WIFI_SSID_LEN];
+    tiny_int ssid_pwd_flag;
+    char ssid_pwd[WIFI_SSID_PWD_LEN];
+    tiny_int bssid_flag;
+    byte bssid[WIFI_BSSID_LEN];
+} LEGACY_CONFIG_TYPE;
+
+// the app's fields -- the counter needs padding in front of it
+#define APP_FIELDS \
+    uint32_t counter; \
+    tiny_int station_id_flag; \
+    char station_id[STATION_ID_LEN];
+
+typedef struct legacy_app_type : legacy_config_type { APP_FIELDS } LEGACY_APP_TYPE;
+typedef struct app_config_type : config_type { APP_FIELDS } APP_CONFIG_TYPE;
+
+TelnetSpy SerialAndTelnet;
+Bootstrap bs = Bootstrap("config migrate", &SerialAndTelnet, 1500000);
+
+APP_CONFIG_TYPE config;
+
+static int failures = 0;
+
+#define EXPECT(cond, ...) { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }
+
+static bool writeLegacyImage() {
+    LEGACY_APP_TYPE legacy;
+    memset(&legacy, 0xff, sizeof(legacy));
+    legacy.hostname_flag = CFG_SET;
+    strcpy(legacy.hostname, "legacy-host");
+    legacy.ssid_flag = CFG_NOT_SET;
+    memset(legacy.ssid, CFG_NOT_SET, WIFI_SSID_LEN);
+    legacy.ssid_pwd_flag = CFG_NOT_SET;
+    legacy.bssid_flag = CFG_NOT_SET;
+    legacy.counter = 0x12345678;
+    legacy.station_id_flag = CFG_SET;
+    strcpy(legacy.station_id, "station-7");
+
+    FILE *f = fopen(bs_host_path("eeprom.bin").c_str(), "wb");
+    if (f == NULL) return false;
+    const bool written = fwrite(&legacy, 1, sizeof(legacy), f) == sizeof(legacy);
+    return fclose(f) == 0 && written;
+}
+
+void setup() {
+    bs_host_test_dir("migrate");
+    EXPECT(writeLegacyImage(), "the legacy image could not be written");
+    if (bs_host_test_setup(&bs, &config, sizeof(config), "migrate", BS_HOST_TEST_DATA)) {
+        EXPECT(config.hostname_flag == CFG_SET && strcmp(config.hostname, "legacy-host") == 0, "hostname [%s]", config.hostname);
+        EXPECT(config.ssid_flag == CFG_NOT_SET, "ssid flag [%d]", config.ssid_flag);
+        EXPECT(config.ntp_server_flag == CFG_NOT_SET && strcmp(config.ntp_server, DEFAULT_NTP_SERVER) == 0, "ntp server [%s]", config.ntp_server);
+        EXPECT(config.tz_flag == CFG_NOT_SET && strcmp(config.tz, DEFAULT_TZ) == 0, "tz [%s]", config.tz);
+        EXPECT(config.counter == 0x12345678, "counter [%08x]", config.counter);
+        EXPECT(config.station_id_flag == CFG_SET && strcmp(config.station_id, "station-7") == 0, "station id [%s]", config.station_id);
+
+        // stored again, header first, the app's fields at their new offset
+        uint8_t image[BS_CONFIG_HEADER_LEN + sizeof(config)];
+        FILE *f = fopen(bs_host_path("eeprom.bin").c_str(), "rb");
+        const size_t n = f != NULL ? fread(image, 1, sizeof(image), f) : 0;
+        if (f != NULL) fclose(f);
+        EXPECT(n == sizeof(image), "[%u] bytes stored", (unsigned) n);
+        EXPECT(memcmp(image, BS_CONFIG_MAGIC, 3) == 0 && image[3] == BS_CONFIG_VERSION, "no header stored");
+        EXPECT(strcmp((char *) image + BS_CONFIG_HEADER_LEN + (config.station_id - (char *) &config), "station-7") == 0, "station id not stored in place");
+    } else {
+        EXPECT(false, "setup() failed");
+    }
+
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    fflush(stdout);
+    _exit(failures == 0 ? 0 : 1);
+}
+
+void loop() {
+}
@@ -0,0 +1,47 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the captive portal dns responder on its own -- dns_host <port> answers
+// with 10.0.0.1 until SIGTERM, then prints its counters.  driven by
+// dns_responder.py
+#include "BSDnsResponder.h"
+
+#include <signal.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int sig) {
+    (void) sig;
+    running = 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: dns_host <port>\n");
+        return 2;
+    }
+
+    BSDnsResponder dns;
+    const uint8_t ip[4] = { 10, 0, 0, 1 };
+    if (!dns.begin((uint16_t) atoi(argv[1]), ip)) {
+        fprintf(stderr, "bind failed\n");
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    printf("ready\n");
+    fflush(stdout);
+
+    while (running) {
+        dns.loop();
+        usleep(1000);
+    }
+
+    printf("queries %u dropped %u\n", dns.queries(), dns.dropped());
+    return 0;
+}
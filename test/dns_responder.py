@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+queries the host dns responder over udp
+
+    dns_responder.py <dns_host>
+
+A gets the portal address, AAAA / TXT an empty NOERROR, anything the
+responder cannot parse (truncated, compressed, a response) no reply at all
+"""
+import socket
+import struct
+import subprocess
+import sys
+
+PORTAL = "10.0.0.1"
+TTL_S = 60
+TYPE_A, TYPE_TXT, TYPE_AAAA, TYPE_OPT = 1, 16, 28, 41
+
+
+def name(qname):
+    return b"".join(bytes([len(l)]) + l.encode() for l in qname.split(".")) + b"\0"
+
+
+def query(qid, qname, qtype, flags=0x0100, qdcount=1, extra=b"", arcount=0):
+    return struct.pack(">HHHHHH", qid, flags, qdcount, 0, 0, arcount) + name(qname) + struct.pack(">HH", qtype, 1) + extra
+
+
+def opt_record():
+    # edns0, 1232 byte payload
+    return b"\0" + struct.pack(">HHIH", TYPE_OPT, 1232, 0, 0)
+
+
+class Client:
+    def __init__(self, port):
+        self.addr = ("127.0.0.1", port)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(0.5)
+
+    def ask(self, packet):
+        self.sock.sendto(packet, self.addr)
+        try:
+            return self.sock.recv(1024)
+        except socket.timeout:
+            return None
+
+
+def header(reply):
+    return struct.unpack(">HHHHHH", reply[:12])
+
+
+def check(cond, what):
+    if not cond:
+        raise AssertionError(what)
+    print("ok   " + what)
+
+
+def run(client):
+    q = query(0x1234, "connectivitycheck.example.com", TYPE_A)
+    r = client.ask(q)
+    check(r is not None, "A is answered")
+    qid, flags, qd, an, ns, ar = header(r)
+    check(qid == 0x1234, "A keeps the query id")
+    check(flags == 0x8500, "A is a noerror authoritative response with rd echoed (%04x)" % flags)
+    check((qd, an, ns, ar) == (1, 1, 0, 0), "A has one question and one answer")
+    check(r[12:len(q)] == q[12:], "A echoes the question")
+    rname, rtype, rclass, ttl, rdlen = struct.unpack(">HHHIH", r[len(q):len(q) + 12])
+    check(rname == 0xc00c and rtype == TYPE_A and rclass == 1, "the answer points back at the question")
+    check(ttl == TTL_S and rdlen == 4, "the answer carries a %d s ttl and four bytes" % TTL_S)
+    check(socket.inet_ntoa(r[len(q) + 12:len(q) + 16]) == PORTAL, "the answer is the portal address")
+    check(len(r) == len(q) + 16, "nothing follows the answer")
+
+    for qtype, label in ((TYPE_AAAA, "AAAA"), (TYPE_TXT, "TXT")):
+        q = query(0x2000 + qtype, "example.com", qtype)
+        r = client.ask(q)
+        check(r is not None, label + " is answered")
+        qid, flags, qd, an, ns, ar = header(r)
+        check(qid == 0x2000 + qtype and flags == 0x8500 and an == 0, label + " gets an empty noerror")
+        check(r[12:] == q[12:], label + " echoes the question and nothing else")
+
+    q = query(0x3000, "example.com", TYPE_A, flags=0x0000)
+    check(header(client.ask(q))[1] == 0x8400, "rd clear stays clear")
+
+    q = query(0x3001, "example.com", TYPE_A, extra=opt_record(), arcount=1)
+    r = client.ask(q)
+    check(r is not None and header(r)[5] == 0, "an edns query is answered without the opt record")
+    check(len(r) == len(q) - 11 + 16, "the opt record is dropped from the reply")
+
+    r = client.ask(query(0x4000, "example.com", TYPE_A, flags=0x0900))
+    check(r is not None and len(r) == 12 and header(r)[1] & 0x000f == 4, "a non-query opcode is NOTIMP, header only")
+
+    r = client.ask(query(0x4001, "example.com", TYPE_A, qdcount=2))
+    check(r is not None and len(r) == 12 and header(r)[1] & 0x000f == 1, "two questions are FORMERR, header only")
+
+    full = query(0x5000, "truncated.example.com", TYPE_A)
+    dropped = 0
+    for cut, label in ((5, "a short header"), (12, "a header without its question"),
+                       (20, "a name cut short"), (len(full) - 2, "a question without its class")):
+        check(client.ask(full[:cut]) is None, "%s gets no reply" % label)
+        dropped += 1
+
+    compressed = struct.pack(">HHHHHH", 0x5001, 0x0100, 1, 0, 0, 0) + b"\xc0\x0c" + struct.pack(">HH", TYPE_A, 1)
+    check(client.ask(compressed) is None, "a compressed question gets no reply")
+    dropped += 1
+
+    response = bytearray(query(0x5002, "example.com", TYPE_A))
+    response[2] |= 0x80
+    check(client.ask(bytes(response)) is None, "a response is never answered")
+    dropped += 1
+
+    # A, AAAA, TXT, rd clear, edns, NOTIMP, FORMERR
+    return 7, dropped
+
+
+def main(argv):
+    if len(argv) != 2:
+        print(__doc__.strip())
+        return 2
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.bind(("127.0.0.1", 0))
+        port = s.getsockname()[1]
+
+    proc = subprocess.Popen([argv[1], str(port)], stdout=subprocess.PIPE, text=True)
+    try:
+        check(proc.stdout.readline().strip() == "ready", "the responder binds udp :%d" % port)
+        answered, dropped = run(Client(port))
+    finally:
+        proc.terminate()
+        out, _ = proc.communicate(timeout=5)
+
+    check(out.strip() == "queries %d dropped %d" % (answered + dropped, dropped),
+          "every query is counted, the unparsable ones as dropped (%s)" % out.strip())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
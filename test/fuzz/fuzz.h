@@ -0,0 +1,34 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+#ifndef BS_FUZZ_H
+#define BS_FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// a broken invariant is a crash -- libFuzzer and fuzz_driver.cpp both keep
+// the input that caused it
+#define FUZZ_CHECK(cond) { if (!(cond)) { fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); abort(); } }
+
+// the input, consumed from the front -- a target takes its knobs first and
+// treats the rest as the payload
+typedef struct fuzz_input_type {
+    const uint8_t *data;
+    size_t size;
+} FUZZ_INPUT_TYPE;
+
+inline uint8_t fuzz_byte(FUZZ_INPUT_TYPE *in) {
+    if (in->size == 0) return 0;
+    in->size--;
+    return *in->data++;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+#endif
@@ -0,0 +1,49 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the config update unpack processEvent runs -- on data whatever built
+// it, a len past the data included.  every pair has to lie inside the
+// data, in order, without overlapping
+//
+// input: [len low] [len high] data
+#include "fuzz.h"
+#include "Bootstrap.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    FUZZ_INPUT_TYPE in = { data, size };
+    const unsigned short len = (unsigned short) (fuzz_byte(&in) | fuzz_byte(&in) << 8);
+    const unsigned short data_size = in.size < 0xffff ? (unsigned short) in.size : 0xffff;
+
+    // the data on its own, so reading past it is caught
+    BS_CONFIG_UPDATE_TYPE update;
+    update.data = (char *) malloc(data_size > 0 ? data_size : 1);
+    memcpy(update.data, in.data, data_size);
+    update.size = data_size;
+    update.len = len;
+    update.dry_run = false;
+
+    const char *end = update.data + (len < data_size ? len : data_size);
+    const char *next = update.data;
+    size_t pairs = 0;
+
+    Bootstrap::unpackConfigItems(&update, [&](const char *name, const char *value)
+        {
+            FUZZ_CHECK(name == next);
+            FUZZ_CHECK(value == name + strlen(name) + 1);
+            FUZZ_CHECK(value + strlen(value) < end);
+            next = value + strlen(value) + 1;
+            pairs++;
+        });
+
+    // nothing left but a pair cut short -- at most the name's nul
+    FUZZ_CHECK(pairs <= data_size / 2u);
+    const char *name_end = (const char *) memchr(next, '\0', end - next);
+    if (name_end != NULL) FUZZ_CHECK(memchr(name_end + 1, '\0', end - name_end - 1) == NULL);
+
+    free(update.data);
+    return 0;
+}
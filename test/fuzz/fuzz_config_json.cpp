@@ -0,0 +1,124 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// a POST /api/config body -- BSJsonParser::feed and the staging behind it,
+// fed in chunks the size the input picks, as the web server would
+//
+// every pair the parser hands out has to be a terminated key and value
+// within their buffers.  an update that is accepted has to unpack to
+// exactly the pairs that passed validation, in order, and an update that
+// is rejected has to say why -- any body with each item once fits
+//
+// input: [chunk size] body
+#include "fuzz.h"
+#include "Bootstrap.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<std::string, std::string>> FUZZ_PAIRS_TYPE;
+
+TelnetSpy SerialAndTelnet;
+
+static Bootstrap* bootstrap() {
+    static Bootstrap *bs = NULL;
+    if (bs == NULL) {
+        bs = new Bootstrap("fuzz", &SerialAndTelnet);
+        bs->addConfigItem("mqtt_host", 64);
+        bs->addConfigItem("mqtt_pwd", 32, true);
+        bs->addConfigItem("unit", 1);
+    }
+    return bs;
+}
+
+static const BS_CONFIG_ITEM_TYPE items[] = {
+    { "hostname", HOSTNAME_LEN - 1, false },
+    { "ssid", WIFI_SSID_LEN - 1, false },
+    { "ssid_pwd", WIFI_SSID_PWD_LEN - 1, true },
+    { "ntp_server", NTP_SERVER_LEN - 1, false },
+    { "tz", TZ_LEN - 1, false },
+    { "mqtt_host", 64, false },
+    { "mqtt_pwd", 32, true },
+    { "unit", 1, false },
+};
+
+static const BS_CONFIG_ITEM_TYPE* find(const char *name) {
+    for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); i++) {
+        if (strcmp(items[i].name, name) == 0) return &items[i];
+    }
+    return NULL;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    FUZZ_INPUT_TYPE in = { data, size };
+    const size_t chunk = 1 + fuzz_byte(&in);
+
+    // the parser on its own, and the pairs staging should keep
+    BSJsonParser parser;
+    parser.begin();
+    FUZZ_PAIRS_TYPE staged;
+    bool stageable = true;
+    bool repeated = false;
+
+    for (size_t i = 0; i < in.size; i++) {
+        const uint8_t result = parser.feed(in.data[i]);
+        FUZZ_CHECK(result <= BS_JSON_ERROR);
+
+        if (result == BS_JSON_ERROR) {
+            FUZZ_CHECK(parser.error() != NULL);
+            FUZZ_CHECK(parser.feed('}') == BS_JSON_ERROR);
+            break;
+        }
+        if (result != BS_JSON_PAIR) continue;
+
+        const size_t key_len = strnlen(parser.key(), BS_JSON_KEY_LEN);
+        FUZZ_CHECK(key_len < BS_JSON_KEY_LEN);
+        FUZZ_CHECK(parser.valueLen() < BS_JSON_VALUE_LEN);
+        FUZZ_CHECK(parser.value()[parser.valueLen()] == '\0');
+        FUZZ_CHECK(strlen(parser.value()) == parser.valueLen());
+
+        const BS_CONFIG_ITEM_TYPE *item = find(parser.key());
+        if (item == NULL || !parser.isString() || parser.valueLen() > item->max_len) {
+            stageable = false;
+        } else if (stageable && !(item->secret && strcmp(parser.value(), BS_CONFIG_REDACTED) == 0)) {
+            for (const auto &pair : staged) repeated |= pair.first == parser.key();
+            staged.push_back(std::make_pair(std::string(parser.key()), std::string(parser.value())));
+        }
+    }
+
+    // the same body through what the web handler runs
+    Bootstrap *bs = bootstrap();
+    BS_API_CONFIG_TYPE *update = bs->newConfigUpdate(in.size);
+    FUZZ_CHECK(update != NULL);
+    for (size_t i = 0; i < in.size; i += chunk) {
+        bs->feedConfigUpdate(update, in.data + i, in.size - i < chunk ? in.size - i : chunk);
+    }
+
+    if (in.size > BS_API_CONFIG_MAX_BODY) {
+        FUZZ_CHECK(update->error != NULL && update->status == 413);
+    } else if (update->error == NULL) {
+        FUZZ_CHECK(parser.error() == NULL);
+        FUZZ_CHECK(update->parser.done() == parser.done());
+
+        FUZZ_PAIRS_TYPE unpacked;
+        Bootstrap::unpackConfigItems(&update->staged, [&unpacked](const char *name, const char *value)
+            {
+                unpacked.push_back(std::make_pair(std::string(name), std::string(value)));
+            });
+        FUZZ_CHECK(stageable);
+        FUZZ_CHECK(unpacked == staged);
+        FUZZ_CHECK(update->items == staged.size());
+    } else {
+        // staging is sized for every item once, only a repeat overflows it
+        FUZZ_CHECK(update->status == 400 || update->status == 413);
+        FUZZ_CHECK(update->status == 400 ? parser.error() != NULL || !stageable : repeated);
+    }
+
+    free(update);
+    return 0;
+}
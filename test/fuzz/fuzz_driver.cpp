@@ -0,0 +1,211 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// stands in for libFuzzer's main() where there is no clang
+//
+//     fuzz_<target> [-runs=N] [-seed=N] [-max_len=N] corpus_dir_or_file...
+//
+// runs every corpus input as is, then N (10000) inputs mutated from them
+// with a fixed seed -- blind, no coverage feedback, but repeatable and
+// enough to keep the invariants honest under ctest.  the flags are
+// libFuzzer's so the same command line works with -DBS_FUZZ_LIBFUZZER=ON.
+// on a crash the input is written to ./crash-<target> and dumped in hex
+#include "fuzz.h"
+
+#include <dirent.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define FUZZ_DEFAULT_RUNS             10000
+#define FUZZ_DEFAULT_MAX_LEN          4096
+#define FUZZ_MAX_MUTATIONS            6
+
+typedef std::vector<uint8_t> FUZZ_UNIT_TYPE;
+
+static const char *target = "fuzz";
+static const FUZZ_UNIT_TYPE *current = NULL;
+
+// bytes the parsers under test give meaning to
+static const char interesting[] = "{}[]\"\\:,/ \t\r\n\b\x7f" "0123456789abcdefuABCDEF_-+.eE" "truefalsenull\xc3\xa9\xed\xa0\x80";
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random() {
+    // splitmix64
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static size_t below(const size_t n) {
+    return n == 0 ? 0 : (size_t) (next_random() % n);
+}
+
+static void onCrash(int sig) {
+    if (current != NULL) {
+        const std::string name = std::string("crash-") + target;
+        FILE *f = fopen(name.c_str(), "wb");
+        if (f != NULL) {
+            fwrite(current->data(), 1, current->size(), f);
+            fclose(f);
+        }
+        fprintf(stderr, "\n%s: signal %d on a %zu byte input, saved to %s\n", target, sig, current->size(), name.c_str());
+        for (size_t i = 0; i < current->size() && i < 512; i++) fprintf(stderr, "%02x%s", (*current)[i], i % 32 == 31 ? "\n" : "");
+        fprintf(stderr, "\n");
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static bool readFile(const std::string &path, std::vector<FUZZ_UNIT_TYPE> *corpus) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) return false;
+
+    FUZZ_UNIT_TYPE unit;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) unit.insert(unit.end(), buf, buf + n);
+    fclose(f);
+
+    corpus->push_back(unit);
+    return true;
+}
+
+static void readPath(const std::string &path, std::vector<FUZZ_UNIT_TYPE> *corpus) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return;
+    if (!S_ISDIR(st.st_mode)) {
+        readFile(path, corpus);
+        return;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL) return;
+
+    // sorted, so a run does not depend on directory order
+    std::vector<std::string> names;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+    for (const std::string &name : names) readPath(path + "/" + name, corpus);
+}
+
+static void mutate(FUZZ_UNIT_TYPE *unit, const std::vector<FUZZ_UNIT_TYPE> &corpus, const size_t max_len) {
+    const size_t mutations = 1 + below(FUZZ_MAX_MUTATIONS);
+
+    for (size_t m = 0; m < mutations; m++) {
+        const size_t at = below(unit->size() + 1);
+
+        switch (below(8)) {
+            case 0:
+                if (!unit->empty()) (*unit)[below(unit->size())] ^= (uint8_t) (1 << below(8));
+                break;
+            case 1:
+                if (!unit->empty()) (*unit)[below(unit->size())] = (uint8_t) next_random();
+                break;
+            case 2:
+                if (!unit->empty()) (*unit)[below(unit->size())] = (uint8_t) interesting[below(sizeof(interesting) - 1)];
+                break;
+            case 3:
+                unit->insert(unit->begin() + at, (uint8_t) interesting[below(sizeof(interesting) - 1)]);
+                break;
+            case 4:
+                if (!unit->empty()) {
+                    const size_t from = below(unit->size());
+                    unit->erase(unit->begin() + from, unit->begin() + from + 1 + below(unit->size() - from));
+                }
+                break;
+            case 5:
+                // repeat a slice -- long tokens, deep runs of the same byte
+                if (!unit->empty()) {
+                    const size_t from = below(unit->size());
+                    const FUZZ_UNIT_TYPE slice(unit->begin() + from, unit->begin() + from + 1 + below(unit->size() - from));
+                    for (size_t r = 1 + below(16); r > 0; r--) unit->insert(unit->begin() + at, slice.begin(), slice.end());
+                }
+                break;
+            case 6:
+                // splice in part of another input
+                if (!corpus.empty()) {
+                    const FUZZ_UNIT_TYPE &other = corpus[below(corpus.size())];
+                    if (!other.empty()) {
+                        const size_t from = below(other.size());
+                        unit->insert(unit->begin() + at, other.begin() + from, other.begin() + from + 1 + below(other.size() - from));
+                    }
+                }
+                break;
+            default:
+                unit->resize(below(unit->size() + 1));
+                break;
+        }
+    }
+
+    if (unit->size() > max_len) unit->resize(max_len);
+}
+
+static void run(const FUZZ_UNIT_TYPE &unit) {
+    current = &unit;
+    // a copy exactly as long as the input, so reading one past it trips
+    // the sanitizers like it does under libFuzzer
+    uint8_t *data = (uint8_t *) malloc(unit.size() > 0 ? unit.size() : 1);
+    if (!unit.empty()) memcpy(data, unit.data(), unit.size());
+    LLVMFuzzerTestOneInput(data, unit.size());
+    free(data);
+    current = NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *slash = strrchr(argv[0], '/');
+    target = slash != NULL ? slash + 1 : argv[0];
+
+    unsigned long runs = FUZZ_DEFAULT_RUNS;
+    size_t max_len = FUZZ_DEFAULT_MAX_LEN;
+    std::vector<FUZZ_UNIT_TYPE> corpus;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = strtoul(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            rng_state = strtoull(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "-max_len=", 9) == 0) {
+            max_len = strtoul(argv[i] + 9, NULL, 10);
+        } else if (argv[i][0] == '-') {
+            // other libFuzzer flags mean nothing here
+            fprintf(stderr, "%s: ignoring %s\n", target, argv[i]);
+        } else {
+            readPath(argv[i], &corpus);
+        }
+    }
+
+    signal(SIGABRT, onCrash);
+    signal(SIGSEGV, onCrash);
+    signal(SIGBUS, onCrash);
+    signal(SIGFPE, onCrash);
+
+    const size_t seeds = corpus.size();
+    for (const FUZZ_UNIT_TYPE &unit : corpus) run(unit);
+    if (corpus.empty()) corpus.push_back(FUZZ_UNIT_TYPE());
+
+    FUZZ_UNIT_TYPE unit;
+    for (unsigned long i = 0; i < runs; i++) {
+        unit = corpus[below(corpus.size())];
+        mutate(&unit, corpus, max_len);
+        run(unit);
+    }
+
+    printf("%s: %zu corpus inputs, %lu mutated runs, no crashes\n", target, seeds, runs);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// BSShell::feed and the dispatch behind it, as telnet input arrives --
+// a few bytes per step().  arguments a command sees have to fit the line,
+// carry no control characters and number at most BS_SHELL_MAX_ARGS; a
+// prompt gets the next line whole
+//
+// input: [bytes per step] keystrokes
+#include "fuzz.h"
+#include "BSShell.h"
+
+class FuzzTerminal : public Stream {
+    public:
+        size_t write(uint8_t c) override { (void) c; return 1; }
+        int available() override { return (int) (size - pos < per_step ? size - pos : per_step); }
+        int read() override { return pos < size ? data[pos++] : -1; }
+
+        const uint8_t *data;
+        size_t size;
+        size_t pos;
+        size_t per_step;
+};
+
+static void checkArg(const char *arg) {
+    const size_t len = strnlen(arg, BS_SHELL_LINE_LEN);
+    FUZZ_CHECK(len < BS_SHELL_LINE_LEN);
+    for (size_t i = 0; i < len; i++) FUZZ_CHECK((unsigned char) arg[i] >= ' ' || arg[i] == '\t');
+}
+
+static BSShell* shell(FuzzTerminal *terminal) {
+    static BSShell *sh = NULL;
+    if (sh != NULL) return sh;
+
+    sh = new BSShell();
+    sh->begin(terminal);
+
+    BSShellCommand echo = [](int argc, char **argv)
+        {
+            FUZZ_CHECK(argc >= 1 && argc <= BS_SHELL_MAX_ARGS);
+            for (int i = 0; i < argc; i++) checkArg(argv[i]);
+        };
+    sh->addCommand("e", "echo", echo);
+    sh->addCommand("echo", "echo", echo);
+    sh->addCommand("?", "help", [](int argc, char **argv) { (void) argc; (void) argv; sh->printHelp(); });
+    // a prompt that asks again while the answer starts with 'a'
+    sh->addCommand("ask", "prompt", [](int argc, char **argv)
+        {
+            (void) argc;
+            (void) argv;
+            static BSShellPrompt answer = [](const char *line)
+                {
+                    checkArg(line);
+                    if (line[0] == 'a') sh->prompt("again? ", answer);
+                };
+            sh->prompt("answer? ", answer);
+        });
+
+    return sh;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static FuzzTerminal terminal;
+    FUZZ_INPUT_TYPE in = { data, size };
+
+    terminal.per_step = 1 + fuzz_byte(&in) % 32;
+    terminal.data = in.data;
+    terminal.size = in.size;
+    terminal.pos = 0;
+
+    BSShell *sh = shell(&terminal);
+    while (terminal.pos < terminal.size) sh->step();
+
+    // whatever is half typed or still prompting goes with the session
+    sh->feed('\n');
+    sh->dispatch();
+    sh->cancelPrompt();
+
+    return 0;
+}
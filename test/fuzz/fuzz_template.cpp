@@ -0,0 +1,125 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// BSTemplate::render -- the template arrives in reads of a size the input
+// picks, so tokens get cut at every possible place, and the output has to
+// match a one-pass render of the whole text.  a writer that fails part way
+// through has to end the render with false
+//
+// input: [read size seed] [bytes before the writer fails, 0 never] template
+#include "fuzz.h"
+#include "BSTemplate.h"
+
+#include <string>
+
+class FuzzStream : public Stream {
+    public:
+        FuzzStream(const uint8_t *data, const size_t size, const uint8_t seed) {
+            this->data = data;
+            this->size = size;
+            this->state = seed;
+        }
+
+        size_t write(uint8_t c) override { (void) c; return 0; }
+        int available() override { return (int) (size - pos); }
+        int read() override { return pos < size ? data[pos++] : -1; }
+
+        // short reads, like a file system handing back what it has
+        size_t readBytes(char *buf, size_t n) override {
+            state = state * 1103515245 + 12345;
+            const size_t want = 1 + (state >> 16) % n;
+            size_t i = 0;
+            while (i < want && pos < size) buf[i++] = (char) data[pos++];
+            return i;
+        }
+
+    private:
+        const uint8_t *data;
+        size_t size;
+        size_t pos = 0;
+        uint32_t state;
+};
+
+class FuzzOutput : public Print {
+    public:
+        FuzzOutput(const size_t fail_after) { this->fail_after = fail_after; }
+
+        size_t write(uint8_t c) override {
+            if (fail_after > 0 && text.size() >= fail_after) return 0;
+            text += (char) c;
+            return 1;
+        }
+
+        std::string text;
+
+    private:
+        size_t fail_after;
+};
+
+static bool isTokenChar(const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static const char* resolve(const char *token) {
+    static const std::string big(300, 'x');
+
+    if (strcmp(token, "empty") == 0) return "";
+    if (strcmp(token, "big") == 0) return big.c_str();
+    // a value is never expanded again
+    if (strcmp(token, "nested") == 0) return "{big}";
+    if (token[0] == 'n') return NULL;
+    return "<v>";
+}
+
+static std::string expected(const uint8_t *data, const size_t size) {
+    std::string out;
+    size_t i = 0;
+
+    while (i < size) {
+        if (data[i] != '{') {
+            out += (char) data[i++];
+            continue;
+        }
+
+        size_t j = i + 1;
+        while (j < size && isTokenChar(data[j]) && j - i - 1 < BS_TEMPLATE_TOKEN_LEN) j++;
+        if (j < size && data[j] == '}' && j > i + 1) {
+            const std::string token((const char *) data + i + 1, j - i - 1);
+            const char *value = resolve(token.c_str());
+            out += value != NULL ? value : "{" + token + "}";
+            i = j + 1;
+        } else {
+            // not a token, what follows is plain text (or the next '{')
+            out.append((const char *) data + i, j - i);
+            i = j;
+        }
+    }
+
+    return out;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    FUZZ_INPUT_TYPE in = { data, size };
+    const uint8_t seed = fuzz_byte(&in);
+    const size_t fail_after = fuzz_byte(&in) * 8;
+
+    FuzzStream stream(in.data, in.size, seed);
+    FuzzOutput output(fail_after);
+    const bool ok = BSTemplate::render(&stream, &output, resolve);
+
+    const std::string want = expected(in.data, in.size);
+    if (fail_after == 0 || want.size() <= fail_after) {
+        FUZZ_CHECK(ok);
+        FUZZ_CHECK(output.text == want);
+    } else {
+        FUZZ_CHECK(!ok);
+        FUZZ_CHECK(output.text.size() <= fail_after);
+        FUZZ_CHECK(want.compare(0, output.text.size(), output.text) == 0);
+    }
+
+    return 0;
+}
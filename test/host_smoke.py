@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+boots the host build of an example the way a new device is brought up
+
+    host_smoke.py <esp_starter> <data dir>
+
+first boot finds a blank eeprom and comes up as an access point; wifi
+credentials go in over POST /api/config and GET /reboot re-executes the
+process, which then finds the scripted network and joins it as a station.
+config, eeprom and littlefs all have to survive the restart
+"""
+import json
+import os
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.error
+import urllib.request
+
+SSID = "hostnet"
+PASSWORD = "hostpass"
+BOOT_TIMEOUT_S = 15
+
+
+def free_offset():
+    # the web server listens on 80 + offset, the captive dns on 53 + offset
+    for _ in range(50):
+        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
+            s.bind(("127.0.0.1", 0))
+            port = s.getsockname()[1]
+        if port > 1024:
+            return port - 80
+    raise RuntimeError("no free port")
+
+
+class Device:
+    def __init__(self, binary, data, home, offset):
+        env = dict(os.environ, BS_HOST_DIR=home, BS_HOST_FS_IMAGE=data, BS_HOST_PORT_OFFSET=str(offset),
+                   BS_HOST_WIFI_SCAN="%s:-48:%s,neighbour:-81" % (SSID, PASSWORD))
+        env.pop("BS_HOST_RESET_REASON", None)
+        self.base = "http://127.0.0.1:%d" % (80 + offset)
+        self.log = []
+        self.proc = subprocess.Popen([binary], env=env, stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, text=True, errors="replace")
+        threading.Thread(target=self.drain, daemon=True).start()
+
+    def drain(self):
+        for line in self.proc.stdout:
+            self.log.append(line.rstrip("\n"))
+
+    def text(self):
+        return "\n".join(self.log)
+
+    def request(self, path, body=None, content_type="application/json", headers=None):
+        req = urllib.request.Request(self.base + path, data=body, method="POST" if body is not None else "GET",
+                                     headers=headers or {})
+        if body is not None:
+            req.add_header("Content-Type", content_type)
+        opener = urllib.request.build_opener(NoRedirect)
+        try:
+            with opener.open(req, timeout=5) as r:
+                return r.status, dict(r.headers), r.read()
+        except urllib.error.HTTPError as e:
+            return e.code, dict(e.headers), e.read()
+
+    def wait_up(self, marker):
+        deadline = time.time() + BOOT_TIMEOUT_S
+        while time.time() < deadline:
+            if self.proc.poll() is not None:
+                raise AssertionError("device exited with %d\n%s" % (self.proc.returncode, self.text()))
+            if marker in self.text():
+                try:
+                    return self.request("/api/config")
+                except OSError:
+                    pass
+            time.sleep(0.1)
+        raise AssertionError("device did not come up (%s)\n%s" % (marker, self.text()))
+
+    def stop(self):
+        if self.proc.poll() is None:
+            self.proc.send_signal(signal.SIGTERM)
+            try:
+                self.proc.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+                self.proc.wait()
+        return self.proc.returncode
+
+
+class NoRedirect(urllib.request.HTTPRedirectHandler):
+    def redirect_request(self, *args):
+        return None
+
+
+def check(cond, what, device):
+    if not cond:
+        raise AssertionError(what + "\n--- device log ---\n" + device.text())
+    print("ok   " + what)
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__.strip())
+        return 2
+
+    with tempfile.TemporaryDirectory(prefix="bs_host_") as home:
+        device = Device(argv[1], argv[2], home, free_offset())
+        try:
+            # first boot -- blank eeprom, access point
+            status, _, body = device.wait_up("System Ready")
+            check(status == 200, "first boot serves /api/config", device)
+            check(json.loads(body)["ssid"] == "", "first boot has no ssid", device)
+            check("SoftAP [" in device.text(), "first boot is an access point", device)
+
+            status, headers, _ = device.request("/")
+            check(status == 301 and headers.get("Location") == "/index.html", "/ redirects to /index.html", device)
+
+            status, headers, body = device.request("/index.html")
+            check(status == 200 and b"<html" in body.lower(), "/index.html is rendered onto littlefs", device)
+            check(headers.get("X-Powered-By") == "ESP-Bootstrap", "routes add their headers", device)
+
+            status, _, body = device.request("/api/config", json.dumps({"ssid": SSID, "ssid_pwd": PASSWORD}).encode())
+            check(status == 202 and json.loads(body).get("status") == "queued", "POST /api/config is queued", device)
+
+            deadline = time.time() + 5
+            while time.time() < deadline and json.loads(device.request("/api/config")[2])["ssid"] != SSID:
+                time.sleep(0.1)
+            check(json.loads(device.request("/api/config")[2])["ssid"] == SSID, "the update is applied by loop()", device)
+            check(os.path.getsize(os.path.join(home, "eeprom.bin")) > 0, "config is committed to eeprom.bin", device)
+
+            # restart -- the same process image, now a station
+            device.log.clear()
+            status, _, _ = device.request("/reboot")
+            check(status == 302, "/reboot answers before restarting", device)
+
+            status, _, body = device.wait_up("System Ready")
+            check("Last Reset Reason: [12]" in device.text(), "restart reports a software reset", device)
+            check(json.loads(body)["ssid"] == SSID, "config survives the restart", device)
+            check("Connected to: " + SSID in device.text(), "second boot joins the scripted network", device)
+
+            status, _, body = device.request("/heap")
+            check(status == 200 and "free" in json.loads(body), "/heap is served in station mode", device)
+            web = json.loads(body)["subsystems"]["web"]
+            # null under the sanitizers, which own malloc
+            check(web.get("allocs", 0) is None or web["allocs"] > 0, "/heap counts web allocations", device)
+            check("heap_delta" in web and web["heap_delta"] is None, "/heap has no web heap delta", device)
+
+            status, _, body = device.request("/api/files?dir=/")
+            check(status == 200 and b"index.html" in body, "littlefs keeps the rendered pages", device)
+
+            status, _, _ = device.request("/no/such/page")
+            check(status == 404, "unknown paths are 404", device)
+
+            # gzip from the bundle or identity from littlefs, either way cached per encoding
+            status, headers, _ = device.request("/favicon.ico", headers={"Accept-Encoding": "gzip"})
+            check(status == 200 and headers.get("Content-Encoding") == "gzip" and headers.get("Vary") == "Accept-Encoding",
+                  "a gzip asset varies on Accept-Encoding", device)
+            status, headers, _ = device.request("/favicon.ico", headers={"Accept-Encoding": "identity"})
+            check(status == 200 and "Content-Encoding" not in headers and headers.get("Vary") == "Accept-Encoding",
+                  "its identity fallback varies too", device)
+
+            # an image without a digest never reaches the update partition
+            boundary = "bs-host-smoke"
+            upload = ("--%s\r\nContent-Disposition: form-data; name=\"firmware\"; filename=\"fw.bin\"\r\n"
+                      "Content-Type: application/octet-stream\r\n\r\n%s\r\n--%s--\r\n" % (boundary, "x" * 256, boundary)).encode()
+            status, _, body = device.request("/ota", upload, "multipart/form-data; boundary=" + boundary)
+            check(status == 400 and b"sha256 required" in body, "/ota refuses an image without a digest", device)
+
+            # every item at its longest, well past what an event carries inline
+            full = {"hostname": "h" * 31, "ssid": "s" * 31, "ssid_pwd": "p" * 63, "ntp_server": "n" * 63,
+                    "tz": "UTC0" + "x" * 43, "station_id": "i" * 99}
+            status, _, body = device.request("/api/config", json.dumps(full).encode())
+            check(status == 202 and json.loads(body).get("items") == len(full), "a full config POST is queued", device)
+
+            deadline = time.time() + 5
+            while time.time() < deadline and json.loads(device.request("/api/config")[2])["tz"] != full["tz"]:
+                time.sleep(0.1)
+            applied = json.loads(device.request("/api/config")[2])
+            check(all(applied[k] == v for k, v in full.items() if k != "ssid_pwd"), "a full config update is applied", device)
+
+            # what tools/bs_load.py submits -- queued and unpacked, never applied
+            with open(os.path.join(home, "eeprom.bin"), "rb") as f:
+                committed = f.read()
+            status, _, _ = device.request("/save?bs_dry_run=1&hostname=dry-run")
+            check(status == 302, "a dry run /save answers like a save", device)
+            deadline = time.time() + 5
+            while time.time() < deadline and "config dry run: [1] items" not in device.text():
+                time.sleep(0.1)
+            check("config dry run: [1] items" in device.text(), "a dry run reaches loop()", device)
+            check(json.loads(device.request("/api/config")[2])["hostname"] == full["hostname"], "a dry run leaves the config alone", device)
+            with open(os.path.join(home, "eeprom.bin"), "rb") as f:
+                check(f.read() == committed, "a dry run commits nothing", device)
+        finally:
+            code = device.stop()
+
+        check(code == 0, "SIGTERM stops the device cleanly", device)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,60 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the idle governor against a sketch with work of its own.  for a second
+// the sketch reports it with busy() every pass and loop() must come
+// straight back; for the next second it says nothing and the governor has
+// to put the loop to sleep again
+#include "Bootstrap.h"
+#include "BSHost.h"
+
+#define BUSY_PHASE_MS                 1000
+// the governor's budget is 250 ms -- a busy loop never waits that long
+#define BUSY_MAX_GAP_US               50000
+
+TelnetSpy SerialAndTelnet;
+Bootstrap bs = Bootstrap("idle busy", &SerialAndTelnet, 1500000);
+
+CONFIG_TYPE config;
+
+static uint64_t started_us = 0;
+static uint64_t last_us = 0;
+static uint32_t max_gap_us = 0;
+static uint32_t busy_passes = 0;
+static uint32_t idle_passes = 0;
+
+void setup() {
+    if (!bs_host_test_setup(&bs, &config, sizeof(config), "busy", BS_HOST_TEST_DATA)) return;
+    bs.setIdleGovernor(true);
+}
+
+void loop() {
+    bs.loop();
+
+    const uint64_t now = bs_micros64();
+    if (started_us == 0) started_us = now;
+    const uint64_t elapsed_ms = (now - started_us) / 1000;
+
+    if (elapsed_ms < BUSY_PHASE_MS) {
+        if (last_us != 0 && now - last_us > max_gap_us) max_gap_us = (uint32_t) (now - last_us);
+        last_us = now;
+        busy_passes++;
+        bs.busy();
+        return;
+    }
+    if (elapsed_ms < 2 * BUSY_PHASE_MS) {
+        idle_passes++;
+        return;
+    }
+
+    // a second of sleeping in steps of at most the budget is a handful of
+    // passes, a second of busy passes is thousands
+    const bool ok = max_gap_us < BUSY_MAX_GAP_US && busy_passes > 1000 && idle_passes < 100;
+    printf("%s: busy [%u] passes, longest gap [%u] us  idle [%u] passes\n", ok ? "ok" : "FAILED", busy_passes, max_gap_us, idle_passes);
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+}
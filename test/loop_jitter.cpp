@@ -0,0 +1,65 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// application loop jitter, with housekeeping inline (loop_jitter) or on
+// its own task (loop_jitter_dual, BS_USE_DUAL_CORE)
+//
+// the sketch does ~200 us of work per pass and records the time between
+// passes while housekeeping re-renders index.html every 100 ms and serves
+// the captive portal.  runs for BS_JITTER_S seconds (10), then prints the
+// period percentiles
+#include "Bootstrap.h"
+#include "BSHost.h"
+
+#include <algorithm>
+#include <vector>
+
+#define JITTER_WORK_US                200
+#define JITTER_RENDER_MS              100
+
+TelnetSpy SerialAndTelnet;
+Bootstrap bs = Bootstrap("loop jitter", &SerialAndTelnet, 1500000);
+
+CONFIG_TYPE config;
+
+static std::vector<uint32_t> periods;
+static uint64_t started_us = 0;
+static uint64_t last_us = 0;
+static uint64_t run_us = 0;
+
+void setup() {
+    if (!bs_host_test_setup(&bs, &config, sizeof(config), "jitter", BS_HOST_TEST_DATA)) return;
+    bs.scheduleEvery(JITTER_RENDER_MS, []() { bs.updateIndexHtml(); });
+
+    periods.reserve(200000);
+    run_us = bs_host_env("BS_JITTER_S", 10) * 1000000ULL;
+    started_us = bs_micros64();
+}
+
+void loop() {
+    bs.loop();
+
+    const uint64_t now = bs_micros64();
+    if (last_us != 0) periods.push_back((uint32_t) (now - last_us));
+    last_us = now;
+
+    // the latency sensitive part of the application
+    while (bs_micros64() - now < JITTER_WORK_US) {}
+
+    if (now - started_us < run_us) return;
+
+    std::sort(periods.begin(), periods.end());
+    const size_t n = periods.size();
+    printf("\n%s: %zu passes  period p50 %u us  p99 %u us  p99.9 %u us  max %u us\n",
+        #ifdef BS_USE_DUAL_CORE
+            "dual core",
+        #else
+            "single core",
+        #endif
+        n, periods[n / 2], periods[n * 99 / 100], periods[n * 999 / 1000], periods[n - 1]);
+    bs_host_stop();
+}
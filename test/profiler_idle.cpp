@@ -0,0 +1,64 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// iterations that sleep in the idle governor between passes, the way
+// Bootstrap::idle() reports it -- the sleep must not count against the
+// budget nor be charged to the app step
+#include "BSProfiler.h"
+
+#include <string>
+
+#define PROF_ITERATIONS               5
+#define PROF_WORK_US                  500
+// far apart, so a preempted pass on a loaded machine stays inside the
+// budget while a single sleep does not
+#define PROF_SLEEP_MS                 200
+#define PROF_BUDGET_US                100000
+
+class ProfileOutput : public Print {
+    public:
+        size_t write(uint8_t c) override {
+            text += (char) c;
+            return 1;
+        }
+
+        std::string text;
+};
+
+static void work(const uint32_t us) {
+    const uint32_t started = micros();
+    while ((uint32_t) micros() - started < us) {}
+}
+
+int main() {
+    static BSProfiler profiler;
+    profiler.setBudget(PROF_BUDGET_US);
+
+    for (int i = 0; i < PROF_ITERATIONS; i++) {
+        profiler.begin();
+        work(PROF_WORK_US);
+        profiler.end();
+
+        const uint32_t started = micros();
+        delay(PROF_SLEEP_MS);
+        profiler.idled((uint32_t) micros() - started);
+    }
+    profiler.begin();
+
+    ProfileOutput out;
+    profiler.printJson(&out);
+
+    unsigned int iterations = 0, overruns = 0, app_count = 0, app_avg_us = 0, app_max_us = 0;
+    sscanf(out.text.c_str(), "{\"iterations\":%u,\"max_us\":%*u,\"budget_us\":%*u,\"overruns\":%u", &iterations, &overruns);
+    // no app step at all when nothing was left after the sleep
+    const size_t app = out.text.find("\"app\":");
+    if (app != std::string::npos) sscanf(out.text.c_str() + app, "\"app\":{\"count\":%u,\"avg_us\":%u,\"max_us\":%u", &app_count, &app_avg_us, &app_max_us);
+
+    const bool ok = iterations == PROF_ITERATIONS && overruns == 0 && app_max_us < PROF_BUDGET_US;
+    printf("%s: %s\n", ok ? "ok" : "FAILED", out.text.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// BSQueue under contention -- N producer threads push numbered items into a
+// small queue, retrying when it is full, while one consumer pops.  every
+// item has to arrive exactly once and each producer's items in the order
+// they were pushed
+#include "BSEventQueue.h"
+
+#include <thread>
+#include <vector>
+
+#define STRESS_PRODUCERS              6
+#define STRESS_ITEMS                  200000
+
+typedef struct stress_item_type {
+    uint32_t producer;
+    uint32_t seq;
+    uint32_t check;
+} STRESS_ITEM_TYPE;
+
+static int failures = 0;
+
+#define EXPECT(cond, ...) { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }
+
+template <unsigned short N>
+static void stress(const uint32_t producers, const uint32_t items) {
+    BSQueue<STRESS_ITEM_TYPE, N> queue;
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> next(producers, 0);
+    uint32_t full = 0;
+
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.push_back(std::thread([&queue, p, items]() {
+            for (uint32_t i = 0; i < items; i++) {
+                const STRESS_ITEM_TYPE item = { p, i, p * 2654435761u ^ i };
+                while (!queue.push(item)) yield();
+            }
+        }));
+    }
+
+    const uint64_t total = (uint64_t) producers * items;
+    uint64_t received = 0;
+    STRESS_ITEM_TYPE item;
+    while (received < total) {
+        if (!queue.pop(&item)) {
+            full++;
+            yield();
+            continue;
+        }
+        received++;
+
+        if (item.producer >= producers) {
+            EXPECT(false, "queue %u: bad producer %u", N, item.producer);
+            break;
+        }
+        EXPECT(item.check == (item.producer * 2654435761u ^ item.seq), "queue %u: torn item from producer %u seq %u", N, item.producer, item.seq);
+        EXPECT(item.seq == next[item.producer], "queue %u: producer %u sent %u, expected %u", N, item.producer, item.seq, next[item.producer]);
+        next[item.producer] = item.seq + 1;
+    }
+
+    for (std::thread &t : threads) t.join();
+
+    for (uint32_t p = 0; p < producers; p++) {
+        EXPECT(next[p] == items, "queue %u: producer %u delivered %u of %u", N, p, next[p], items);
+    }
+    EXPECT(queue.empty(), "queue %u: items left over", N);
+    EXPECT(!queue.pop(&item), "queue %u: pop after drain", N);
+
+    printf("queue %-3u %u producers x %u items, %u empty polls, %u full pushes\n", N, producers, items, full, queue.dropped());
+}
+
+// the capacity is exact and a full queue only counts the drops
+static void bounds() {
+    BSQueue<STRESS_ITEM_TYPE, 8> queue;
+    STRESS_ITEM_TYPE item = { 0, 0, 0 };
+
+    for (uint32_t i = 0; i < 8; i++) {
+        item.seq = i;
+        EXPECT(queue.push(item), "push %u into a queue of 8", i);
+    }
+    EXPECT(!queue.push(item), "a ninth push is refused");
+    EXPECT(queue.dropped() == 1, "the refusal is counted (%u)", queue.dropped());
+
+    for (uint32_t i = 0; i < 8; i++) {
+        EXPECT(queue.pop(&item) && item.seq == i, "pop %u in order", i);
+    }
+    EXPECT(queue.empty() && !queue.pop(&item), "drained");
+}
+
+int main() {
+    bounds();
+    stress<2>(STRESS_PRODUCERS, STRESS_ITEMS / 4);
+    stress<BS_EVENT_QUEUE_LEN>(STRESS_PRODUCERS, STRESS_ITEMS);
+    stress<64>(STRESS_PRODUCERS, STRESS_ITEMS);
+
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the BSSampleBatch clock across deep sleeps that add up to more than the
+// 49.7 days a 32 bit millisecond count holds -- the clock has to keep
+// counting and the samples keep their times
+#include "BSSampleBatch.h"
+
+#define DAY_US                        (86400ULL * 1000000ULL)
+
+static int failures = 0;
+
+#define EXPECT(cond, ...) { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }
+
+int main() {
+    BSSampleBatch batch;
+    batch.begin(1, 0, NULL);
+    batch.restore(false);
+
+    // the host's uptime does not restart on a wake the way a device's does,
+    // so the expected clock adds it up the same way the batch should
+    uint64_t shadow_ms = 0;
+    int32_t value = 0;
+
+    // a wake every ten days, 60 of them
+    for (int wake = 0; wake < 60; wake++) {
+        const uint32_t expected_s = (uint32_t) ((shadow_ms + bs_micros64() / 1000) / 1000);
+        const uint32_t clock_s = batch.clockS();
+        EXPECT(clock_s >= expected_s && clock_s - expected_s <= 1, "wake %d: clock %u s, expected %u s", wake, clock_s, expected_s);
+
+        value++;
+        if (wake % 12 == 0) batch.clear();
+        batch.add(&value);
+
+        shadow_ms += (bs_micros64() + 10 * DAY_US) / 1000;
+        batch.prepareDeepSleep(10 * DAY_US);
+        batch.restore(true);
+    }
+
+    // the twelve samples since the last clear, ten days apart
+    uint32_t previous_s = 0;
+    uint16_t samples = 0;
+    batch.forEach([&](const uint32_t t_s, const int32_t *values)
+        {
+            if (samples > 0) EXPECT(t_s - previous_s >= 10 * 86400 && t_s - previous_s < 10 * 86400 + 86400, "sample %u: %u s after the one before", samples, t_s - previous_s);
+            EXPECT(values[0] == 49 + samples, "sample %u: value %d", samples, values[0]);
+            previous_s = t_s;
+            samples++;
+        });
+    EXPECT(samples == 12, "%u samples, expected 12", samples);
+    EXPECT(batch.clockS() >= 600 * 86400u, "clock %u s after 600 days", batch.clockS());
+
+    printf("%s: clock %u s after 60 wakes\n", failures == 0 ? "ok" : "FAILED", batch.clockS());
+    return failures == 0 ? 0 : 1;
+}
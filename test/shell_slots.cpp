@@ -0,0 +1,39 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the telnet command table once Bootstrap has registered its own -- the
+// application gets every slot of BS_SHELL_APP_COMMANDS and is told when
+// there are none left
+#include "Bootstrap.h"
+
+TelnetSpy SerialAndTelnet;
+// for the life of the process, like a sketch's
+Bootstrap bs = Bootstrap("shell slots", &SerialAndTelnet);
+
+static int failures = 0;
+
+#define EXPECT(cond, ...) { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }
+
+int main() {
+    BSShellCommand nothing = [](int argc, char **argv) { (void) argc; (void) argv; };
+
+    // every slot the reserve promises, and one more without the profiler's P
+    static char names[BS_SHELL_MAX_COMMANDS + 1][4];
+    int added = 0;
+    while (added <= BS_SHELL_MAX_COMMANDS) {
+        snprintf(names[added], sizeof(names[added]), "a%d", added);
+        if (!bs.addRemoteCommand(names[added], "app", nothing)) break;
+        added++;
+    }
+    EXPECT(added >= BS_SHELL_APP_COMMANDS && added <= BS_SHELL_APP_COMMANDS + 1, "[%d] application commands added, [%d] reserved", added, BS_SHELL_APP_COMMANDS);
+
+    // a name already taken is replaced, full or not
+    EXPECT(bs.addRemoteCommand("c", "app", nothing), "replacing a built-in was refused");
+
+    printf("%s: [%d] application commands added, [%d] reserved\n", failures == 0 ? "ok" : "FAILED", added, BS_SHELL_APP_COMMANDS);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+/***************************************************************************
+Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+----------------------------------------------------------------------------
+This work is free. You can redistribute it and/or modify it under the
+terms of the Do What The Fuck You Want To Public License, Version 2,
+as published by Sam Hocevar. See the COPYING file for more details.
+****************************************************************************/
+// the application's watchdog channel, armed through Bootstrap and never
+// refreshed -- the device has to restart and name it as the stall on the
+// next boot.  channels out of range are ignored (the sanitizers see any
+// write past the channel tables)
+#include "Bootstrap.h"
+#include "BSHost.h"
+
+#define APP_CHECKPOINT                42
+// a 1 s channel trips within two ticks
+#define APP_STALL_WAIT_MS             5000
+
+TelnetSpy SerialAndTelnet;
+Bootstrap bs = Bootstrap("watchdog app", &SerialAndTelnet, 1500000);
+
+CONFIG_TYPE config;
+
+static unsigned long armed_ms = 0;
+
+void setup() {
+    if (!bs_host_test_setup(&bs, &config, sizeof(config), "wdt", BS_HOST_TEST_DATA)) return;
+
+    // the restart -- reported with the channel and checkpoint it stalled at
+    BS_WDT_STALL_TYPE stall;
+    if (BSWatchdog::lastStall(&stall)) {
+        const bool ok = stall.channel == BS_WDT_CHANNEL_APP && stall.checkpoint == APP_CHECKPOINT;
+        printf("%s: stall on [%s] checkpoint [%u]\n", ok ? "ok" : "FAILED", BSWatchdog::channelName(stall.channel), stall.checkpoint);
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+
+    bs.watchDogRefresh(BS_WDT_MAX_CHANNELS);
+    bs.watchDogCheckpoint(BS_WDT_MAX_CHANNELS + 1, APP_CHECKPOINT);
+    bs.watchDogArm(255);
+    bs.watchDogIdle(BS_WDT_MAX_CHANNELS);
+
+    BSWatchdog::setChannel(BS_WDT_CHANNEL_APP, "app", 1);
+    bs.watchDogArm(BS_WDT_CHANNEL_APP, APP_CHECKPOINT);
+    armed_ms = millis();
+}
+
+void loop() {
+    bs.loop();
+
+    if (armed_ms == 0 || millis() - armed_ms < APP_STALL_WAIT_MS) return;
+    printf("FAILED: the app channel never tripped\n");
+    fflush(stdout);
+    _exit(1);
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+run and compare ESP-Bootstrap on-device micro-benchmarks
+
+    bs_bench.py run     <device> out.json
+    bs_bench.py compare base.json new.json [threshold %]
+
+run starts the suite (POST /bench), waits for it and saves the results.
+compare prints both side by side and exits 1 when any case got slower (or
+retains more heap per op) by more than threshold percent (default 10), or
+allocates more often per op where both runs count allocations (the host
+build).  only compare runs from the same platform and cpu frequency
+"""
+import json
+import sys
+import time
+import urllib.error
+import urllib.request
+
+POLL_S = 1
+TIMEOUT_S = 120
+DEFAULT_THRESHOLD = 10.0
+
+
+def run(device, out):
+    base = device if device.startswith("http") else "http://" + device
+    try:
+        urllib.request.urlopen(urllib.request.Request(base + "/bench", data=b"", method="POST"), timeout=10).close()
+    except urllib.error.HTTPError as e:
+        # 409 while a run is already queued
+        if e.code != 409:
+            raise
+        raise SystemExit("%s: benchmarks already running" % device)
+
+    deadline = time.time() + TIMEOUT_S
+    while time.time() < deadline:
+        time.sleep(POLL_S)
+        try:
+            with urllib.request.urlopen(base + "/bench", timeout=10) as r:
+                results = json.load(r)
+                break
+        except urllib.error.HTTPError as e:
+            # 503 while the suite is running
+            if e.code != 503:
+                raise
+    else:
+        raise SystemExit("%s: benchmarks did not finish in %d s" % (device, TIMEOUT_S))
+
+    with open(out, "w") as f:
+        json.dump(results, f, indent=2)
+
+    for r in results["results"]:
+        print("%-24s %10d ns/op %10.3f B/op %10s allocs/op" % (r["name"], r["ns_per_op"], r["heap_bytes_per_op"], allocs(r)))
+    print("%s: %d cases" % (out, len(results["results"])))
+
+
+def allocs(r):
+    # null where the platform keeps no count
+    a = r.get("allocs_per_op")
+    return "-" if a is None else "%.3f" % a
+
+
+def compare(base, new, threshold):
+    if (base["platform"], base["cpu_mhz"]) != (new["platform"], new["cpu_mhz"]):
+        print("warning: %s @ %d MHz vs %s @ %d MHz" % (base["platform"], base["cpu_mhz"], new["platform"], new["cpu_mhz"]))
+
+    old = {r["name"]: r for r in base["results"]}
+    regressions = 0
+
+    print("%-24s %10s %10s %8s %10s %10s %11s %11s" % ("benchmark", "base ns", "new ns", "delta", "base B", "new B", "base allocs", "new allocs"))
+    for r in new["results"]:
+        b = old.get(r["name"])
+        if b is None:
+            print("%-24s %10s %10d %8s" % (r["name"], "-", r["ns_per_op"], "new"))
+            continue
+
+        delta = 100.0 * (r["ns_per_op"] - b["ns_per_op"]) / max(b["ns_per_op"], 1)
+        # heap retained per op only matters when it goes from none to some
+        leaks = r["heap_bytes_per_op"] > max(b["heap_bytes_per_op"], 0) * (1 + threshold / 100.0) + 0.5
+        churns = b.get("allocs_per_op") is not None and r.get("allocs_per_op") is not None \
+            and r["allocs_per_op"] > b["allocs_per_op"] + 0.0005
+        flag = ""
+        if delta > threshold or leaks or churns:
+            regressions += 1
+            flag = "  <-- regression"
+
+        print("%-24s %10d %10d %+7.1f%% %10.3f %10.3f %11s %11s%s"
+              % (r["name"], b["ns_per_op"], r["ns_per_op"], delta, b["heap_bytes_per_op"], r["heap_bytes_per_op"], allocs(b), allocs(r), flag))
+
+    print("%d regression(s) over %.1f%%" % (regressions, threshold))
+    return 1 if regressions else 0
+
+
+def main(argv):
+    if len(argv) == 4 and argv[1] == "run":
+        run(argv[2], argv[3])
+        return 0
+
+    if len(argv) in (4, 5) and argv[1] == "compare":
+        with open(argv[2]) as f:
+            base = json.load(f)
+        with open(argv[3]) as f:
+            new = json.load(f)
+        return compare(base, new, float(argv[4]) if len(argv) == 5 else DEFAULT_THRESHOLD)
+
+    print(__doc__.strip())
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+build (and check) ESP-Bootstrap delta patches
+
+    bs_delta.py diff  old.bin new.bin out.patch
+    bs_delta.py apply old.bin in.patch out.bin
+
+old.bin must be the exact image running on the device -- the patch carries
+its md5 and the device refuses anything else.  push the patch with
+
+    curl -F "patch=@out.patch" http://<device>/ota/delta
+"""
+import hashlib
+import struct
+import sys
+
+MAGIC = b"BSDP"
+VERSION = 1
+
+OP_END = 0
+OP_COPY = 1
+OP_ADD = 2
+
+# match granularity -- old image offsets are indexed every ALIGN bytes.  a
+# copy op costs 9 bytes so a BLOCK long match always pays for itself
+BLOCK = 32
+ALIGN = 4
+
+
+def diff(old, new):
+    index = {}
+    for off in range(0, len(old) - BLOCK + 1, ALIGN):
+        index.setdefault(old[off:off + BLOCK], off)
+
+    ops = []
+    literal_start = 0
+    shift = 0
+    i = 0
+
+    while i <= len(new) - BLOCK:
+        block = new[i:i + BLOCK]
+
+        # most of a rebuild lines up with the previous match, try that first
+        off = i + shift
+        if not (0 <= off <= len(old) - BLOCK and old[off:off + BLOCK] == block):
+            off = index.get(block)
+            if off is None:
+                i += 1
+                continue
+
+        n = BLOCK
+        while i + n < len(new) and off + n < len(old) and new[i + n] == old[off + n]:
+            n += 1
+
+        back = 0
+        while i - back > literal_start and off - back > 0 and new[i - back - 1] == old[off - back - 1]:
+            back += 1
+        i -= back
+        off -= back
+        n += back
+
+        if i > literal_start:
+            ops.append((OP_ADD, new[literal_start:i]))
+        ops.append((OP_COPY, off, n))
+
+        shift = off - i
+        i += n
+        literal_start = i
+
+    if literal_start < len(new):
+        ops.append((OP_ADD, new[literal_start:]))
+
+    return ops
+
+
+def encode(old, new, ops):
+    out = bytearray(MAGIC)
+    out += struct.pack("<B3x", VERSION)
+    out += hashlib.md5(old).digest()
+    out += struct.pack("<I", len(new))
+    out += hashlib.sha256(new).digest()
+
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        else:
+            out += struct.pack("<BI", OP_ADD, len(op[1]))
+            out += op[1]
+
+    out += struct.pack("<B", OP_END)
+    return bytes(out)
+
+
+def apply(old, patch):
+    if patch[:4] != MAGIC or patch[4] != VERSION:
+        raise ValueError("not a version %d delta patch" % VERSION)
+    if patch[8:24] != hashlib.md5(old).digest():
+        raise ValueError("patch was built against a different base image")
+
+    size, = struct.unpack_from("<I", patch, 24)
+    digest = patch[28:60]
+
+    new = bytearray()
+    pos = 60
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            off, n = struct.unpack_from("<II", patch, pos)
+            pos += 8
+            new += old[off:off + n]
+        elif op == OP_ADD:
+            n, = struct.unpack_from("<I", patch, pos)
+            pos += 4
+            new += patch[pos:pos + n]
+            pos += n
+        else:
+            raise ValueError("unknown op %d at %d" % (op, pos - 1))
+
+    if len(new) != size or hashlib.sha256(new).digest() != digest:
+        raise ValueError("rebuilt image does not match")
+    return bytes(new)
+
+
+def main(argv):
+    if len(argv) != 5 or argv[1] not in ("diff", "apply"):
+        print(__doc__.strip())
+        return 2
+
+    with open(argv[2], "rb") as f:
+        old = f.read()
+    with open(argv[3], "rb") as f:
+        second = f.read()
+
+    if argv[1] == "diff":
+        ops = diff(old, second)
+        patch = encode(old, second, ops)
+        # never ship something the device would reject
+        apply(old, patch)
+        with open(argv[4], "wb") as f:
+            f.write(patch)
+
+        copied = sum(op[2] for op in ops if op[0] == OP_COPY)
+        print("%s: %d bytes (%.1f%% of %d), %d ops, %d bytes copied from base"
+              % (argv[4], len(patch), 100.0 * len(patch) / max(len(second), 1), len(second), len(ops), copied))
+    else:
+        with open(argv[4], "wb") as f:
+            f.write(apply(old, second))
+        print("%s: rebuilt" % argv[4])
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+load test the ESP-Bootstrap web and captive portal surface
+
+    bs_load.py run <host[:port]> [scenario] [concurrency] [seconds] [out.json]
+
+scenarios (default mixed):
+
+    portal   captive portal probe storm -- what a crowd of phones does
+    browse   index, setup and favicon views
+    save     setup submissions
+    mixed    all of the above, weighted like a busy portal
+
+every request opens its own connection, the way portal probes do.  the
+device's /heap low water window is reset before the run and read after it,
+and /heap is sampled once a second in between.  /save is a dry run
+(bs_dry_run): it is validated, packed and queued, and loop() unpacks it
+into a copy of the config -- nothing is applied and flash is not written,
+so neither the app's config callback nor the commit is part of the load
+
+to try it without a device, run the host build of the example (the top
+level CMakeLists.txt) -- the same firmware, serving :80 on localhost:8080
+
+    cmake -S . -B build && cmake --build build
+    BS_HOST_FS_IMAGE=examples/ESP-Starter/data build/esp_starter &
+    bs_load.py run localhost:8080 mixed
+"""
+import http.client
+import json
+import random
+import sys
+import threading
+import time
+
+TIMEOUT_S = 10
+HEAP_POLL_S = 1
+
+SCENARIOS = {
+    "portal": [("GET", "/generate_204", 1, 200), ("GET", "/hotspot-detect.html", 1, 200),
+               ("GET", "/library/test/success.html", 1, 200)],
+    "browse": [("GET", "/index.html", 2, 200), ("GET", "/setup", 1, 200),
+               ("GET", "/favicon-32x32.png", 2, 200), ("GET", "/favicon.ico", 1, 200)],
+    "save":   [("GET", "/save?bs_dry_run=1&hostname=bs-load&tz=UTC0", 1, 302)],
+}
+SCENARIOS["mixed"] = [(m, p, w * 4 if p in ("/generate_204", "/hotspot-detect.html") else w, s)
+                      for name in ("portal", "browse", "save") for m, p, w, s in SCENARIOS[name]]
+
+
+def split_host(target):
+    host, _, port = target.partition(":")
+    return host, int(port) if port else 80
+
+
+def fetch(host, port, method, path):
+    conn = http.client.HTTPConnection(host, port, timeout=TIMEOUT_S)
+    try:
+        conn.request(method, path, headers={"Connection": "close"})
+        r = conn.getresponse()
+        r.read()
+        return r.status
+    finally:
+        conn.close()
+
+
+def heap(host, port, reset=False):
+    conn = http.client.HTTPConnection(host, port, timeout=TIMEOUT_S)
+    try:
+        conn.request("GET", "/heap?reset" if reset else "/heap")
+        r = conn.getresponse()
+        return json.loads(r.read()) if r.status == 200 else None
+    except (OSError, ValueError):
+        return None
+    finally:
+        conn.close()
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(len(values) * p / 100.0))]
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latency = {}
+        self.statuses = {}
+        self.errors = {}
+
+    def add(self, path, ms, status, ok):
+        with self.lock:
+            self.latency.setdefault(path, []).append(ms)
+            key = (path, status)
+            self.statuses[key] = self.statuses.get(key, 0) + 1
+            if not ok:
+                self.errors[path] = self.errors.get(path, 0) + 1
+
+
+def worker(host, port, mix, deadline, stats, seed):
+    rng = random.Random(seed)
+    weights = [w for _, _, w, _ in mix]
+    while time.time() < deadline:
+        method, path, _, expected = rng.choices(mix, weights)[0]
+        started = time.perf_counter()
+        try:
+            status = fetch(host, port, method, path)
+        except OSError as e:
+            status = type(e).__name__
+        ms = (time.perf_counter() - started) * 1000.0
+        stats.add(path, ms, status, status == expected)
+
+
+def run(target, scenario, concurrency, seconds, out):
+    host, port = split_host(target)
+    mix = SCENARIOS[scenario]
+
+    before = heap(host, port, reset=True)
+    samples = []
+    stats = Stats()
+    deadline = time.time() + seconds
+
+    threads = [threading.Thread(target=worker, args=(host, port, mix, deadline, stats, i)) for i in range(concurrency)]
+    for t in threads:
+        t.start()
+    while any(t.is_alive() for t in threads):
+        time.sleep(HEAP_POLL_S)
+        h = heap(host, port)
+        if h:
+            samples.append(h["free"])
+    for t in threads:
+        t.join()
+
+    # give the device a moment to release what the last responses held
+    time.sleep(HEAP_POLL_S)
+    after = heap(host, port)
+
+    total = sum(len(v) for v in stats.latency.values())
+    errors = sum(stats.errors.values())
+    report = {"target": target, "scenario": scenario, "concurrency": concurrency, "seconds": seconds,
+              "requests": total, "rps": total / float(seconds), "errors": errors, "routes": {}}
+
+    width = max([28] + [len(p) for p in stats.latency])
+    print("%-*s %7s %7s %9s %9s %9s" % (width, "route", "reqs", "errors", "p50 ms", "p99 ms", "p999 ms"))
+    for path in sorted(stats.latency):
+        v = sorted(stats.latency[path])
+        route = {"requests": len(v), "errors": stats.errors.get(path, 0),
+                 "p50_ms": percentile(v, 50), "p99_ms": percentile(v, 99), "p999_ms": percentile(v, 99.9),
+                 "statuses": {str(s): n for (p, s), n in stats.statuses.items() if p == path}}
+        report["routes"][path] = route
+        print("%-*s %7d %7d %9.1f %9.1f %9.1f" % (width, path, len(v), route["errors"], route["p50_ms"], route["p99_ms"], route["p999_ms"]))
+
+    print("\n%d requests in %d s (%.1f/s) with %d concurrent, %d errors (%.2f%%)"
+          % (total, seconds, report["rps"], concurrency, errors, 100.0 * errors / max(total, 1)))
+
+    if before and after:
+        # the web counters run from boot, the run is the difference
+        web_before, web_after = before["subsystems"]["web"], after["subsystems"]["web"]
+        calls = web_after["calls"] - web_before["calls"]
+        allocs = None if web_after["allocs"] is None else web_after["allocs"] - web_before["allocs"]
+        report["heap"] = {"free_before": before["free"], "free_after": after["free"], "low_water": after["low_water"],
+                          "min_sampled": min(samples) if samples else None,
+                          "web": {"calls": calls, "allocs": allocs}}
+        print("heap: [%d] B before  [%d] B after  low water [%d] B  web [%d] calls, %s allocs per call"
+              % (before["free"], after["free"], after["low_water"], calls,
+                 "-" if allocs is None else "%.1f" % (allocs / float(max(calls, 1)))))
+    else:
+        print("heap: /heap not available")
+
+    if out:
+        with open(out, "w") as f:
+            json.dump(report, f, indent=2)
+    return 1 if errors else 0
+
+
+def main(argv):
+    if len(argv) >= 3 and argv[1] == "run" and (len(argv) < 4 or argv[3] in SCENARIOS):
+        return run(argv[2], argv[3] if len(argv) > 3 else "mixed", int(argv[4]) if len(argv) > 4 else 8,
+                   int(argv[5]) if len(argv) > 5 else 30, argv[6] if len(argv) > 6 else None)
+
+    print(__doc__.strip())
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
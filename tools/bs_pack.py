@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+pack a data/ directory into a flash resident ESP-Bootstrap asset bundle
+
+    bs_pack.py <data dir> <out.h>
+
+or, from platformio.ini, as a pre build script that packs the project's
+data/ into include/bs_assets.h:
+
+    extra_scripts = pre:path/to/bs_pack.py
+
+the header holds one PROGMEM array per file (gzipped when that saves at
+least 10%) and an index sorted by path for BSAssets::find().  mutable
+files stay on littlefs and are left out: templates (foo.template.html)
+and the pages rendered from them (foo.html)
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+HEADER = "bs_assets.h"
+MIN_SAVING = 0.9
+PER_LINE = 20
+
+MIME = {
+    ".html": "text/html", ".htm": "text/html", ".css": "text/css", ".js": "application/javascript",
+    ".json": "application/json", ".webmanifest": "application/manifest+json", ".xml": "text/xml",
+    ".txt": "text/plain", ".svg": "image/svg+xml", ".png": "image/png", ".jpg": "image/jpeg",
+    ".jpeg": "image/jpeg", ".gif": "image/gif", ".ico": "image/x-icon", ".woff2": "font/woff2",
+}
+
+
+def mutable(name, names):
+    if name.endswith(".template.html"):
+        return True
+    stem, ext = os.path.splitext(name)
+    return stem + ".template" + ext in names
+
+
+def collect(data_dir):
+    assets = []
+    for root, _, files in os.walk(data_dir):
+        names = set(files)
+        for name in files:
+            if name.startswith(".") or mutable(name, names):
+                continue
+            path = os.path.join(root, name)
+            url = "/" + os.path.relpath(path, data_dir).replace(os.sep, "/")
+            with open(path, "rb") as f:
+                raw = f.read()
+            assets.append((url, raw))
+    # the device binary searches with strcmp
+    return sorted(assets, key=lambda a: a[0].encode())
+
+
+def pack(data_dir, out):
+    lines = ["// generated by bs_pack.py from %s -- do not edit" % os.path.basename(os.path.normpath(data_dir)),
+             "#ifndef BS_ASSETS_DATA_H", "#define BS_ASSETS_DATA_H", "", '#include "BSAssets.h"', ""]
+    index = []
+    total_raw = total_packed = 0
+
+    for i, (url, raw) in enumerate(collect(data_dir)):
+        packed = gzip.compress(raw, 9, mtime=0)
+        gzipped = len(packed) < len(raw) * MIN_SAVING
+        body = packed if gzipped else raw
+
+        lines.append("static const uint8_t bs_asset_%d[] PROGMEM = {" % i)
+        for off in range(0, len(body), PER_LINE):
+            lines.append("    " + ",".join("0x%02x" % b for b in body[off:off + PER_LINE]) + ",")
+        lines.append("};")
+
+        mime = MIME.get(os.path.splitext(url)[1].lower(), "application/octet-stream")
+        etag = hashlib.md5(raw).hexdigest()[:16]
+        index.append('    { "%s", bs_asset_%d, %d, "%s", "\\"%s\\"", %s },'
+                     % (url, i, len(body), mime, etag, "true" if gzipped else "false"))
+
+        total_raw += len(raw)
+        total_packed += len(body)
+
+    lines += ["", "static const BS_ASSET_TYPE bs_assets[] = {"] + index + ["};",
+              "#define BS_ASSET_COUNT %d" % len(index), "#endif", ""]
+
+    text = "\n".join(lines)
+    # leave the header (and so the build) alone when nothing changed
+    if os.path.exists(out):
+        with open(out) as f:
+            if f.read() == text:
+                return len(index), total_raw, total_packed
+    with open(out, "w") as f:
+        f.write(text)
+
+    return len(index), total_raw, total_packed
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__.strip())
+        return 2
+
+    count, raw, packed = pack(argv[1], argv[2])
+    print("%s: %d assets, %d bytes packed from %d" % (argv[2], count, packed, raw))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
+elif __name__ == "SCons.Script":
+    Import("env")  # noqa: F821 -- provided by platformio
+    project = env.subst("$PROJECT_DIR")  # noqa: F821
+    count, raw, packed = pack(os.path.join(project, "data"), os.path.join(project, "include", HEADER))
+    print("bs_pack: %d assets, %d bytes packed from %d" % (count, packed, raw))
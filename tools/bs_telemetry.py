@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# ***************************************************************************
+# Copyright © 2023 Shell M. Shrader <shell at shellware dot com>
+# ---------------------------------------------------------------------------
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+# ***************************************************************************
+"""
+local stand-in for an ESP-Bootstrap telemetry endpoint
+
+    bs_telemetry.py sink [port] [fail_every] [fail_status] [out.ndjson]
+
+accepts the newline delimited batches BSTelemetry POSTs, on any path, and
+prints one line per batch.  every fail_every-th request (0, the default,
+never) is answered with fail_status (default 503) instead, to exercise
+the device's retry and backoff -- a 4xx other than 408 / 429 makes it drop
+the batch instead.  records are appended to out.ndjson when given
+
+records carrying a numeric "seq" are checked as they arrive: a repeat is
+a duplicate (expected after a failed attempt or a reboot, delivery is at
+least once), a jump is a gap (records the device dropped).  ctrl-c prints
+the totals
+
+point the device at it with
+    bs.useTelemetry("http://<this host>:<port>/ingest");
+"""
+import http.server
+import json
+import sys
+import threading
+import time
+
+
+class Sink:
+    def __init__(self, fail_every, fail_status, out):
+        self.fail_every = fail_every
+        self.fail_status = fail_status
+        self.out = out
+        self.lock = threading.Lock()
+        self.requests = self.failed = self.batches = self.records = self.bytes = 0
+        self.duplicates = self.gaps = self.malformed = 0
+        self.seen = set()
+        self.high = None
+
+    def check(self, line):
+        try:
+            seq = json.loads(line).get("seq")
+        except (ValueError, AttributeError):
+            self.malformed += 1
+            return
+        if not isinstance(seq, int):
+            return
+        if seq in self.seen:
+            self.duplicates += 1
+        elif self.high is not None and seq > self.high + 1:
+            self.gaps += seq - self.high - 1
+        self.seen.add(seq)
+        self.high = seq if self.high is None else max(self.high, seq)
+
+    def take(self, body):
+        with self.lock:
+            self.requests += 1
+            if self.fail_every and self.requests % self.fail_every == 0:
+                self.failed += 1
+                return self.fail_status, 0
+
+            lines = [l for l in body.decode("utf-8", "replace").split("\n") if l]
+            for line in lines:
+                self.check(line)
+            if self.out:
+                with open(self.out, "a") as f:
+                    f.write("\n".join(lines) + "\n")
+
+            self.batches += 1
+            self.records += len(lines)
+            self.bytes += len(body)
+            return 200, len(lines)
+
+    def summary(self):
+        return ("requests %d  failed %d  batches %d  records %d  bytes %d  duplicates %d  gaps %d  malformed %d"
+                % (self.requests, self.failed, self.batches, self.records, self.bytes,
+                   self.duplicates, self.gaps, self.malformed))
+
+
+def serve(port, sink):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            status, count = sink.take(body)
+            self.send_response(status)
+            self.send_header("Content-Length", "0")
+            self.send_header("Connection", "close")
+            self.end_headers()
+            print("%s %s %s %d B %d records -> %d" % (time.strftime("%H:%M:%S"), self.client_address[0], self.path,
+                                                     len(body), count, status))
+
+        def log_message(self, *args):
+            pass
+
+    server = http.server.ThreadingHTTPServer(("", port), Handler)
+    print("telemetry sink on :%d%s" % (port, "  failing every %d with %d" % (sink.fail_every, sink.fail_status)
+                                         if sink.fail_every else ""))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print("\n" + sink.summary())
+
+
+def main(argv):
+    if len(argv) < 2 or argv[1] != "sink":
+        print(__doc__.strip())
+        return 2
+
+    port = int(argv[2]) if len(argv) > 2 else 8080
+    fail_every = int(argv[3]) if len(argv) > 3 else 0
+    fail_status = int(argv[4]) if len(argv) > 4 else 503
+    out = argv[5] if len(argv) > 5 else None
+
+    serve(port, Sink(fail_every, fail_status, out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))